@@ -48,6 +48,9 @@ class Node;
 class JAM_API Action : public NamedTaggedObject
 {
 public:
+	// actions are created and released at high rates, they are allocated from pools
+	JAM_DECLARE_OBJECT_ALLOCATOR()
+
 #ifdef JAM_DEBUG
 	// store the total number of allocated nodes
 	static int32_t			m_totCount ;
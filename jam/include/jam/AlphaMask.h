@@ -0,0 +1,109 @@
+/**********************************************************************************
+* 
+* AlphaMask.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+#ifndef __JAM_ALPHAMASK_H__
+#define __JAM_ALPHAMASK_H__
+
+#include <jam/jam.h>
+#include <jam/RefCountedObject.h>
+#include <jam/core/geom.h>
+
+#include <vector>
+
+namespace jam
+{
+
+class Texture2D ;
+class Rect ;
+
+/*!
+	\class AlphaMask
+
+	Packed 1-bit mask of the opaque pixels of a texture portion, used by pixel perfect collisions.
+
+	Rows are stored top to bottom as they are displayed, each one padded to a whole number of
+	64-bit words: column x is bit (x & 63) of word (x >> 6). The bounds of the opaque pixels are
+	kept too, so that an intersection only walks the region where both masks may have bits set.
+*/
+class JAM_API AlphaMask : public RefCountedObject
+{
+public:
+	/**
+		Builds the mask of the given texture portion from its client copy of the pixels: a pixel
+		is opaque if its alpha is greater than alphaThreshold, textures without alpha are opaque.
+		Returns null if the texture has no client data
+	*/
+	static AlphaMask*		create( const Texture2D* pTexture, const Rect& rect, U8 alphaThreshold = 0 ) ;
+
+	U32						getWidth() const { return m_width ; }
+	U32						getHeight() const { return m_height ; }
+	U32						getWordsPerRow() const { return m_wordsPerRow ; }
+	const U64*				getRow( U32 y ) const { return &m_bits[y * m_wordsPerRow] ; }
+
+	/// Returns true if the mask has no opaque pixel
+	bool					isEmpty() const { return m_maxX < m_minX ; }
+
+	/// Returns whether the pixel is opaque, pixels outside the mask are transparent
+	bool					test( I32 x, I32 y ) const ;
+
+	/// Returns 64 pixels of row y starting at column x (in bit 0), columns outside the mask read as transparent
+	U64						fetch( U32 y, I32 x ) const ;
+
+	/**
+		Returns true if an opaque pixel of a overlaps an opaque pixel of b.
+		pixelToWorldA maps the pixel coordinates of a (x right, y down, the pixel centers at +0.5) to the world,
+		pixelToWorldB does the same for b. Pure translations by whole pixels compare 64 pixels at a time,
+		any other transform (rotations, scales) walks the rows of b clipped to the span covered by a
+	*/
+	static bool				intersects( const AlphaMask& a, const Matrix3& pixelToWorldA, const AlphaMask& b, const Matrix3& pixelToWorldB ) ;
+
+	/// Reference implementation of intersects(), testing every opaque pixel of a on its own
+	static bool				intersectsSlow( const AlphaMask& a, const Matrix3& pixelToWorldA, const AlphaMask& b, const Matrix3& pixelToWorldB ) ;
+
+private:
+							AlphaMask( U32 width, U32 height ) ;
+
+	static bool				intersectsTranslated( const AlphaMask& a, const AlphaMask& b, I32 offsetX, I32 offsetY ) ;
+	static bool				intersectsTransformed( const AlphaMask& a, const AlphaMask& b, const Matrix3& bToA ) ;
+
+private:
+	U32						m_width ;
+	U32						m_height ;
+	U32						m_wordsPerRow ;
+	std::vector<U64>		m_bits ;
+
+	// inclusive bounds of the opaque pixels, empty (max < min) if there aren't any
+	I32						m_minX, m_minY, m_maxX, m_maxY ;
+
+							AlphaMask( const AlphaMask& ) = delete ;
+	AlphaMask&				operator=( const AlphaMask& ) = delete ;
+};
+
+}
+
+#endif // __JAM_ALPHAMASK_H__
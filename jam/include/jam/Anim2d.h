@@ -37,9 +37,13 @@
 
 #include <vector>
 
+#define JAM_ANIM2D_MAX_FRAME_SLOTS		1024
+
 namespace jam
 {
 
+class Animation2D ;
+
 /**
 	This class represents a single frame of a 2D animation
 */
@@ -72,15 +76,25 @@ private:
 	bool					m_flipX ;
 	bool					m_flipY ;
 	float					m_partialTime ;
+
+	// animations holding this frame, their cached draw items are invalidated by setDrawItem()
+	std::vector<Animation2D*>	m_owners ;
 };
 
 // *************************************************************************
 
 /**
 	This class represents a 2D animation
+
+	Frame lookup by time is O(1): the animation is split in slots as long as its shortest frame,
+	so every slot overlaps at most two frames and a precomputed table gives the first of them.
+	Animations with zero-length frames, or needing more than JAM_ANIM2D_MAX_FRAME_SLOTS slots,
+	fall back to a binary search on the frames end times.
 */
 class JAM_API Animation2D : public NamedObject
 {
+	friend class AnimFrame2D ;
+
 public:
 	virtual					~Animation2D();
 
@@ -91,7 +105,13 @@ public:
 	AnimFrame2D*			getFrame(int index) const ;
 	size_t					getNumOfFrames() const { return m_frames.size(); } ;
 
-	float					getTotalTime();
+	/// Returns the draw item of the given frame, without going through AnimFrame2D
+	DrawItem*				getFrameItem(int index) const ;
+
+	/// Returns the index of the frame shown at the given time (in [0,getTotalTime()]), or -1 if time is negative
+	int						getFrameIndexAt(float time) const ;
+
+	float					getTotalTime() const ;
 
 	void					setFlipAllX( bool flipX ) ;
 	bool					getFlipAllX() const;
@@ -101,7 +121,7 @@ public:
 
 
 	void					setLoop(bool bLoop) ;
-	bool					isLooping() ;
+	bool					isLooping() const ;
 
 	void					update(const jam::Timer&, int& currentFrameIndex, float speed=1.0f, int lastFrame=0) ;
 
@@ -110,13 +130,33 @@ public:
 private:
 							Animation2D();
 
+	void					buildFrameSlots() ;
+	void					buildFrameItems() const ;
+
 	std::vector<Ref<AnimFrame2D>>	m_frames ;
+
+	// dense copies of the frames data used by the lookup
+	std::vector<float>		m_frameEndTimes ;
+	// built lazily, since a frame draw item can be changed after the frame has been added
+	mutable std::vector<DrawItem*>	m_frameItems ;
+	mutable bool			m_frameItemsDirty ;
+	std::vector<U16>		m_frameSlots ;
+	float					m_invSlotTime ;
+
 	float					m_totalTime ;
 	bool					m_bLoop ;
 	bool*					m_flipAllX;
 	bool*					m_flipAllY;
 };
 
+JAM_INLINE DrawItem* Animation2D::getFrameItem( int index ) const
+{
+	if( m_frameItemsDirty ) {
+		buildFrameItems() ;
+	}
+	return m_frameItems[index] ;
+}
+
 }
 
 #endif // __JAM_ANIM2D_H__
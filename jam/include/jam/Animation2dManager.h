@@ -36,13 +36,47 @@
 #include <jam/Singleton.h>
 #include <jam/Anim2d.h>
 
+#include <vector>
+
 namespace jam
 {
+class ExtAnimator ;
+
+/**
+	Stores the 2D animations by name and advances every animator in a single pass per frame.
 
+	The state of the animators is kept in a dense array, ExtAnimator is just a handle to its slot.
+	When the frame of an animator changes, the new draw item is set directly on the animated drawable.
+*/
 class JAM_API Animation2DManager : public Singleton<Animation2DManager>, public NamedObjectManager<Animation2D>
 {
 	friend class Singleton<Animation2DManager> ;
+	friend class ExtAnimator ;
+
+public:
+	/// Advances all the playing animators, called once per frame by Application
+	void					updateAnimators( jam::time elapsed ) ;
+
+	size_t					getNumOfAnimators() const { return m_animators.size(); }
+
 private:
+	struct AnimatorState {
+		const Animation2D*	pAnimation ;
+		IDrawable2D*		pDrawable ;
+		float				phase ;				// seconds since the beginning of the animation
+		float				speed ;
+		int					frameIndex ;
+		int					completeFrameIndex ;
+		bool				playing ;
+	};
+
+	std::vector<AnimatorState>	m_animators ;
+	std::vector<ExtAnimator*>	m_animatorOwners ;	// parallel to m_animators, to fix slots on removal
+
+	size_t					addAnimator( ExtAnimator* pOwner, IDrawable2D* pDrawable ) ;
+	void					removeAnimator( size_t slot ) ;
+	AnimatorState&			getAnimatorState( size_t slot ) { return m_animators[slot]; }
+
 	Animation2DManager() ;
 	virtual ~Animation2DManager() = default ;
 };
@@ -35,6 +35,8 @@
 #include <jam/Singleton.h>
 #include <jam/Color.h>
 #include <jam/ResourceManager.h>
+#include <jam/JobSystem.h>
+#include <jam/PostProcess.h>
 
 #ifdef _MSC_VER
 #include <windows.h>
@@ -92,9 +94,44 @@ public:
 	/// Returns remaining time (in ms) since the current frame started
 	uint64_t				getRemainingFrameMs() const;
 
+	/// Returns the time (in ns) at which the current frame started, as returned by SysTimer::getTimeNs()
+	uint64_t				getFrameStartNs() const { return m_frameStartNs; }
+
+	/// Sets the duration (in secs) of a fixed simulation step. Defaults to 1/60.0
+	void					setFixedTimeStep( jam::time step ) ;
+
+	/// Returns the duration (in secs) of a fixed simulation step
+	jam::time				getFixedTimeStep() const ;
+
+	/**
+		Sets the maximum number of fixed steps run in a single frame. Defaults to 5
+		\remark When the limit is reached the remaining simulation backlog is dropped, so a slow frame cannot trigger an ever growing number of steps
+	*/
+	void					setMaxFixedSteps( int maxSteps ) { m_maxFixedSteps = maxSteps; }
+	int						getMaxFixedSteps() const { return m_maxFixedSteps; }
+
+	/// Sets the maximum frame duration (in secs) fed to the simulation, longer frames (e.g. after a breakpoint) are clamped. Defaults to 0.25
+	void					setMaxFrameTime( jam::time maxFrameTime ) ;
+
+	/**
+		Returns how far (in the range [0,1]) the rendered frame is between the previous and the current simulation state
+		\sa Node::setInterpolated
+	*/
+	float					getInterpolationAlpha() const { return m_interpolationAlpha; }
+
+	/// Returns the number of fixed steps run since the application started
+	uint64_t				getFixedStepCount() const { return m_fixedStepCount; }
+
 	/// Gets the pointer to the scene node
 	Scene*					getScene();
 
+	/**
+		Sets the post processing chain applied to the rendered frame, null to render straight to the screen.
+		The application keeps a reference to the chain
+	*/
+	void					setPostProcessChain( PostProcessChain* pChain ) ;
+	PostProcessChain*		getPostProcessChain() const { return m_pPostProcessChain.get(); }
+
 	TimerManager&			getSysTimerManager() ;
 
 	ResourceManager&		getResourceManager() ;
@@ -105,6 +142,20 @@ public:
 
 	float					getPtmRatio() const { return m_ptmRatio; }
 	void					setPtmRatio(float ptmRatio) ;
+
+	/**
+		Sets the Box2D solver iterations used by every physics step. Defaults to 10 velocity and 8 position iterations
+	*/
+	void					setPhysicsIterations( int velocityIterations, int positionIterations ) ;
+	int						getPhysicsVelocityIterations() const { return m_physVelocityIterations; }
+	int						getPhysicsPositionIterations() const { return m_physPositionIterations; }
+
+	/**
+		Sets the number of Box2D steps run for every fixed simulation step, each one lasting getFixedTimeStep()/substeps secs.
+		Defaults to 1
+	*/
+	void					setPhysicsSubsteps( int substeps ) ;
+	int						getPhysicsSubsteps() const { return m_physSubsteps; }
 #endif
 
 	/// Returns frames per second value
@@ -156,6 +207,35 @@ public:
 	bool					isImguiEnabled() const ;
 	void					setImguiEnabled( bool enabled = true ) ;
 
+	/**
+		Runs without a visible window and without vsync, e.g. for benchmarks. It must be called before start()
+		\remark The GL implementation is picked by the environment, e.g. LIBGL_ALWAYS_SOFTWARE=1 forces Mesa software rendering
+	*/
+	void					setHeadless( bool headless = true ) ;
+	bool					isHeadless() const { return m_headless; }
+
+	/**
+		Caches the program binaries built by the driver in the given folder, which must exist and be writable,
+		e.g. the folder returned by SDL_GetPrefPath(). The binaries are machine specific, so they never belong
+		to the shaders folder. It must be called before start(); empty (the default) disables the cache
+	*/
+	void					setShaderCacheFolder( const String& folder ) ;
+	const String&			getShaderCacheFolder() const { return m_shaderCacheFolder; }
+
+	/**
+		When enabled every frame advances the application time by exactly the animation interval and the frames
+		are not paced, so a run is repeatable regardless of how long frames really last. Defaults to false
+	*/
+	void					setFixedFrameMode( bool enabled = true ) { m_fixedFrameMode = enabled; }
+	bool					isFixedFrameMode() const { return m_fixedFrameMode; }
+
+	/// Exits the main loop after the given number of frames, 0 (the default) means no limit
+	void					setFrameLimit( uint64_t numOfFrames ) { m_frameLimit = numOfFrames; }
+	uint64_t				getFrameLimit() const { return m_frameLimit; }
+
+	/// Returns the number of frames run since the main loop started
+	uint64_t				getFrameCount() const { return m_frameCount; }
+
 #ifdef JAM_TRACE_ACTIVE_NODES
 	void					traceActiveNodes(TimeExpiredEventArgs& args, IEventSource& source) ;
 #endif
@@ -196,6 +276,12 @@ protected:
 	/** Called when the application is idle. */
 	virtual void			idle() ;
 
+	/**
+		Called once for every fixed simulation step, just after physics has been stepped.
+		It can be called zero, one or more times in a frame, dt is always getFixedTimeStep()
+	*/
+	virtual void			fixedUpdate( jam::time dt ) ;
+
 	float					getCollisionCheckFactor() const { return m_collisionCheckFactor; }
 	void					setCollisionCheckFactor(float val);
 
@@ -213,6 +299,8 @@ private:
 	void					cleanup() ;
 	void					doFrame();
 	void					refreshTime() ;
+	void					stepSimulation() ;
+	void					waitNextFrame() ;
 	void					updateCollisions();
 	void					updateSounds() ;
 	void					updateMsPerFrame();
@@ -227,13 +315,31 @@ private:
 	uint64_t				m_elapsedMs ;
 	uint64_t				m_lastTimeMs ;
 	uint64_t				m_animationIntervalMs ;
+	uint64_t				m_animationIntervalNs ;
 	float					m_actionSpeed;
+
+	// high resolution frame timing, in nanoseconds
+	uint64_t				m_frameStartNs ;
+	uint64_t				m_frameDeltaNs ;
+	uint64_t				m_nextFrameNs ;
+
+	// fixed step simulation
+	uint64_t				m_fixedStepNs ;
+	uint64_t				m_accumulatorNs ;
+	uint64_t				m_maxFrameNs ;
+	uint64_t				m_fixedStepCount ;
+	int						m_maxFixedSteps ;
+	float					m_interpolationAlpha ;
+
+	// sounds update job, it runs while the scene is rendered
+	JobCounter				m_soundsJob ;
 		
 	// time in seconds, it's refreshed every frame
 	jam::time				m_secsElapsed ;
 	jam::time				m_secsTotalElapsed ;
 
 	Scene*					m_sceneNode ;
+	Ref<PostProcessChain>	m_pPostProcessChain ;
 	bool					m_exitFromMainLoop ;
 	bool					m_callAppHandlers ;
 
@@ -257,6 +363,9 @@ private:
 	b2World*				m_pPhysWorld ;
 	bool					m_physicsEnabled ;
 	float					m_ptmRatio ;		// pixel to meter ratio for Box2D
+	int						m_physVelocityIterations ;
+	int						m_physPositionIterations ;
+	int						m_physSubsteps ;
 #endif
 
 	float					m_collisionCheckFactor ;
@@ -275,6 +384,13 @@ private:
 	Ref<ResourceManager>	m_resourceManager ;
 
 	bool					m_imguiEnabled ;
+	String					m_shaderCacheFolder ;
+
+	// benchmark support
+	bool					m_headless ;
+	bool					m_fixedFrameMode ;
+	uint64_t				m_frameCount ;
+	uint64_t				m_frameLimit ;
 };	// class Application
 
 JAM_INLINE Application& GetAppMgr() { return Application::getSingleton(); }
@@ -38,6 +38,7 @@
 #include <jam/String.h>
 
 #include <map>
+#include <mutex>
 #include <al.h>
 
 namespace jam
@@ -194,6 +195,11 @@ private:
 	bool					m_aLoop ;
 };
 
+/**
+* The sounds update is run by a job concurrently with the scene rendering, so the public methods
+* of this class are serialized by an internal lock. Sounds should be controlled through this class
+* rather than by calling ISound methods directly while the frame is being rendered.
+*/
 class JAM_API AudioManager : public Singleton<AudioManager>, public NamedObjectManager<ISound>
 {
 	friend class Singleton<AudioManager> ;
@@ -308,6 +314,9 @@ private:
 	uint32_t				m_usedChannels ;
 
 	Timer*					m_pUpdateTimer ;
+
+	// serializes sounds control and the sounds update job
+	std::recursive_mutex	m_mutex ;
 };
 
 JAM_INLINE AudioManager& GetAudioMgr() { return AudioManager::getSingleton(); }
@@ -42,6 +42,11 @@ namespace jam
 	
 /**
 	A sprite with physics support
+
+	Sprites owning a body are kept in a registry which is synchronized in a single pass after every
+	fixed simulation step: awake bodies move their sprites, sleeping or inactive bodies are teleported
+	to their sprite only when the sprite has been moved since the last synchronization.
+	Call setInterpolated() to render a B2Sprite smoothly between two physics steps, it's off by default.
 */
 class JAM_API B2Sprite : public Sprite
 {
@@ -136,9 +141,6 @@ public:
 	// overrides
 	virtual void			setFrame(DrawItem* frame ) override ;
 
-	// overrides
-	virtual void			update() ;
-
 	b2Body*					getBody() const;
 
 	void					setActive(bool activeFlag) ;
@@ -156,8 +158,25 @@ public:
 
 	Vector2					getWorldCenter() const ;
 
+	/// Moves the bodies of the registered sprites which are sleeping or inactive and have been moved by the user
+	static void				syncBodiesFromSprites() ;
+	/// Moves the registered sprites whose bodies are active and awake
+	static void				syncSpritesFromBodies() ;
+
 protected:
 	b2Body*					m_pBody ;
+
+private:
+	void					registerBody() ;
+	void					unregisterBody() ;
+	void					syncFromBody( float ptmRatio ) ;
+	bool					isMovedSinceSync() const ;
+	void					storeSyncState() ;
+
+	int						m_bodySlot ;
+	// world transform at the last synchronization with the body
+	Vector2					m_syncPos ;
+	float					m_syncAngle ;
 };
 
 }	
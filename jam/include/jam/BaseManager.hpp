@@ -32,6 +32,9 @@
 
 #include <jam/jam.h>
 #include <jam/Object.h>
+#include <jam/Ref.hpp>
+#include <jam/Name.h>
+#include <jam/Handle.hpp>
 
 #include <unordered_map>
 #include <vector>
@@ -39,17 +42,41 @@
 namespace jam
 {
 
+/*!
+	\class NamedObjectManager
+
+	Owns objects keyed by their interned (case-insensitive) name.
+	Every managed object also gets a generational Handle, which can be resolved
+	without hashing and safely outlives the object.
+*/
 template <typename T>
 class NamedObjectManager : public RefCountedObject
 {
 public:
-	using ObjectsMap = std::unordered_map<String,Ref<T>> ;
+	using ObjectsMap = std::unordered_map<Name,Ref<T>,Name::Hasher> ;
 
 public:
 	virtual void			addObject( T* object ) ;
+
+	/// These ones raise an error if the object is not found
 	T*						getObject( const String& name ) ;
 	const T*				getObject( const String& name ) const ;
-	virtual void			eraseObject( const String& name ) ;
+	T*						getObject( const Name& name ) const ;
+
+	/// These ones return nullptr if the object is not found
+	T*						findObject( const String& name ) const ;
+	T*						findObject( const Name& name ) const ;
+	T*						getObject( Handle<T> handle ) const ;
+
+	/// Returns a null handle if the object is not found
+	Handle<T>				getHandle( const String& name ) const ;
+	Handle<T>				getHandle( const Name& name ) const ;
+	bool					isValid( Handle<T> handle ) const { return getObject(handle) != nullptr ; }
+
+	virtual void			eraseObject( const Name& name ) ;
+	void					eraseObject( const String& name ) ;
+	/// Erases the given object only (not another object with the same name)
+	void					eraseObject( T* object ) ;
 	virtual void			clearAll() ;
 	size_t					size() const ;
 
@@ -62,8 +89,21 @@ protected:
 							NamedObjectManager() ;
 	virtual					~NamedObjectManager() = default ;
 
+	Handle<T>				allocHandle( T* object ) ;
+	void					freeHandle( Handle<T> handle ) ;
+
 protected:
+	struct HandleSlot
+	{
+		T*					object ;
+		U32					generation ;
+	};
+
 	ObjectsMap				m_objectsMap ;
+	// handles are kept aside, so that the objects map still maps names to objects
+	std::unordered_map<Name,Handle<T>,Name::Hasher>	m_handlesMap ;
+	std::vector<HandleSlot>	m_handleSlots ;
+	std::vector<U32>		m_freeHandleSlots ;
 };
 
 template<typename T>
@@ -74,52 +114,120 @@ NamedObjectManager<T>::NamedObjectManager()
 template<typename T>
 void NamedObjectManager<T>::addObject( T* object )
 {
-	String name = jam::makeLower(object->getName()) ;
-	auto v = std::make_pair(name,Ref<T>(object,true)) ;
-	m_objectsMap.insert( v ) ;
+	auto res = m_objectsMap.insert( std::make_pair(object->getNameId(),Ref<T>(object,true)) ) ;
+	if( res.second ) {
+		m_handlesMap[object->getNameId()] = allocHandle(object) ;
+	}
 }
 
 template<typename T>
 const T* NamedObjectManager<T>::getObject( const String& name ) const
 {
-	// std::unordered_map::at
-	// Returns a reference to the mapped value of the element with key k in the unordered_map.
-	// If k does not match the key of any element in the container, the function throws an out_of_range exception.
-	try {
-		return m_objectsMap.at(jam::makeLower(name)).get();
-	}
-	catch( std::out_of_range& ex ) {
+	T* object = findObject(name) ;
+	if( !object ) {
 		JAM_ERROR( "Cannot get managed object named \"%s\"", name.c_str() ) ;
 	}
+	return object ;
 }
 
 template<typename T>
 T* NamedObjectManager<T>::getObject( const String& name )
 {
-	// std::unordered_map::at
-	// Returns a reference to the mapped value of the element with key k in the unordered_map.
-	// If k does not match the key of any element in the container, the function throws an out_of_range exception.
-	try {
-		return m_objectsMap.at(jam::makeLower(name)).get();
+	T* object = findObject(name) ;
+	if( !object ) {
+		JAM_ERROR( "Cannot get managed object named \"%s\"", name.c_str() ) ;
 	}
-	catch( std::out_of_range& ex ) {
+	return object ;
+}
+
+template<typename T>
+T* NamedObjectManager<T>::getObject( const Name& name ) const
+{
+	T* object = findObject(name) ;
+	if( !object ) {
 		JAM_ERROR( "Cannot get managed object named \"%s\"", name.c_str() ) ;
 	}
+	return object ;
 }
 
 template<typename T>
-void NamedObjectManager<T>::eraseObject( const String& name )
+T* NamedObjectManager<T>::findObject( const String& name ) const
+{
+	// a string never interned cannot be the name of a managed object
+	Name n = Name::find(name) ;
+	return (n.isNull() && !name.empty()) ? nullptr : findObject(n) ;
+}
+
+template<typename T>
+T* NamedObjectManager<T>::findObject( const Name& name ) const
+{
+	auto it = m_objectsMap.find(name) ;
+	return it != m_objectsMap.end() ? it->second.get() : nullptr ;
+}
+
+template<typename T>
+T* NamedObjectManager<T>::getObject( Handle<T> handle ) const
+{
+	if( handle.isNull() || handle.m_index >= m_handleSlots.size() ) {
+		return nullptr ;
+	}
+	const HandleSlot& slot = m_handleSlots[handle.m_index] ;
+	return slot.generation == handle.m_generation ? slot.object : nullptr ;
+}
+
+template<typename T>
+Handle<T> NamedObjectManager<T>::getHandle( const String& name ) const
 {
-	auto it = m_objectsMap.find(jam::makeLower(name)) ;
+	Name n = Name::find(name) ;
+	return (n.isNull() && !name.empty()) ? Handle<T>() : getHandle(n) ;
+}
+
+template<typename T>
+Handle<T> NamedObjectManager<T>::getHandle( const Name& name ) const
+{
+	auto it = m_handlesMap.find(name) ;
+	return it != m_handlesMap.end() ? it->second : Handle<T>() ;
+}
+
+template<typename T>
+void NamedObjectManager<T>::eraseObject( const Name& name )
+{
+	auto it = m_objectsMap.find(name) ;
 	if( it != m_objectsMap.end() ) {
+		auto hIt = m_handlesMap.find(name) ;
+		freeHandle( hIt->second ) ;
+		m_handlesMap.erase(hIt) ;
 		m_objectsMap.erase(it) ;
 	}
 }
 
+template<typename T>
+void NamedObjectManager<T>::eraseObject( const String& name )
+{
+	Name n = Name::find(name) ;
+	if( !n.isNull() || name.empty() ) {
+		eraseObject(n) ;
+	}
+}
+
+template<typename T>
+void NamedObjectManager<T>::eraseObject( T* object )
+{
+	if( findObject(object->getNameId()) == object ) {
+		eraseObject(object->getNameId()) ;
+	}
+}
+
 template<typename T>
 void NamedObjectManager<T>::clearAll()
 {
 	m_objectsMap.clear();
+	m_handlesMap.clear();
+	for( U32 i=0; i<m_handleSlots.size(); i++ ) {
+		if( m_handleSlots[i].object ) {
+			freeHandle( Handle<T>(i,m_handleSlots[i].generation) ) ;
+		}
+	}
 }
 
 template<typename T>
@@ -146,19 +254,52 @@ void NamedObjectManager<T>::dump(const char* msg)
 	// TODO
 }
 
+template<typename T>
+Handle<T> NamedObjectManager<T>::allocHandle( T* object )
+{
+	U32 index ;
+	if( !m_freeHandleSlots.empty() ) {
+		index = m_freeHandleSlots.back() ;
+		m_freeHandleSlots.pop_back() ;
+	}
+	else {
+		index = (U32)m_handleSlots.size() ;
+		HandleSlot slot = { nullptr, 1 } ;
+		m_handleSlots.push_back( slot ) ;
+	}
+	m_handleSlots[index].object = object ;
+	return Handle<T>( index, m_handleSlots[index].generation ) ;
+}
+
+template<typename T>
+void NamedObjectManager<T>::freeHandle( Handle<T> handle )
+{
+	HandleSlot& slot = m_handleSlots[handle.m_index] ;
+	slot.object = nullptr ;
+	// generation 0 is reserved to the null handle
+	if( ++slot.generation == 0 ) {
+		slot.generation = 1 ;
+	}
+	m_freeHandleSlots.push_back( handle.m_index ) ;
+}
+
+
 template <typename T>
 class NamedTaggedObjectManager : public NamedObjectManager<T>
 {
 public:
-	using TagsMap = std::unordered_multimap<String,T*> ;
+	using TagsMap = std::unordered_multimap<Name,T*,Name::Hasher> ;
 	using RangeTags = std::pair<typename NamedTaggedObjectManager<T>::TagsMap::iterator,typename NamedTaggedObjectManager<T>::TagsMap::iterator> ;
 
+	using NamedObjectManager<T>::eraseObject ;
+
 public:
 	virtual void			addObject( T* object ) override ;
 	T*						findObjectByTag( const String& tag ) const ;
 	RangeTags				findObjectsByTag( const String& tag ) ;
+	RangeTags				findObjectsByTag( const Name& tag ) ;
 	size_t					countObjectsByTag( const String& tag ) ;
-	virtual void			eraseObject( const String& name ) override ;
+	virtual void			eraseObject( const Name& name ) override ;
 	virtual void			clearAll() override ;
 
 	virtual	void			dump(const char* msg) override ;
@@ -166,6 +307,10 @@ public:
 protected:
 							NamedTaggedObjectManager() ;
 
+private:
+	// a tag never interned is not the tag of any object
+	bool					findTag( const String& tag, Name& name ) const ;
+
 private:
 	TagsMap					m_tagsMap ;
 };
@@ -178,16 +323,28 @@ NamedTaggedObjectManager<T>::NamedTaggedObjectManager()
 template<typename T>
 void NamedTaggedObjectManager<T>::addObject( T* object )
 {
-	m_objectsMap.insert( std::make_pair(jam::makeLower(object->getName()),Ref<T>(object,true)) ) ;
-	if( std::is_base_of<ITaggedObject,T>::value ) {
-		m_tagsMap.insert( std::make_pair(jam::makeLower(object->getTag()),Ref<T>(object,true)) ) ;
+	size_t count = this->m_objectsMap.size() ;
+	NamedObjectManager<T>::addObject( object ) ;
+	if( this->m_objectsMap.size() != count ) {
+		m_tagsMap.insert( std::make_pair(object->getTagId(),object) ) ;
 	}
 }
 
+template<typename T>
+bool NamedTaggedObjectManager<T>::findTag( const String& tag, Name& name ) const
+{
+	name = Name::find(tag) ;
+	return !name.isNull() || tag.empty() ;
+}
+
 template<typename T>
 T* NamedTaggedObjectManager<T>::findObjectByTag(const String& tag) const
 {
-	auto elem = m_tagsMap.find(jam::makeLower(tag));
+	Name name ;
+	if( !findTag(tag,name) )
+		return nullptr ;
+
+	auto elem = m_tagsMap.find(name);
 	if( elem == m_tagsMap.end() )
 		return nullptr ;
 
@@ -197,39 +354,48 @@ T* NamedTaggedObjectManager<T>::findObjectByTag(const String& tag) const
 template<typename T>
 typename NamedTaggedObjectManager<T>::RangeTags NamedTaggedObjectManager<T>::findObjectsByTag(const String& tag)
 {
-	return m_tagsMap.equal_range( jam::makeLower(tag) ) ;
+	Name name ;
+	if( !findTag(tag,name) )
+		return RangeTags( m_tagsMap.end(), m_tagsMap.end() ) ;
+
+	return m_tagsMap.equal_range( name ) ;
+}
+
+template<typename T>
+typename NamedTaggedObjectManager<T>::RangeTags NamedTaggedObjectManager<T>::findObjectsByTag(const Name& tag)
+{
+	return m_tagsMap.equal_range( tag ) ;
 }
 
 template<typename T>
 size_t NamedTaggedObjectManager<T>::countObjectsByTag(const String& tag)
 {
-	return m_tagsMap.count(jam::makeLower(tag));
+	Name name ;
+	return findTag(tag,name) ? m_tagsMap.count(name) : 0 ;
 }
 
 template<typename T>
-void NamedTaggedObjectManager<T>::eraseObject( const String& name )
+void NamedTaggedObjectManager<T>::eraseObject( const Name& name )
 {
-	auto it = m_objectsMap.find(jam::makeLower(name)) ;
-	if( it != m_objectsMap.end() ) {
-		ITaggedObject* tObj = (*it).second ;
-		if (std::is_base_of<ITaggedObject,T>::value && !tObj->getTag().empty() ) {
-			auto range = m_tagsMap.equal_range( jam::makeLower(tObj->getTag()) ) ;
-			for( auto rIt = range.first; rIt!= range.second; rIt++ ) { 
-				if ( (*rIt).second == tObj ) {
-					m_tagsMap.erase(rIt) ;
-					break ;
-				}
+	auto it = this->m_objectsMap.find(name) ;
+	if( it != this->m_objectsMap.end() ) {
+		T* tObj = it->second.get() ;
+		auto range = m_tagsMap.equal_range( tObj->getTagId() ) ;
+		for( auto rIt = range.first; rIt!= range.second; rIt++ ) { 
+			if ( (*rIt).second == tObj ) {
+				m_tagsMap.erase(rIt) ;
+				break ;
 			}
 		}
 
-		m_objectsMap.erase(it) ;
+		NamedObjectManager<T>::eraseObject( name ) ;
 	}
 }
 
 template<typename T>
 void NamedTaggedObjectManager<T>::clearAll()
 {
-	m_objectsMap.clear();
+	NamedObjectManager<T>::clearAll() ;
 	m_tagsMap.clear() ;
 }
 
@@ -33,6 +33,7 @@
 #include <jam/jam.h>
 #include <jam/GameObject.h>
 #include <jam/core/geom.h>
+#include <jam/Frustum.h>
 
 namespace jam
 {
@@ -88,6 +89,9 @@ public:
 	Matrix4					getViewMatrix() const ;
 	Matrix4					getProjectionMatrix() const ;
 
+	/// Returns the view volume in the space of the given model matrix, e.g. the global 2d scale
+	Frustum					getFrustum( const Matrix4& model = Matrix4(1.0f) ) ;
+
 private:
 	void					updateProjection() ;
 	void					updateView();
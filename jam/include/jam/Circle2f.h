@@ -80,6 +80,18 @@ public:
 	/** Returns true if this circle intersects the given circle. */
 	bool					intersects( const Circle2f& other ) const ;
 
+	/**
+		Returns true if this circle intersects the given circle, also returning the contact:
+		the unit normal pointing from this circle towards other and the penetration depth along it
+	*/
+	bool					intersects( const Circle2f& other, Vector2& normal, float& depth ) const ;
+
+	/**
+		Returns true if this circle intersects the given convex polygon (e.g. an OBB), also returning the contact:
+		the unit normal pointing from this circle towards poly and the penetration depth along it
+	*/
+	bool					intersects( const Polygon2f& poly, Vector2& normal, float& depth ) const ;
+
 	/** Returns true if the given point in inside this circle. */
 	bool					isPointInside(const Vector2& p) const ;
 	
@@ -34,12 +34,14 @@
 
 #include <jam/Singleton.h>
 #include <jam/RefCountedObject.h>
+#include <jam/Narrowphase.h>
 
 #include <vector>
 #include <map>
 #include <set>
 #define COLLISION_MANAGER_DEFAULT_SCALE_FACTOR			1.0f
 #define COLLISION_MANAGER_MAX_COLLISIONS					10
+#define COLLISION_MANAGER_PAIRS_GRAIN					64
 
 
 namespace jam
@@ -56,6 +58,18 @@ namespace jam
 * Collision types are just numbers you assign to a node using setCollisionType.
 * This class then uses the collision types to check for collisions between
 * all the nodes that have those collision types.
+*
+* Every type is a collision layer, i.e. a bit of a 64 bits mask: setCollisions() fills a layer matrix
+* (for each type the mask of the types it collides with), intersected with the per-node masks of
+* Node::setCollisionMask(). Pairs of layers not in the matrix are rejected by the quadtree query,
+* before any bounding test.
+*
+* Candidate pairs are collected by the quadtree, then hit-tested in parallel by the JobSystem
+* and finally resolved in the original order, so the results don't depend on the number of threads.
+* When parallel hit-tests are enabled, Node::collide() overrides must only read the nodes state.
+*
+* The bounding tests of nodes with Node::hasStandardCollide() are batched in a Narrowphase, which also
+* returns the contact normal and depth stored in ObjCollision and CollisionEventArgs.
 */
 class JAM_API CollisionManager : public Singleton<CollisionManager>, public RefCountedObject
 {
@@ -79,6 +93,12 @@ public:
 
 	/// Enables collisions between two different collision types.
 	void					setCollisions( int src_type,int dest_type,Method method,int response );
+
+	/// Returns the mask of the collision types src_type collides with
+	U64						getLayerMask( int src_type ) const { return m_layerMasks[src_type]; }
+
+	/// Returns the bit of the given collision type in the layer masks, 0 for type 0
+	static U64				getLayerBit( int collType ) { return collType ? ((U64)1 << (collType-1)) : 0; }
 	
 	/// Called by Application class. Normally you shouldn't call this method
 	void					update( float elapsed );
@@ -86,6 +106,9 @@ public:
 	bool					getOptimized() const { return m_isOptimized; }
 	void					setOptimized(bool val) { m_isOptimized = val; }
 
+	bool					getParallel() const { return m_isParallel; }
+	void					setParallel(bool val) { m_isParallel = val; }
+
 	void					setRegionBounds( const AABB& aabb) ;
 
 	Timer&					getUpdateTimer() { return *m_pUpdateTimer; }
@@ -117,6 +140,19 @@ private:
 		int response;
 	};
 
+	struct CollPair {
+		Node* src ;
+		Node* dst ;
+		Method method ;
+		int dst_type ;
+		bool hit ;
+		bool standard ;		// bounding tests done by the narrowphase
+		bool deferred ;		// dst has collected (dst,src) first, tested only if that pair was dropped by the collisions cap
+		size_t test ;		// narrowphase test of the current stage
+		Vector2 normal ;
+		float depth ;
+	};
+
 	// number of simoultaneous collisions detected
 	int						m_maxSimultaneousColls;
 	
@@ -126,6 +162,9 @@ private:
 	// for each coll_type there are one or more CollInfo
 	std::vector<CollInfo>	m_collInfo[JAM_CM_MAX_COLL_TYPES];
 
+	// for each coll_type, the layer bits of the dst_type of its CollInfo
+	U64						m_layerMasks[JAM_CM_MAX_COLL_TYPES];
+
 	// for each coll_type there are one or more nodes
 	std::vector<Node*>		m_objsByType[JAM_CM_MAX_COLL_TYPES];
 
@@ -138,10 +177,23 @@ private:
 	// matrix containg already checked Nodes (avoid to check a pair already checked)
 	std::map<Node*,std::set<Node*> > m_checked ;
 
+	// pairs to be hit-tested in the current update, grouped by src and then by dst_type
+	std::vector<CollPair>	m_pairs ;
+
+	// batched bounding tests of the standard pairs
+	Narrowphase				m_narrowphase ;
+
+	// pairs to be hit-tested by collide(): custom overrides and the pixel tests
+	std::vector<size_t>		m_collidePairs ;
+
 	bool					m_isOptimized;
+	bool					m_isParallel;
 
 #ifndef JAM_CM_QUADTREE_DISABLED
 	Quadtree*				m_quadTree ;
+
+	// nodes returned by the quadtree query of the current src
+	std::vector<Node*>		m_nearNodes ;
 #endif
 
 	Timer*					m_pUpdateTimer ;
@@ -152,10 +204,19 @@ private:
 	// called when src and dest Objects have collided
 	// updates the list of src and also the list of dest
 	// queue a collision event
-	void					collided(Node* src, Node* dest) ;
+	void					collided(Node* src, Node* dest, const Vector2& normal, float depth) ;
+
+	// collects the pairs (src, dst) to be hit-tested
+	void					collectPairs(Node* src) ;
+
+	// hit-tests every collected pair, but the deferred ones
+	void					testPairs() ;
+
+	// hit-tests a single pair on the calling thread
+	void					testPair(CollPair& pair) ;
 
-	// the main collision detection (and response) method
-	void					checkCollisions(Node* src) ;
+	// the collision response: calls collided() for the pairs that hit
+	void					resolvePairs() ;
 
 	// helper method to allocate an ObjCollision
 	ObjCollision*			allocObjColl( Node* with ) ;
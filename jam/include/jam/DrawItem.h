@@ -36,6 +36,7 @@
 #include <jam/Object.h>
 #include <jam/Texture2D.h> 
 #include <jam/Material.h> 
+#include <jam/AlphaMask.h>
 #include <jam/Ref.hpp>
 
 namespace jam
@@ -47,6 +48,9 @@ namespace jam
 class JAM_API DrawItem : public NamedObject
 {
 public:
+	// draw items are allocated from pools, so the ones of a sheet are packed together
+	JAM_DECLARE_OBJECT_ALLOCATOR()
+
 	static const BlendMode DEFAULT_BLEND_MODE ;
 
 	Material*				getMaterial() const ;
@@ -110,6 +114,12 @@ public:
 
 	float					getGfxScale() const { return m_gfxScale; }
 
+	/**
+		Returns the mask of the opaque pixels, built once at construction for pixel perfect collisions.
+		\remark It is null if the texture had no client copy of its pixels (e.g. render targets)
+	*/
+	const AlphaMask*		getAlphaMask() const { return m_alphaMask.get(); }
+
 	/**
 	 Constructs an empty DrawItem with no texture 
 	 \remark Useful to draw with solid color. Rect is set to empty and not used
@@ -169,6 +179,8 @@ protected:
 	// to scale graphics
 	float					m_gfxScale ;
 
+	Ref<AlphaMask>			m_alphaMask ;
+
 private:
 	void					init();
 
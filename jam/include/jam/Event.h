@@ -53,6 +53,9 @@ using IEventSource = RefCountedObject ;
 class JAM_API EventArgs : public RefCountedObject
 {
 public:    
+	// event args are created and released at high rates, they are allocated from pools
+	JAM_DECLARE_OBJECT_ALLOCATOR()
+
 	virtual					~EventArgs() = default ;
 
 	/**
@@ -70,7 +73,7 @@ public:
 	void					setTimestamp(float val) { m_timestamp = val; }
 
 protected:
-							EventArgs() : m_isConsumed(false), m_timestamp(0.0f) {}
+							EventArgs() : m_isConsumed(false), m_timestamp(0.0f) { setRefCountPolicy( RefCountPolicy::SingleThreaded ) ; }
 
 	bool					m_isConsumed ;
 	float					m_timestamp ;
@@ -32,14 +32,21 @@
 
 
 #include <jam/jam.h>
-#include <jam/Timer.h>
 #include <jam/Anim2d.h>
 
 namespace jam
 {
 
+/**
+	Plays a 2D animation on a drawable.
+
+	The animator is a handle to a slot of Animation2DManager, which advances all the animators
+	of the scene in a single pass at every frame.
+*/
 class JAM_API ExtAnimator : public RefCountedObject
 {
+	friend class Animation2DManager ;
+
 public:
 							ExtAnimator(IDrawable2D* pIDrawable);
 							ExtAnimator( const ExtAnimator& ) = delete ;
@@ -49,8 +56,8 @@ public:
 	void					setAnimation( const Animation2D* pAnimation, bool autoStart=false, int firstFrame=0 );
 	const Animation2D*		getAnimation()	const { return m_pAnimation.get() ; }
 		
-	float					getSpeed() const { return m_speed; }
-	void					setSpeed(float val) { m_speed = val; }
+	float					getSpeed() const ;
+	void					setSpeed(float val) ;
 
 	void					startAnimation();
 	void					stopAnimation();
@@ -58,20 +65,14 @@ public:
 	void					completeAnimation(int frame=-1);
 	bool					isPlaying();
 
-	int						getLastFrameIndex() const { return m_lastFrameIndex; }
-
-	virtual void			update() ;
+	int						getLastFrameIndex() const ;
 
 protected:
 	virtual					~ExtAnimator();
 
 private:
-	int						m_lastFrameIndex ;
-	int						m_completeFrameIndex;
-	float					m_speed ;
-	Ref<Timer>				m_timer ;
+	size_t					m_slot ;
 	Ref<Animation2D>		m_pAnimation ;
-	Ref<Animation2D>		m_defaultAnimation ;
 	IDrawable2D*			m_pIDrawable ;
 };
 
@@ -0,0 +1,138 @@
+/**********************************************************************************
+* 
+* FrameAllocator.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_FRAMEALLOCATOR_H__
+#define __JAM_FRAMEALLOCATOR_H__
+
+#include <jam/jam.h>
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#define JAM_FRAME_ARENA_BLOCK_SIZE		(256*1024)		// initial size of every thread arena, it grows to the peak usage
+
+namespace jam
+{
+
+/*!
+	\class FrameAllocator
+
+	Linear allocator for transient data.
+
+	Every thread allocates from its own pair of arenas without any lock: memory allocated during a frame
+	stays valid until the end of the next frame, then its arena is reused as a whole. Nothing is ever freed
+	one allocation at a time, and destructors are not called by the allocator.
+	An arena which overflows falls back to the heap for the rest of the frame and is enlarged on its next reset,
+	so in the steady state a frame does not touch the heap at all.
+
+	\remark Never keep a pointer to frame memory across more than one newFrame()
+	\remark FrameStlAllocator and FrameVector let std containers use the arenas
+*/
+class JAM_API FrameAllocator
+{
+public:
+	/// Returns uninitialized memory valid until the end of the next frame
+	static void*			allocate( size_t size, size_t alignment = alignof(std::max_align_t) ) ;
+
+	/// Returns an uninitialized array of count elements
+	template <typename T>
+	static T*				allocateArray( size_t count ) { return (T*)allocate( count*sizeof(T), alignof(T) ) ; }
+
+	/// Constructs an object in frame memory, destroy() must be called if T is not trivially destructible
+	template <typename T, typename... Args>
+	static T*				create( Args&&... args ) { return ::new (allocate(sizeof(T),alignof(T))) T( std::forward<Args>(args)... ) ; }
+
+	template <typename T>
+	static void				destroy( T* p ) { if( p ) p->~T() ; }
+
+	/// Called by Application at the beginning of every frame
+	static void				newFrame() ;
+
+	static uint64_t			getFrame() { return m_frame.load(std::memory_order_relaxed) ; }
+
+	/// Returns true if memory allocated during the given frame is still valid
+	static bool				isAlive( uint64_t frame ) { return frame + 1 >= getFrame() ; }
+
+	/// Total size of the arenas of all the threads
+	static size_t			getCapacity() ;
+
+	/// Releases the arenas of all the threads, called by Application on termination
+	static void				shutdown() ;
+
+private:
+	static std::atomic<uint64_t>	m_frame ;
+};
+
+
+/**
+	Allocator adaptor for std containers. Deallocation does nothing, containers using it must not
+	outlive the next frame
+*/
+template <typename T>
+class FrameStlAllocator
+{
+public:
+	using value_type = T ;
+
+	template <typename U>
+	struct rebind { using other = FrameStlAllocator<U> ; } ;
+
+							FrameStlAllocator() = default ;
+	template <typename U>
+							FrameStlAllocator( const FrameStlAllocator<U>& ) {}
+
+	T*						allocate( size_t n ) { return FrameAllocator::allocateArray<T>( n ) ; }
+	void					deallocate( T*, size_t ) {}
+
+	template <typename U>
+	bool					operator==( const FrameStlAllocator<U>& ) const { return true ; }
+	template <typename U>
+	bool					operator!=( const FrameStlAllocator<U>& ) const { return false ; }
+};
+
+template <typename T> using FrameVector = std::vector<T,FrameStlAllocator<T>> ;
+
+
+/**
+	Base class for objects created with new that live at most until the end of the next frame, e.g. event args.
+	Their memory comes from the frame arenas and delete only runs the destructor
+*/
+class JAM_API FrameAllocated
+{
+public:
+	static void*			operator new( size_t size ) ;
+	static void				operator delete( void* p ) ;
+};
+
+}
+
+#endif // __JAM_FRAMEALLOCATOR_H__
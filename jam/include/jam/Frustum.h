@@ -0,0 +1,66 @@
+/**********************************************************************************
+* 
+* Frustum.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_FRUSTUM_H__
+#define __JAM_FRUSTUM_H__
+
+#include <jam/jam.h>
+#include <jam/core/geom.h>
+
+namespace jam
+{
+
+/*!
+	\class Frustum
+
+	The six planes of a view volume, extracted from a view-projection matrix.
+	Works for both perspective and orthographic projections.
+*/
+class JAM_API Frustum
+{
+public:
+							Frustum() ;
+	/// m is projection * view, optionally multiplied by a model matrix to test boxes in model space
+	explicit				Frustum( const Matrix4& m ) ;
+
+	void					set( const Matrix4& m ) ;
+
+	/// Returns false only if the box is entirely outside the volume (conservative test)
+	bool					intersects( const Vector3& boxMin, const Vector3& boxMax ) const ;
+
+	/// Tests a rectangle lying on the z=0 plane
+	bool					intersects( const Vector2& rectMin, const Vector2& rectMax ) const ;
+
+private:
+	Vector4					m_planes[6] ;		// xyz normal pointing inside, w distance
+};
+
+}
+
+#endif // __JAM_FRUSTUM_H__
@@ -45,7 +45,9 @@ class StridedVertexBuffer ;
 class Draw3DBatch ;
 class DrawItem ;
 class Material ;
+class Shader ;
 class VertexArrayObject ;
+class TransientVertexArena ;
 
 class JAM_API Gfx : public Singleton<Gfx>
 {
@@ -73,14 +75,26 @@ public:
 	Draw3DBatch*			getBatch() ;
 	bool					isBatchingInProgress() const ;
 
+	/// Returns the batch buffer or, when not batching, a buffer in frame memory drawn through the transient arena
 	StridedVertexBuffer&	getVertexBuffer( DrawItem* handle, uint16_t vCount, uint16_t iCount, GLenum pType = GL_TRIANGLES ) ;
 	void					appendOrDraw();
+	TransientVertexArena&	getTransientArena() ;
+
+	/// Called once per frame by Application
+	void					newFrame() ;
 	void					drawPrimitive( VertexArrayObject* pVao, size_t numOfVertices, Material* pMaterial, GLenum pType = GL_TRIANGLES ) ;
 	void					drawIndexedPrimitive( VertexArrayObject* pVao, size_t numOfElements, Material* pMaterial, U16 offset = 0 , GLenum pType = GL_TRIANGLES ) ;
 	void					drawIndexedPrimitive( IVertexBuffer* pVBuff, Material* pMaterial, U16 offset = 0 , GLenum pType = GL_TRIANGLES ) ;
+	void					drawIndexedPrimitiveInstanced( VertexArrayObject* pVao, size_t numOfElements, size_t numOfInstances, Material* pMaterial, Shader* pShader, GLenum pType = GL_TRIANGLES ) ;
 	void					setRenderLevel( int level ) ;
 	int						getRenderLevel() const { return m_renderLevel; } ;
 
+	/// Counts a draw call issued straight to GL, i.e. not through the draw methods of this class
+	void					countDrawCall() { m_numOfDrawCalls++ ; }
+
+	/// Returns the number of draw calls issued in the last frame, transient arena draws included
+	size_t					getNumOfDrawCalls() const { return m_lastNumOfDrawCalls; }
+
 	Material*				getMaterial( DrawItem* item ) ;
 
 private:
@@ -96,6 +110,13 @@ private:
 	DrawItem*				m_handle ;
 	GLenum					m_pType ;
 	int32_t					m_lastSlotID ;
+
+	// immediate draws storage, created on first use
+	TransientVertexArena*	m_pTransientArena ;
+
+	// draw calls of the current and of the last frame
+	size_t					m_numOfDrawCalls ;
+	size_t					m_lastNumOfDrawCalls ;
 };
 
 JAM_INLINE Gfx& GetGfx() { return Gfx::getSingleton(); }
@@ -36,35 +36,46 @@
 
 namespace jam 
 {
+class RenderTarget ;
 
 /**
 	Class for internal use
+
+	Render target is taken from the RenderTargetPool in beforeRender() and given back by releaseTarget(),
+	so it is shared with the other grids and the post processing passes
 */
 class Grabber
 {
 public:
-/*
 	Grabber(void);
 
 	~Grabber(void);
-*/
-	// attach the texture to the framebuffer, so that it can be possible render on texture
+
+	// records the size of the texture to render on
 	void grab(jam::DrawItem* pDrawitem);
 
-	// clear the texture and prepare to render on it
+	// acquires the render target, clears it and prepare to render on it
 	// called before rendering to texture begin
 	void beforeRender();
 
-	// make the default framebuffer as current (i.e. screen)
+	// restores the previous framebuffer and viewport
 	// called after rendering to texture is over
 	void afterRender();
 
+	// gives the render target back to the pool, its texture can't be used anymore
+	void releaseTarget();
+
 	Texture2D* getTexture() ;
-/*
-protected:
-	CIwGxSurface*	m_pSurface ;
-*/
+
 	jam::Color		m_clearColor ;
+
+private:
+	U32				m_width ;
+	U32				m_height ;
+	RenderTarget*	m_pTarget ;
+	GLint			m_prevFramebuffer ;
+	GLint			m_prevViewport[4] ;
+	GLfloat			m_prevClearColor[4] ;
 };
 
 }
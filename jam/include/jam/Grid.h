@@ -33,6 +33,7 @@
 #include <jam/RefCountedObject.h>
 #include <jam/Node.h>
 #include <jam/Texture2D.h>
+#include <jam/core/geom.h>
 
 namespace jam
 {
@@ -40,6 +41,35 @@ class Grabber;
 class DrawItem ;
 class StridedVertexBuffer ;
 
+/**
+	Grid deformations, the values match the effectType uniform of the grid effect shader
+*/
+enum class GridEffectType {
+	NONE = 0,
+	WAVES = 1,			// z waves along the grid diagonal
+	RIPPLE = 2,			// z waves going out of center, inside radius
+	LIQUID = 3,			// x,y waves
+	SHAKY = 4,			// random x,y offset of every vertex
+	WAVES_TILES = 5,	// z waves moving whole tiles, TiledGrid3D only
+	SHAKY_TILES = 6		// random x,y offset of whole tiles, TiledGrid3D only
+} ;
+
+/**
+	Parameters of a grid deformation, lengths are in grid units (pixels)
+*/
+struct JAM_API GridEffect
+{
+							GridEffect() :
+								type(GridEffectType::NONE), amplitude(0.0f), waves(1.0f), center(0.0f,0.0f), radius(0.0f), range(0.0f) {}
+
+	GridEffectType			type ;
+	float					amplitude ;
+	float					waves ;			// number of waves over the effect duration
+	Vector2					center ;		// RIPPLE only
+	float					radius ;		// RIPPLE only
+	float					range ;			// SHAKY and SHAKY_TILES only
+} ;
+
 /**
 	Base class for the other Grid based classes
 */
@@ -74,9 +104,26 @@ public:
 	void beforeDraw();
 	void afterDraw(Node *pTarget);
 	virtual void blit();
+	/** saves the mesh currently drawn as the new original mesh, the effect is evaluated on the cpu even when gpu effects are enabled */
 	virtual void reuse();
 	virtual void calculateVertexPoints() = 0;
 
+	/**
+		Sets the deformation applied to the original vertices.
+		The effect is evaluated by the grid vertex shader on the static grid mesh, so vertices aren't touched on the CPU.
+		Vertices edited with setVertex()/setTile() are drawn as they are instead, until a new effect is set
+	*/
+	void setEffect(const GridEffect& effect);
+	JAM_INLINE const GridEffect& getEffect() const { return m_effect; }
+
+	/** Sets the effect progress, usually the normalized time [0,1] of the action driving the grid */
+	void setEffectTime(float time);
+	JAM_INLINE float getEffectTime() const { return m_effectTime; }
+
+	/** Evaluates the effects on the CPU, it's a global setting meant for drivers with no shader support. Defaults to true */
+	static void setGpuEffectsEnabled(bool bEnabled) { s_gpuEffectsEnabled = bEnabled; }
+	static bool isGpuEffectsEnabled() { return s_gpuEffectsEnabled; }
+
 public:
 	//static GridBase* gridWithSize(const GridSize& gridSize, DrawItem *pDrawItem, bool flipped);
 	//static GridBase* gridWithSize(const GridSize& gridSize);
@@ -85,6 +132,10 @@ public:
 
 protected:
 	GridBase() ;
+
+	/** CPU fallback, writes the effect applied to the original vertices into the vertex buffer */
+	void applyEffect();
+	void invalidateVertices();
 		
 protected:
 	bool m_bActive;
@@ -97,6 +148,17 @@ protected:
 
 	StridedVertexBuffer*	m_pVertexBuffer ;
 	StridedVertexBuffer*	m_pOriginalVertexBuffer;
+
+	GridEffect				m_effect ;
+	float					m_effectTime ;
+	float					m_effectSeed ;
+	bool					m_verticesEdited ;		// setVertex/setTile have been called since the last setEffect
+	bool					m_verticesDirty ;		// m_pVertexBuffer must be uploaded again
+	Matrix4					m_viewMatrix ;
+	Matrix4					m_projMatrix ;
+
+private:
+	static bool				s_gpuEffectsEnabled ;
 };
 
 /**
@@ -0,0 +1,72 @@
+/**********************************************************************************
+* 
+* Handle.hpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_HANDLE_H__
+#define __JAM_HANDLE_H__
+
+#include <jam/jam.h>
+
+namespace jam
+{
+
+template <typename T> class NamedObjectManager ;
+
+/*!
+	\class Handle
+
+	A generational index into the slots of a NamedObjectManager.
+	Resolving a handle is an array access; a handle to an erased object resolves to nullptr
+	because its slot generation has changed. The default handle is null.
+*/
+template <typename T>
+class Handle
+{
+	friend class NamedObjectManager<T> ;
+
+public:
+							Handle() : m_index(0), m_generation(0) {}
+
+	bool					isNull() const { return m_generation == 0 ; }
+	U32						getIndex() const { return m_index ; }
+	U32						getGeneration() const { return m_generation ; }
+
+	bool					operator==( const Handle& other ) const { return m_index == other.m_index && m_generation == other.m_generation ; }
+	bool					operator!=( const Handle& other ) const { return !(*this == other) ; }
+
+private:
+							Handle( U32 index, U32 generation ) : m_index(index), m_generation(generation) {}
+
+private:
+	U32						m_index ;
+	U32						m_generation ;
+};
+
+}
+
+#endif // __JAM_HANDLE_H__
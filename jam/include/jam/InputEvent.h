@@ -0,0 +1,107 @@
+/**********************************************************************************
+* 
+* InputEvent.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_INPUTEVENT_H__
+#define __JAM_INPUTEVENT_H__
+
+#include <jam/jam.h>
+
+#include <SDL.h>
+#include <atomic>
+#include <vector>
+
+namespace jam
+{
+
+/// An input event as reported by SDL, stamped with the SysTimer time (nanoseconds) it happened at
+struct JAM_API InputEvent
+{
+	uint64_t				timeNs ;
+	SDL_Event				event ;
+};
+
+
+/// A range of time ordered input events, valid until the next InputManager update
+class JAM_API InputEventRange
+{
+public:
+							InputEventRange() : m_first(0), m_last(0) {}
+							InputEventRange( const InputEvent* first, const InputEvent* last ) : m_first(first), m_last(last) {}
+
+	const InputEvent*		begin() const { return m_first ; }
+	const InputEvent*		end() const { return m_last ; }
+	size_t					size() const { return (size_t)(m_last - m_first) ; }
+	bool					empty() const { return m_first == m_last ; }
+
+private:
+	const InputEvent*		m_first ;
+	const InputEvent*		m_last ;
+};
+
+
+/*!
+	\class InputEventQueue
+
+	Lock-free single producer, single consumer ring buffer of input events.
+	The producer is the thread pumping SDL events, the consumer is the main thread.
+	When the ring is full new events are dropped and counted.
+*/
+class JAM_API InputEventQueue
+{
+public:
+	static const size_t		DefaultCapacity ;
+
+public:
+	/// capacity is rounded up to a power of two
+	explicit				InputEventQueue( size_t capacity = DefaultCapacity ) ;
+
+	/// Producer side, returns false if the ring is full
+	bool					push( const InputEvent& e ) ;
+
+	/// Consumer side, appends every queued event to out and returns their number
+	size_t					drain( std::vector<InputEvent>& out ) ;
+
+	size_t					getCapacity() const { return m_ring.size() ; }
+	/// Returns and resets the number of events dropped because the ring was full
+	U32						takeDroppedCount() ;
+
+private:
+	std::vector<InputEvent>	m_ring ;
+	size_t					m_mask ;
+	std::atomic<size_t>		m_head ;			// next slot to read, written by the consumer
+	std::atomic<size_t>		m_tail ;			// next slot to write, written by the producer
+	std::atomic<U32>		m_dropped ;
+
+							InputEventQueue( const InputEventQueue& ) = delete ;
+	InputEventQueue&		operator=( const InputEventQueue& ) = delete ;
+};
+
+}
+
+#endif // __JAM_INPUTEVENT_H__
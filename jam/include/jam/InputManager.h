@@ -33,9 +33,13 @@
 #include <jam/jam.h>
 #include <jam/Singleton.h>
 #include <jam/String.h>
+#include <jam/InputEvent.h>
 
 #include <SDL.h>
+#include <atomic>
 #include <map>
+#include <thread>
+#include <vector>
 
 // todo : method to choose the maximum number of handled touches
 #define JAM_MAX_TOUCHES   1
@@ -46,6 +50,15 @@ class Timer ;
 
 typedef SDL_Scancode key ;
 
+/*!
+	\class InputManager
+
+	Input events are stamped with the time they happened and queued in a lock-free ring
+	by the thread pumping SDL events, the main thread by default or the polling thread when started.
+	update() drains the ring once per frame, in time order, into the key, pointer and touch states
+	and into the frame events, which keep the sub-frame ordering lost by the states.
+	Fixed step handlers get the events happened during their step from getStepEvents().
+*/
 class JAM_API InputManager : public Singleton<InputManager>
 {
 	friend class Singleton<InputManager> ;
@@ -61,6 +74,7 @@ public:
 
 public:
 	static const uint64_t	DefaultDoubleTapMaxDelayMs ;
+	static const uint32_t	DefaultPollingIntervalUs ;
 
 public:
 	/** Returns true if the given key is currently down. */
@@ -156,8 +170,39 @@ public:
 
 	static String			keyStatusString(KeyStatus ks) ;
 
+	/** Queues an SDL input event, stamped with the time it happened. Must be called by the thread pumping SDL events */
+	void					pushEvent( const SDL_Event& e ) ;
+
+	/** Returns true if e is an event handled by InputManager */
+	static bool				isInputEvent( const SDL_Event& e ) ;
+
+	/**
+		Takes from the SDL queue the next event not handled by InputManager, returns false if there isn't any.
+		Used by the main thread while the polling thread is active, so the polling thread stays the only producer of input events
+	*/
+	static bool				takeNonInputEvent( SDL_Event& e ) ;
+
+	/** Returns the input events received since the previous frame, in the order they happened */
+	InputEventRange			getFrameEvents() const ;
+
+	/** Returns the input events happened during the current fixed step, valid only inside fixedUpdate handlers */
+	InputEventRange			getStepEvents() const ;
+
+	/**
+		Starts a thread pumping SDL input events every intervalUs microseconds, so events are stamped
+		as soon as they arrive instead of once per frame. Window and quit events are still handled by the main thread.
+		\remark Pumping SDL events outside the thread which initialized the video subsystem is not supported on every platform (e.g. Windows and macOS)
+	*/
+	void					startPollingThread( uint32_t intervalUs = DefaultPollingIntervalUs ) ;
+	void					stopPollingThread() ;
+	bool					isPollingThreadActive() const ;
+
 protected:
 	void					update() ;
+	/// Makes getStepEvents() return the events happened up to stepEndNs and not yet returned by a previous step
+	void					beginStep( uint64_t stepEndNs ) ;
+	/// Forgets the events consumed by the steps of this frame, the others are left to the next frame
+	void					endSteps() ;
 	void					touchUpdate() ;
 	void					keyUpdate() ;
 	void					pointerUpdate();
@@ -167,6 +212,8 @@ private:
 	void					mouseButtonCallback( SDL_MouseButtonEvent& e ) ;
 	void					mouseMoveCallback( SDL_MouseMotionEvent& e ) ;
 	void					mouseScrollCallback( SDL_MouseWheelEvent& e );
+	void					dispatchEvent( const InputEvent& e ) ;
+	void					pollingMain( uint32_t intervalUs ) ;
 
 private:
 	KeyStatus				m_keyMap[SDL_NUM_SCANCODES+1] ;
@@ -188,11 +235,22 @@ private:
 	float					m_touchLastY[JAM_MAX_TOUCHES] ;
 
 	bool					m_doubleTap[JAM_MAX_TOUCHES] ;
-	uint64_t				m_lastTapTime[JAM_MAX_TOUCHES] ;
+	uint64_t				m_lastTapTimeNs[JAM_MAX_TOUCHES] ;
 	uint64_t				m_doubleTapDelay ;
 
 	uint16_t				m_frame ;
 
+	InputEventQueue			m_eventQueue ;
+	std::vector<InputEvent>	m_frameEvents ;
+	std::vector<InputEvent>	m_stepEvents ;			// events not yet consumed by fixed steps
+	size_t					m_stepFirst ;
+	size_t					m_stepLast ;
+	uint64_t				m_lastEventTimeNs ;
+	uint64_t				m_dispatchTimeNs ;		// time of the event being dispatched
+
+	std::thread				m_pollingThread ;
+	std::atomic<bool>		m_pollingActive ;
+
 	InputManager() ;
 	virtual ~InputManager() ;
 
@@ -211,6 +269,7 @@ JAM_INLINE uint64_t			InputManager::getDoubleTapMaxDelay() const { return m_doub
 JAM_INLINE bool				InputManager::isTouchDoublePressed(int32_t touchId) { return m_doubleTap[touchId] ; }
 JAM_INLINE Timer&			InputManager::getUpdateTimer() { return *m_pUpdateTimer; }
 JAM_INLINE const Timer&		InputManager::getUpdateTimer() const { return *m_pUpdateTimer; }
+JAM_INLINE bool				InputManager::isPollingThreadActive() const { return m_pollingActive.load(); }
 
 }
 
@@ -0,0 +1,155 @@
+/**********************************************************************************
+* 
+* InstancingManager.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_INSTANCINGMANAGER_H__
+#define __JAM_INSTANCINGMANAGER_H__
+
+#include <GL/glew.h>
+
+#include <jam/jam.h>
+#include <jam/Singleton.h>
+#include <jam/Color.h>
+#include <jam/VertexBufferObject.h>
+#include <jam/core/geom.h>
+
+#include <map>
+#include <vector>
+
+namespace jam
+{
+class Mesh ;
+class SkinnedMesh ;
+class Material ;
+class Shader ;
+
+/*!
+	\class InstancingManager
+
+	Collects the instances of meshes queued during the frame and draws every mesh/material pair
+	with a single glDrawElementsInstanced call.
+
+	Per-instance data (model matrix, normal matrix and color) of the whole frame is packed into one
+	texture buffer which the instanced programs read by gl_InstanceID. Skinned instances also
+	store their bones palettes in a second texture buffer.
+
+	\remark Instances are drawn with ShaderManager instanced programs, lit by the LightManager active lights.
+	Static meshes use the instanced normal mapping program only when their material uses normal mapping
+	and the mesh has tangents, the instanced lit program otherwise
+*/
+class JAM_API InstancingManager : public Singleton<InstancingManager>
+{
+	friend class Singleton<InstancingManager> ;
+
+public:
+	/// number of RGBA32F texels used by a single instance
+	static const size_t		INSTANCE_TEXELS = 8 ;
+
+	/// texture units used by the instance texture buffers (units 0-2 are used by materials)
+	static const GLint		INSTANCE_DATA_TEXTURE_UNIT = 3 ;
+	static const GLint		INSTANCE_BONES_TEXTURE_UNIT = 4 ;
+
+	/// Queues an instance of a static mesh. If pMaterial is null the mesh material is used
+	void					addInstance( Mesh* pMesh, const Matrix4& worldMatrix, const Color& color = Color::WHITE, Material* pMaterial = nullptr ) ;
+
+	/// Queues an instance of a skinned mesh whose bones palette has been stored by addBonesPalette()
+	void					addInstance( SkinnedMesh* pMesh, const Matrix4& worldMatrix, size_t bonesPaletteBase, const Color& color = Color::WHITE, Material* pMaterial = nullptr ) ;
+
+	/// Stores a bones palette for the current frame and returns its base index, to be passed to addInstance()
+	size_t					addBonesPalette( const std::vector<Matrix4>& bones ) ;
+
+	/// Uploads the instances queued so far and draws them, one draw call per mesh/material pair
+	void					flush() ;
+
+	/// Discards all the queued instances
+	void					clear() ;
+
+	size_t					getNumOfInstances() const { return m_numOfInstances; }
+
+	/// Returns the number of draw calls issued by the last flush
+	size_t					getNumOfDrawCalls() const { return m_numOfDrawCalls; }
+
+private:
+							InstancingManager() ;
+	virtual					~InstancingManager() ;
+
+	struct InstanceData
+	{
+		Vector4				modelMatrix[4] ;
+		Vector4				normalMatrix[3] ;		// normalMatrix[0].w holds the bones palette base
+		Vector4				color ;
+	};
+
+	template<typename T>
+	struct Batch
+	{
+		T*					pMesh ;
+		Material*			pMaterial ;
+		Shader*				pShader ;
+		size_t				base ;
+		std::vector<InstanceData>	instances ;
+	};
+
+	template<typename T> using BatchesMap = std::map<std::pair<T*,Material*>,Batch<T>> ;
+
+	void					fillInstance( InstanceData& out, const Matrix4& worldMatrix, float bonesPaletteBase, const Color& color ) ;
+	void					uploadTextureBuffer( VertexBufferObject& vbo, GLuint tex, GLsizeiptr size, const void* data ) ;
+	void					prepareProgram( Shader* pShader ) ;
+	Shader*					getInstancedProgram( Mesh* pMesh, Material* pMaterial ) ;
+	Shader*					getInstancedProgram( SkinnedMesh* pMesh, Material* pMaterial ) ;
+
+	template<typename T>
+	void					stage( BatchesMap<T>& batches ) ;
+
+	template<typename T>
+	void					drawBatches( BatchesMap<T>& batches ) ;
+
+private:
+	BatchesMap<Mesh>		m_meshBatches ;
+	BatchesMap<SkinnedMesh>	m_skinnedMeshBatches ;
+
+	std::vector<InstanceData>	m_instancesStaging ;
+	std::vector<Matrix4>	m_bonesPalettes ;
+
+	VertexBufferObject		m_instancesVbo ;
+	GLuint					m_instancesTex ;
+	VertexBufferObject		m_bonesVbo ;
+	GLuint					m_bonesTex ;
+	GLint					m_maxTextureBufferTexels ;	// queried on the first flush
+
+	std::vector<Shader*>	m_batchPrograms ;			// distinct programs of the batches being drawn
+
+	size_t					m_numOfInstances ;
+	size_t					m_numOfDrawCalls ;
+};
+
+JAM_INLINE InstancingManager& GetInstancingMgr() { return InstancingManager::getSingleton(); }
+
+}
+
+#endif // __JAM_INSTANCINGMANAGER_H__
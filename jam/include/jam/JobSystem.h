@@ -0,0 +1,166 @@
+/**********************************************************************************
+* 
+* JobSystem.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_JOBSYSTEM_H__
+#define __JAM_JOBSYSTEM_H__
+
+#include <jam/jam.h>
+#include <jam/Singleton.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jam
+{
+
+typedef std::function<void()>					JobFunction ;
+typedef std::function<void(size_t,size_t)>		JobRangeFunction ;
+
+/*!
+	\class JobCounter
+
+	Counts the jobs not yet completed of a group. A counter reaches zero when every job
+	run with it has completed: it can be waited on by JobSystem::wait() or used as the
+	dependency of other jobs.
+
+	\remark A counter must outlive the jobs run with it
+*/
+class JAM_API JobCounter
+{
+	friend class JobSystem ;
+
+public:
+							JobCounter() : m_value(0) {}
+
+	/// Returns true when every job run with this counter has completed
+	bool					isDone() const { return m_value.load(std::memory_order_acquire) == 0 ; }
+
+private:
+	std::atomic<int>		m_value ;
+
+							JobCounter( const JobCounter& ) = delete ;
+	JobCounter&				operator=( const JobCounter& ) = delete ;
+};
+
+
+/*!
+	\class JobSystem
+
+	Work-stealing job scheduler.
+
+	Every worker thread owns a queue: it pushes and pops its own jobs in LIFO order, while idle
+	workers steal the oldest jobs of the others. The main thread is worker 0 and executes jobs
+	only while waiting on a counter, so it never sleeps when there is work to do.
+
+	Jobs with a dependency are parked until the dependency counter reaches zero, so a frame can
+	be described as a graph of counters instead of explicit synchronization points.
+
+	\remark Jobs must not touch OpenGL or the scene graph, which are owned by the main thread
+	\remark Only the main thread (the one which created the JobSystem) and the jobs may queue jobs or wait on
+			 counters, since any other thread has no queue of its own
+*/
+class JAM_API JobSystem : public Singleton<JobSystem>
+{
+	friend class Singleton<JobSystem> ;
+
+public:
+	/// Index returned by getThreadIndex() on threads not owned by the JobSystem
+	static const size_t		INVALID_THREAD_INDEX = (size_t)-1 ;
+
+	/// Queues a job; counter is incremented now and decremented when the job completes
+	void					run( const JobFunction& job, JobCounter& counter ) ;
+
+	/// Queues a job that will start only after every job of dependency has completed. dependency must outlive the job
+	void					run( const JobFunction& job, JobCounter& counter, const JobCounter& dependency ) ;
+
+	/// Executes queued jobs until counter reaches zero
+	void					wait( const JobCounter& counter ) ;
+
+	/**
+		Calls func(begin,end) over [0,count) split in chunks of grainSize items and returns
+		when every chunk has been processed. Small ranges are executed inline
+	*/
+	void					parallelFor( size_t count, size_t grainSize, const JobRangeFunction& func ) ;
+
+	/// Number of threads executing jobs, including the main thread
+	size_t					getNumOfThreads() const { return m_queues.size() ; }
+
+	/// Returns the index of the calling thread, 0 for the main thread or INVALID_THREAD_INDEX for a foreign thread
+	static size_t			getThreadIndex() ;
+
+private:
+	struct Job {
+		JobFunction			function ;
+		JobCounter*			pCounter ;
+	};
+
+	struct PendingJob {
+		Job					job ;
+		const JobCounter*	pDependency ;
+	};
+
+	struct WorkQueue {
+		std::mutex			mutex ;
+		std::deque<Job>		jobs ;
+	};
+
+	std::vector<WorkQueue*>		m_queues ;
+	std::vector<std::thread>	m_workers ;
+
+	// jobs waiting for their dependency
+	std::vector<PendingJob>	m_pending ;
+	std::mutex				m_pendingMutex ;
+
+	// used to put idle workers to sleep
+	std::mutex				m_sleepMutex ;
+	std::condition_variable	m_sleepCondition ;
+	std::atomic<int>		m_numOfQueuedJobs ;
+	std::atomic<bool>		m_quit ;
+
+	void					push( const Job& job ) ;
+	bool					pop( size_t threadIndex, Job& job ) ;
+	void					execute( Job& job ) ;
+	void					schedulePending() ;
+	void					workerMain( size_t threadIndex ) ;
+
+							JobSystem() ;
+	virtual					~JobSystem() ;
+};
+
+/** Returns the singleton instance */
+JAM_INLINE JobSystem& GetJobSystem() { return JobSystem::getSingleton(); }
+
+}
+
+#endif // __JAM_JOBSYSTEM_H__
@@ -37,10 +37,26 @@
 #include <jam/Singleton.h>
 #include <jam/Object.h>
 #include <jam/BaseManager.hpp>
+#include <jam/VertexBufferObject.h>
 #include <jam/core/geom.h>
 
+#include <vector>
+
+/// max number of active lights, it must match MAX_LIGHTS in the lit shaders
+#define JAM_LIGHTS_MAX						128
+
+/// clusters grid: screen tiles along x and y, exponential depth slices along z
+#define JAM_LIGHTS_CLUSTERS_X				16
+#define JAM_LIGHTS_CLUSTERS_Y				9
+#define JAM_LIGHTS_CLUSTERS_Z				24
+
+/// max number of light indices referenced by all the clusters in a frame
+#define JAM_LIGHTS_MAX_INDICES				32768
+
 namespace jam
 {
+class Shader ;
+class Camera ;
 
 /*!
 	\class Light
@@ -56,6 +72,7 @@ public:
 
 	Light() ;
 
+	/// Makes this light the idx-th active light of the LightManager
 	void				update( int16_t idx ) ;
 	void				dump() ;
 
@@ -79,6 +96,9 @@ public:
 	Color				getDiffuseColor() const ;
 	Color				getSpecularColor() const ;
 
+	/// Returns the distance beyond which a point light contributes less than 1/256 of its intensity
+	float				getRange() const ;
+
 private:
 	Type				m_type ;
 	Vector3				m_position ;
@@ -104,15 +124,100 @@ JAM_INLINE Color		Light::getAmbientColor() const { return m_ambient; }
 JAM_INLINE Color		Light::getDiffuseColor() const { return m_diffuse; }
 JAM_INLINE Color		Light::getSpecularColor() const { return m_specular; }
 
+/*!
+	\class LightManager
+
+	Keeps the active lights and shares them with every lit program through the LightsBlock uniform block.
+
+	Once per frame (and camera) prepare() packs the active lights into a uniform buffer, directional lights
+	first, and bins the point lights into a grid of clusters (screen tiles split into exponential depth slices)
+	by their view space bounding sphere. Clusters and light indices are stored in a texture buffer, so that
+	a fragment only loops over the directional lights and the point lights overlapping its cluster.
+
+	The buffers are bound once per frame by bind(), and the lightGrid sampler of every program is set when
+	the program is linked, so programs drawn through Gfx find the lights without calling prepare().
+
+	\remark Lights changed after the first prepare() of a frame are applied from the next frame
+*/
 class JAM_API LightManager : public NamedObjectManager<Light>, public jam::Singleton<LightManager>
 {
 	friend class jam::Singleton<LightManager> ;
 
 public:
+	/// binding point of the LightsBlock uniform block
+	static const GLuint		UNIFORM_BLOCK_BINDING = 0 ;
+
+	/// texture unit used by the clusters texture buffer (units 0-4 are used by materials and instancing)
+	static const GLint		GRID_TEXTURE_UNIT = 5 ;
+
+	void					addActiveLight( Light* pLight ) ;
+	void					removeActiveLight( Light* pLight ) ;
+	/// Sets the idx-th active light, growing the active lights if needed
+	void					setActiveLight( size_t idx, Light* pLight ) ;
+	void					clearActiveLights() ;
+
+	size_t					getNumOfActiveLights() const { return m_activeLights.size(); }
+	Light*					getActiveLight( size_t idx ) const { return m_activeLights[idx].get(); }
+
+	/// Invalidates the lights packed in the previous frame
+	void					newFrame() ;
+
+	/// Packs the lights for the given camera if needed, the packed lights are seen by all the programs
+	void					prepare( Camera* pCam ) ;
+
+	/// Packs the lights for the given camera if needed, then binds the lights block and the clusters texture. Called once per frame by Application
+	void					bind( Camera* pCam ) ;
 
 protected:
-						LightManager() = default ;
+							LightManager() ;
+	virtual					~LightManager() ;
+
+private:
+	// std140 layout of the LightsBlock uniform block
+	struct LightData
+	{
+		Vector4				positionType ;			// w: light type
+		Vector4				directionRange ;		// w: range of influence
+		Vector4				ambientConstant ;		// w: constant attenuation factor
+		Vector4				diffuseLinear ;			// w: linear attenuation factor
+		Vector4				specularQuadratic ;		// w: quadratic attenuation factor
+	};
+
+	struct LightsBlock
+	{
+		LightData			lights[JAM_LIGHTS_MAX] ;
+		I32					lightsInfo[4] ;			// number of directional lights, clusters grid size
+		Vector4				clusterParams ;			// near plane, depth slices scale
+		Vector4				clusterViewport ;		// viewport origin and size
+		Matrix4				clusterView ;
+	};
+
+	// clusters overlapped by a point light
+	struct LightClusters
+	{
+		U16					light ;
+		U8					minX, maxX, minY, maxY, minZ, maxZ ;
+	};
+
+	void					pack( Camera* pCam ) ;
+	void					packLight( LightData& out, const Light* pLight ) ;
+	bool					computeClusters( LightClusters& out, const Light* pLight, const Matrix4& view, const Matrix4& proj, float zNear, float zFar ) ;
+	void					upload() ;
+
 private:
+	std::vector<Ref<Light>>	m_activeLights ;
+
+	LightsBlock				m_block ;
+	std::vector<LightClusters>	m_lightClusters ;
+	// for each cluster its light indices offset (high 16 bits) and count (low 16 bits), then the light indices
+	std::vector<U32>		m_grid ;
+
+	VertexBufferObject		m_blockUbo ;
+	VertexBufferObject		m_gridVbo ;
+	GLuint					m_gridTex ;
+
+	Camera*					m_pPackedCamera ;
+	bool					m_dirty ;
 };
 
 JAM_INLINE LightManager& GetLightMgr() { return (LightManager&) LightManager::getSingleton(); }
@@ -108,6 +108,8 @@ public:
 	Shader*					getShader() const ;
 
 	void					bind() ;
+	// binds the material state using the given program instead of the material's own shader
+	void					bind( Shader* pProgram ) ;
 	void					unbind() ;
 	
 private:
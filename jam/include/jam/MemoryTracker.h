@@ -0,0 +1,105 @@
+/**********************************************************************************
+* 
+* MemoryTracker.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_MEMORYTRACKER_H__
+#define __JAM_MEMORYTRACKER_H__
+
+#include <jam/jam.h>
+
+#include <vector>
+
+namespace jam
+{
+
+class RefCountedObject ;
+
+/**
+	Memory used by the tracked objects, returned by MemoryTracker::getStats()
+*/
+struct MemoryStats
+{
+	size_t					liveObjects ;
+	size_t					liveBytes ;
+	size_t					peakLiveBytes ;
+	uint64_t				allocations ;			// since the application started
+	uint64_t				frameAllocations ;		// during the last frame
+	uint64_t				frameBytes ;
+};
+
+/**
+	Memory used by the tracked objects of a concrete type, returned by MemoryTracker::getTypeStats()
+*/
+struct ObjectTypeStats
+{
+	const char*				name ;					// as given by type_info::name()
+	size_t					liveObjects ;
+	size_t					liveBytes ;
+	uint64_t				released ;				// objects deleted by RefCountedObject::release()
+	uint64_t				frameAllocations ;		// since the last newFrame(), still alive or already released
+};
+
+/*!
+	\class MemoryTracker
+
+	Opt-in accounting of the RefCountedObject instances allocated by operator new, enabled by JAM_MEMORY_TRACKING.
+
+	Every allocation is recorded with its size and frame, and it's bound to its object when the object is constructed.
+	Global counters are always up to date, the statistics of every type are computed on request by walking the live objects.
+	Objects deleted without release() are counted globally but not by type, objects in frame memory are not tracked.
+
+	\remark getTypeStats() and dump() must be called when no job is creating objects, e.g. between frames
+	\remark Tracking takes a lock for every allocation, it's meant for debugging sessions
+*/
+class JAM_API MemoryTracker
+{
+public:
+	/// Returns true if the engine has been built with JAM_MEMORY_TRACKING
+	static bool				isEnabled() ;
+
+	/// Called by Application at the beginning of every frame
+	static void				newFrame() ;
+
+	static void				getStats( MemoryStats& stats ) ;
+
+	/// Replaces the content of stats with the live objects grouped by type, sorted by decreasing live bytes
+	static void				getTypeStats( std::vector<ObjectTypeStats>& stats ) ;
+
+	/// Traces the global and the per type statistics, e.g. to find the objects leaked at the end of a run
+	static void				dump() ;
+
+	// used by RefCountedObject
+	static void				trackAllocation( void* p, size_t size ) ;
+	static void				trackDeallocation( void* p ) ;
+	static void				trackConstruction( RefCountedObject* pObj ) ;
+	static void				trackRelease( RefCountedObject* pObj ) ;
+};
+
+}
+
+#endif // __JAM_MEMORYTRACKER_H__
@@ -44,6 +44,18 @@
 namespace jam
 {
 
+/**
+	Interleaved vertex layout used by cooked models
+*/
+struct MeshVertex
+{
+	Vector3					position ;
+	Vector3					normal ;
+	Vector2					texCoords ;
+	Vector3					tangent ;
+	Vector3					bitangent ;
+};
+
 /*!
 	\class Mesh
 */
@@ -59,11 +71,15 @@ public:
 	void					create(int numOfVertices, int numOfElements) ;
 	void					destroy() ;
 	void					upload() ;
+	void					uploadInterleaved( const MeshVertex* pVertices, size_t numOfVertices, const U16* pElements, size_t numOfElements ) ;
 	void					draw() ;
+	void					drawInstanced( size_t numOfInstances, Shader* pShader, Material* pMaterial = nullptr ) ;
 
 	bool					isUploaded() const ;
+	size_t					getNumOfElements() const ;
 
 	void					disableTangents( bool value = true ) ;
+	bool					isTangentsDisabled() const ;
 
 	void					doNotCalculateTangents() ;
 
@@ -90,6 +106,7 @@ private:
 	VertexBufferObject		m_elementsVbo ;
 	VertexArrayObject		m_vao ;
 
+	size_t					m_numOfElements ;
 	bool					m_uploaded ;
 	bool					m_tangentsDisabled ;
 	bool					m_needsCalculateTangents ;
@@ -103,6 +120,8 @@ JAM_INLINE HeapArray<Vector3>&		Mesh::getTangentsArray() { return m_tangents; }
 JAM_INLINE HeapArray<Vector3>&		Mesh::getBitangentsArray() { return m_bitangents; }
 JAM_INLINE HeapArray<uint16_t>&		Mesh::getElementsArray() { return m_elements; }
 JAM_INLINE bool						Mesh::isUploaded() const { return m_uploaded; }
+JAM_INLINE bool						Mesh::isTangentsDisabled() const { return m_tangentsDisabled; }
+JAM_INLINE size_t					Mesh::getNumOfElements() const { return m_numOfElements; }
 
 }
 
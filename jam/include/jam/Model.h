@@ -37,6 +37,7 @@
 #include <jam/Transform.h>
 #include <jam/Gameobject.h>
 #include <jam/Ref.hpp>
+#include <jam/ModelCache.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -55,12 +56,21 @@ public:
 	virtual					~Model() ;
 
 	void					draw() ;
+
+	/**
+		Loads the model from its cooked file if up to date, otherwise imports it with assimp and cooks it
+		\remark models loaded from the same file share their meshes
+	*/
 	void					load(const String& modelPath) ;
 
+	/// Queues an instance of the model with the given world matrix, it will be drawn by InstancingManager::flush()
+	void					addInstance( const Matrix4& worldMatrix, const Color& color = Color::WHITE ) ;
+
 private:
-	void					processNode(aiNode* node, const aiScene* scene) ;
-	Mesh*					processMesh(aiMesh* mesh, const aiScene* scene) ;
-	void					loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::vector<Texture2D*>& out ) ;
+	void					cook( const String& modelPath, std::vector<U8>& blob ) ;
+	void					processNode(aiNode* node, const aiScene* scene, CookedModelWriter& writer) ;
+	void					processMesh(aiMesh* mesh, const aiScene* scene, CookedModelWriter& writer) ;
+	void					loadMaterialTexture(aiMaterial* mat, aiTextureType type, char* pOut ) ;
 
 private:
 	std::vector<Ref<Mesh>>	m_meshes ;
@@ -0,0 +1,281 @@
+/**********************************************************************************
+* 
+* ModelCache.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_MODELCACHE_H__
+#define __JAM_MODELCACHE_H__
+
+#include <jam/jam.h>
+#include <jam/Singleton.h>
+#include <jam/RefCountedObject.h>
+#include <jam/Ref.hpp>
+#include <jam/Mesh.h>
+#include <jam/SkinnedMesh.h>
+#include <jam/Texture2D.h>
+#include <jam/core/geom.h>
+
+#include <map>
+#include <vector>
+
+#define JAM_COOKED_MODEL_MAGIC			0x4C444D4A		// "JMDL"
+#define JAM_COOKED_MODEL_VERSION		2
+#define JAM_COOKED_MODEL_EXTENSION		".jmdl"
+#define JAM_COOKED_MAX_NAME_LENGTH		128
+
+namespace jam
+{
+
+/*
+	Cooked model file layout, every block starts on a 4 bytes boundary
+
+	CookedModelHeader
+	numOfMeshes x { CookedMeshHeader, vertices[numOfVertices*vertexStride bytes], elements[numOfElements U16 padded to 4 bytes] }
+	numOfBones  x Matrix4 (bone offset)
+	numOfNodes  x CookedNode (parents always precede their children)
+	numOfClips  x { CookedClipHeader, numOfChannels x { CookedChannelHeader, CookedVectorKey[], CookedQuatKey[], CookedVectorKey[] } }
+*/
+
+struct CookedModelHeader
+{
+	U32						magic ;
+	U32						version ;
+	U32						skinned ;
+	U32						sourceSize ;		// size and last modification time of the source asset, used to detect stale files
+	I64						sourceTime ;
+	U32						numOfMeshes ;
+	U32						numOfBones ;
+	U32						numOfNodes ;
+	U32						numOfClips ;
+	Matrix4					globalInverseTransform ;
+};
+
+struct CookedMeshHeader
+{
+	U32						numOfVertices ;
+	U32						numOfElements ;
+	U32						vertexStride ;
+	F32						shininess ;			// negative if the source material has no shininess
+	char					diffuseTexture[JAM_COOKED_MAX_NAME_LENGTH] ;
+	char					specularTexture[JAM_COOKED_MAX_NAME_LENGTH] ;
+	char					normalTexture[JAM_COOKED_MAX_NAME_LENGTH] ;
+};
+
+struct CookedNode
+{
+	I32						parent ;			// -1 for the root node
+	I32						boneIndex ;			// -1 if the node doesn't drive a bone
+	Matrix4					transform ;
+};
+
+struct CookedClipHeader
+{
+	char					name[JAM_COOKED_MAX_NAME_LENGTH] ;
+	F32						duration ;
+	F32						ticksPerSecond ;
+	U32						numOfChannels ;
+	U32						reserved ;
+};
+
+struct CookedChannelHeader
+{
+	I32						nodeIndex ;
+	U32						numOfPositionKeys ;
+	U32						numOfRotationKeys ;
+	U32						numOfScalingKeys ;
+};
+
+struct CookedVectorKey
+{
+	F32						time ;
+	Vector3					value ;
+};
+
+struct CookedQuatKey
+{
+	F32						time ;
+	Vector4					value ;				// x, y, z, w
+};
+
+/// Non owning views over a cooked blob
+struct CookedMeshView
+{
+	const CookedMeshHeader*	pHeader ;
+	const U8*				pVertices ;
+	const U16*				pElements ;
+};
+
+struct CookedChannelView
+{
+	const CookedChannelHeader*	pHeader ;
+	const CookedVectorKey*	pPositions ;
+	const CookedQuatKey*	pRotations ;
+	const CookedVectorKey*	pScalings ;
+};
+
+struct CookedClipView
+{
+	const CookedClipHeader*	pHeader ;
+	std::vector<CookedChannelView>	channels ;
+	std::vector<I32>		nodeChannels ;		// node index -> channel index, -1 if the node is not animated
+};
+
+struct CookedModelView
+{
+	const CookedModelHeader*	pHeader ;
+	std::vector<CookedMeshView>	meshes ;
+	const Matrix4*			pBoneOffsets ;
+	const CookedNode*		pNodes ;
+	std::vector<CookedClipView>	clips ;
+};
+
+
+/*!
+	\class CookedModelWriter
+	Appends cooked model blocks to a byte buffer
+*/
+class JAM_API CookedModelWriter
+{
+public:
+							CookedModelWriter( std::vector<U8>& out ) ;
+
+	size_t					tell() const ;
+	void					write( const void* pData, size_t size ) ;
+	template<typename T> void	write( const T& value ) { write( &value, sizeof(T) ) ; }
+	void					align() ;
+
+	/// Returns a block already written, the pointer is valid until the next write
+	template<typename T> T*	at( size_t offset ) { return (T*)(m_out.data() + offset) ; }
+
+	static void				copyName( char* pDest, const char* pSrc ) ;
+
+private:
+	std::vector<U8>&		m_out ;
+};
+
+
+/*!
+	\class ModelData
+	GPU data shared by every Model loaded from the same file
+*/
+class JAM_API ModelData : public RefCountedObject
+{
+public:
+							ModelData() = default ;
+
+	std::vector<Ref<Mesh>>&	getMeshes() ;
+
+private:
+	std::vector<Ref<Mesh>>	m_meshes ;
+};
+
+JAM_INLINE std::vector<Ref<Mesh>>&	ModelData::getMeshes() { return m_meshes; }
+
+
+/*!
+	\class SkinnedModelData
+	GPU data, skeleton and clips shared by every SkinnedModel loaded from the same file
+	\remark skeleton and clips point straight into the cooked blob, which is kept alive by this object
+*/
+class JAM_API SkinnedModelData : public RefCountedObject
+{
+public:
+							SkinnedModelData() = default ;
+
+	std::vector<Ref<SkinnedMesh>>&	getMeshes() ;
+	std::vector<U8>&		getBlob() ;
+	CookedModelView&		getView() ;
+	const CookedModelView&	getView() const ;
+
+private:
+	std::vector<Ref<SkinnedMesh>>	m_meshes ;
+	std::vector<U8>			m_blob ;
+	CookedModelView			m_view ;
+};
+
+JAM_INLINE std::vector<Ref<SkinnedMesh>>&	SkinnedModelData::getMeshes() { return m_meshes; }
+JAM_INLINE std::vector<U8>&					SkinnedModelData::getBlob() { return m_blob; }
+JAM_INLINE CookedModelView&					SkinnedModelData::getView() { return m_view; }
+JAM_INLINE const CookedModelView&			SkinnedModelData::getView() const { return m_view; }
+
+
+/*!
+	\class ModelCache
+
+	Reads and writes cooked models (JAM_COOKED_MODEL_EXTENSION files stored next to the source asset)
+	and keeps a registry of the models already loaded, so repeated loads of the same file share GPU data
+*/
+class JAM_API ModelCache : public jam::Singleton<ModelCache>
+{
+	friend class jam::Singleton<ModelCache> ;
+
+public:
+	ModelData*				findModel( const String& modelPath ) ;
+	void					addModel( const String& modelPath, ModelData* pData ) ;
+
+	SkinnedModelData*		findSkinnedModel( const String& modelPath ) ;
+	void					addSkinnedModel( const String& modelPath, SkinnedModelData* pData ) ;
+
+	/// Drops the registry entries no longer referenced by any model
+	void					purgeUnused() ;
+	void					removeAll() ;
+
+	bool					isCookingEnabled() const ;
+	/// When disabled the cooked files are neither read nor written
+	void					setCookingEnabled( bool value ) ;
+
+	/// Reads the cooked file of modelPath, returns false if it is missing or out of date
+	bool					readCooked( const String& modelPath, bool skinned, std::vector<U8>& blob ) ;
+	bool					writeCooked( const String& modelPath, const std::vector<U8>& blob ) ;
+
+	/// Creates the material textures of a cooked mesh, textures already in textures are reused
+	void					setupMaterial( Material* pMaterial, const CookedMeshHeader& header, const String& folder, std::map<String,Ref<Texture2D>>& textures ) ;
+
+	static String			getCookedPathName( const String& modelPath ) ;
+	static bool				parse( const std::vector<U8>& blob, CookedModelView& view ) ;
+
+protected:
+							ModelCache() ;
+	virtual					~ModelCache() ;
+
+private:
+	static String			getKey( const String& modelPath ) ;
+	Texture2D*				getTexture( const char* pName, const String& folder, std::map<String,Ref<Texture2D>>& textures ) ;
+
+	std::map<String,Ref<ModelData>>			m_models ;
+	std::map<String,Ref<SkinnedModelData>>	m_skinnedModels ;
+	bool					m_cookingEnabled ;
+};
+
+JAM_INLINE bool				ModelCache::isCookingEnabled() const { return m_cookingEnabled; }
+JAM_INLINE void				ModelCache::setCookingEnabled( bool value ) { m_cookingEnabled = value; }
+
+JAM_INLINE ModelCache&		GetModelCache() { return (ModelCache&) ModelCache::getSingleton(); }
+
+}
+
+#endif
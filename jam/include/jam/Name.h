@@ -0,0 +1,124 @@
+/**********************************************************************************
+* 
+* Name.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_NAME_H__
+#define __JAM_NAME_H__
+
+#include <jam/jam.h>
+#include <jam/String.h>
+
+#include <cstdint>
+
+namespace jam
+{
+
+/*!
+	\class Name
+
+	A string interned in a global table, to be used as a key in the object managers.
+	Each interned string stores its case-folded hash and the entry of its lowercase form, so
+	names compare case-insensitively (the same way managers always did) with a pointer comparison.
+	Interned strings are never freed; they are meant for names given by the user, not for unique ids.
+	Objects without a user name get an anonymous Name built from their address, which is not interned
+	and does not allocate.
+*/
+class JAM_API Name
+{
+public:
+	struct Hasher
+	{
+		size_t				operator()( const Name& name ) const { return name.getHash() ; }
+	};
+
+public:
+							Name() : m_pEntry(nullptr), m_id(0) {}
+
+	/// Interns the given string (if not already interned)
+	explicit				Name( const String& str ) ;
+	explicit				Name( const char* str ) ;
+
+	/// Returns the Name of an already interned string (or of its lowercase form) or a null Name. Never interns nor allocates.
+	static Name				find( const String& str ) ;
+	static Name				find( const char* str ) ;
+
+	/// Returns an anonymous Name, unique for the given address
+	static Name				fromId( const void* p ) ;
+
+	bool					isNull() const { return m_pEntry == nullptr && m_id == 0 ; }
+	bool					isAnonymous() const { return m_id != 0 ; }
+
+	/// Returns the interned string, empty for a null or an anonymous Name
+	const String&			str() const ;
+	const char*				c_str() const { return str().c_str() ; }
+
+	/// Returns the case-folded hash, precomputed at intern time
+	size_t					getHash() const { return m_pEntry ? m_pEntry->foldedHash : hashId(m_id) ; }
+
+	/// Case-insensitive comparison
+	bool					operator==( const Name& other ) const ;
+	bool					operator!=( const Name& other ) const { return !(*this == other) ; }
+
+	/// Case-sensitive comparison
+	bool					equals( const Name& other ) const { return m_pEntry == other.m_pEntry && m_id == other.m_id ; }
+
+	/// Returns the number of strings interned so far
+	static size_t			getNumOfInterned() ;
+
+private:
+	struct Entry
+	{
+		String				str ;
+		const Entry*		pFolded ;			// entry of the lowercase string (itself if already lowercase)
+		size_t				hash ;				// hash of the exact string
+		size_t				foldedHash ;		// hash of the lowercase string
+		Entry*				pNext ;				// next entry in the same bucket
+	};
+
+	explicit				Name( const Entry* pEntry ) : m_pEntry(pEntry), m_id(0) {}
+
+	static size_t			hashId( uintptr_t id ) { return (size_t)(id ^ (id >> 4)) * (size_t)0x9E3779B97F4A7C15ull ; }
+
+	friend class NameTable ;
+
+private:
+	const Entry*			m_pEntry ;
+	uintptr_t				m_id ;
+};
+
+JAM_INLINE bool Name::operator==( const Name& other ) const
+{
+	if( m_pEntry && other.m_pEntry ) {
+		return m_pEntry->pFolded == other.m_pEntry->pFolded ;
+	}
+	return m_pEntry == other.m_pEntry && m_id == other.m_id ;
+}
+
+}
+
+#endif // __JAM_NAME_H__
@@ -0,0 +1,141 @@
+/**********************************************************************************
+* 
+* Narrowphase.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+#ifndef __JAM_NARROWPHASE_H__
+#define __JAM_NARROWPHASE_H__
+
+#include <jam/jam.h>
+#include <jam/Circle2f.h>
+#include <jam/Polygon2f.h>
+
+#include <vector>
+
+#define NARROWPHASE_BATCH_LANES					4
+#define NARROWPHASE_BATCHES_GRAIN				16
+
+
+namespace jam
+{
+
+/*!
+	\class Narrowphase
+
+	Batched contact tests between circles and convex polygons.
+
+	Tests are gathered with the add methods, each one returning the index of its result, and then
+	executed together by run(). Circle-circle, quad-quad (e.g. the collision OBBs) and circle-quad tests
+	are stored in SoA batches of NARROWPHASE_BATCH_LANES tests and computed by SIMD kernels (SSE2, or a
+	scalar fallback when JAM_SIMD_DISABLED is defined or SSE2 isn't available), one test per lane.
+	Polygons with a different number of vertices fall back to the scalar Polygon2f and Circle2f tests.
+
+	A hit test returns the contact: the unit normal pointing from the first shape towards the second one
+	and the penetration depth along it.
+*/
+class JAM_API Narrowphase
+{
+public:
+							Narrowphase() ;
+
+	/// Removes the tests and their results
+	void					clear() ;
+
+	size_t					addCircles( const Circle2f& a, const Circle2f& b ) ;
+	size_t					addPolygons( const Polygon2f& a, const Polygon2f& b ) ;
+	size_t					addCirclePolygon( const Circle2f& a, const Polygon2f& b ) ;
+
+	/// Runs the tests added since the last clear(), the batches are split among the JobSystem threads if parallel is true
+	void					run( bool parallel = false ) ;
+
+	size_t					getNumOfTests() const { return m_results.size() ; }
+	bool					isHit( size_t test ) const { return m_results[test].hit ; }
+	const Vector2&			getNormal( size_t test ) const { return m_results[test].normal ; }
+	float					getDepth( size_t test ) const { return m_results[test].depth ; }
+
+private:
+	struct Result {
+		Vector2				normal ;
+		float				depth ;
+		bool				hit ;
+	};
+
+	// SoA batches, lane i holds the i-th test of the batch
+	struct CircleBatch {
+		float				ax[NARROWPHASE_BATCH_LANES], ay[NARROWPHASE_BATCH_LANES], ar[NARROWPHASE_BATCH_LANES] ;
+		float				bx[NARROWPHASE_BATCH_LANES], by[NARROWPHASE_BATCH_LANES], br[NARROWPHASE_BATCH_LANES] ;
+		size_t				tests[NARROWPHASE_BATCH_LANES] ;
+		size_t				count ;
+	};
+
+	struct QuadBatch {
+		float				ax[4][NARROWPHASE_BATCH_LANES], ay[4][NARROWPHASE_BATCH_LANES] ;
+		float				bx[4][NARROWPHASE_BATCH_LANES], by[4][NARROWPHASE_BATCH_LANES] ;
+		size_t				tests[NARROWPHASE_BATCH_LANES] ;
+		size_t				count ;
+	};
+
+	struct CircleQuadBatch {
+		float				ax[NARROWPHASE_BATCH_LANES], ay[NARROWPHASE_BATCH_LANES], ar[NARROWPHASE_BATCH_LANES] ;
+		float				bx[4][NARROWPHASE_BATCH_LANES], by[4][NARROWPHASE_BATCH_LANES] ;
+		size_t				tests[NARROWPHASE_BATCH_LANES] ;
+		size_t				count ;
+	};
+
+	// tests between polygons that aren't quads
+	struct PolygonTest {
+		Polygon2f			a ;
+		Polygon2f			b ;
+		size_t				test ;
+	};
+
+	struct CirclePolygonTest {
+		Circle2f			a ;
+		Polygon2f			b ;
+		size_t				test ;
+	};
+
+	std::vector<Result>				m_results ;
+	std::vector<CircleBatch>		m_circleBatches ;
+	std::vector<QuadBatch>			m_quadBatches ;
+	std::vector<CircleQuadBatch>	m_circleQuadBatches ;
+	std::vector<PolygonTest>		m_polygonTests ;
+	std::vector<CirclePolygonTest>	m_circlePolygonTests ;
+
+	// returns the lane of the next test, appending a batch when the last one is full
+	template<typename Batch>
+	size_t					nextLane( std::vector<Batch>& batches, size_t test ) ;
+
+	size_t					addResult() ;
+
+	void					runCircles( const CircleBatch& batch ) ;
+	void					runQuads( const QuadBatch& batch ) ;
+	void					runCircleQuads( const CircleQuadBatch& batch ) ;
+};
+
+}
+
+#endif // __JAM_NARROWPHASE_H__
@@ -40,6 +40,7 @@
 #include <jam/Event.h>
 #include <jam/InputManager.h>
 #include <jam/Ref.hpp>
+#include <jam/FrameAllocator.h>
 
 #include <list>
 #include <map>
@@ -80,12 +81,37 @@ typedef	Event<TouchEventArgs>	TouchEvent ;
 
 struct JAM_API ObjCollision {
 	Node *with;
+	Vector2 normal;		// unit contact normal, pointing from this node towards with
+	float depth;		// penetration depth along normal, 0 when not computed
 //	Vector coords;
 //	Collision collision;
 };
 
 typedef std::list<Ref<Node>>	NodesList ;
 
+/// Place of a touchable node in the scene PickGrid
+struct JAM_API PickProxy
+{
+							PickProxy() : slot(-1), minX(0), minY(0), maxX(-1), maxY(-1), frame(0), order(0) {}
+
+	I32						slot ;				// index in the grid nodes, -1 when not in the grid
+	I32						minX ;				// range of cells covered by the world bounds
+	I32						minY ;
+	I32						maxX ;
+	I32						maxY ;
+	U32						frame ;				// last frame the node was visited
+	U32						order ;				// visit order in that frame, higher is on top
+};
+
+/// Collision layer bits of a node, refreshed by the CollisionManager when the node enters the quadtree
+struct JAM_API CollisionProxy
+{
+							CollisionProxy() : category(0), mask(~(U64)0) {}
+
+	U64						category ;			// bit of the collision type, 0 if the node doesn't collide
+	U64						mask ;				// layers the node accepts to collide with, all by default
+};
+
 /**
 	This is the core class Node
 
@@ -101,6 +127,7 @@ class JAM_API Node : public NamedTaggedObject
 	friend class RotateBy ;
 	friend class Animate ;
 	friend class Scene ;
+	friend class PickGrid ;
 
 public:
 	typedef std::map<String,String>				AttributesList ;
@@ -491,6 +518,21 @@ public:
 	bool					isInView();
 	bool					isInViewActive(bool forceVerify = true);
 
+	/**
+		Enables the culling of the children subtrees: visit() skips the subtrees whose bounds are
+		entirely outside the view of the camera, so their nodes are neither updated nor rendered.
+		Suited to containers of many nodes, e.g. the layers of a scrolling level. Default is disabled
+		\remark Children with their own camera are never culled
+	*/
+	void					setCullingEnabled(bool val = true) { m_cullingEnabled = val; }
+	bool					isCullingEnabled() const { return m_cullingEnabled; }
+
+	/** Returns the world bounds of this node and all its descendants, they are updated only when a node below moves */
+	void					getSubtreeBounds( Vector2& boundsMin, Vector2& boundsMax ) const ;
+
+	/** Returns the number of subtrees culled by the last scene visit */
+	static U32				getNumOfCulledSubtrees() ;
+
 	/** Returns the list of this node (if enabled) and all its enabled children */
 	void					enumEnabled( std::vector<Node*> &out ) const ;
 
@@ -665,6 +707,38 @@ public:
 	virtual void			onResume() ;
 
 
+	//
+	// render interpolation
+	//
+
+	/**
+		Enables or disables render interpolation for this node.
+		When enabled, the node is rendered between the state it had before the last fixed simulation step
+		and its current state, according to Application::getInterpolationAlpha()
+		\remark Use it for nodes moved in fixedUpdate() handlers or by physics, so their motion doesn't stutter
+				 when the refresh rate differs from the simulation rate
+	*/
+	void					setInterpolated( bool val = true ) ;
+
+	/** Returns whether render interpolation is enabled for this node */
+	bool					isInterpolated() const { return m_interpolated; }
+
+	/** Discards the previous simulation state, e.g. after teleporting the node */
+	void					resetInterpolation() ;
+
+	/** Returns true if this node or one of its ancestors is interpolated */
+	bool					isInterpolationActive() const ;
+
+	/**
+		Returns the world transformation matrix used to render the node
+		\remark It's equal to getWorldTform() if neither this node nor its ancestors are interpolated
+	*/
+	Matrix3					getRenderTform() const ;
+
+	/** Returns the oriented bounding box transformed with getRenderTform() */
+	const Polygon2f&		getRenderTransformedAABB() const ;
+
+
 	//
 	// collisions
 	//
@@ -697,9 +771,10 @@ public:
 	\brief Sets the collision type for a node.
 
 	A collision_type value of 0 indicates that no collision checking will occur with that node.
-	A collision value of 1-999 will mean collision checking will occur.
+	A collision value of 1-JAM_CM_MAX_COLL_LAYERS will mean collision checking will occur,
+	the type is the collision layer of the node.
 
-	\param collType Collision type of node. Must be in the range 0-999.
+	\param collType Collision type of node. Must be in the range 0-JAM_CM_MAX_COLL_LAYERS.
 	\param recursive Optional - true to apply collision type to entity's children. Defaults to false.
 	*/
 	void					setCollisionType( int collType, bool recursive=false ) ;
@@ -707,6 +782,17 @@ public:
 	/** Returns the collision type of a node */
 	int						getCollisionType() const { return m_collType; }
 
+	/**
+		Restricts the collision layers this node collides with, on top of the types enabled by CollisionManager::setCollisions().
+		A pair is tested only if each node's mask contains the layer of the other one.
+		\sa CollisionManager::getLayerBit
+	*/
+	void					setCollisionMask( U64 mask ) { m_collProxy.mask = mask; }
+	U64						getCollisionMask() const { return m_collProxy.mask; }
+
+	/** Returns the layer bit of the node as of the last CollisionManager update, 0 if the node didn't collide */
+	U64						getCollisionCategory() const { return m_collProxy.category; }
+
 	/** Returns how many collisions this node was involved in during the last update. */
 	size_t					countCollisions() const ;
 
@@ -727,6 +813,14 @@ public:
 	*/
 	virtual bool			collide(Node* other, CollisionManager::Method m) const ;
 
+	/**
+		Returns true if collide() is the standard test of Sprite: collision bounding circles, then collision OBBs
+		for BoundingBox and PerPixel, then pixels for PerPixel. The CollisionManager batches the bounding tests
+		of these nodes in its narrowphase, returning also the contact normal and depth.
+		\remark Overrides of collide() doing anything else must return false
+	*/
+	virtual bool			hasStandardCollide() const { return false; }
+
 
 	//
 	// touch handling
@@ -860,10 +954,15 @@ protected:
 	void					updateWorldTForm();
 	void					updateOBB();
 	void					updateTouches();
+	/// Returns true if the node has a touch state to be updated in the next frames, even if it is not under a touch
+	bool					hasTouchState() const ;
 
 	void					invalidateLocal();
 	void					invalidateWorld();
 	void					invalidateOBB();
+	void					invalidateSubtreeBounds();
+	bool					isInCullingView( Camera* pCamera ) const ;
+	static void				resetCulling() ;
 
 	bool					isLocalTformInvalid() const { return m_local_tform_dirty; }
 	bool					isWorldTformInvalid() const { return m_world_tform_dirty; }
@@ -892,6 +991,9 @@ private:
 
 	void					detachChild(Node *child, bool doCleanup);
 
+	// called by Scene before every fixed simulation step
+	void					storeSimulationState() ;
+
 protected:
 	bool					m_local_tform_dirty ;
 	Matrix3				m_local_tform ;
@@ -905,6 +1007,13 @@ protected:
 	Matrix3				m_world_rot ;
 	Vector2				m_world_scl ;
 
+	// simulation state before the last fixed step, used by render interpolation
+	bool					m_interpolated ;
+	Vector2					m_prev_pos ;
+	float					m_prev_angle ;
+	Vector2					m_prev_scl ;
+	mutable Polygon2f		m_renderObb ;
+
 	Vector2				m_hspot ;
 	bool					m_enabled ;
 	bool					m_visible ;
@@ -934,6 +1043,7 @@ protected:
 	bool					m_released[JAM_MAX_TOUCHES];
 	bool					m_pressed[JAM_MAX_TOUCHES];
 	bool					m_inside[JAM_MAX_TOUCHES];
+	PickProxy				m_pickProxy ;
 
 	TouchEvent				m_touchPressedEvent ;
 	TouchEvent				m_touchDownEvent ;
@@ -976,28 +1086,46 @@ private:
 	int						m_collType ;
 	CollisionsList			m_colls ;
 	int						m_savedCollType;			// used to pause collision detection for this node
+	CollisionProxy			m_collProxy ;
 	bool					m_justCollisionPaused;		// tells if collisions detection is paused for the node
 
 	// Speed of actions
 	float					m_actionSpeed;
 	bool					m_is_in_view;
 	bool					m_isInViewCalculated;
+
+	// culling
+	bool					m_cullingEnabled ;
+	mutable bool			m_subtreeBoundsDirty ;
+	mutable Vector2			m_subtreeMin ;
+	mutable Vector2			m_subtreeMax ;
+	I8						m_renderLevelNode ;			// 1 for layers and scenes, -1 until the first visit
 };
 
-// queued
-class CollisionEventArgs : public EventArgs
+// queued, in frame memory: handlers must not keep it beyond the next frame
+class CollisionEventArgs : public EventArgs, public FrameAllocated
 {
 public:
+	using FrameAllocated::operator new ;
+	using FrameAllocated::operator delete ;
+
 	/** Creates a new CollisionEventArgs and calls autorelease() on it */
-	static CollisionEventArgs* create( Node* src, Node* dst ) ;
+	static CollisionEventArgs* create( Node* src, Node* dst, const Vector2& normal = Vector2(0.0f), float depth = 0.0f ) ;
 	Node*					getSrcNode() const { return m_src; }
 	Node*					getDstNode() const { return m_dst; }
 
+	/// Unit contact normal pointing from the src node towards the dst node
+	const Vector2&			getNormal() const { return m_normal; }
+	/// Penetration depth along the normal, 0 when not computed (e.g. custom collide() overrides)
+	float					getDepth() const { return m_depth; }
+
 private:
-	CollisionEventArgs( Node* src, Node* dst ) : m_src(src), m_dst(dst) {}
+	CollisionEventArgs( Node* src, Node* dst, const Vector2& normal, float depth ) : m_src(src), m_dst(dst), m_normal(normal), m_depth(depth) {}
 
 	Node*					m_src ;
 	Node*					m_dst ;
+	Vector2					m_normal ;
+	float					m_depth ;
 };
 
 }
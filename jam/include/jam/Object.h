@@ -33,7 +33,10 @@
 #include <jam/jam.h>
 #include <jam/String.h>
 #include <jam/RefCountedObject.h>
+#include <jam/Name.h>
 #include <sstream>
+#include <typeinfo>
+#include <cstdio>
 
 namespace jam
 {
@@ -82,6 +85,10 @@ public:
 	virtual String			getName() const override;
 	virtual void			setName(const String& name) override;
 
+	/// Returns the interned name, anonymous if setName() has never been called
+	const Name&				getNameId() const { return m_name ; }
+	void					setName(const Name& name) { m_name = name ; }
+
 protected:
 	virtual					~NamedObject() = default ;
 
@@ -90,7 +97,7 @@ private:
 	NamedObject&			operator=( const NamedObject& ) = delete ;
 
 private:
-	String					m_name ;
+	Name					m_name ;
 
 };
 
@@ -107,7 +114,7 @@ private:
 	TaggedObject&			operator=( const TaggedObject& ) = delete ;
 
 private:
-	String					m_tag ;
+	Name					m_tag ;
 
 	// Inherited via ITaggedObject
 	virtual String			getTag() const override;
@@ -124,6 +131,14 @@ public:
 	virtual String			getTag() const override;
 	virtual void			setTag(const String& tag) override;
 
+	/// Returns the interned name, anonymous if setName() has never been called
+	const Name&				getNameId() const { return m_name ; }
+	void					setName(const Name& name) { m_name = name ; }
+
+	/// Returns the interned tag, null if the object is not tagged
+	const Name&				getTagId() const { return m_tag ; }
+	void					setTag(const Name& tag) { m_tag = tag ; }
+
 protected:
 	virtual					~NamedTaggedObject() = default ;
 
@@ -132,16 +147,16 @@ private:
 	NamedTaggedObject&		operator=( const NamedTaggedObject& ) = delete ;
 
 private:
-	String					m_name ;
-	String					m_tag ;
+	Name					m_name ;
+	Name					m_tag ;
 };
 
 template <typename T>
 String generateID( T* p ) {
 	JAM_ASSERT( p!=0 ) ;
-	std::stringstream s ;
-	s << typeid(*p).name() << "@" << p ;
-	return s.str() ;
+	char buff[256] ;
+	snprintf( buff, sizeof(buff), "%s@%p", typeid(*p).name(), (const void*)p ) ;
+	return String(buff) ;
 }
 
 }
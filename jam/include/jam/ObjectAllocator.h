@@ -0,0 +1,184 @@
+/**********************************************************************************
+* 
+* ObjectAllocator.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_OBJECTALLOCATOR_H__
+#define __JAM_OBJECTALLOCATOR_H__
+
+#include <jam/jam.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#define JAM_OBJECT_POOL_GRANULARITY			16			// block sizes of PoolObjectAllocator are multiples of this
+#define JAM_OBJECT_POOL_MAX_SIZE			512			// larger objects are allocated from the heap
+#define JAM_OBJECT_POOL_BLOCKS_PER_CHUNK	256
+
+
+/**
+	Gives a RefCountedObject type, and the types derived from it, its own allocator.
+	It must be placed in a public section of the class declaration and matched by JAM_IMPLEMENT_OBJECT_ALLOCATOR
+*/
+#define JAM_DECLARE_OBJECT_ALLOCATOR() \
+	static void*					operator new( size_t size ) { return jam::RefCountedObject::allocate( size, getAllocator() ) ; } \
+	static void						operator delete( void* p, size_t size ) { jam::RefCountedObject::deallocate( p, size, getAllocator() ) ; } \
+	static jam::ObjectAllocator&	getAllocator() ; \
+	static void						setAllocator( jam::ObjectAllocator* pAllocator ) ;
+
+/**
+	Defines the allocator functions declared by JAM_DECLARE_OBJECT_ALLOCATOR, defaultAllocator is used until setAllocator() is called.
+	\remark setAllocator() must be called while the current allocator has no live blocks, e.g. before the first object is created
+*/
+#define JAM_IMPLEMENT_OBJECT_ALLOCATOR( T, defaultAllocator ) \
+	static jam::ObjectAllocator* s_p##T##Allocator = nullptr ; \
+	jam::ObjectAllocator& T::getAllocator() \
+	{ \
+		static jam::ObjectAllocator* s_pDefaultAllocator = (defaultAllocator) ; \
+		return s_p##T##Allocator ? *s_p##T##Allocator : *s_pDefaultAllocator ; \
+	} \
+	void T::setAllocator( jam::ObjectAllocator* pAllocator ) \
+	{ \
+		JAM_ASSERT_MSG( getAllocator().getNumOfBlocks() == 0, #T "::setAllocator() : the current allocator has live blocks" ) ; \
+		s_p##T##Allocator = pAllocator ; \
+	}
+
+namespace jam
+{
+
+/*!
+	\class ObjectAllocator
+
+	Interface of the allocators of RefCountedObject types.
+
+	Allocators are thread safe, and they must outlive the objects they allocate: the default ones are never destroyed,
+	so objects can still be released by the destructors of static objects
+*/
+class JAM_API ObjectAllocator
+{
+public:
+	virtual					~ObjectAllocator() {}
+
+	virtual void*			allocate( size_t size ) = 0 ;
+
+	/// size is the size given to allocate()
+	virtual void			deallocate( void* p, size_t size ) = 0 ;
+
+	/// Returns the number of blocks allocated and not yet deallocated
+	virtual size_t			getNumOfBlocks() const = 0 ;
+
+	/// Returns the allocator used by RefCountedObject types without their own allocator
+	static ObjectAllocator&	getDefault() ;
+};
+
+
+/**
+	Allocates from the heap by the global operator new
+*/
+class JAM_API HeapObjectAllocator : public ObjectAllocator
+{
+public:
+							HeapObjectAllocator() : m_numOfBlocks(0) {}
+
+	virtual void*			allocate( size_t size ) ;
+	virtual void			deallocate( void* p, size_t size ) ;
+	virtual size_t			getNumOfBlocks() const { return m_numOfBlocks.load(std::memory_order_relaxed) ; }
+
+private:
+	std::atomic<size_t>		m_numOfBlocks ;
+};
+
+
+/**
+	Free list of equally sized blocks, carved from chunks allocated as needed and kept until destruction.
+	It isn't thread safe
+*/
+class JAM_API FixedSizePool
+{
+public:
+							FixedSizePool( size_t blockSize, size_t blocksPerChunk ) ;
+							~FixedSizePool() ;
+
+	void*					allocate() ;
+	void					deallocate( void* p ) ;
+
+	size_t					getBlockSize() const { return m_blockSize; }
+	size_t					getNumOfBlocks() const { return m_numOfBlocks; }
+	size_t					getCapacity() const { return m_chunks.size() * m_blocksPerChunk; }
+
+private:
+	struct FreeBlock {
+		FreeBlock*			next ;
+	};
+
+	std::vector<U8*>		m_chunks ;
+	FreeBlock*				m_pFreeList ;
+	size_t					m_blockSize ;
+	size_t					m_blocksPerChunk ;
+	size_t					m_numOfBlocks ;
+
+							FixedSizePool( const FixedSizePool& ) = delete ;
+	FixedSizePool&			operator=( const FixedSizePool& ) = delete ;
+};
+
+
+/**
+	Allocates small objects from fixed size pools, one for every multiple of JAM_OBJECT_POOL_GRANULARITY bytes.
+	Objects larger than JAM_OBJECT_POOL_MAX_SIZE are allocated from the heap.
+
+	Pool blocks are never given back to the heap, so the memory used is the peak of the live objects,
+	but allocations are cheap and objects of the same type are packed together
+*/
+class JAM_API PoolObjectAllocator : public ObjectAllocator
+{
+public:
+	explicit				PoolObjectAllocator( size_t blocksPerChunk = JAM_OBJECT_POOL_BLOCKS_PER_CHUNK ) ;
+	virtual					~PoolObjectAllocator() ;
+
+	virtual void*			allocate( size_t size ) ;
+	virtual void			deallocate( void* p, size_t size ) ;
+	virtual size_t			getNumOfBlocks() const ;
+
+	/// Returns the bytes reserved by the pools
+	size_t					getCapacity() const ;
+
+private:
+	static const size_t		NumOfPools = JAM_OBJECT_POOL_MAX_SIZE / JAM_OBJECT_POOL_GRANULARITY ;
+
+	FixedSizePool*			m_pools[NumOfPools] ;		// created on first use
+	size_t					m_blocksPerChunk ;
+	HeapObjectAllocator		m_heap ;
+	mutable std::mutex		m_mutex ;
+
+							PoolObjectAllocator( const PoolObjectAllocator& ) = delete ;
+	PoolObjectAllocator&	operator=( const PoolObjectAllocator& ) = delete ;
+};
+
+}
+
+#endif // __JAM_OBJECTALLOCATOR_H__
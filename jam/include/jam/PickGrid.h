@@ -0,0 +1,109 @@
+/**********************************************************************************
+* 
+* PickGrid.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_PICKGRID_H__
+#define __JAM_PICKGRID_H__
+
+#include <jam/jam.h>
+#include <jam/Node.h>
+
+#include <vector>
+
+namespace jam
+{
+
+/*!
+	\class PickGrid
+
+	Spatial hash of the touchable nodes of a scene, used to find the nodes under a touch.
+
+	The world is split in square cells and every node is stored in the buckets of the cells
+	covered by its world bounds. Nodes are stamped when they are visited and moved only when
+	their bounds cover different cells, so a query tests only the nodes of a single bucket.
+	Nodes not visited during a frame are removed by removeStale().
+
+	\remark Nodes covering more than MaxCellsPerNode cells are kept in a list tested by every query
+*/
+class JAM_API PickGrid
+{
+public:
+	static const float		DefaultCellSize ;
+	static const size_t		DefaultNumOfBuckets ;
+	static const I32		MaxCellsPerNode ;
+
+public:
+	/// numOfBuckets is rounded up to a power of two
+	explicit				PickGrid( float cellSize = DefaultCellSize, size_t numOfBuckets = DefaultNumOfBuckets ) ;
+							~PickGrid() ;
+
+	/// Starts a new frame, visit order restarts from 0
+	void					newFrame() ;
+
+	/// Stamps a visited node and updates its cells from its world bounds
+	void					update( Node* pNode ) ;
+
+	/// Removes the nodes not visited since the last newFrame()
+	void					removeStale() ;
+
+	void					remove( Node* pNode ) ;
+	void					clear() ;
+	bool					contains( const Node* pNode ) const { return pNode->m_pickProxy.slot >= 0 ; }
+
+	/// Returns the topmost node containing the given point, 0 if there isn't one
+	Node*					pick( const Vector2& p ) const ;
+
+	/// Appends the nodes containing the given point to results, topmost first
+	void					pickAll( const Vector2& p, std::vector<Node*>& results ) const ;
+
+	size_t					getNumOfNodes() const { return m_nodes.size() ; }
+	float					getCellSize() const { return m_cellSize ; }
+
+private:
+	std::vector<Ref<Node>>				m_nodes ;			// nodes in the grid, kept alive until removed
+	std::vector<std::vector<Node*>>		m_buckets ;
+	std::vector<Node*>					m_largeNodes ;		// nodes covering too many cells
+	size_t					m_bucketMask ;
+	float					m_cellSize ;
+	float					m_invCellSize ;
+	U32						m_frame ;
+	U32						m_order ;
+
+	size_t					getBucket( I32 cx, I32 cy ) const ;
+	void					insertCells( Node* pNode ) ;
+	void					removeCells( Node* pNode ) ;
+	bool					isLarge( const PickProxy& proxy ) const ;
+	bool					hit( const Node* pNode, const Vector2& p ) const ;
+
+							PickGrid( const PickGrid& ) = delete ;
+	PickGrid&				operator=( const PickGrid& ) = delete ;
+};
+
+}
+
+#endif // __JAM_PICKGRID_H__
@@ -94,6 +94,13 @@ public:
 	/** Returns true if this polygon intersects the given polygon. */
 	bool					intersects(const Polygon2f& poly) const;
 
+	/**
+		Returns true if this polygon intersects the given polygon, also returning the contact.
+		normal is the unit axis of minimum overlap, pointing from this polygon towards poly,
+		depth is the overlap along it (the distance to move poly to separate them)
+	*/
+	bool					intersects(const Polygon2f& poly, Vector2& normal, float& depth) const;
+
 	/** Returns true if this polygon intersects the given segment. */
 	bool					intersects(const Vector2& p0, const Vector2& p1) ;
 
@@ -106,6 +113,9 @@ public:
 	/** Returns true if the given point in inside this polygon. */
 	bool					isPointInside(const Vector2& v) const ;
 
+	/** Returns the mean of the vertices, a cheap inner point of convex polygons */
+	Vector2					getVertexMean() const ;
+
 	/**
 		Returns true if the given point in outside this polygon, also returning the nearest edge number.
 		\remark Edge number starts from 1 to the number of edges
@@ -143,6 +153,8 @@ private:
 	void					calculateInterval(const Vector2& axis, float& min, float& max) const;
 	bool					intervalsSeparated(float mina, float maxa, float minb, float maxb) const;
 	bool					separatedByAxis(const Vector2& axis, const Polygon2f& poly) const;
+	// tests the edge normals of this polygon keeping the one of minimum overlap, returns false if one separates the polygons
+	bool					findMinimumOverlap(const Polygon2f& poly, Vector2& normal, float& depth) const;
 };
 
 
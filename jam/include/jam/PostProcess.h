@@ -0,0 +1,236 @@
+/**********************************************************************************
+* 
+* PostProcess.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_POSTPROCESS_H__
+#define __JAM_POSTPROCESS_H__
+
+#include <jam/jam.h>
+#include <jam/RefCountedObject.h>
+#include <jam/Ref.hpp>
+#include <jam/Color.h>
+#include <jam/VertexArrayObject.h>
+#include <jam/VertexBufferObject.h>
+#include <jam/core/geom.h>
+
+#include <vector>
+
+namespace jam
+{
+class PostProcessChain ;
+class RenderTarget ;
+class Shader ;
+class Texture2D ;
+
+/*!
+	\class PostProcessPass
+
+	Base class of a full screen pass of a PostProcessChain
+*/
+class JAM_API PostProcessPass : public RefCountedObject
+{
+public:
+	bool					isEnabled() const { return m_enabled; }
+	void					setEnabled( bool val ) { m_enabled = val; }
+
+	/**
+		Renders pSource into pTarget.
+		pTarget is null when the pass is the last one, in that case it must render to the chain output.
+		Targets needed by the pass for intermediate results are acquired from the chain and released before returning
+	*/
+	virtual void			render( PostProcessChain& chain, Texture2D* pSource, RenderTarget* pTarget ) = 0 ;
+
+protected:
+							PostProcessPass() ;
+	virtual					~PostProcessPass() ;
+
+private:
+	bool					m_enabled ;
+};
+
+
+/*!
+	\class ShaderPass
+
+	Draws the source through a fragment shader linked with the screen vertex shader.
+	Derived classes set their own uniforms overriding setUniforms()
+*/
+class JAM_API ShaderPass : public PostProcessPass
+{
+public:
+							ShaderPass( Shader* pShader ) ;
+
+	Shader*					getShader() const { return m_pShader; }
+
+	virtual void			render( PostProcessChain& chain, Texture2D* pSource, RenderTarget* pTarget ) override ;
+
+protected:
+	/// Called with the shader in use, just before drawing
+	virtual void			setUniforms( Shader* pShader ) ;
+
+	Shader*					m_pShader ;
+};
+
+
+/*!
+	\class ColorGradingPass
+
+	Exposure, contrast, saturation and tint adjustment
+*/
+class JAM_API ColorGradingPass : public ShaderPass
+{
+public:
+							ColorGradingPass() ;
+
+	float					getExposure() const { return m_exposure; }
+	void					setExposure( float val ) { m_exposure = val; }
+	float					getContrast() const { return m_contrast; }
+	void					setContrast( float val ) { m_contrast = val; }
+	/// 0 is grayscale, 1 leaves the colors unchanged
+	float					getSaturation() const { return m_saturation; }
+	void					setSaturation( float val ) { m_saturation = val; }
+	const Color&			getTint() const { return m_tint; }
+	void					setTint( const Color& val ) { m_tint = val; }
+
+protected:
+	virtual void			setUniforms( Shader* pShader ) override ;
+
+private:
+	float					m_exposure ;
+	float					m_contrast ;
+	float					m_saturation ;
+	Color					m_tint ;
+};
+
+
+/*!
+	\class BloomPass
+
+	Adds a blurred copy of the brightest areas to the source.
+	Bright pass and blur run on downsampled targets taken from the pool
+*/
+class JAM_API BloomPass : public PostProcessPass
+{
+public:
+							BloomPass() ;
+
+	/// Luminance above which pixels bleed, defaults to 0.7
+	float					getThreshold() const { return m_threshold; }
+	void					setThreshold( float val ) { m_threshold = val; }
+	float					getIntensity() const { return m_intensity; }
+	void					setIntensity( float val ) { m_intensity = val; }
+	/// Size divisor of the blur targets, defaults to 2
+	U32						getDownsample() const { return m_downsample; }
+	void					setDownsample( U32 val ) ;
+	/// Number of horizontal+vertical blur iterations, defaults to 2
+	int						getBlurIterations() const { return m_blurIterations; }
+	void					setBlurIterations( int val ) { m_blurIterations = val; }
+
+	virtual void			render( PostProcessChain& chain, Texture2D* pSource, RenderTarget* pTarget ) override ;
+
+private:
+	float					m_threshold ;
+	float					m_intensity ;
+	U32						m_downsample ;
+	int						m_blurIterations ;
+};
+
+
+/*!
+	\class PostProcessChain
+
+	An ordered list of full screen passes applied to the rendered scene.
+	Between begin() and end() the scene is rendered into a target taken from the RenderTargetPool,
+	end() runs the enabled passes, each one reading the previous result, and the last one writes to the output.
+	Intermediate targets are released as soon as they have been read, so they are reused by the following passes.
+	When no pass is enabled begin() does nothing and the scene is rendered straight to the output.
+
+	\sa Application::setPostProcessChain
+*/
+class JAM_API PostProcessChain : public RefCountedObject
+{
+public:
+							PostProcessChain() ;
+	virtual					~PostProcessChain() ;
+
+	void					addPass( PostProcessPass* pPass ) ;
+	void					removePass( PostProcessPass* pPass ) ;
+	void					removeAllPasses() ;
+	size_t					getNumOfPasses() const { return m_passes.size(); }
+	PostProcessPass*		getPass( size_t idx ) const { return m_passes[idx].get(); }
+
+	/// Internal format of the scene and intermediate targets, defaults to GL_RGBA8. Use GL_RGBA16F for HDR rendering
+	GLenum					getFormat() const { return m_format; }
+	void					setFormat( GLenum format ) { m_format = format; }
+
+	/**
+		Redirects rendering to the scene target, with depth buffer, and clears it.
+		Returns false, and leaves the current frame buffer bound, when there are no enabled passes
+	*/
+	bool					begin() ;
+
+	/// Runs the passes, the last one renders into pOutput or the default frame buffer when pOutput is null
+	void					end( RenderTarget* pOutput = 0 ) ;
+
+	/// Width of the scene target
+	U32						getWidth() const { return m_width; }
+	/// Height of the scene target
+	U32						getHeight() const { return m_height; }
+
+	/// Acquires from the pool a target with the format of the chain
+	RenderTarget*			acquireTarget( U32 width, U32 height ) ;
+	void					releaseTarget( RenderTarget* pTarget ) ;
+
+	/// Binds pTexture to the texture unit and sets the sampler uniform, the shader must be in use
+	void					bindTexture( Shader* pShader, const char* uniformName, Texture2D* pTexture, int unit ) ;
+
+	/**
+		Draws a full screen triangle with the shader in use into pTarget.
+		pTarget content is discarded before drawing, a null pTarget means the chain output
+	*/
+	void					drawFullscreen( Shader* pShader, RenderTarget* pTarget ) ;
+
+private:
+	void					upload() ;
+
+	std::vector<Ref<PostProcessPass>>	m_passes ;
+	GLenum					m_format ;
+	U32						m_width ;
+	U32						m_height ;
+
+	RenderTarget*			m_pSceneTarget ;
+	RenderTarget*			m_pOutput ;
+
+	VertexArrayObject		m_vao ;
+	VertexBufferObject		m_vbo ;
+	bool					m_uploaded ;
+};
+
+}
+
+#endif // __JAM_POSTPROCESS_H__
@@ -0,0 +1,172 @@
+/**********************************************************************************
+* 
+* Profiler.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_PROFILER_H__
+#define __JAM_PROFILER_H__
+
+#include <jam/jam.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define JAM_PROFILER_EVENTS_PER_THREAD		(64*1024)
+#define JAM_PROFILER_GPU_ZONES_PER_FRAME	64
+#define JAM_PROFILER_GPU_LATENCY			3			// frames waited before reading back GPU timer queries
+
+namespace jam
+{
+
+/**
+	Captured events sharing the same name and type, aggregated by Profiler::getStats()
+*/
+struct ProfileStats
+{
+	enum class Type { Zone, GpuZone, Counter } ;
+
+	const char*				name ;
+	Type					type ;
+	uint64_t				count ;
+	double					total ;			// zones durations are in ns, counters values are summed
+	double					min ;
+	double					max ;
+};
+
+/*!
+	\class Profiler
+
+	Low overhead instrumentation profiler.
+
+	Zones are recorded by the JAM_PROFILE(name) macro: the zone lasts until the end of the enclosing scope
+	and zones can be nested. JAM_PROFILE_GPU(name) also measures the GPU time of the GL commands issued in
+	the scope by timer queries (if ARB_timer_query is available); it must only be used by the GL thread.
+	JAM_PROFILE_DETAIL(name) records a zone repeated for every object (e.g. every node visit), which can be
+	excluded from captures by setDetailEnabled(false).
+	JAM_PROFILE_COUNTER(name,value) records the value of a counter.
+
+	Every thread writes its events into its own buffer without any lock, so zones can be recorded
+	by the job threads too. Nothing is recorded until start() is called; captured events are exported
+	as Chrome trace JSON, which can be loaded by chrome://tracing and ui.perfetto.dev, or aggregated
+	by getStats().
+
+	\remark Names must be string literals (or strings outliving the capture), only the pointer is stored
+	\remark exportChromeTrace(), getStats() and clear() must be called when no job is running, e.g. between frames
+	\remark This header is included by jam.h, so it can't depend on String.h
+*/
+class JAM_API Profiler
+{
+public:
+	/// Starts recording zones and counters
+	static void				start() ;
+
+	/// Stops recording, events captured so far are kept until clear()
+	static void				stop() ;
+
+	static bool				isCapturing() { return m_capturing.load(std::memory_order_relaxed) ; }
+
+	/// Enables the zones recorded by JAM_PROFILE_DETAIL (default is enabled)
+	static void				setDetailEnabled( bool enabled ) { m_detailEnabled.store( enabled, std::memory_order_relaxed ) ; }
+	static bool				isCapturingDetail() { return isCapturing() && m_detailEnabled.load(std::memory_order_relaxed) ; }
+
+	/// Discards the captured events
+	static void				clear() ;
+
+	/// Captures the next numOfFrames frames, then exports them to fileName
+	static void				captureFrames( size_t numOfFrames, const std::string& fileName ) ;
+
+	/// Writes the captured events in Chrome trace event format
+	static bool				exportChromeTrace( const std::string& fileName ) ;
+
+	/// Replaces the content of stats with the captured events aggregated by name, sorted by type and name
+	static void				getStats( std::vector<ProfileStats>& stats ) ;
+
+	/// Called by Application at the beginning of every frame
+	static void				newFrame() ;
+
+	/// Records the value of a counter at the current time
+	static void				counter( const char* name, double value ) ;
+
+	/// Number of events lost because a thread buffer was full
+	static size_t			getNumOfDroppedEvents() ;
+
+	/// Releases GL queries and thread buffers, called by Application on termination
+	static void				shutdown() ;
+
+	// used by ProfileZone and GpuProfileZone
+	static uint64_t			beginZone() ;
+	static void				endZone( const char* name, uint64_t startNs ) ;
+	static bool				beginGpuZone( const char* name ) ;
+	static void				endGpuZone() ;
+
+private:
+	static std::atomic<bool>	m_capturing ;
+	static std::atomic<bool>	m_detailEnabled ;
+};
+
+
+/**
+	Records a zone from construction to destruction, created by JAM_PROFILE
+*/
+class JAM_API ProfileZone
+{
+public:
+	explicit				ProfileZone( const char* name ) : m_name(name), m_startNs(0), m_active(Profiler::isCapturing()) { if( m_active ) m_startNs = Profiler::beginZone() ; }
+							ProfileZone( const char* name, bool active ) : m_name(name), m_startNs(0), m_active(active) { if( m_active ) m_startNs = Profiler::beginZone() ; }
+							~ProfileZone() { if( m_active ) Profiler::endZone( m_name, m_startNs ) ; }
+
+private:
+	const char*				m_name ;
+	uint64_t				m_startNs ;
+	bool					m_active ;
+
+							ProfileZone( const ProfileZone& ) = delete ;
+	ProfileZone&			operator=( const ProfileZone& ) = delete ;
+};
+
+
+/**
+	Records a CPU zone and the GPU time of the commands issued in it, created by JAM_PROFILE_GPU
+*/
+class JAM_API GpuProfileZone
+{
+public:
+	explicit				GpuProfileZone( const char* name ) : m_zone(name), m_active(Profiler::isCapturing() && Profiler::beginGpuZone(name)) {}
+							~GpuProfileZone() { if( m_active ) Profiler::endGpuZone() ; }
+
+private:
+	ProfileZone				m_zone ;
+	bool					m_active ;
+
+							GpuProfileZone( const GpuProfileZone& ) = delete ;
+	GpuProfileZone&			operator=( const GpuProfileZone& ) = delete ;
+};
+
+}
+
+#endif // __JAM_PROFILER_H__
@@ -33,30 +33,45 @@
 #include <jam/jam.h>
 #include <jam/Node.h>
 
+#include <vector>
+#include <float.h>
+
 namespace jam
 {
 
+/**
+	\class Quadtree
 
+	A loose QuadTree that provides fast and efficient storage of objects in a world space.
+	Used to optimize collision detection, it is also a standalone spatial query structure
+	(e.g. "enemies within radius").
 
-/**
-	A QuadTree Object that provides fast and efficient storage of objects in a world space.
-	Internal class used to optimize collision detection
-
-	Quadtree maxLevel
-	maxLevel - quadnodes
-	--------------------
-	1        -      1
-	2        -      4
-	3        -     16
-	4        -     64
-	5        -    256
-	6        -   1024
+	Quads live in a flat pool linked by indices (the four children of a quad are consecutive)
+	and the objects in a pool of entries linked in a list per quad. clear() keeps both pools,
+	so once they have grown to the working set inserts and queries don't allocate.
+	Queries append raw Node pointers to caller-provided vectors, without touching refcounts:
+	the tree doesn't keep its objects alive, they must be erased or cleared before being destroyed.
+
+	An object is stored in the deepest quad whose loose bounds (twice the quad size) contain
+	its bounds. The bounds are the AABB of the collision OBB at insertion time, objects moved
+	later must be erased and inserted again.
+
+	Queries can be restricted to the objects whose collision category (cf. Node::getCollisionCategory())
+	is in the given categories, quads without such objects are skipped. AllCategories matches every object,
+	also the ones without a collision category.
 */
 class JAM_API Quadtree
 {
 public:
+	static const U32		MaxObjectsPerQuad = 4 ;				// objects of a quad before it subdivides
+	static const U32		MaxDepth = 8 ;
+	static const size_t		MaxNearest = 32 ;					// max k of getNearest()
+	static const size_t		DefaultQuadsCapacity = 256 ;
+	static const size_t		DefaultObjectsCapacity = 256 ;
+	static const U64		AllCategories = ~(U64)0 ;
+
 	/** Creates a QuadTree for the specified area. */
-							Quadtree(const AABB& rect) ;
+	explicit				Quadtree(const AABB& rect, size_t quadsCapacity = DefaultQuadsCapacity, size_t objectsCapacity = DefaultObjectsCapacity) ;
 
 	/**
 		Creates a QuadTree for the specified area.
@@ -72,59 +87,86 @@ public:
 
 	/**  The area this QuadTree represents. */
 	const AABB&				getQuadRect() const { return m_rect; }
-	
-	/**  The objects contained in this QuadTree at it's level (ie, excludes children) */
-	const jam::NodesList&	getObjects() { return m_objects; }
 
-	/**  The top left child for this QuadTree */
-	Quadtree*				getTopLeftChild() const { return m_childTL; }
-	
-	/**  The top right child for this QuadTree */
-	Quadtree*				getTopRightChild() const { return m_childTR; }
+	/**  Clears the QuadTree and changes its area, the pools are kept */
+	void					reset( const AABB& rect ) ;
 
-	/**  The bottom left child for this QuadTree */
-	Quadtree*				getBottomLeftChild() const { return m_childBL; }
-	
-	/**  The bottom right child for this QuadTree */
-	Quadtree*				getBottomRightChild() const { return m_childBR; }
-	
-	/**  How many total objects are contained within this QuadTree (ie, includes children) */
-	size_t					getCount() const { return getObjectCount(); }
+	/**  How many total objects are contained within this QuadTree */
+	size_t					getCount() const { return m_numOfObjects; }
 
-	/**  Clears the QuadTree of all objects, including any objects living in its children. */
+	/**  Clears the QuadTree of all objects, the pools are kept */
 	void					clear() ;
 	
-	/**
-		Deletes an item from this QuadTree.
-		If the object is removed causes this Quad to have no objects in its children, it's children will be removed as well.
-	*/
+	/**  Deletes an item from this QuadTree. */
 	void					erase( Node* item ) ;
 
 	/**  Insert an item into this QuadTree object. */
 	void					insert( Node* item ) ;
 
-	/**  Get the objects in this tree that intersect with the specified rectangle. */
-	void					getObjects( const Polygon2f& rect, NodesList& results ) ;
+	/**
+		Appends the objects in this tree that intersect with the specified polygon to results.
+		Returns the number of objects appended
+	*/
+	size_t					getObjects( const Polygon2f& rect, std::vector<Node*>& results, U64 categories = AllCategories ) const ;
+
+	/**  Appends the objects whose bounds are within radius from center, returns the number of objects appended */
+	size_t					getObjectsInRadius( const Vector2& center, float radius, std::vector<Node*>& results, U64 categories = AllCategories ) const ;
+
+	/**  Appends the objects whose collision OBB contains the point, returns the number of objects appended */
+	size_t					getObjectsAt( const Vector2& p, std::vector<Node*>& results, U64 categories = AllCategories ) const ;
+
+	/**
+		Appends the (at most) k objects whose bounds are nearest to p and within maxDistance,
+		ordered by distance. Returns the number of objects appended
+		\remark k must be <= MaxNearest
+	*/
+	size_t					getNearest( const Vector2& p, size_t k, std::vector<Node*>& results, U64 categories = AllCategories, float maxDistance = FLT_MAX ) const ;
 
-	/**  Get all objects in this Quad, and it's children. */
-	void					getAllObjects( NodesList& results ) ;
+	/**  Appends all the objects, returns the number of objects appended */
+	size_t					getAllObjects( std::vector<Node*>& results, U64 categories = AllCategories ) const ;
 
 private:
-	void					add( Node* item ) ;
-//	void					remove( Node* item ) ;
-	size_t					getObjectCount() const ;
-	void					subdivide() ;
-	Quadtree*				getDestinationTree( Node* item ) ;
-
-	// How many objects can exist in a QuadTree before it sub divides itself
-	static const uint32_t	MAX_OBJECTS_PER_NODE = 2;
-	NodesList				m_objects ;		// The objects in this QuadTree
+	struct Quad {
+		float				cx, cy ;		// center
+		float				hw, hh ;		// half size, the loose bounds are twice as large
+		I32					firstChild ;	// index of the 4 children, -1 for leaves
+		I32					firstEntry ;	// list of the objects stored in this quad, -1 when empty
+		U32					numOfEntries ;
+		U32					depth ;
+		U64					categories ;	// categories of the objects in this quad and its children (a superset after erase)
+	};
+
+	struct Entry {
+		Node*				item ;
+		float				minX, minY, maxX, maxY ;
+		U64					category ;
+		I32					next ;			// next entry of the quad, or of the free list
+		I32					quad ;			// -1 for free entries
+	};
+
+	// the stack of the visit: the children of up to MaxDepth levels
+	static const size_t		MaxStackSize = 3*MaxDepth + 4 ;
+
+	std::vector<Quad>		m_quads ;		// m_quads[0] is the root
+	std::vector<Entry>		m_entries ;
+	I32						m_freeEntry ;
+	size_t					m_numOfObjects ;
 	AABB					m_rect ;		// The area this QuadTree represents
 
-	Quadtree*				m_childTL ;		// Top Left Child
-	Quadtree*				m_childTR ;		// Top Right Child
-	Quadtree*				m_childBL ;		// Bottom Left Child
-	Quadtree*				m_childBR ;		// Bottom Right Child
+	void					initRoot() ;
+	I32						allocEntry() ;
+	void					link( I32 quad, I32 entry ) ;
+	void					place( I32 quad, I32 entry ) ;
+	void					subdivide( I32 quad ) ;
+	// returns the child of quad whose loose bounds contain the entry, -1 if none
+	I32						getDestinationChild( I32 quad, const Entry& e ) const ;
+	// true if the loose bounds of the quad intersect the box (the root contains everything)
+	bool					overlaps( I32 quad, float minX, float minY, float maxX, float maxY ) const ;
+	// squared distance from p to the loose bounds of the quad (0 for the root)
+	float					distanceSquared( I32 quad, const Vector2& p ) const ;
+
+	template<typename Filter>
+	size_t					query( float minX, float minY, float maxX, float maxY, U64 categories, const Filter& accept, std::vector<Node*>& results ) const ;
 
 	// to prevent the use
 							Quadtree( const Quadtree& ) = delete ;
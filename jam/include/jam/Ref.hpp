@@ -110,8 +110,13 @@ public:
 
 	Ref& operator=( Ref&& other ) noexcept 	{
 		if( this != &other ) {
+			// the reference held until now must be dropped, or the previous object would leak
+			T* pOld = m_pReferenceCountedObject ;
 			m_pReferenceCountedObject = other.m_pReferenceCountedObject ;
 			other.m_pReferenceCountedObject = nullptr ;
+			if( pOld != nullptr ) {
+				pOld->release() ;
+			}
 		}
 		return *this ;
 	}
@@ -221,6 +226,61 @@ private:
 	T*						m_pReferenceCountedObject ;
 };
 
+/**
+	Non-owning handle to a RefCountedObject: it never touches the reference counter, so copying it costs
+	as much as copying a raw pointer.
+	Use it in hot code (per-frame batches, iterations) when an owning Ref keeps the object alive for the
+	whole lifetime of the handle, toRef() gives back an owning reference when the object must be kept
+*/
+template <typename T>
+class BorrowedRef
+{
+public:
+	BorrowedRef(): m_pObject(nullptr) {
+	}
+
+	BorrowedRef(T* rawptr): m_pObject(rawptr) {
+	}
+
+	BorrowedRef(const Ref<T>& owner): m_pObject(const_cast<T*>(owner.get())) {
+	}
+
+	T* get() const {
+		return m_pObject ;
+	}
+
+	operator T* () const {
+		return m_pObject ;
+	}
+
+	T* operator->() const {
+		return m_pObject ;
+	}
+
+	T& operator*() const {
+		if( !m_pObject ) { 
+			JAM_ERROR("Null pointer");
+		}
+		return *m_pObject ;
+	}
+
+	/// Returns an owning reference to the borrowed object
+	Ref<T> toRef() const {
+		return Ref<T>(m_pObject,true) ;
+	}
+
+	bool isNull() const {
+		return m_pObject == nullptr ;
+	}
+
+	explicit operator bool() const {
+		return m_pObject != nullptr ;
+	}
+
+private:
+	T*						m_pObject ;
+};
+
 template <typename S,typename T>
 Ref<S> dynamic_ref_cast( const Ref<T>& r ) {
     if( auto p = dynamic_cast<S*>(r.get()) ) {
@@ -32,16 +32,35 @@
 
 #include <jam/jam.h>
 #include <jam/String.h>
+#include <jam/ObjectAllocator.h>
 
 #include <atomic>
+#include <climits>
 
 
 namespace jam
 {
 
+/**
+	How the reference counter of a RefCountedObject is updated, chosen by each type in its constructor
+*/
+enum class RefCountPolicy : U8
+{
+	/// Atomic counter, the object can be referenced and released by any thread (default)
+	ThreadSafe,
+	/// Plain counter without atomic instructions, the object must be referenced only by the main thread
+	SingleThreaded,
+	/// Atomic counter, but if the last reference is dropped by another thread the object is deleted later by the main thread
+	Deferred
+};
+
 /**
 *
 * \remark A RefCountedObject when created has a reference counter of 1
+* \remark Hot types can have their own allocator, see JAM_DECLARE_OBJECT_ALLOCATOR. With JAM_MEMORY_TRACKING every
+* object allocated by operator new is accounted by MemoryTracker
+* \remark Types referenced only by the main thread (e.g. nodes, actions) should use RefCountPolicy::SingleThreaded, types
+* owning OpenGL objects RefCountPolicy::Deferred. Hot code can use BorrowedRef to avoid touching the counter at all
 */
 class JAM_API RefCountedObject
 {
@@ -61,6 +80,31 @@ public:
 	*/
 	void					release();
 
+	/** Returns how the reference counter is updated */
+	RefCountPolicy			getRefCountPolicy() const { return m_refCountPolicy ; }
+
+	/**
+		Deletes the objects with RefCountPolicy::Deferred whose last reference was dropped by another thread.
+		Called by the main thread once per frame
+	*/
+	static void				releaseDeferred() ;
+
+	/** Returns true if called by the thread which owns the objects with RefCountPolicy::SingleThreaded and Deferred */
+	static bool				isMainThread() ;
+
+	/**
+		Allocates the memory of an object from the given allocator, used by the operator new of the types
+		with their own allocator, see JAM_DECLARE_OBJECT_ALLOCATOR
+	*/
+	static void*			allocate( size_t size, ObjectAllocator& allocator ) ;
+	static void				deallocate( void* p, size_t size, ObjectAllocator& allocator ) ;
+
+#ifdef JAM_MEMORY_TRACKING
+	// the types without their own allocator are tracked too
+	static void*			operator new( size_t size ) { return allocate( size, ObjectAllocator::getDefault() ) ; }
+	static void				operator delete( void* p, size_t size ) { deallocate( p, size, ObjectAllocator::getDefault() ) ; }
+#endif
+
 #ifdef JAM_DEBUG
 	/** Get object debug info */
 	virtual String			getDebugInfo(bool typeInfo=true) ;
@@ -71,7 +115,11 @@ protected:
 							RefCountedObject();
 	virtual					~RefCountedObject();
 
+	/** Changes the policy of the reference counter, allowed only in the constructor of the derived types */
+	void					setRefCountPolicy( RefCountPolicy policy ) ;
+
 	std::atomic_int32_t		m_refCount ;
+	RefCountPolicy			m_refCountPolicy ;
 
 #ifdef JAM_DEBUG
 private:
@@ -83,8 +131,44 @@ private:
 	// forbids copy-construction and assignment
 							RefCountedObject( const RefCountedObject& ) = delete ;
 	RefCountedObject&		operator=(const RefCountedObject&) = delete ;
+
+	void					destroy() ;
 };
 
+// the counter is updated inline, only the destruction is out of line
+JAM_INLINE void RefCountedObject::addRef()
+{
+	JAM_ASSERT_MSG( m_refCountPolicy != RefCountPolicy::SingleThreaded || isMainThread(), "single threaded object referenced by another thread" ) ;
+	int32_t count ;
+	if( m_refCountPolicy == RefCountPolicy::SingleThreaded ) {
+		count = m_refCount.load( std::memory_order_relaxed ) ;
+		m_refCount.store( count + 1, std::memory_order_relaxed ) ;
+	}
+	else {
+		count = m_refCount.fetch_add( 1, std::memory_order_relaxed ) ;
+	}
+	JAM_ASSERT_MSG( count>0, "m_refCount should be greater than 0" ) ;
+}
+
+JAM_INLINE void RefCountedObject::release()
+{
+	JAM_ASSERT_MSG( m_refCountPolicy != RefCountPolicy::SingleThreaded || isMainThread(), "single threaded object released by another thread" ) ;
+	int32_t count ;
+	if( m_refCountPolicy == RefCountPolicy::SingleThreaded ) {
+		count = m_refCount.load( std::memory_order_relaxed ) ;
+		m_refCount.store( count - 1, std::memory_order_relaxed ) ;
+	}
+	else {
+		// acquire on the last release: every write made by the other owners is visible to the destructor
+		count = m_refCount.fetch_sub( 1, std::memory_order_acq_rel ) ;
+	}
+	// if something goes wrong with memory, m_refCount become garbagled and generally a very high value (absolute value)
+	JAM_ASSERT_MSG( count>0 && count<INT_MAX, "m_refCount=%d (should be > 0)", count ) ;
+	if( count == 1 ) {
+		destroy() ;
+	}
+}
+
 }
 
 #endif // __JAM_REFCOUNTEDOBJECT_H__
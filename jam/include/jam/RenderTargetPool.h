@@ -0,0 +1,137 @@
+/**********************************************************************************
+* 
+* RenderTargetPool.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_RENDERTARGETPOOL_H__
+#define __JAM_RENDERTARGETPOOL_H__
+
+#include <jam/jam.h>
+#include <jam/Singleton.h>
+#include <jam/Ref.hpp>
+#include <jam/FrameBufferObject.h>
+#include <jam/Texture2D.h>
+
+#include <vector>
+
+// frames a released render target is kept in the pool before being destroyed
+#define JAM_RENDER_TARGET_MAX_IDLE_FRAMES		60
+
+namespace jam
+{
+class RenderBufferObject ;
+
+/*!
+	\class RenderTarget
+
+	A frame buffer object with a color texture and an optional depth/stencil buffer.
+	Render targets are created and owned by the RenderTargetPool
+*/
+class JAM_API RenderTarget
+{
+	friend class RenderTargetPool ;
+
+public:
+	U32						getWidth() const { return m_width; }
+	U32						getHeight() const { return m_height; }
+	GLenum					getInternalFormat() const { return m_internalFormat; }
+	bool					hasDepth() const { return m_pDepth != 0; }
+
+	FrameBufferObject&		getFBO() { return m_fbo; }
+	Texture2D*				getTexture() const { return m_pTexture.get(); }
+
+	/// Binds the frame buffer and sets the viewport to the whole target
+	void					bind() ;
+
+	/// Discards the current content (color and depth), to be called when the target is going to be fully overwritten
+	void					discard() ;
+	/// Discards depth and stencil content only, i.e. when the color is going to be sampled and depth is not needed anymore
+	void					discardDepth() ;
+
+	size_t					getByteSize() const ;
+
+private:
+							RenderTarget( U32 width, U32 height, GLenum internalFormat, bool depth ) ;
+							~RenderTarget() ;
+
+							RenderTarget( const RenderTarget& ) = delete ;
+	RenderTarget&			operator=( const RenderTarget& ) = delete ;
+
+	U32						m_width ;
+	U32						m_height ;
+	GLenum					m_internalFormat ;
+	FrameBufferObject		m_fbo ;
+	Ref<Texture2D>			m_pTexture ;
+	RenderBufferObject*		m_pDepth ;
+
+	bool					m_inUse ;
+	uint64_t				m_lastUsedFrame ;
+};
+
+
+/*!
+	\class RenderTargetPool
+
+	Pool of transient render targets.
+	Targets are acquired by size and format for the time they are needed and then released,
+	so passes which don't overlap in time share the same memory.
+	Targets not used for JAM_RENDER_TARGET_MAX_IDLE_FRAMES frames are destroyed
+*/
+class JAM_API RenderTargetPool : public jam::Singleton<RenderTargetPool>
+{
+	friend class jam::Singleton<RenderTargetPool> ;
+
+public:
+	/// Returns a free target matching size, format and depth, creating it if needed
+	RenderTarget*			acquire( U32 width, U32 height, GLenum internalFormat = GL_RGBA8, bool depth = false ) ;
+	/// Gives a target back to the pool, its content must be considered lost
+	void					release( RenderTarget* pTarget ) ;
+
+	/// Destroys the targets idle for too long, called once per frame by Application
+	void					newFrame() ;
+	/// Destroys all the free targets
+	void					purge() ;
+
+	size_t					getNumOfTargets() const { return m_targets.size(); }
+	size_t					getNumOfTargetsInUse() const ;
+	/// Returns the video memory used by the pool in bytes (approximated)
+	size_t					getByteSize() const ;
+
+protected:
+							RenderTargetPool() ;
+	virtual					~RenderTargetPool() ;
+
+private:
+	std::vector<RenderTarget*>	m_targets ;
+	uint64_t				m_frame ;
+};
+
+JAM_INLINE RenderTargetPool&	GetRenderTargetPool() { return (RenderTargetPool&) RenderTargetPool::getSingleton(); }
+
+}
+
+#endif // __JAM_RENDERTARGETPOOL_H__
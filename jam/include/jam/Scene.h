@@ -34,6 +34,9 @@
 #include <jam/Node.h>
 #include <jam/InputManager.h>
 #include <jam/Ring2f.h>
+#include <jam/PickGrid.h>
+
+#include <vector>
 
 
 namespace jam
@@ -79,6 +82,9 @@ public:
 	/// Returns the topmost Node under the given touch (or 0 if there isn't a touchable node under the touch)
 	Node*					getTouchedNode(size_t idx) { return m_touchedNodes[idx] ; } ; 
 
+	/// Returns the spatial hash of the touchable nodes visited in the last frame, e.g. to pick nodes under a point
+	const PickGrid&			getPickGrid() const { return m_pickGrid ; }
+
 private:
 	void					clearTouchableNodes() ;
 	void					addTouchableNode( Node* pNode );
@@ -87,10 +93,16 @@ private:
 	void					setTouches(size_t idx, bool val) { m_touches[idx] = val; }
 	void					setTouchedNode(size_t idx, Node* n) { m_touchedNodes[idx] = n ; } ; 
 
+	void					addInterpolatedNode( Node* pNode ) ;
+	void					removeInterpolatedNode( Node* pNode ) ;
+	void					storeSimulationState() ;
+
 private:
-	// it's the list of touchable (potential) nodes to be checked for touches
-	// the list is polulated during the visitGraph()
-	NodesList				m_touchableNodes ;
+	// touchable nodes visited during the visitGraph(), hashed by their world bounds
+	PickGrid				m_pickGrid ;
+
+	// nodes under a touch or with a touch state from previous frames, the only ones whose touches are updated
+	std::vector<Ref<Node>>	m_touchNodes ;
 
 	// in the updateTochableNodes(), for each touch id, we set the corresponding array item to true
 	// if at least a (touchable) node is under the touch
@@ -99,6 +111,9 @@ private:
 	// for each touch id, we set the corresponding array item with the foremost Node pointer 
 	Node*					m_touchedNodes[JAM_MAX_TOUCHES] ;
 
+	// running nodes with render interpolation enabled, they are registered on enter and unregistered on exit
+	std::vector<Node*>		m_interpolatedNodes ;
+
 	// fog of view
 	Ring2f					m_fogOfViewRing ;
 	float					m_fogOfViewInnerRadius ;
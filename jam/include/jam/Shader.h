@@ -33,10 +33,13 @@
 #define __JAM_SHADER_H__
 
 #include <jam/ShaderFile.h>
+#include <jam/ShaderCompiler.h>
 #include <jam/BaseManager.hpp>
 #include <jam/Singleton.h>
 #include <jam/core/geom.h>
 
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 
 
@@ -54,18 +57,18 @@
 #define JAM_PROGRAM_UNIFORM_MATERIAL_SPECULAR			"material_specular"
 #define JAM_PROGRAM_UNIFORM_MATERIAL_NORMAL				"material_normal"
 
-#define JAM_PROGRAM_UNIFORM_LIGHT_TYPE					"lights[%d].type"
-#define JAM_PROGRAM_UNIFORM_LIGHT_POSITION				"lights[%d].position"
-#define JAM_PROGRAM_UNIFORM_LIGHT_DIRECTION				"lights[%d].direction"
-#define JAM_PROGRAM_UNIFORM_LIGHT_CONSTANT				"lights[%d].constant"
-#define JAM_PROGRAM_UNIFORM_LIGHT_LINEAR				"lights[%d].linear"
-#define JAM_PROGRAM_UNIFORM_LIGHT_QUADRATIC				"lights[%d].quadratic"
-#define JAM_PROGRAM_UNIFORM_LIGHT_AMBIENT				"lights[%d].ambient"
-#define JAM_PROGRAM_UNIFORM_LIGHT_DIFFUSE				"lights[%d].diffuse"
-#define JAM_PROGRAM_UNIFORM_LIGHT_SPECULAR				"lights[%d].specular"
+#define JAM_PROGRAM_UNIFORM_BLOCK_LIGHTS				"LightsBlock"
+#define JAM_PROGRAM_UNIFORM_BLOCK_FRAME					"FrameBlock"
+#define JAM_PROGRAM_UNIFORM_BLOCK_VIEW					"ViewBlock"
+#define JAM_PROGRAM_UNIFORM_BLOCK_OBJECT				"ObjectBlock"
+#define JAM_PROGRAM_UNIFORM_LIGHT_GRID					"lightGrid"
 
 #define JAM_PROGRAM_UNIFORM_BONES						"bones[%d]"
 
+#define JAM_PROGRAM_UNIFORM_INSTANCE_DATA				"instanceData"
+#define JAM_PROGRAM_UNIFORM_INSTANCE_BONES				"instanceBones"
+#define JAM_PROGRAM_UNIFORM_INSTANCE_BASE				"instanceBase"
+
 #define JAM_PROGRAM_UNIFORM_VIEW_POS					"viewPos"
 
 #define JAM_PROGRAM_UNIFORM_MODEL_MATRIX				"modelMatrix"
@@ -81,7 +84,13 @@ namespace jam
 */
 class JAM_API Shader : public NamedObject
 { 
+	friend class ShaderCompiler ;
+
 public:
+	/// Build state of the program, BUILD_PENDING until the ShaderCompiler has linked it
+	enum BuildState { BUILD_NONE = 0, BUILD_PENDING, BUILD_LINKED, BUILD_FAILED } ;
+
+
 	/**
 		Creates a program by linking a list of ShaderFile objects
 		@param shaders  The shaders to link together to make the program
@@ -92,8 +101,25 @@ public:
         
 	void					setShaderFiles( const std::vector<Ref<ShaderFile>>& shaderFiles ) ;
 
+	/// Links the program on the calling thread, raising an error on failure
 	void					compile() ;
 
+	/**
+		Compiles the shader files and links them, returning false with the compiler or linker log
+		in errorMsg on failure. If retrievable, the driver is hinted that the binary will be queried
+	*/
+	bool					link( String& errorMsg, bool retrievable = false ) ;
+	/// Creates the program from a binary returned by glGetProgramBinary(), returns false if the driver refuses it
+	bool					linkBinary( GLenum format, const void* pBinary, GLsizei length ) ;
+	/// Binds the uniform blocks and sets the samplers shared by all the programs, to be called once linked
+	void					bindUniformBlocks() ;
+
+	BuildState				getBuildState() const { return (BuildState)m_buildState.load(std::memory_order_acquire) ; }
+
+	/**
+		Camera and model setters: programs declaring the ViewBlock and ObjectBlock uniform blocks
+		forward them to SharedUniforms, the other ones set their own uniforms
+	*/
 	void					setModelMatrix( const Matrix4& mat ) ;
 	void					setViewMatrix( const Matrix4& mat ) ;
 	void					setProjectionMatrix( const Matrix4& mat ) ;
@@ -190,10 +216,26 @@ public:
 
 	static const char*		GL_type_to_string(GLenum type);
 
+private:
+	// waits for a pending build and reports a failed one, every access to the program object goes through it
+	void					ensureLinked() const ;
+	void					setBuildResult( bool linked, const String& errorMsg ) ;
+
 private:
     GLuint					m_object;
 	std::vector<Ref<ShaderFile>>	m_shaderFiles ;
 
+	// written by the compiler worker, m_object and the block flags are published by the release of m_buildState
+	std::atomic<int>		m_buildState ;
+	String					m_buildError ;
+
+	bool					m_usesViewBlock ;
+	bool					m_usesObjectBlock ;
+
+	// the object block is shared, the model matrix of this program is bound again by use()
+	Matrix4					m_modelMatrix ;
+	bool					m_hasModelMatrix ;
+
     //copying disabled
 							Shader(const Shader&) = delete ;
     const Shader&			operator=(const Shader&) = delete ;
@@ -214,6 +256,14 @@ public:
 	static const String		SKYBOX_PROGRAM_NAME ;
 	static const String		NORMAL_MAPPING_PROGRAM_NAME ;
 	static const String		SCREEN_PROGRAM_NAME ;
+	static const String		INSTANCED_NORMAL_MAPPING_PROGRAM_NAME ;
+	static const String		INSTANCED_SKINNING_PROGRAM_LIT_NAME ;
+	static const String		INSTANCED_PROGRAM_LIT_NAME ;
+	static const String		POSTFX_BRIGHT_PROGRAM_NAME ;
+	static const String		POSTFX_BLUR_PROGRAM_NAME ;
+	static const String		POSTFX_BLOOM_PROGRAM_NAME ;
+	static const String		POSTFX_COLOR_GRADING_PROGRAM_NAME ;
+	static const String		GRID_EFFECT_PROGRAM_NAME ;
 	static const String		DEFAULT_SHADERS_PATH ;
 
 public:
@@ -225,6 +275,9 @@ public:
 	void					createSkyBox() ;
 	void					createNormalMapping() ;
 	void					createScreen() ;
+	void					createInstancedNormalMapping() ;
+	void					createInstancedSkinningLit() ;
+	void					createInstancedLit() ;
 
 	Shader*		            getDefaultUnlit() ;
 	Shader*		            getDefaultLit() ;
@@ -232,16 +285,45 @@ public:
 	Shader*		            getSkyBox() ;
 	Shader*		            getNormalMapping() ;
 	Shader*		            getScreen() ;
+	Shader*		            getInstancedNormalMapping() ;
+	Shader*		            getInstancedSkinningLit() ;
+	Shader*		            getInstancedLit() ;
 
 	Shader*                 getShader( const String& name ) ;
 
 	void					loadAndCreateProgram( const String& shaderName ) ;
+	/// Links shaderName.frag with the vertex shader vertexShaderName.vert, e.g. to share SCREEN_PROGRAM_NAME vertex shader
+	void					loadAndCreateProgram( const String& shaderName, const String& vertexShaderName ) ;
+	/**
+		As above, with each define (e.g. "MAX_BONES 64") injected as a #define after the #version line.
+		Programs with the same sources and defines are built once: a later name becomes an alias of the first program
+	*/
+	void					loadAndCreateProgram( const String& shaderName, const String& vertexShaderName, const std::vector<String>& defines ) ;
+	/// Returns the named program, loading and linking it on first request
+	Shader*					getOrCreateProgram( const String& shaderName ) ;
+	Shader*					getOrCreateProgram( const String& shaderName, const String& vertexShaderName ) ;
+	Shader*					getOrCreateProgram( const String& shaderName, const String& vertexShaderName, const std::vector<String>& defines ) ;
+
+	/**
+		Programs are built by the compiler, in the background once its worker is started.
+		Loading returns immediately, a program is waited on when first used
+	*/
+	ShaderCompiler&			getCompiler() { return m_compiler ; }
 
 	Shader*     			getCurrent() ;
 	void					setCurrent( Shader* pShader ) ;
 
+private:
+	Shader*					findProgram( const String& name ) ;
+	static String			injectDefines( const String& source, const std::vector<String>& defines ) ;
+
 private:
 	Shader*                 m_pCurrentShader ;
+	ShaderCompiler			m_compiler ;
+
+	// programs by the key of their sources and defines, and names aliasing an identical program
+	std::unordered_map<U64,Shader*>		m_programsByKey ;
+	std::unordered_map<String,Shader*>	m_aliases ;
 };
 
 JAM_INLINE ShaderManager& GetShaderMgr() { return ShaderManager::getSingleton(); }
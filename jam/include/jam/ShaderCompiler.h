@@ -0,0 +1,135 @@
+/**********************************************************************************
+* 
+* ShaderCompiler.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+#ifndef __JAM_SHADERCOMPILER_H__
+#define __JAM_SHADERCOMPILER_H__
+
+#include <jam/jam.h>
+
+#include <GL/glew.h>
+#include <SDL.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jam
+{
+
+class Shader ;
+
+/*!
+	\class ShaderCompiler
+
+	Builds the programs of the ShaderManager.
+
+	When the driver allows it, programs are compiled and linked by a worker thread owning an
+	OpenGL context shared with the main one, so loading them doesn't stall the main thread:
+	a program is waited on only when it is first used. Without a shared context (or before
+	startWorker() is called) programs are built synchronously on submission.
+
+	Linked programs may also be cached on disk through glGetProgramBinary() and reloaded with
+	glProgramBinary(), skipping compilation altogether. Cached binaries are keyed by the program
+	sources and defines and are ignored whenever the driver changes.
+
+	\remark Submission, waiting and configuration are main thread only
+*/
+class JAM_API ShaderCompiler
+{
+public:
+							ShaderCompiler() ;
+							~ShaderCompiler() ;
+
+	/**
+		Creates a context shared with mainContext and starts the worker thread making it current.
+		Returns false, leaving the compiler synchronous, if the shared context is not available
+	*/
+	bool					startWorker( SDL_Window* pWindow, SDL_GLContext mainContext ) ;
+	/// Builds the queued programs, then stops the worker and deletes its context
+	void					stopWorker() ;
+	bool					isWorkerRunning() const { return m_pWorkerContext != nullptr ; }
+
+	/**
+		Enables the program binary cache in the given folder, if the driver exposes at least
+		one program binary format. Returns true if the cache is enabled
+	*/
+	bool					enableBinaryCache( const String& folder ) ;
+	void					disableBinaryCache() ;
+	bool					isBinaryCacheEnabled() const { return m_binaryCacheEnabled ; }
+
+	/// Queues the build of a program, key identifies its sources and defines (see computeKey())
+	void					submit( Shader* pShader, U64 key ) ;
+	/// Returns when the given program has been built, building it on the calling thread if still queued
+	void					wait( Shader* pShader ) ;
+	/// Returns when every submitted program has been built
+	void					waitAll() ;
+
+	/// Returns the key identifying a program made of the given sources and defines
+	static U64				computeKey( const String& vertexSource, const String& fragmentSource, const std::vector<String>& defines ) ;
+
+private:
+	struct Job {
+		Shader*				pShader ;
+		U64					key ;
+	};
+
+	void					build( const Job& job, bool onWorker ) ;
+	bool					loadBinary( const Job& job ) ;
+	void					storeBinary( const Job& job ) ;
+	String					getBinaryPathName( U64 key ) const ;
+	void					workerMain( SDL_Window* pWindow ) ;
+	static U64				hash( const String& s, U64 h ) ;
+
+private:
+	std::deque<Job>			m_jobs ;
+	// program being built by the worker, if any
+	Shader*					m_pBuilding ;
+	std::mutex				m_mutex ;
+	std::condition_variable	m_jobsCondition ;
+	std::condition_variable	m_doneCondition ;
+	std::atomic<bool>		m_quit ;
+
+	std::thread				m_worker ;
+	SDL_GLContext			m_pWorkerContext ;
+	// 0 while starting, 1 once the worker made its context current, -1 if it could not
+	int						m_workerState ;
+
+	String					m_binaryCacheFolder ;
+	U64						m_driverHash ;
+	bool					m_binaryCacheEnabled ;
+
+							ShaderCompiler( const ShaderCompiler& ) = delete ;
+	ShaderCompiler&			operator=( const ShaderCompiler& ) = delete ;
+};
+
+}
+
+#endif // __JAM_SHADERCOMPILER_H__
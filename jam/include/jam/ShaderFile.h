@@ -67,8 +67,13 @@ public:
 
 	virtual					~ShaderFile() ;
 
+	/// Sets the source code, the shader object is created and compiled by compile()
 	void					setSource( const String& shaderCode ) ;
+	const String&			getSource() const ;
+	/// Compiles the source, raising an error on failure
 	void					compile() ;
+	/// Compiles the source, returning false with the compiler log in errorMsg on failure. Safe on a thread with a shared context
+	bool					tryCompile( String& errorMsg ) ;
 
     /**
         Creates a shader from a text file.
@@ -100,8 +105,11 @@ private:
 	GLenum					m_shaderType ;
 	bool					m_compiled ;
 	ResHandle*      		m_resHandle ;	
+	// name of the resource, the handle may be released by the cache before a background compile
+	String					m_sourceName ;
 };
 JAM_INLINE bool				ShaderFile::isCompiled() const { return m_compiled; }
+JAM_INLINE const String&	ShaderFile::getSource() const { return m_sourceCode; }
 JAM_INLINE ResHandle*       ShaderFile::getResHandle() const { return m_resHandle; }
 
 
@@ -0,0 +1,142 @@
+/**********************************************************************************
+* 
+* SharedUniforms.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_SHAREDUNIFORMS_H__
+#define __JAM_SHAREDUNIFORMS_H__
+
+#include <GL/glew.h>
+
+#include <jam/jam.h>
+#include <jam/Singleton.h>
+#include <jam/VertexBufferObject.h>
+#include <jam/core/geom.h>
+
+#define JAM_SHARED_UNIFORMS_VIEW_SLOTS			64				// views written in a frame before the buffer is orphaned
+#define JAM_SHARED_UNIFORMS_OBJECT_SLOTS		4096			// objects written in a frame before the buffer is orphaned
+
+namespace jam
+{
+class Camera ;
+
+/*!
+	\class SharedUniforms
+
+	Frame, view and object constants shared by every program through std140 uniform blocks
+	(FrameBlock, ViewBlock and ObjectBlock), so that switching programs doesn't upload any matrix.
+
+	Frame constants are written once per frame, view constants once per view: a view is written
+	only if it differs from the bound one. Object constants are written into the next slot of a
+	per frame ring and bound by offset, so a draw only uploads its own model and normal matrices.
+	The normal matrix is inverted only for objects which aren't uniformly scaled.
+
+	\remark It must only be used by the GL thread
+*/
+class JAM_API SharedUniforms : public Singleton<SharedUniforms>
+{
+	friend class Singleton<SharedUniforms> ;
+
+public:
+	/// binding points of the uniform blocks (0 is used by the LightsBlock)
+	static const GLuint		FRAME_BLOCK_BINDING = 1 ;
+	static const GLuint		VIEW_BLOCK_BINDING = 2 ;
+	static const GLuint		OBJECT_BLOCK_BINDING = 3 ;
+
+	// std140 layouts of the uniform blocks
+	struct FrameData
+	{
+		Vector4				time ;					// total time, delta time, frame number
+	};
+
+	struct ViewData
+	{
+		Matrix4				viewMatrix ;
+		Matrix4				projMatrix ;
+		Vector4				viewPos ;
+	};
+
+	struct ObjectData
+	{
+		Matrix4				modelMatrix ;
+		Vector4				normalMatrix[3] ;
+	};
+
+	/// Orphans the buffers written in the previous frame, called once per frame by Application
+	void					newFrame() ;
+
+	void					setFrame( float totalTime, float deltaTime ) ;
+
+	void					setView( Camera* pCam ) ;
+	void					setView( const Matrix4& viewMatrix, const Matrix4& projMatrix, const Vector3& viewPos ) ;
+	void					setViewMatrix( const Matrix4& mat ) ;
+	void					setProjectionMatrix( const Matrix4& mat ) ;
+	void					setViewPosition( const Vector3& pos ) ;
+	const ViewData&			getView() const { return m_view; }
+
+	void					setModelMatrix( const Matrix4& mat ) ;
+	const Matrix4&			getModelMatrix() const { return m_object.modelMatrix; }
+
+	/// Returns the number of object blocks written in the current frame
+	size_t					getNumOfObjectWrites() const { return m_numOfObjectWrites; }
+
+private:
+							SharedUniforms() ;
+	virtual					~SharedUniforms() = default ;
+
+	struct Ring
+	{
+		VertexBufferObject	ubo ;
+		size_t				slotSize ;
+		size_t				numOfSlots ;
+		size_t				next ;
+	};
+
+	void					createRing( Ring& ring, size_t dataSize, size_t numOfSlots ) ;
+	GLintptr				write( Ring& ring, const void* pData, size_t size ) ;
+	void					commitView() ;
+	void					commitObject() ;
+
+private:
+	VertexBufferObject		m_frameUbo ;
+	Ring					m_views ;
+	Ring					m_objects ;
+
+	FrameData				m_frame ;
+	ViewData				m_view ;
+	ObjectData				m_object ;
+	bool					m_hasView ;
+	bool					m_hasObject ;
+
+	size_t					m_numOfObjectWrites ;
+};
+
+JAM_INLINE SharedUniforms& GetSharedUniforms() { return SharedUniforms::getSingleton(); }
+
+}
+
+#endif // __JAM_SHAREDUNIFORMS_H__
@@ -46,6 +46,9 @@ public:
 	static T&				getSingleton();
 	static void				destroySingleton() ;
 
+	/// Returns true if the instance exists, it doesn't create it
+	static bool				isSingletonCreated() { return m_singleton != 0 ; }
+
 protected:
 							Singleton() = default ;
 	virtual					~Singleton() = default ;
@@ -46,6 +46,18 @@
 namespace jam
 {
 
+/**
+	Interleaved vertex layout used by cooked skinned models
+*/
+struct SkinnedMeshVertex
+{
+	Vector3					position ;
+	Vector3					normal ;
+	Vector2					texCoords ;
+	glm::ivec4				bonesId ;
+	Vector4					weights ;
+};
+
 /*!
 	\class SkinnedMesh
 */
@@ -60,9 +72,12 @@ public:
 	void					create(size_t numOfVertices, size_t numOfElements) ;
 	void					destroy() ;
 	void					upload() ;
+	void					uploadInterleaved( const SkinnedMeshVertex* pVertices, size_t numOfVertices, const U16* pElements, size_t numOfElements ) ;
 	void					draw() ;
+	void					drawInstanced( size_t numOfInstances, Shader* pShader, Material* pMaterial = nullptr ) ;
 
 	bool					isUploaded() const ;
+	size_t					getNumOfElements() const ;
 
 	HeapArray<Vector3>&		getVerticesArray() ;
 	HeapArray<Vector3>&		getNormalsArray() ;
@@ -84,6 +99,7 @@ private:
 	Array<VertexBufferObject,6>	m_vbos ;
 	VertexArrayObject		m_vao ;
 
+	size_t					m_numOfElements ;
 	bool					m_uploaded ;
 };			
 
@@ -95,6 +111,7 @@ JAM_INLINE HeapArray<glm::ivec4>&	SkinnedMesh::getBonesIdArray() { return m_bone
 JAM_INLINE HeapArray<glm::vec4>&	SkinnedMesh::getWeightsArray() { return m_weights; }
 JAM_INLINE HeapArray<uint16_t>&		SkinnedMesh::getElementsArray() { return m_elements; }
 JAM_INLINE bool						SkinnedMesh::isUploaded() const { return m_uploaded; }
+JAM_INLINE size_t					SkinnedMesh::getNumOfElements() const { return m_numOfElements; }
 
 class JAM_API SkinnedMeshManager : public NamedTaggedObjectManager<SkinnedMesh>, public jam::Singleton<SkinnedMeshManager>
 {
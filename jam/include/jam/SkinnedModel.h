@@ -35,6 +35,7 @@
 #include <jam/jam.h>
 #include <jam/SkinnedMesh.h>
 #include <jam/GameObject.h>
+#include <jam/ModelCache.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -52,8 +53,19 @@ public:
 	virtual 				~SkinnedModel() ;
 
 	void					draw() ;
+
+	/**
+		Loads the model from its cooked file if up to date, otherwise imports it with assimp and cooks it
+		\remark models loaded from the same file share meshes, skeleton and clips
+	*/
 	void					load(const String& modelPath) ;
 
+	/// Queues an instance of the model posed at the given time, it will be drawn by InstancingManager::flush()
+	void					addInstance( const Matrix4& worldMatrix, float timeInSeconds, size_t animationIdx = 0, const Color& color = Color::WHITE ) ;
+
+	/// Queues many instances of the model at once, their poses are sampled in parallel by the JobSystem
+	void					addInstances( const Matrix4* pWorldMatrices, const float* pTimesInSeconds, size_t numOfInstances, size_t animationIdx = 0, const Color& color = Color::WHITE ) ;
+
 	// it must to be called after load(), otherwise it will return -1
 	int						getNumOfAnimations() const ;
 		
@@ -61,53 +73,36 @@ public:
 
 private:
 	using BonesMap = std::map<String,unsigned int> ;
-	using AnimationsMap = std::map<String,const aiNodeAnim*> ;
 
 	static Matrix4			assimpToGlmMatrix( const aiMatrix4x4& ) ;
-	static Matrix4			assimpToGlmMatrix( const aiMatrix3x3& ) ;
-
-	void					processNode(aiNode* node) ;
-	SkinnedMesh*			processMesh(aiMesh* mesh) ;
-	void					loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::vector<Texture2D*>& out ) ;
-	void					loadBones( const aiMesh* pMesh, SkinnedMesh* pSkinnedMesh ) ;
-//	void					addBoneData(unsigned int vertexIdx, unsigned int boneId, float weight) ;
-
-	void					calcInterpolatedScaling(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);
-	void					calcInterpolatedRotation(aiQuaternion& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);
-	void					calcInterpolatedPosition(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);    
-	size_t					findScaling(float AnimationTime, const aiNodeAnim* pNodeAnim);
-	size_t					findRotation(float AnimationTime, const aiNodeAnim* pNodeAnim);
-	size_t					findPosition(float AnimationTime, const aiNodeAnim* pNodeAnim);
-	void					readNodeHeirarchy(float AnimationTime, const aiNode* pNode, const Matrix4& ParentTransform, size_t animationIdx);
-	const aiNodeAnim*		findNodeAnim(size_t animIdx, const String& NodeName);
-
-	// stores animations in maps for faster retrieval 
-	void					storeAnim() ;
-	void					storeNodeAnim(const aiAnimation* pAnimation, AnimationsMap& animMap) ;
 
-private:
-	struct BoneInfo
-	{
-		Matrix4				BoneOffset;	// brings the vertices from their local space position into their node space
-		Matrix4				FinalTransformation;        
+	void					cook( const String& modelPath, std::vector<U8>& blob ) ;
+	void					processNode(const aiScene* pScene, aiNode* node, CookedModelWriter& writer, BonesMap& boneMapping, std::vector<Matrix4>& boneOffsets) ;
+	void					processMesh(const aiScene* pScene, aiMesh* mesh, CookedModelWriter& writer, BonesMap& boneMapping, std::vector<Matrix4>& boneOffsets) ;
+	void					loadMaterialTexture(aiMaterial* mat, aiTextureType type, char* pOut ) ;
+	void					loadBones( const aiMesh* pMesh, std::vector<SkinnedMeshVertex>& vertices, BonesMap& boneMapping, std::vector<Matrix4>& boneOffsets ) ;
+	void					processNodeHierarchy( const aiNode* pNode, I32 parent, CookedModelWriter& writer, const BonesMap& boneMapping, std::map<String,I32>& nodeMapping, U32& numOfNodes ) ;
+	void					processAnimation( const aiAnimation* pAnimation, CookedModelWriter& writer, const std::map<String,I32>& nodeMapping ) ;
 
-		BoneInfo() : BoneOffset(1.0f), FinalTransformation(1.0f) {} ;
-	};
+	// thread-safe sampling of the clip pose, nodeTransforms is the scratch buffer for the skeleton nodes
+	void					sampleBones( float TimeInSeconds, size_t animationIdx, std::vector<Matrix4>& nodeTransforms, std::vector<Matrix4>& Transforms ) const ;
 
-	std::vector<SkinnedMesh*>	m_meshes ;
-	String					m_folder ;
+	static Vector3			calcInterpolated( const CookedVectorKey* pKeys, size_t numOfKeys, float AnimationTime ) ;
+	static Quaternion		calcInterpolated( const CookedQuatKey* pKeys, size_t numOfKeys, float AnimationTime ) ;
 
-	// maps a bone name to its index
-	unsigned int			m_numBones ;
+private:
+	Ref<SkinnedModelData>	m_data ;
+	String					m_folder ;
 
-	Matrix4					m_globalInverseTransform ;
+	// global transform of every skeleton node, reused by boneTransform()
+	std::vector<Matrix4>	m_nodeTransforms ;
 
-	std::vector<BoneInfo>	m_boneInfo ;
-	const aiScene*			m_pScene;
-	Assimp::Importer		m_import;
+	// reused by addInstance() to avoid per-instance allocations
+	std::vector<Matrix4>	m_instanceTransforms ;
 
-	BonesMap				m_boneMapping ;
-	HeapArray<AnimationsMap>	m_animMapping ;
+	// reused by addInstances(): a bones palette per instance and a nodes scratch buffer per job thread
+	std::vector<std::vector<Matrix4>>	m_instancesPalettes ;
+	std::vector<std::vector<Matrix4>>	m_threadNodeTransforms ;
 };
 
 }
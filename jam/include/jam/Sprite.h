@@ -113,6 +113,7 @@ public:
 	\remark Overrides the implementation of class Node
 	*/
 	virtual bool			collide(Node* other, CollisionManager::Method m) const ;
+	virtual bool			hasStandardCollide() const { return true; }
 
 	virtual void			scaleFix(float width, float height);
 
@@ -142,6 +143,11 @@ protected:
 	bool					intersectPixels( Sprite* other ) const ;
 	bool					intersectPixelsSlow( Sprite* other ) const ;
 
+	/// Returns the flips the frame is drawn with, the ones of the current animation frame if animated
+	void					getDrawnFlips( bool& flipX, bool& flipY ) const ;
+	/// Returns the transform from the pixels of the given mask of the frame to the world
+	Matrix3					getPixelToWorldTform( const AlphaMask& mask ) const ;
+
 protected:
 	Color					m_color;
 	bool					m_flipX;
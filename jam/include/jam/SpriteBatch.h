@@ -97,7 +97,8 @@ private:
     class SpriteBatchItem : public RefCountedObject
     {
     public:
-	    Ref<Texture2D>			Texture ;
+	    // borrowed, the caller keeps the texture alive until the batch is flushed
+	    BorrowedRef<Texture2D>	Texture ;
 	    float					SortKey ;
 
 	    V3F_C4B_T2F				vertexTL ;
@@ -106,7 +107,7 @@ private:
 	    V3F_C4B_T2F				vertexBR ;
 
     public:
-							    SpriteBatchItem() = default ;
+							    SpriteBatchItem() { setRefCountPolicy( RefCountPolicy::SingleThreaded ) ; }
 	    void					set( float x, float y, float dx, float dy, float w, float h, float sin, float cos, Color color, Vector2 texCoordTL, Vector2 texCoordBR, float depth ) ;
 	    void					set( float x, float y, float w, float h, Color color, Vector2 texCoordTL, Vector2 texCoordBR, float depth ) ;
 	    static bool 			comparator( SpriteBatchItem* i, SpriteBatchItem* j ) ;
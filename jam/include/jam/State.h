@@ -170,6 +170,14 @@ public:
 	*/
 	virtual void			beforeSceneUpdate() {}
 
+	/**
+		Called once for every fixed simulation step, just after physics has been stepped.
+
+		\remark The engine will call the corresponding method defined in the Application class before,
+				then it will call this method.
+	*/
+	virtual void			fixedUpdate( jam::time dt ) {}
+
 	/**
 		Called after the scene is updated.
 
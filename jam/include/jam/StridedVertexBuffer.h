@@ -48,6 +48,10 @@ class JAM_API StridedVertexBuffer : public IVertexBuffer
 {
 public:
 							StridedVertexBuffer( U16 vertexCount = StridedVertexBuffer::DefaultMaxVertexCount, U16 indexCount = 0 ) ;
+	/// Uses the given arrays as storage, they are not owned (e.g. frame memory) and must outlive the buffer
+							StridedVertexBuffer( V3F_C4B_T2F* pVertices, U16 vertexCount, U16* pIndices, U16 indexCount ) ;
+	/// Copies vertices and indices, GL objects are not shared and the copy is uploaded on its first use
+							StridedVertexBuffer( const StridedVertexBuffer& other ) ;
 							~StridedVertexBuffer() ;
 
 	V3F_C4B_T2F*			getVertexArray() { return &m_vertices[m_startVertexCount]; }
@@ -108,6 +112,7 @@ protected:
 	U16						m_maxIndexCount ;
 
 	GLuint					m_vbo ;
+	bool					m_ownsStorage ;
 };
 
 JAM_INLINE U16 StridedVertexBuffer::getStartVertexCount() const { return m_startVertexCount; }
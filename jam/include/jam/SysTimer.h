@@ -37,6 +37,12 @@
 namespace jam
 {
 
+/**
+	Monotonic system clock, based on the platform high resolution performance counter
+
+	\remark getTime() returns milliseconds (see getUnitsPerSecond()), getTimeNs() returns nanoseconds.
+			 Both are measured from the timer creation and never go backwards
+*/
 class JAM_API SysTimer : public jam::Singleton<SysTimer>
 {
 	friend class jam::Singleton<SysTimer> ;
@@ -47,12 +53,23 @@ public:
 	uint64_t				getTime() { return this->getTimeMs(); }
 	uint64_t				getUnitsPerSecond() { return m_unitsPerSecond; }
 
+	/// Returns the time in nanoseconds
+	uint64_t				getTimeNs() ;
+
+	/// Returns the time in seconds, with sub-microsecond resolution
+	double					getTimeSecs() ;
+
+	/// Returns the resolution of the underlying counter in ticks per second
+	uint64_t				getCounterFrequency() const { return m_counterFrequency; }
+
 private:
 	// get the time in milliseconds
 	uint64_t				getTimeMs() ;
 
 private:
 	uint64_t				m_unitsPerSecond ;
+	uint64_t				m_counterFrequency ;
+	uint64_t				m_counterStart ;
 };
 
 /** Returns the singleton instance */
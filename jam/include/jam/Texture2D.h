@@ -62,6 +62,8 @@ public:
 	void					createDefaultEmpty( Color color = Color::WHITE, bool fUpload = true ) ;
 	void					createFromSDLSurface( SDL_Surface* pSurface ) ;
 	void					load( const String& filename, bool flipV = true, bool fUpload = true );
+	/// Creates an empty texture to be used as framebuffer attachment, e.g. internalFormat GL_RGBA8 or GL_RGBA16F
+	void					createRenderTarget( U32 width, U32 height, GLenum internalFormat ) ;
 
 	/// Returns the width of texture
 	U32						getWidth() const { return m_width; }
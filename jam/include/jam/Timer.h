@@ -33,15 +33,19 @@
 #include <jam/jam.h>
 #include <jam/BaseManager.hpp>
 #include <jam/Event.h>
+#include <jam/FrameAllocator.h>
 
 #include <jam/Object.h>
 
 namespace jam
 {
-// fired
-class TimeExpiredEventArgs : public EventArgs
+// fired, in frame memory: handlers must not keep it beyond the next frame
+class TimeExpiredEventArgs : public EventArgs, public FrameAllocated
 {
 public:
+	using FrameAllocated::operator new ;
+	using FrameAllocated::operator delete ;
+
 	/** Creates a new TimeExpiredEventArgs */
 	static TimeExpiredEventArgs*	create() ;
 
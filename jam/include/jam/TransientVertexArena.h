@@ -0,0 +1,99 @@
+/**********************************************************************************
+* 
+* TransientVertexArena.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __JAM_TRANSIENTVERTEXARENA_H__
+#define __JAM_TRANSIENTVERTEXARENA_H__
+
+#include <jam/jam.h>
+#include <GL/glew.h>
+
+#define JAM_TRANSIENT_ARENA_FRAMES					3				// frames in flight, each one writes its own segment
+#define JAM_TRANSIENT_ARENA_VERTICES_PER_FRAME		65536			// so a single draw (U16 vertex count) always fits
+#define JAM_TRANSIENT_ARENA_INDICES_PER_FRAME		(65536*2)
+
+namespace jam
+{
+class StridedVertexBuffer ;
+class Material ;
+
+/*!
+	\class TransientVertexArena
+
+	Streaming storage for immediate (non batched) draws.
+	A single vertex buffer and a single index buffer are split into one segment per frame in flight:
+	every draw copies its vertices and indices in the segment of the current frame and is issued with
+	a base vertex, using one VAO created once for the V3F_C4B_T2F format.
+	A fence is inserted at the end of each frame; its segment is written again only after the fence is signaled,
+	so mapping never stalls on buffers in use. If a segment fills up the buffers are orphaned.
+
+	\remark It's owned by Gfx and must only be used by the GL thread
+*/
+class JAM_API TransientVertexArena
+{
+public:
+							TransientVertexArena() ;
+							~TransientVertexArena() ;
+
+	/// Copies the vertices and indices of the given buffer and draws them
+	void					draw( StridedVertexBuffer& vbuff, Material* pMaterial, GLenum pType = GL_TRIANGLES ) ;
+
+	/// Fences the segment of the frame just ended and moves to the next one, called once per frame by Gfx
+	void					newFrame() ;
+
+	size_t					getNumOfDraws() const { return m_numOfDraws ; }
+	size_t					getNumOfBytes() const { return m_numOfBytes ; }
+	size_t					getNumOfOrphans() const { return m_numOfOrphans ; }
+
+private:
+	void					create() ;
+	void					orphan() ;
+	void					write( GLenum target, size_t offset, size_t size, const void* pData ) ;
+
+							TransientVertexArena( const TransientVertexArena& ) = delete ;
+	TransientVertexArena&	operator=( const TransientVertexArena& ) = delete ;
+
+private:
+	GLuint					m_vao ;
+	GLuint					m_vbo ;
+	GLuint					m_ebo ;
+	GLsync					m_fences[JAM_TRANSIENT_ARENA_FRAMES] ;
+
+	size_t					m_segment ;
+	size_t					m_vertexCount ;			// vertices written in the current segment
+	size_t					m_indexCount ;			// indices written in the current segment
+
+	// statistics of the current frame
+	size_t					m_numOfDraws ;
+	size_t					m_numOfBytes ;
+	size_t					m_numOfOrphans ;
+};
+
+}
+
+#endif // __JAM_TRANSIENTVERTEXARENA_H__
@@ -50,6 +50,8 @@ public:
 	void					setTarget( GLenum target ) ;
 	GLenum					getTarget() const ;
 
+	GLuint					getId() const ;
+
 	void					create() ;
 	void					destroy() ;
 
@@ -68,6 +70,7 @@ private:
 
 JAM_INLINE void VertexBufferObject::setTarget( GLenum target ) { m_type = target; }
 JAM_INLINE GLenum VertexBufferObject::getTarget() const { return m_type; }
+JAM_INLINE GLuint VertexBufferObject::getId() const { return m_vbo; }
 
 }
 
@@ -75,6 +75,9 @@ JAM_API String				appendPath(const String& path, const String& more) ;
 
 JAM_API int64_t				getFileSize(const char* filename ) ;
 
+/// Returns the last modification time of the given file, in seconds since the epoch (-1 if the file doesn't exist)
+JAM_API int64_t				getFileModificationTime(const char* filename ) ;
+
 JAM_API String				getCurrentDirectory() ;
 
 JAM_API bool				exists( const String& filename ) ;
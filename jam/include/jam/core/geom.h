@@ -76,5 +76,8 @@ JAM_API Matrix4				createScaleMatrix3D(const Vector3& v) ;
 JAM_API Matrix4				createRotationMatrix3D( float yaw, float pitch, float roll ) ;
 JAM_API Matrix4				createTranslationMatrix3D(const Vector3& v) ;
 
+// returns the matrix transforming the normals, the inverse-transpose is computed only for non-uniform scales
+JAM_API Matrix3				computeNormalMatrix(const Matrix4& model) ;
+
 }
 #endif	// __JAM_GEOM_H__
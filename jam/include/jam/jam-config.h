@@ -30,9 +30,11 @@
 #ifndef __JAM_JAM_CONFIG_H__
 #define __JAM_JAM_CONFIG_H__
 
-#define JAM_CM_MAX_COLL_TYPES		32
+#define JAM_CM_MAX_COLL_LAYERS		64							// collision types 1..64 are the bits of the collision layer masks
+#define JAM_CM_MAX_COLL_TYPES		(JAM_CM_MAX_COLL_LAYERS+1)	// type 0 disables collisions
 #define JAM_WINDOWS_WIDTH			960
 #define JAM_WINDOWS_HEIGHT			540
+#define JAM_MAX_JOB_THREADS			8
 
 //#define IW_USE_PROFILE
 //#define JAM_DEBUG_MENU_ENABLED
@@ -48,6 +50,9 @@
 //#define JAM_FORCE_BLENDING_MODE
 //#define JAM_USE_QUAD_LIST
 //#define JAM_MULTITHREADING_ENABLED
+//#define JAM_PROFILER_DISABLED
+//#define JAM_SIMD_DISABLED
+//#define JAM_MEMORY_TRACKING
 
 #ifdef _DEBUG
 
@@ -61,7 +61,19 @@
 	#error "Unsupported compiler"
 #endif
 
-#define JAM_PROFILE(x)				
+#ifndef JAM_PROFILER_DISABLED
+	#define JAM_PROFILE_CONCAT_(a,b)	a##b
+	#define JAM_PROFILE_CONCAT(a,b)		JAM_PROFILE_CONCAT_(a,b)
+	#define JAM_PROFILE(x)				jam::ProfileZone JAM_PROFILE_CONCAT(jamProfileZone,__LINE__)(x)
+	#define JAM_PROFILE_GPU(x)			jam::GpuProfileZone JAM_PROFILE_CONCAT(jamGpuProfileZone,__LINE__)(x)
+	#define JAM_PROFILE_COUNTER(x,v)	jam::Profiler::counter((x),(double)(v))
+	#define JAM_PROFILE_DETAIL(x)		jam::ProfileZone JAM_PROFILE_CONCAT(jamProfileZone,__LINE__)((x),jam::Profiler::isCapturingDetail())
+#else
+	#define JAM_PROFILE(x)
+	#define JAM_PROFILE_DETAIL(x)
+	#define JAM_PROFILE_GPU(x)
+	#define JAM_PROFILE_COUNTER(x,v)
+#endif
 #define JAM_INLINE					inline
 
 #define JAM_DELETE(x)				if( (x) ) { delete (x); (x)=nullptr; }
@@ -123,4 +135,7 @@
 		OutputDebugStringA( buff ) ; \
 	} while(false)
 
+// zones and counters used by JAM_PROFILE macros
+#include <jam/Profiler.h>
+
 #endif	// __JAM_H__
@@ -0,0 +1,43 @@
+#version 140
+
+// each instance takes 8 texels in instanceData:
+// 0-3 model matrix columns, 4-6 normal matrix columns (4.w is the bones palette base), 7 color
+#define INSTANCE_TEXELS 8
+
+in vec3 in_Position ;
+in vec3 in_Normal ;
+in vec2 in_TexCoords ;
+
+uniform samplerBuffer instanceData ;
+uniform int   instanceBase ;
+
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+out vec3 ex_FragPos ;
+out vec2 ex_TexCoords ;
+out vec4 ex_InstanceColor ;
+out vec3 ex_Normal ;
+
+void main(void)
+{
+	int base = (instanceBase + gl_InstanceID) * INSTANCE_TEXELS ;
+	mat4 modelMatrix = mat4( texelFetch(instanceData, base),
+							 texelFetch(instanceData, base+1),
+							 texelFetch(instanceData, base+2),
+							 texelFetch(instanceData, base+3) ) ;
+	mat3 normalMatrix = mat3( texelFetch(instanceData, base+4).xyz,
+							  texelFetch(instanceData, base+5).xyz,
+							  texelFetch(instanceData, base+6).xyz ) ;
+	ex_InstanceColor = texelFetch(instanceData, base+7) ;
+
+    ex_FragPos = vec3(modelMatrix * vec4(in_Position, 1.0));   
+    ex_TexCoords = in_TexCoords;
+    ex_Normal = normalMatrix * in_Normal ;
+
+    gl_Position = projMatrix * viewMatrix * vec4(ex_FragPos, 1.0);
+}
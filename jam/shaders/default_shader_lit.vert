@@ -5,10 +5,18 @@ in vec3 in_Normal ;
 in vec4 in_Color ;
 in vec2 in_TexCoords ;
 
-uniform mat4  modelMatrix ;
-uniform mat4  viewMatrix ;
-uniform mat4  projMatrix ;
-uniform mat3  normalMatrix ;
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+// per object constants, bound by offset for each draw (SharedUniforms::ObjectData)
+layout(std140) uniform ObjectBlock {
+	mat4	modelMatrix ;
+	mat3	normalMatrix ;
+} ;
 
 out vec3 ex_FragPos ;
 out vec3 ex_Normal;
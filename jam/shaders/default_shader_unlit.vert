@@ -4,9 +4,18 @@ in vec3 in_Position;
 in vec4 in_Color;
 in vec2 in_TexCoords ;
 
-uniform mat4 modelMatrix ;
-uniform mat4 viewMatrix ;
-uniform mat4 projMatrix ;
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+// per object constants, bound by offset for each draw (SharedUniforms::ObjectData)
+layout(std140) uniform ObjectBlock {
+	mat4	modelMatrix ;
+	mat3	normalMatrix ;
+} ;
 
 out vec4 ex_Color;
 out vec2 ex_TexCoords ;
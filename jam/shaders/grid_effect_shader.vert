@@ -0,0 +1,79 @@
+#version 140
+
+in vec3 in_Position;
+in vec4 in_Color;
+in vec2 in_TexCoords ;
+
+uniform mat4 modelMatrix ;
+uniform mat4 viewMatrix ;
+uniform mat4 projMatrix ;
+
+// effect parameters, see GridEffectType
+uniform int effectType ;
+uniform float effectTime ;
+uniform float effectSeed ;
+uniform float amplitude ;
+uniform float waves ;
+uniform vec2 center ;
+uniform float radius ;
+uniform float range ;
+
+// grid layout, used by tiled effects to find the tile of a vertex
+uniform ivec2 gridSize ;
+uniform vec2 gridStep ;
+uniform vec2 gridOrigin ;
+
+out vec4 ex_Color;
+out vec2 ex_TexCoords ;
+
+const float PI = 3.14159265 ;
+
+float hash( float n )
+{
+	return fract( sin(n) * 43758.5453 ) ;
+}
+
+void main(void)
+{
+	vec3 p = in_Position ;
+	float phase = effectTime * PI * waves * 2.0 ;
+
+	if( effectType == 1 ) {
+		// waves
+		p.z += sin( phase + (p.x + p.y) * 0.01 ) * amplitude ;
+	}
+	else if( effectType == 2 ) {
+		// ripple
+		float r = distance( center, p.xy ) ;
+		if( r < radius ) {
+			float rate = (radius - r) / radius ;
+			p.z += sin( phase + r * 0.1 ) * amplitude * rate * rate ;
+		}
+	}
+	else if( effectType == 3 ) {
+		// liquid
+		p.x += sin( phase + p.x * 0.01 ) * amplitude ;
+		p.y += sin( phase + p.y * 0.01 ) * amplitude ;
+	}
+	else if( effectType == 4 ) {
+		// shaky
+		float n = float(gl_VertexID) + effectSeed * 7919.0 ;
+		p.xy += vec2( hash(n) * 2.0 - 1.0, hash(n + 17.0) * 2.0 - 1.0 ) * range ;
+	}
+	else if( effectType == 5 ) {
+		// waves tiles, the four vertices of a tile move together
+		int tile = gl_VertexID / 4 ;
+		float cx = gridOrigin.x + (float(tile % gridSize.x) + 0.5) * gridStep.x ;
+		float cy = gridOrigin.y - (float(tile / gridSize.x) + 0.5) * gridStep.y ;
+		p.z += sin( phase + (cx + cy) * 0.01 ) * amplitude ;
+	}
+	else if( effectType == 6 ) {
+		// shaky tiles
+		float n = float(gl_VertexID / 4) + effectSeed * 7919.0 ;
+		p.xy += vec2( hash(n) * 2.0 - 1.0, hash(n + 17.0) * 2.0 - 1.0 ) * range ;
+	}
+
+	gl_Position = projMatrix * viewMatrix * modelMatrix * vec4(p, 1.0) ;
+	ex_Color = in_Color ;
+	ex_TexCoords = in_TexCoords ;
+}
@@ -0,0 +1,119 @@
+#version 140
+
+#define MAX_LIGHTS 128
+
+// std140 layout of LightManager::LightData
+struct Light {
+	vec4	positionType ;			// xyz position (point light), w type: 1=directional, 2=point, 3=spot
+	vec4	directionRange ;		// xyz direction (directional and spot light), w range of influence
+	vec4	ambientConstant ;		// rgb ambient, w constant attenuation factor
+	vec4	diffuseLinear ;			// rgb diffuse, w linear attenuation factor
+	vec4	specularQuadratic ;		// rgb specular, w quadratic attenuation factor
+} ;
+
+// lights shared by all the lit programs, directional lights are stored first
+layout(std140) uniform LightsBlock {
+	Light	lights[MAX_LIGHTS] ;
+	ivec4	lightsInfo ;			// x number of directional lights, yzw clusters grid size
+	vec4	clusterParams ;			// x near plane, y depth slices scale
+	vec4	clusterViewport ;		// viewport origin and size
+	mat4	clusterView ;
+} ;
+
+in vec3 ex_FragPos ;
+in vec2 ex_TexCoords ;
+in vec4 ex_InstanceColor ;
+in mat3 ex_TBN ;
+
+// for version 140 we can't encapsulate sampler2D into a Material struct, so we define material here
+uniform float		material_shininess ;
+uniform sampler2D	material_diffuse ;
+uniform sampler2D	material_specular ;
+uniform sampler2D	material_normal ;
+
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+// for each cluster its light indices offset (high 16 bits) and count (low 16 bits), then the light indices
+uniform usamplerBuffer	lightGrid ;
+
+out vec4 FragColor;
+
+int clusterIndex( vec3 fragPos )
+{
+	float depth = -(clusterView * vec4(fragPos, 1.0)).z ;
+	int slice = int( log(max(depth, clusterParams.x) / clusterParams.x) * clusterParams.y ) ;
+	vec2 tile = (gl_FragCoord.xy - clusterViewport.xy) / clusterViewport.zw * vec2(lightsInfo.yz) ;
+	ivec3 cluster = clamp( ivec3(ivec2(tile), slice), ivec3(0), lightsInfo.yzw - 1 ) ;
+	return (cluster.z * lightsInfo.z + cluster.y) * lightsInfo.y + cluster.x ;
+}
+
+vec3 calcDirLight( Light light, vec3 normal, vec3 viewDir )
+{
+    vec3 lightDir = normalize(-light.directionRange.xyz);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
+    // combine results
+    vec3 ambient  = light.ambientConstant.rgb  * vec3(texture(material_diffuse, ex_TexCoords));
+    vec3 diffuse  = light.diffuseLinear.rgb  * diff * vec3(texture(material_diffuse, ex_TexCoords));
+    vec3 specular = light.specularQuadratic.rgb * spec * vec3(texture(material_specular, ex_TexCoords));
+    return (ambient + diffuse + specular);
+}
+
+vec3 calcPointLight( Light light, vec3 normal, vec3 viewDir, vec3 fragPos )
+{
+    vec3 lightDir = normalize(light.positionType.xyz - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
+    // attenuation
+    float dist    = length(light.positionType.xyz - fragPos);
+    float attenuation = 1.0 / (light.ambientConstant.w + light.diffuseLinear.w * dist + 
+  			     light.specularQuadratic.w * (dist * dist));    
+    // combine results
+    vec3 ambient  = light.ambientConstant.rgb  * vec3(texture(material_diffuse, ex_TexCoords));
+    vec3 diffuse  = light.diffuseLinear.rgb  * diff * vec3(texture(material_diffuse, ex_TexCoords));
+    vec3 specular = light.specularQuadratic.rgb * spec * vec3(texture(material_specular, ex_TexCoords));
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+} 
+
+void main(void)
+{
+     // obtain normal from normal map in range [0,1]
+	vec3 normal = texture(material_normal,ex_TexCoords).rgb;
+
+	// transform normal vector to range [-1,1], then to world space
+	normal = normalize(ex_TBN * (normal * 2.0 - 1.0)) ;
+
+    vec3 viewDir = normalize(viewPos - ex_FragPos) ;
+
+	vec3 result	= vec3(0) ;
+
+	for( int i=0; i<lightsInfo.x; i++ ) {
+		result += calcDirLight( lights[i], normal, viewDir ) ;
+	}
+
+	// only the point lights overlapping the fragment cluster
+	uint cluster = texelFetch( lightGrid, clusterIndex(ex_FragPos) ).r ;
+	int offset = int(cluster >> 16u) ;
+	int count = int(cluster & 0xFFFFu) ;
+	for( int i=0; i<count; i++ ) {
+		int idx = int( texelFetch(lightGrid, offset + i).r ) ;
+		result += calcPointLight( lights[idx], normal, viewDir, ex_FragPos ) ;
+	}
+
+	FragColor = vec4(result,1.0) * ex_InstanceColor ;
+}
+
@@ -1,41 +1,27 @@
 #version 140
 
-#define NR_OF_LIGHTS 2
-
-struct Light {
-	int		type ;			// 1=directional, 2=point, 3=spot
-	vec3	position ;		// point light
-	vec3	direction ;		// directional and spot light
-
-	// attenuation factors for point light
-    float	constant ;
-    float	linear ;
-    float	quadratic ;  
-
-	vec3	ambient ;
-	vec3	diffuse ;
-	vec3	specular ; 
-} ;
-
 in vec3 in_Position ;
 in vec3 in_Normal ;
 in vec2 in_TexCoords ;
 in vec3 in_Tangent ;
 //in vec3 in_Bitangent ;
 
-uniform mat4  modelMatrix ;
-uniform mat4  viewMatrix ;
-uniform mat4  projMatrix ;
-uniform mat3  normalMatrix ;
-uniform Light lights[NR_OF_LIGHTS] ;
-uniform vec3  viewPos ;
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+// per object constants, bound by offset for each draw (SharedUniforms::ObjectData)
+layout(std140) uniform ObjectBlock {
+	mat4	modelMatrix ;
+	mat3	normalMatrix ;
+} ;
 
 out vec3 ex_FragPos ;
 out vec2 ex_TexCoords ;
-out vec3 ex_TangentLightPos[NR_OF_LIGHTS] ;
-out vec3 ex_TangentLightDir[NR_OF_LIGHTS] ;
-out vec3 ex_TangentViewPos ;
-out vec3 ex_TangentFragPos ;
+out mat3 ex_TBN ;
 
 void main(void)
 {
@@ -49,13 +35,8 @@ void main(void)
 	// then retrieve perpendicular vector B with the cross product of T and N
     vec3 B = cross(N, T);
     
-    mat3 TBN = transpose(mat3(T, B, N));
-	for( int i = 0 ; i<NR_OF_LIGHTS; i++ ) {    
-		ex_TangentLightPos[i] = TBN * lights[i].position ;
-		ex_TangentLightDir[i] = TBN * lights[i].direction ;
-	}
-    ex_TangentViewPos = TBN * viewPos;
-    ex_TangentFragPos = TBN * ex_FragPos;
+	// tangent to world space, lighting is done in world space
+    ex_TBN = mat3(T, B, N);
         
     gl_Position = projMatrix * viewMatrix * modelMatrix * vec4(in_Position, 1.0);
 }
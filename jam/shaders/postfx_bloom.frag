@@ -0,0 +1,17 @@
+#version 140
+
+in vec2 ex_TexCoords;
+in vec4 ex_Color ;
+
+out vec4 FragColor;
+
+uniform sampler2D	material_diffuse;
+uniform sampler2D	bloom_texture;
+uniform float		intensity;
+
+void main()
+{
+	vec4 color = texture(material_diffuse, ex_TexCoords);
+	color.rgb += texture(bloom_texture, ex_TexCoords).rgb * intensity;
+	FragColor = color;
+}
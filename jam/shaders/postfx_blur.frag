@@ -0,0 +1,22 @@
+#version 140
+
+in vec2 ex_TexCoords;
+in vec4 ex_Color ;
+
+out vec4 FragColor;
+
+uniform sampler2D	material_diffuse;
+uniform vec2		direction;		// texel size along the blur axis
+
+// 9 taps gaussian blur, taken as 5 linearly filtered fetches
+void main()
+{
+	vec2 off1 = direction * 1.3846153846;
+	vec2 off2 = direction * 3.2307692308;
+	vec3 color = texture(material_diffuse, ex_TexCoords).rgb * 0.2270270270;
+	color += texture(material_diffuse, ex_TexCoords + off1).rgb * 0.3162162162;
+	color += texture(material_diffuse, ex_TexCoords - off1).rgb * 0.3162162162;
+	color += texture(material_diffuse, ex_TexCoords + off2).rgb * 0.0702702703;
+	color += texture(material_diffuse, ex_TexCoords - off2).rgb * 0.0702702703;
+	FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 140
+
+in vec2 ex_TexCoords;
+in vec4 ex_Color ;
+
+out vec4 FragColor;
+
+uniform sampler2D	material_diffuse;
+uniform float		threshold;
+
+// keeps the part of the color brighter than threshold
+void main()
+{
+	vec3 color = texture(material_diffuse, ex_TexCoords).rgb;
+	float luma = dot(color, vec3(0.2126, 0.7152, 0.0722));
+	FragColor = vec4(color * max(luma - threshold, 0.0) / max(luma, 0.0001), 1.0);
+}
@@ -0,0 +1,22 @@
+#version 140
+
+in vec2 ex_TexCoords;
+in vec4 ex_Color ;
+
+out vec4 FragColor;
+
+uniform sampler2D	material_diffuse;
+uniform float		exposure;
+uniform float		contrast;
+uniform float		saturation;
+uniform vec3		tint;
+
+void main()
+{
+	vec4 color = texture(material_diffuse, ex_TexCoords);
+	vec3 rgb = color.rgb * exposure;
+	rgb = (rgb - 0.5) * contrast + 0.5;
+	float luma = dot(rgb, vec3(0.2126, 0.7152, 0.0722));
+	rgb = mix(vec3(luma), rgb, saturation) * tint;
+	FragColor = vec4(clamp(rgb, 0.0, 1.0), color.a);
+}
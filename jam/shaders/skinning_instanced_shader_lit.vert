@@ -0,0 +1,65 @@
+#version 140
+
+// each instance takes 8 texels in instanceData:
+// 0-3 model matrix columns, 4-6 normal matrix columns (4.w is the bones palette base), 7 color
+#define INSTANCE_TEXELS 8
+
+in vec3  in_Position ;
+in vec3  in_Normal ;
+in vec2  in_TexCoords ;
+in ivec4 in_BonesId ;
+in vec4  in_Weights ;
+
+// bones palettes of all instances, 4 texels per bone
+uniform samplerBuffer instanceBones ;
+uniform samplerBuffer instanceData ;
+uniform int   instanceBase ;
+
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+out vec3 ex_FragPos ;
+out vec3 ex_Normal;
+out vec2 ex_TexCoords ;
+out vec4 ex_InstanceColor ;
+
+mat4 fetchBone( int paletteBase, int boneId )
+{
+	int base = (paletteBase + boneId) * 4 ;
+	return mat4( texelFetch(instanceBones, base),
+				 texelFetch(instanceBones, base+1),
+				 texelFetch(instanceBones, base+2),
+				 texelFetch(instanceBones, base+3) ) ;
+}
+
+void main(void)
+{
+	int base = (instanceBase + gl_InstanceID) * INSTANCE_TEXELS ;
+	mat4 modelMatrix = mat4( texelFetch(instanceData, base),
+							 texelFetch(instanceData, base+1),
+							 texelFetch(instanceData, base+2),
+							 texelFetch(instanceData, base+3) ) ;
+	vec4 normalCol0 = texelFetch(instanceData, base+4) ;
+	mat3 normalMatrix = mat3( normalCol0.xyz,
+							  texelFetch(instanceData, base+5).xyz,
+							  texelFetch(instanceData, base+6).xyz ) ;
+	int paletteBase = int(normalCol0.w) ;
+	ex_InstanceColor = texelFetch(instanceData, base+7) ;
+
+    mat4 BoneTransform = fetchBone(paletteBase, in_BonesId[0]) * in_Weights[0];
+    BoneTransform     += fetchBone(paletteBase, in_BonesId[1]) * in_Weights[1];
+    BoneTransform     += fetchBone(paletteBase, in_BonesId[2]) * in_Weights[2];
+    BoneTransform     += fetchBone(paletteBase, in_BonesId[3]) * in_Weights[3];
+
+	vec4 PosL = BoneTransform * vec4(in_Position, 1.0);
+	gl_Position = projMatrix * viewMatrix * modelMatrix * PosL ;
+
+	ex_FragPos = vec3(modelMatrix*vec4(in_Position,1.0)) ;
+	vec4 normalL = BoneTransform * vec4(in_Normal,0.0) ;
+	ex_Normal = normalMatrix * (normalL.xyz) ;
+	ex_TexCoords = in_TexCoords ;
+}
@@ -8,10 +8,19 @@ in vec4  in_Weights ;
 
 const int MAX_BONES = 100;
 
-uniform mat4  modelMatrix ;
-uniform mat4  viewMatrix ;
-uniform mat4  projMatrix ;
-uniform mat3  normalMatrix ;
+// per view constants shared by all the programs (SharedUniforms::ViewData)
+layout(std140) uniform ViewBlock {
+	mat4	viewMatrix ;
+	mat4	projMatrix ;
+	vec3	viewPos ;
+} ;
+
+// per object constants, bound by offset for each draw (SharedUniforms::ObjectData)
+layout(std140) uniform ObjectBlock {
+	mat4	modelMatrix ;
+	mat3	normalMatrix ;
+} ;
+
 uniform mat4  bones[MAX_BONES] ;
 
 out vec3 ex_FragPos ;
@@ -36,6 +36,8 @@ using namespace std ;
 
 namespace jam
 {
+JAM_IMPLEMENT_OBJECT_ALLOCATOR( Action, new PoolObjectAllocator() )
+
 #ifdef JAM_DEBUG
 	int32_t Action::m_totCount = 0 ;
 #endif
@@ -44,6 +46,8 @@ Action::Action() :
 	m_pOriginalTarget(0),
 	m_pTarget(0)
 {
+	setRefCountPolicy( RefCountPolicy::SingleThreaded ) ;
+
 #ifdef JAM_DEBUG
 	m_totCount++ ;
 #endif
@@ -1431,7 +1431,6 @@ void Animate::stop()
 
 void Animate::update(jam::time time)
 {
-	m_pSprite->getAnimator().update();
 	m_pTarget->setActionFlags( Node::ActionFlags::ANIMATING ) ;
 }
 
@@ -113,7 +113,7 @@ void ActionManager::removeAllActionsFromTarget( Node* pTarget, bool eraseTargetE
 
 		for( ActionsList::iterator vit = pElement->actions.begin(); vit != pElement->actions.end(); vit++ ) {
 //			if( vit!=currentActionIt || pElement->currentActionSalvaged==false ) {
-				eraseObject((*vit)->getName()) ;
+				eraseObject(*vit) ;
 //			}
 		}
 		pElement->actions.clear() ;
@@ -159,11 +159,13 @@ void ActionManager::removeActionByName( const String& name, Node* pTarget )
 Action* ActionManager::getActionByName( const String& name, Node* pTarget )
 {
 	Action* action = 0 ;
+	// an action can only have a name already interned, anonymous ones never match
+	Name actionName = Name::find(name) ;
 	TargetsMap::iterator it = m_targets.find(pTarget) ;
-	if( it != m_targets.end() ) {
+	if( it != m_targets.end() && !actionName.isNull() ) {
 		ActionsList::iterator vit = it->second->actions.begin() ;
 		while(  vit != it->second->actions.end() ) {
-			if( (*vit)->getName() == name ) {
+			if( (*vit)->getNameId().equals(actionName) ) {
 				action = (Action*)*vit ;
 				break ;
 			}
@@ -265,7 +267,7 @@ void ActionManager::removeActionAt( ActionsList::iterator it, ActionMgrMapElemen
 	pElement->actions.erase(it);
 
 	// remove from bank
-	eraseObject(pAction->getName()) ;
+	eraseObject(pAction) ;
 
 	// update actionIndex in case we are in tick. looping over the actions
 	if (pElement->actionIndex >= uIndex)
@@ -0,0 +1,266 @@
+/**********************************************************************************
+* 
+* AlphaMask.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+#include "stdafx.h"
+#include "jam/AlphaMask.h"
+#include "jam/Texture2D.h"
+#include "jam/Draw2d.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace jam
+{
+
+// index of the lowest bit set, bits must not be 0
+static JAM_INLINE U32 lowestBit( U64 bits )
+{
+#ifdef _MSC_VER
+	unsigned long idx ;
+	_BitScanForward64( &idx, bits ) ;
+	return (U32)idx ;
+#else
+	return (U32)__builtin_ctzll( bits ) ;
+#endif
+}
+
+AlphaMask::AlphaMask( U32 width, U32 height ) :
+	m_width(width),
+	m_height(height),
+	m_wordsPerRow((width + 63) / 64),
+	m_bits( (size_t)m_wordsPerRow * height, 0 ),
+	m_minX((I32)width), m_minY((I32)height), m_maxX(-1), m_maxY(-1)
+{
+}
+
+AlphaMask* AlphaMask::create( const Texture2D* pTexture, const Rect& rect, U8 alphaThreshold )
+{
+	const U8* pData = pTexture ? pTexture->getData() : nullptr ;
+	I32 width = rect.getWidth() ;
+	I32 height = rect.getHeight() ;
+	U32 bytesPerPixel = pTexture ? pTexture->getBitCount() / 8 : 0 ;
+	if( !pData || width <= 0 || height <= 0 || bytesPerPixel == 0 ) {
+		return nullptr ;
+	}
+
+	bool hasAlpha = bytesPerPixel == 4 ;
+	I32 texWidth = (I32)pTexture->getWidth() ;
+	I32 texHeight = (I32)pTexture->getHeight() ;
+
+	AlphaMask* pMask = new AlphaMask( (U32)width, (U32)height ) ;
+	for( I32 y = 0; y < height; y++ ) {
+		// the first row of the texture is its bottom one, as it is uploaded (see DrawItem texture coordinates)
+		I32 texY = texHeight - 1 - (rect.top + y) ;
+		if( texY < 0 || texY >= texHeight ) {
+			continue ;
+		}
+
+		U64* pRow = &pMask->m_bits[(size_t)y * pMask->m_wordsPerRow] ;
+		const U8* pTexel = pData + ((size_t)texY * texWidth + rect.left) * bytesPerPixel ;
+		I32 rowWidth = std::min( width, texWidth - rect.left ) ;
+		for( I32 x = 0; x < rowWidth; x++, pTexel += bytesPerPixel ) {
+			if( !hasAlpha || pTexel[3] > alphaThreshold ) {
+				pRow[x >> 6] |= 1ull << (x & 63) ;
+				pMask->m_minX = std::min( pMask->m_minX, x ) ;
+				pMask->m_maxX = std::max( pMask->m_maxX, x ) ;
+				pMask->m_minY = std::min( pMask->m_minY, y ) ;
+				pMask->m_maxY = std::max( pMask->m_maxY, y ) ;
+			}
+		}
+	}
+
+	return pMask ;
+}
+
+bool AlphaMask::test( I32 x, I32 y ) const
+{
+	if( x < 0 || y < 0 || x >= (I32)m_width || y >= (I32)m_height ) {
+		return false ;
+	}
+	return ( getRow(y)[x >> 6] >> (x & 63) ) & 1 ;
+}
+
+U64 AlphaMask::fetch( U32 y, I32 x ) const
+{
+	if( x >= (I32)m_width || x <= -64 ) {
+		return 0 ;
+	}
+
+	const U64* pRow = getRow( y ) ;
+	if( x < 0 ) {
+		return pRow[0] << (-x) ;
+	}
+
+	U32 word = (U32)x >> 6 ;
+	U32 shift = (U32)x & 63 ;
+	U64 bits = pRow[word] >> shift ;
+	if( shift != 0 && word + 1 < m_wordsPerRow ) {
+		bits |= pRow[word + 1] << (64 - shift) ;
+	}
+	return bits ;
+}
+
+bool AlphaMask::intersects( const AlphaMask& a, const Matrix3& pixelToWorldA, const AlphaMask& b, const Matrix3& pixelToWorldB )
+{
+	if( a.isEmpty() || b.isEmpty() ) {
+		return false ;
+	}
+
+	Matrix3 aToB = glm::inverse( pixelToWorldB ) * pixelToWorldA ;
+
+	const float eps = 1e-3f ;
+	bool translationOnly = fabsf(aToB[0][0] - 1.0f) < eps && fabsf(aToB[1][1] - 1.0f) < eps &&
+						   fabsf(aToB[0][1]) < eps && fabsf(aToB[1][0]) < eps ;
+	if( translationOnly ) {
+		// the center of pixel (x,y) of a falls inside pixel (x+offsetX,y+offsetY) of b
+		I32 offsetX = (I32)floorf( aToB[2][0] + 0.5f ) ;
+		I32 offsetY = (I32)floorf( aToB[2][1] + 0.5f ) ;
+		return intersectsTranslated( a, b, offsetX, offsetY ) ;
+	}
+
+	return intersectsTransformed( a, b, aToB ) ;
+}
+
+bool AlphaMask::intersectsTranslated( const AlphaMask& a, const AlphaMask& b, I32 offsetX, I32 offsetY )
+{
+	I32 y0 = std::max( a.m_minY, b.m_minY - offsetY ) ;
+	I32 y1 = std::min( a.m_maxY, b.m_maxY - offsetY ) ;
+	I32 x0 = std::max( a.m_minX, b.m_minX - offsetX ) ;
+	I32 x1 = std::min( a.m_maxX, b.m_maxX - offsetX ) ;
+
+	// the last word of a row may run past x1: there either a or b has no opaque pixels, so no masking is needed
+	for( I32 y = y0; y <= y1; y++ ) {
+		for( I32 x = x0; x <= x1; x += 64 ) {
+			if( a.fetch( (U32)y, x ) & b.fetch( (U32)(y + offsetY), x + offsetX ) ) {
+				return true ;
+			}
+		}
+	}
+
+	return false ;
+}
+
+bool AlphaMask::intersectsTransformed( const AlphaMask& a, const AlphaMask& b, const Matrix3& aToB )
+{
+	Matrix3 bToA = glm::inverse( aToB ) ;
+
+	// rows of b covered by the opaque bounds of a
+	Vector2 corners[4] = {
+		Vector2( (float)a.m_minX, (float)a.m_minY ), Vector2( (float)a.m_maxX + 1, (float)a.m_minY ),
+		Vector2( (float)a.m_maxX + 1, (float)a.m_maxY + 1 ), Vector2( (float)a.m_minX, (float)a.m_maxY + 1 )
+	} ;
+	float minY = FLT_MAX, maxY = -FLT_MAX ;
+	for( const Vector2& corner : corners ) {
+		float y = transform( aToB, corner ).y ;
+		minY = std::min( minY, y ) ;
+		maxY = std::max( maxY, y ) ;
+	}
+	I32 y0 = std::max( b.m_minY, (I32)floorf(minY) ) ;
+	I32 y1 = std::min( b.m_maxY, (I32)floorf(maxY) ) ;
+
+	// moving one pixel right in b moves by stepX in a
+	Vector2 stepX( bToA[0][0], bToA[0][1] ) ;
+	const float boundsMin[2] = { (float)a.m_minX, (float)a.m_minY } ;
+	const float boundsMax[2] = { (float)a.m_maxX + 1, (float)a.m_maxY + 1 } ;
+
+	for( I32 y = y0; y <= y1; y++ ) {
+		// position in a of the center of the first pixel of the row, column c is at rowStart + c * stepX
+		Vector2 rowStart = transform( bToA, Vector2( 0.5f, y + 0.5f ) ) ;
+
+		// clip the row to the span whose centers fall inside the opaque bounds of a
+		float t0 = (float)b.m_minX ;
+		float t1 = (float)b.m_maxX + 1 ;
+		for( int axis = 0; axis < 2 && t0 < t1; axis++ ) {
+			float start = rowStart[axis] ;
+			float step = stepX[axis] ;
+			if( fabsf(step) < 1e-6f ) {
+				if( start < boundsMin[axis] || start >= boundsMax[axis] ) {
+					t1 = t0 ;
+				}
+				continue ;
+			}
+			float c0 = (boundsMin[axis] - start) / step ;
+			float c1 = (boundsMax[axis] - start) / step ;
+			if( c0 > c1 ) {
+				std::swap( c0, c1 ) ;
+			}
+			t0 = std::max( t0, c0 ) ;
+			t1 = std::min( t1, c1 ) ;
+		}
+		if( t0 >= t1 ) {
+			continue ;
+		}
+
+		// a pixel wider span, test() rejects the pixels just outside a
+		I32 x0 = std::max( b.m_minX, (I32)floorf(t0) ) ;
+		I32 x1 = std::min( b.m_maxX, (I32)ceilf(t1) ) ;
+
+		// only the opaque pixels of b are looked up in a
+		for( I32 x = x0; x <= x1; x += 64 ) {
+			U64 bits = b.fetch( (U32)y, x ) ;
+			I32 span = x1 - x + 1 ;
+			if( span < 64 ) {
+				bits &= (1ull << span) - 1 ;
+			}
+			while( bits ) {
+				U32 bit = lowestBit( bits ) ;
+				bits &= bits - 1 ;
+				Vector2 p = rowStart + stepX * (float)(x + (I32)bit) ;
+				if( a.test( (I32)floorf(p.x), (I32)floorf(p.y) ) ) {
+					return true ;
+				}
+			}
+		}
+	}
+
+	return false ;
+}
+
+bool AlphaMask::intersectsSlow( const AlphaMask& a, const Matrix3& pixelToWorldA, const AlphaMask& b, const Matrix3& pixelToWorldB )
+{
+	Matrix3 aToB = glm::inverse( pixelToWorldB ) * pixelToWorldA ;
+	for( I32 y = a.m_minY; y <= a.m_maxY; y++ ) {
+		for( I32 x = a.m_minX; x <= a.m_maxX; x++ ) {
+			if( a.test( x, y ) ) {
+				Vector2 p = transform( aToB, Vector2( x + 0.5f, y + 0.5f ) ) ;
+				if( b.test( (I32)floorf(p.x), (I32)floorf(p.y) ) ) {
+					return true ;
+				}
+			}
+		}
+	}
+
+	return false ;
+}
+
+}
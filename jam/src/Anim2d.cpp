@@ -32,6 +32,7 @@
 #include "jam/Anim2d.h"
 
 #include <math.h>
+#include <algorithm>
 
 namespace jam
 {
@@ -40,7 +41,7 @@ namespace jam
 // class AnimFrame2D
 //
 AnimFrame2D::AnimFrame2D() :
-	m_handleImg(0), m_time(0), m_flipX(false), m_flipY(false), m_partialTime(0.0f)
+	m_handleImg(0), m_time(0), m_flipX(false), m_flipY(false), m_partialTime(0.0f), m_owners()
 {
 }
 
@@ -61,12 +62,21 @@ DrawItem* AnimFrame2D::getDrawItem()
 void AnimFrame2D::setDrawItem( DrawItem* val )
 {
 	m_handleImg = val;
+	for( Animation2D* pOwner : m_owners ) {
+		pOwner->m_frameItemsDirty = true ;
+	}
 }
 
 //
 // class Animation2D
 //
 Animation2D::Animation2D() :
+	m_frames(),
+	m_frameEndTimes(),
+	m_frameItems(),
+	m_frameItemsDirty(true),
+	m_frameSlots(),
+	m_invSlotTime(0.0f),
 	m_totalTime(0.0f),
 	m_bLoop(false),
 	m_flipAllX(0),
@@ -76,6 +86,11 @@ Animation2D::Animation2D() :
 
 Animation2D::~Animation2D()
 {
+	// frames can outlive the animation, when shared by other animations
+	for( auto& rFrame : m_frames ) {
+		std::vector<Animation2D*>& owners = rFrame->m_owners ;
+		owners.erase( std::remove(owners.begin(), owners.end(), this), owners.end() ) ;
+	}
 	m_frames.clear() ;
 }
 
@@ -85,6 +100,73 @@ void Animation2D::addFrame(AnimFrame2D* frame)
 	m_frames.push_back(rFrame) ;
 	m_totalTime += frame->getTime();
 	m_frames[m_frames.size()-1]->m_partialTime = m_totalTime ;
+	frame->m_owners.push_back( this ) ;
+	m_frameItemsDirty = true ;
+
+	m_frameEndTimes.push_back( m_totalTime ) ;
+	buildFrameSlots() ;
+}
+
+void Animation2D::buildFrameItems() const
+{
+	m_frameItems.resize( m_frames.size() ) ;
+	for( size_t i=0; i<m_frames.size(); i++ ) {
+		m_frameItems[i] = const_cast<AnimFrame2D*>(m_frames[i].get())->getDrawItem() ;
+	}
+	m_frameItemsDirty = false ;
+}
+
+void Animation2D::buildFrameSlots()
+{
+	m_frameSlots.clear() ;
+	m_invSlotTime = 0.0f ;
+
+	float slotTime = m_totalTime ;
+	for( size_t i=0; i<m_frames.size(); i++ ) {
+		slotTime = std::min( slotTime, m_frames[i]->getTime() ) ;
+	}
+
+	if( slotTime <= 0.0f || m_totalTime / slotTime > (float)JAM_ANIM2D_MAX_FRAME_SLOTS ) {
+		return ;
+	}
+
+	// slot k starts in the first frame ending at or after k*slotTime
+	size_t numOfSlots = (size_t)ceilf(m_totalTime / slotTime) + 1 ;
+	m_frameSlots.resize( numOfSlots ) ;
+	size_t frameIdx = 0 ;
+	for( size_t k=0; k<numOfSlots; k++ ) {
+		float slotStart = k * slotTime ;
+		while( frameIdx+1 < m_frameEndTimes.size() && slotStart > m_frameEndTimes[frameIdx] ) {
+			frameIdx++ ;
+		}
+		m_frameSlots[k] = (U16)frameIdx ;
+	}
+	m_invSlotTime = 1.0f / slotTime ;
+}
+
+int Animation2D::getFrameIndexAt( float time ) const
+{
+	if( time < 0.0f || m_frames.empty() ) {
+		return -1 ;
+	}
+
+	int lastIdx = (int)m_frames.size() - 1 ;
+	if( time >= m_totalTime ) {
+		return lastIdx ;
+	}
+
+	if( !m_frameSlots.empty() ) {
+		size_t slot = std::min( (size_t)(time * m_invSlotTime), m_frameSlots.size()-1 ) ;
+		int idx = m_frameSlots[slot] ;
+		// a slot overlaps two frames at most, the loop guards against rounding only
+		while( idx < lastIdx && time > m_frameEndTimes[idx] ) {
+			idx++ ;
+		}
+		return idx ;
+	}
+
+	// first frame ending at or after time
+	return (int)(std::lower_bound( m_frameEndTimes.begin(), m_frameEndTimes.end(), time ) - m_frameEndTimes.begin()) ;
 }
 
 void Animation2D::addFrame( Texture2D* pTexture, const jam::Rect& rect, float time, bool flipX/*=false*/, bool flipY/*=false*/ )
@@ -106,8 +188,6 @@ void Animation2D::addFrame( DrawItem* elem, float time, bool flipX/*=false*/, bo
 void Animation2D::update(const jam::Timer& timer, int& currentFrameIndex, float speed/*=1.0f*/, int lastFrame/*=0*/)
 {
 
-	float timeCount = 0.0f ;
-
 	float elapsed = speed * timer.getTotalElapsed();
 	
 	// in the case of startWithDelay elapsed is less than 0
@@ -116,17 +196,9 @@ void Animation2D::update(const jam::Timer& timer, int& currentFrameIndex, float
 		// loop the animation
 		if( m_bLoop && elapsed >= m_totalTime ) {
 			elapsed = fmodf(elapsed,m_totalTime) ;
-			lastFrame=0;
 		}
 
-		for( currentFrameIndex=lastFrame; currentFrameIndex < (int)m_frames.size(); currentFrameIndex++ ) {
-			timeCount = m_frames[currentFrameIndex]->m_partialTime ;
-			if( elapsed <= timeCount ) break ;
-		}
-
-		if( /*!m_bLoop &&*/ currentFrameIndex>=(int)m_frames.size() ) {
-			currentFrameIndex = m_frames.size()-1 ;
-		}
+		currentFrameIndex = getFrameIndexAt( elapsed ) ;
 
 	}
 	else {
@@ -138,6 +210,9 @@ void Animation2D::update(const jam::Timer& timer, int& currentFrameIndex, float
 AnimFrame2D* Animation2D::getFrame(int index) const
 {
 	AnimFrame2D* pAnimFrame = 0 ;
+	if( m_frames.empty() ) {
+		return pAnimFrame ;
+	}
 	if( index < 0 || index >= (int)m_frames.size() ) {
 		index = 0;
 	}
@@ -151,7 +226,7 @@ AnimFrame2D* Animation2D::getFrame(int index) const
 	return pAnimFrame;
 }
 
-float Animation2D::getTotalTime()
+float Animation2D::getTotalTime() const
 {
 	return m_totalTime ;
 }
@@ -161,7 +236,7 @@ void Animation2D::setLoop(bool bLoop)
 	m_bLoop = bLoop ;
 }
 
-bool Animation2D::isLooping()
+bool Animation2D::isLooping() const
 {
 	return m_bLoop ;
 }
@@ -29,13 +29,84 @@
 
 #include "stdafx.h"
 #include "jam/Animation2dManager.h"
+#include "jam/ExtAnimator.h"
+
+#include <math.h>
 
 namespace jam
 {
 
-	Animation2DManager::Animation2DManager()
+	Animation2DManager::Animation2DManager() :
+		m_animators(),
+		m_animatorOwners()
+	{
+	}
+
+	void Animation2DManager::updateAnimators( jam::time elapsed )
+	{
+		JAM_PROFILE("Animation2DManager.updateAnimators") ;
+
+		for( size_t i=0; i<m_animators.size(); i++ ) {
+			AnimatorState& state = m_animators[i] ;
+			if( !state.playing || !state.pAnimation ) {
+				continue ;
+			}
+
+			const Animation2D* pAnimation = state.pAnimation ;
+			float totalTime = pAnimation->getTotalTime() ;
+			if( totalTime <= 0.0f ) {
+				continue ;
+			}
+
+			// the phase is kept inside the animation, so that it never loses precision
+			state.phase += elapsed * state.speed ;
+			if( state.phase >= totalTime ) {
+				if( pAnimation->isLooping() ) {
+					state.phase -= totalTime ;
+					if( state.phase >= totalTime ) {
+						state.phase = fmodf( state.phase, totalTime ) ;
+					}
+				}
+				else {
+					state.phase = totalTime ;
+				}
+			}
+			else if( state.phase < 0.0f ) {
+				state.phase = pAnimation->isLooping() ? fmodf( state.phase, totalTime ) + totalTime : 0.0f ;
+			}
+
+			int frameIndex = pAnimation->getFrameIndexAt( state.phase ) ;
+			if( frameIndex != state.frameIndex ) {
+				state.frameIndex = frameIndex ;
+				state.pDrawable->setFrame( pAnimation->getFrameItem(frameIndex) ) ;
+			}
+
+			if( state.completeFrameIndex >= 0 && state.frameIndex == state.completeFrameIndex ) {
+				state.playing = false ;
+				state.frameIndex = 0 ;
+			}
+		}
+	}
+
+	size_t Animation2DManager::addAnimator( ExtAnimator* pOwner, IDrawable2D* pDrawable )
 	{
+		AnimatorState state = { nullptr, pDrawable, 0.0f, 1.0f, 0, -1, false } ;
+		m_animators.push_back( state ) ;
+		m_animatorOwners.push_back( pOwner ) ;
+		return m_animators.size() - 1 ;
+	}
 
+	void Animation2DManager::removeAnimator( size_t slot )
+	{
+		// swap with the last one, then tell its owner the new slot
+		size_t lastSlot = m_animators.size() - 1 ;
+		if( slot != lastSlot ) {
+			m_animators[slot] = m_animators[lastSlot] ;
+			m_animatorOwners[slot] = m_animatorOwners[lastSlot] ;
+			m_animatorOwners[slot]->m_slot = slot ;
+		}
+		m_animators.pop_back() ;
+		m_animatorOwners.pop_back() ;
 	}
 	
 }
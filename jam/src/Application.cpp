@@ -51,14 +51,25 @@
 #include "jam/SysTimer.h"
 #include "jam/Gfx.h"
 #include "jam/Camera.h"
+#include "jam/InstancingManager.h"
+#include "jam/Light.h"
+#include "jam/ModelCache.h"
+#include "jam/JobSystem.h"
+#include "jam/Profiler.h"
+#include "jam/RenderTargetPool.h"
+#include "jam/SharedUniforms.h"
+#include "jam/FrameAllocator.h"
+#include "jam/MemoryTracker.h"
 #include "imgui_impl_sdl.h"
 #include "imgui_impl_opengl3.h"
 
 #ifdef JAM_PHYSIC_ENABLED
 #include <Box2D/Dynamics/b2World.h>
+#include "jam/B2Sprite.h"
 #endif
 
 #include <stdexcept>
+#include <thread>
 #include <typeinfo>
 
 //////////////////////////////////////////////////////////////////////////
@@ -67,6 +78,10 @@
 
 // Attempt to lock to 60 frames per second
 #define JAM_APP_DEFAULT_MS_PER_FRAME (1000UL / 60UL)
+#define JAM_APP_DEFAULT_NS_PER_FRAME (1000000000ULL / 60ULL)
+
+// frame pacing sleeps until this far from the deadline, then it yields in a loop
+#define JAM_APP_PACING_SPIN_NS		2000000ULL
 
 namespace jam
 {
@@ -79,6 +94,7 @@ Application::Application() :
 	m_secsTotalElapsed(0.0f),
 	m_lastTimeMs(0),
 	m_sceneNode(0),
+	m_pPostProcessChain(),
 	m_exitFromMainLoop(false),
 	m_callAppHandlers(true),
 	m_minMsPerFrame(0),
@@ -86,12 +102,26 @@ Application::Application() :
 	m_msPerFrame(0),
 	m_avgMsPerFrameIdx(0),
 #ifdef JAM_PHYSIC_ENABLED
-	m_pPhysWorld(nullptr)
+	m_pPhysWorld(nullptr),
 	m_physicsEnabled(false),
 	m_ptmRatio(0),
+	m_physVelocityIterations(10),
+	m_physPositionIterations(8),
+	m_physSubsteps(1),
 #endif		
 	m_animationIntervalMs(JAM_APP_DEFAULT_MS_PER_FRAME),
+	m_animationIntervalNs(JAM_APP_DEFAULT_NS_PER_FRAME),
 	m_actionSpeed(1.0f),
+	m_frameStartNs(0),
+	m_frameDeltaNs(0),
+	m_nextFrameNs(0),
+	m_fixedStepNs(JAM_APP_DEFAULT_NS_PER_FRAME),
+	m_accumulatorNs(0),
+	m_maxFrameNs(250000000ULL),
+	m_fixedStepCount(0),
+	m_maxFixedSteps(5),
+	m_interpolationAlpha(0.0f),
+	m_soundsJob(),
 	m_clearColorBuffer(true),
 	m_clearColor(Color::BLACK),
 	m_bClearColorChanged(true),
@@ -106,7 +136,12 @@ Application::Application() :
 	m_resourceManager(nullptr),
 	m_pWindow(nullptr),
 	m_GLContext(nullptr),
-	m_imguiEnabled(false)
+	m_imguiEnabled(false),
+	m_shaderCacheFolder(),
+	m_headless(false),
+	m_fixedFrameMode(false),
+	m_frameCount(0),
+	m_frameLimit(0)
 {
 	setup() ;
 }
@@ -127,10 +162,15 @@ void Application::start()
 
 		// default setting
 		m_animationIntervalMs = SysTimer().getUnitsPerSecond() / 60UL ;
+		m_animationIntervalNs = JAM_APP_DEFAULT_NS_PER_FRAME ;
 
-		m_totalElapsedMs = GetSysTimer().getTime() ;
+		// in fixed frame mode the application clock starts from zero
+		m_frameStartNs = m_fixedFrameMode ? 0 : GetSysTimer().getTimeNs() ;
 		refreshTime() ;
 
+		// starts the job threads
+		GetJobSystem() ;
+
 		m_sceneNode = new Scene() ;
 
 		GetGfx().setDepthTest(true) ;
@@ -149,13 +189,23 @@ void Application::start()
 		m_resourceManager->init() ;
 		m_resourceManager->registerLoader( new ShaderFileResourceLoader() ) ;
 
-		// create default shaders
+		// programs are built by a worker with a shared context when available, and cached as binaries
+		// in the shader cache folder, if any, when the driver supports it; both fall back to plain compilation
+		if( !m_shaderCacheFolder.empty() ) {
+			GetShaderMgr().getCompiler().enableBinaryCache( m_shaderCacheFolder ) ;
+		}
+		GetShaderMgr().getCompiler().startWorker( m_pWindow, m_GLContext ) ;
+
+		// create default shaders, they are waited on when first used
 		GetShaderMgr().createDefaultLit() ;
 		GetShaderMgr().createSkinningLit() ;
 		GetShaderMgr().createSkyBox() ;
 		GetShaderMgr().createNormalMapping() ;
 		GetShaderMgr().createScreen() ;
 		GetShaderMgr().createDefaultUnlit() ;
+		GetShaderMgr().createInstancedNormalMapping() ;
+		GetShaderMgr().createInstancedSkinningLit() ;
+		GetShaderMgr().createInstancedLit() ;
 
 		if( game::GetStateMachine().isStarted() ) {
 			game::GetStateMachine().checkNewState() ;
@@ -245,6 +295,7 @@ void Application::start()
 		m_sceneNode->destroy() ;
 		m_sceneNode->release() ;
 		m_sceneNode = nullptr ;
+		m_pPostProcessChain.reset() ;
 	}
 	catch( std::exception& ex ) {
 		if( isEngineInited() ) {
@@ -266,15 +317,22 @@ void Application::start()
 
 void Application::gameLoop()
 {
-	int64_t yieldMs = 0 ;
-		
 	SDL_Event e;
+
+	if( !m_fixedFrameMode ) {
+		m_frameStartNs = GetSysTimer().getTimeNs() ;
+	}
+	m_nextFrameNs = m_frameStartNs ;
+	m_frameCount = 0 ;
+
 	while( !m_exitFromMainLoop )
 	{
-		m_totalElapsedMs = GetSysTimer().getTime() ;
 		refreshTime() ;
 
-		while( SDL_PollEvent( &e ) != 0 )
+		// when the input polling thread is active, it pumps the events and it is the only producer of input events:
+		// the main thread takes only the other ones left in the queue, the input ones reach ImGui in doFrame
+		bool pollingThread = GetInputMgr().isPollingThreadActive() ;
+		while( pollingThread ? InputManager::takeNonInputEvent( e ) : SDL_PollEvent( &e ) != 0 )
 		{
 
 			if( isImguiEnabled() ) {
@@ -284,17 +342,9 @@ void Application::gameLoop()
 			if( e.type == SDL_QUIT ) {
 				m_exitFromMainLoop = true;
 			}
-			else if( e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP ) {
-				GetInputMgr().mouseButtonCallback( (SDL_MouseButtonEvent&)e ) ;
-			}
-			else if( e.type == SDL_MOUSEMOTION ) {
-				GetInputMgr().mouseMoveCallback( (SDL_MouseMotionEvent&)e ) ;
-			}
-			else if( e.type == SDL_MOUSEWHEEL ) {
-				GetInputMgr().mouseScrollCallback( (SDL_MouseWheelEvent&)e ) ;
-			}
-			else if( e.type == SDL_KEYDOWN || e.type == SDL_KEYUP ) {
-				GetInputMgr().keyboardCallback( (SDL_KeyboardEvent&)e ) ;
+			else if( InputManager::isInputEvent(e) ) {
+				// input events are queued and handled, in time order, by InputManager::update
+				GetInputMgr().pushEvent( e ) ;
 			}
 			else if( e.type == SDL_WINDOWEVENT ) {
 				switch (e.window.event) {
@@ -319,23 +369,60 @@ void Application::gameLoop()
 			game::GetStateMachine().update() ;
 		}
 
-		while( true ) {
- 			yieldMs = (int64_t)getRemainingFrameMs() ;
-			if (yieldMs<=0) break ;
-			SDL_Delay((DWORD)yieldMs) ;
-		}
+		waitNextFrame() ;
 
-		if( getTotalElapsed() > 1.0f ) {
+		// the application clock isn't the wall clock in fixed frame mode
+		if( getTotalElapsed() > 1.0f && !m_fixedFrameMode ) {
 			updateMsPerFrame() ;
 		}
 
+		m_frameCount++ ;
+		if( m_frameLimit && m_frameCount >= m_frameLimit ) {
+			m_exitFromMainLoop = true ;
+		}
+
 	}	// main game loop
 }
 
 uint64_t Application::getRemainingFrameMs() const
 {
-	uint64_t elapsedInThisFrameMs = (uint64_t)(GetSysTimer().getTime() - m_totalElapsedMs) ;
-	return (elapsedInThisFrameMs < m_animationIntervalMs) ? (m_animationIntervalMs - elapsedInThisFrameMs) : 0 ;
+	uint64_t elapsedInThisFrameNs = GetSysTimer().getTimeNs() - m_frameStartNs ;
+	return (elapsedInThisFrameNs < m_animationIntervalNs) ? (m_animationIntervalNs - elapsedInThisFrameNs) / 1000000ULL : 0 ;
+}
+
+/**
+	Waits for the end of the current frame slot.
+	Deadlines are accumulated, instead of being measured from the frame start, so rounding errors don't drift the frame rate
+*/
+void Application::waitNextFrame()
+{
+	m_nextFrameNs += m_animationIntervalNs ;
+
+	// frames are run back to back in fixed frame mode
+	if( m_fixedFrameMode ) {
+		return ;
+	}
+
+	uint64_t nowNs = GetSysTimer().getTimeNs() ;
+	if( nowNs >= m_nextFrameNs ) {
+		// more than a whole frame late: restart pacing from now, instead of rushing frames to catch up
+		if( nowNs - m_nextFrameNs > m_animationIntervalNs ) {
+			m_nextFrameNs = nowNs ;
+		}
+		return ;
+	}
+
+	// sleep is coarse grained, so we sleep until close to the deadline and then yield
+	while( nowNs < m_nextFrameNs ) {
+		uint64_t remainingNs = m_nextFrameNs - nowNs ;
+		if( remainingNs > JAM_APP_PACING_SPIN_NS ) {
+			SDL_Delay( (Uint32)((remainingNs - JAM_APP_PACING_SPIN_NS) / 1000000ULL) ) ;
+		}
+		else {
+			std::this_thread::yield() ;
+		}
+		nowNs = GetSysTimer().getTimeNs() ;
+	}
 }
 
 Scene* Application::getScene()
@@ -343,6 +430,11 @@ Scene* Application::getScene()
 	return m_sceneNode;
 }
 
+void Application::setPostProcessChain( PostProcessChain* pChain )
+{
+	m_pPostProcessChain = Ref<PostProcessChain>( pChain, true ) ;
+}
+
 TimerManager& Application::getSysTimerManager()
 {
 	return *m_sysTimerManager ;
@@ -367,21 +459,34 @@ void Application::cleanup()
 	handleInput (application and state)
 	update timers (timeexpired event are fired, not queued)
 	update actions
+	update sprites animations
 	beforeSceneUpdate (application and state)
-	update collisions
+	fixed step simulation: update physics, fixedUpdate (application and state), zero or more times
+	update collisions (hit-tests run by the job threads)
 	queued events dispatch (touches, collisions, achievement completed)
-	update physics
+	start sound update job
 	custom render (application and state)
 	render nodes
 	afterSceneUpdate (application and state)
 	gfx flush
 	update touchable nodes
-	sound update
+	wait sound update job
 	exitFrame (application and state)
 	swap frame buffers
 */
 void Application::doFrame()
 {
+	Profiler::newFrame() ;
+	JAM_PROFILE("Application.doFrame") ;
+
+	FrameAllocator::newFrame() ;
+	RefCountedObject::releaseDeferred() ;
+	MemoryTracker::newFrame() ;
+	GetRenderTargetPool().newFrame() ;
+	GetGfx().newFrame() ;
+	GetLightMgr().newFrame() ;
+	GetSharedUniforms().newFrame() ;
+
 	/* TODO
 	s3eDeviceYield(0);
 	*/
@@ -397,10 +502,26 @@ void Application::doFrame()
 			m_bClearColorChanged = false ;
 		}
 	}
-	GetGfx().clear( clearFlags ) ;
+
+	// with post processing the frame is rendered into a pooled target, which is always fully cleared by the chain
+	bool postProcessing = m_pPostProcessChain && m_pPostProcessChain->begin() ;
+	if( !postProcessing ) {
+		GetGfx().clear( clearFlags ) ;
+	}
 
 	// handle input update
-	GetInputMgr().update() ;
+	{
+		JAM_PROFILE("InputManager.update") ;
+		GetInputMgr().update() ;
+	}
+
+	// events pumped by the input polling thread never went through the main thread loop
+	if( isImguiEnabled() && GetInputMgr().isPollingThreadActive() ) {
+		for( const InputEvent& ie : GetInputMgr().getFrameEvents() ) {
+			SDL_Event e = ie.event ;
+			ImGui_ImplSDL2_ProcessEvent(&e) ;
+		}
+	}
 
 	Draw3DManager::Origin3D() ;
 	Draw3DManager::Clear3D();
@@ -436,9 +557,15 @@ void Application::doFrame()
 	// update actions
 
 	if( !isPaused() ) {
+		JAM_PROFILE("ActionManager.update") ;
 		GetActionMgr().update( getElapsed() ) ;
 	}
 
+	// advance sprites animations
+	if( !isPaused() ) {
+		GetAnim2DMgr().updateAnimators( getElapsed() ) ;
+	}
+
 	if( m_callAppHandlers && !isPaused() ) {
 		beforeSceneUpdate() ;			// virtual call
 	}
@@ -450,22 +577,25 @@ void Application::doFrame()
 	Node::clearDebugNodeInfo() ;
 #endif
 
-#ifdef JAM_PHYSIC_ENABLED
-	// update physics
-	if( m_physicsEnabled && !isPaused() ) {
-		JAM_PROFILE("Box2d.step") ;
-		m_pPhysWorld->Step( 1.0f/60.0f, 10, 8 ) ;
-		// By default, forces will be automatically cleared, so you don't need to call this function.
-		// m_pPhysWorld->ClearForces();
+	// fixed step simulation (physics and fixedUpdate handlers)
+	if( !isPaused() ) {
+		stepSimulation() ;
 	}
-#endif
 
 	// handle collisions
 	if( m_callAppHandlers && !isPaused() ) {
 		updateCollisions() ;
 	}
 
-	GetEventDispatcher().dispatch() ;
+	{
+		JAM_PROFILE("EventDispatcher.dispatch") ;
+		GetEventDispatcher().dispatch() ;
+	}
+
+	// sounds are updated by a job while the scene is rendered
+	updateSounds() ;
+
+	GetSharedUniforms().setFrame( (float)getTotalElapsed(), (float)getElapsed() ) ;
 
 	// default unlit to draw 2d scene
 	Shader* pCurrentShader = GetShaderMgr().getDefaultUnlit() ;
@@ -476,15 +606,20 @@ void Application::doFrame()
 	if( pCamera ) {
 		pCamera->setActive() ;
 		pCurrentShader->setModelMatrix( Matrix4(1.0f) ) ;
-		pCurrentShader->setViewMatrix( pCamera->getViewMatrix() ) ;
-		pCurrentShader->setProjectionMatrix( pCamera->getProjectionMatrix() ) ;
-		pCurrentShader->setViewPosition( pCamera->getPosition() ) ;	//  for specular light
+		// bound once for all the programs
+		GetSharedUniforms().setView( pCamera ) ;
 		Node::setCurrentCamera(pCamera) ;
 	}
+	// the lights set in the previous frame, bound once for all the programs too
+	GetLightMgr().bind( pCamera ) ;
 
 	if( m_callAppHandlers ) render() ;			// virtual call
 	if( gState != 0 ) gState->render() ;
 
+	// draws the instances queued by render handlers
+	GetInstancingMgr().flush() ;
+	pCurrentShader->use() ;
+
 	// render nodes
 #ifdef JAM_TRACE_INVIEW_SPRITES
 	Sprite::setTotalInView(0) ;
@@ -503,6 +638,10 @@ void Application::doFrame()
 		gState->afterSceneUpdate() ;
 	}
 
+	if( postProcessing ) {
+		m_pPostProcessChain->end() ;
+	}
+
 	pCurrentShader->stopUsing();
 
 	// end drawing
@@ -510,8 +649,11 @@ void Application::doFrame()
 
 	m_sceneNode->updateTouchableNodes() ;
 
-	// handle sound update
-	updateSounds() ;
+	// sounds update must complete before the frame handlers can control sounds again
+	{
+		JAM_PROFILE("Application.waitSounds") ;
+		GetJobSystem().wait( m_soundsJob ) ;
+	}
 
 	if( m_callAppHandlers && !isPaused() ) {
 		exitFrame() ;
@@ -521,17 +663,104 @@ void Application::doFrame()
 	}
 
 	// swap buffers
+	JAM_PROFILE("Application.swap") ;
 	SDL_GL_SwapWindow(m_pWindow) ;
 }
 
 void Application::refreshTime()
 {
+	// in fixed frame mode every frame lasts exactly the animation interval
+	uint64_t nowNs = m_fixedFrameMode ? m_frameStartNs + m_animationIntervalNs : GetSysTimer().getTimeNs() ;
+	m_frameDeltaNs = nowNs - m_frameStartNs ;
+	m_frameStartNs = nowNs ;
+	m_totalElapsedMs = nowNs / 1000000ULL ;
+
 	m_elapsedMs = (m_totalElapsedMs - m_lastTimeMs);
 	m_lastTimeMs = m_totalElapsedMs ;
 	m_elapsedMs = (uint64_t)(m_elapsedMs * m_actionSpeed) ;		// scales elapsed
 
-	m_secsElapsed = m_elapsedMs / ((float)GetSysTimer().getUnitsPerSecond()) ;
-	m_secsTotalElapsed = m_totalElapsedMs / ((float)GetSysTimer().getUnitsPerSecond()) ;
+	// seconds are taken from the nanoseconds clock, so they are not truncated to whole milliseconds
+	m_secsElapsed = (jam::time)(m_frameDeltaNs * 1e-9 * m_actionSpeed) ;
+	m_secsTotalElapsed = (jam::time)(nowNs * 1e-9) ;
+}
+
+/**
+	Advances the simulation by whole fixed steps, consuming the time accumulated since the last frame.
+	The fraction of step left in the accumulator is used to interpolate the rendered state
+*/
+void Application::stepSimulation()
+{
+	JAM_PROFILE("Application.stepSimulation") ;
+
+	// clamp long frames, e.g. after a breakpoint or a window drag
+	uint64_t frameNs = Min( m_frameDeltaNs, m_maxFrameNs ) ;
+	m_accumulatorNs += (uint64_t)(frameNs * m_actionSpeed) ;
+
+	game::State* gState = game::GetStateMachine().isStarted() ? game::GetStateMachine().getCurrentState() : 0 ;
+	jam::time dt = getFixedTimeStep() ;
+
+	// wall clock time reached by the simulation, each step is given the input events happened before its end
+	double speed = m_actionSpeed > 0.0f ? m_actionSpeed : 1.0 ;
+	uint64_t lagNs = (uint64_t)(m_accumulatorNs / speed) ;
+	uint64_t simulatedNs = m_frameStartNs > lagNs ? m_frameStartNs - lagNs : 0 ;
+	uint64_t stepWallNs = (uint64_t)(m_fixedStepNs / speed) ;
+
+	int steps = 0 ;
+	while( m_accumulatorNs >= m_fixedStepNs ) {
+		if( steps == m_maxFixedSteps ) {
+			// catch-up limit reached, drop the backlog but keep the fraction of step
+			m_accumulatorNs %= m_fixedStepNs ;
+			break ;
+		}
+
+		getScene()->storeSimulationState() ;
+
+		simulatedNs += stepWallNs ;
+		GetInputMgr().beginStep( simulatedNs ) ;
+
+#ifdef JAM_PHYSIC_ENABLED
+		if( m_physicsEnabled ) {
+			JAM_PROFILE("Box2d.step") ;
+			// sleeping bodies whose sprites have been moved by the user are teleported before stepping
+			B2Sprite::syncBodiesFromSprites() ;
+			jam::time subDt = dt / m_physSubsteps ;
+			for( int i=0; i<m_physSubsteps; i++ ) {
+				m_pPhysWorld->Step( subDt, m_physVelocityIterations, m_physPositionIterations ) ;
+			}
+			// By default, forces will be automatically cleared, so you don't need to call this function.
+			// m_pPhysWorld->ClearForces();
+			B2Sprite::syncSpritesFromBodies() ;
+		}
+#endif
+
+		if( m_callAppHandlers ) fixedUpdate( dt ) ;		// virtual call
+		if( gState ) gState->fixedUpdate( dt ) ;
+
+		m_accumulatorNs -= m_fixedStepNs ;
+		m_fixedStepCount++ ;
+		steps++ ;
+	}
+	GetInputMgr().endSteps() ;
+
+	JAM_PROFILE_COUNTER("Application.fixedSteps", steps) ;
+	m_interpolationAlpha = (float)((double)m_accumulatorNs / (double)m_fixedStepNs) ;
+}
+
+void Application::setFixedTimeStep( jam::time step )
+{
+	JAM_ASSERT_MSG( step > 0.0f, ("setFixedTimeStep() : step must be greater than 0") ) ;
+	m_fixedStepNs = (uint64_t)(step * 1e9) ;
+	m_accumulatorNs = 0 ;
+}
+
+jam::time Application::getFixedTimeStep() const
+{
+	return (jam::time)(m_fixedStepNs * 1e-9) ;
+}
+
+void Application::setMaxFrameTime( jam::time maxFrameTime )
+{
+	m_maxFrameNs = (uint64_t)(maxFrameTime * 1e9) ;
 }
 
 
@@ -550,6 +779,19 @@ void Application::setPtmRatio( float ptmRatio )
 {
 	m_ptmRatio = ptmRatio;
 }
+
+void Application::setPhysicsIterations( int velocityIterations, int positionIterations )
+{
+	JAM_ASSERT_MSG( velocityIterations > 0 && positionIterations > 0, ("setPhysicsIterations() : iterations must be greater than 0") ) ;
+	m_physVelocityIterations = velocityIterations ;
+	m_physPositionIterations = positionIterations ;
+}
+
+void Application::setPhysicsSubsteps( int substeps )
+{
+	JAM_ASSERT_MSG( substeps > 0, ("setPhysicsSubsteps() : substeps must be greater than 0") ) ;
+	m_physSubsteps = substeps ;
+}
 #endif
 
 
@@ -599,6 +841,10 @@ void Application::idle()
 {
 }
 
+void Application::fixedUpdate( jam::time dt )
+{
+}
+
 float Application::getFps() const
 {
 	return ((float)GetSysTimer().getUnitsPerSecond()) / m_msPerFrame ;
@@ -621,13 +867,15 @@ float Application::getFpsAvg() const
 
 void Application::setAnimationInterval( jam::time interval )
 {
-	setAnimationIntervalMs((uint64_t)interval * 1000) ;
+	setAnimationIntervalMs( (uint64_t)(interval * 1000) ) ;
+	m_animationIntervalNs = (uint64_t)(interval * 1e9) ;
 }
 
 
 void Application::setAnimationIntervalMs( uint64_t interval )
 {
 	m_animationIntervalMs = interval ;
+	m_animationIntervalNs = interval * 1000000ULL ;
 	setCollisionCheckFactor( m_collisionCheckFactor) ;
 	setAudioCheckFactor( m_audioCheckFactor ) ;
 	setInputCheckFactor( m_inputCheckFactor ) ;
@@ -663,7 +911,8 @@ void Application::updateSounds()
 {
 	const Timer& timer = GetAudioMgr().getUpdateTimer() ;
 	if( timer.isSweep() ) {
-		GetAudioMgr().update( getElapsed() );
+		jam::time elapsed = getElapsed() ;
+		GetJobSystem().run( [elapsed]() { GetAudioMgr().update( elapsed ); }, m_soundsJob ) ;
 	}
 }
 
@@ -731,6 +980,18 @@ void Application::setImguiEnabled(bool enabled)
 	m_imguiEnabled = true;
 }
 
+void Application::setHeadless( bool headless )
+{
+	JAM_ASSERT_MSG( !isEngineInited(), ("setHeadless() must be called before start()") ) ;
+	m_headless = headless ;
+}
+
+void Application::setShaderCacheFolder( const String& folder )
+{
+	JAM_ASSERT_MSG( !isEngineInited(), ("setShaderCacheFolder() must be called before start()") ) ;
+	m_shaderCacheFolder = folder ;
+}
+
 
 
 #ifdef JAM_DEBUG
@@ -815,7 +1076,7 @@ void Application::engineInitialize()
 	m_pWindow = SDL_CreateWindow( "Jam Engine", 
 								 SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 
 								 JAM_WINDOWS_WIDTH, JAM_WINDOWS_HEIGHT,
-								 SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN );
+								 SDL_WINDOW_OPENGL | (m_headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN) );
 	if( m_pWindow == NULL ){
 		SDL_Quit();
 		JAM_ERROR("Failed to create window") ;
@@ -841,8 +1102,11 @@ void Application::engineInitialize()
 	// is it really needed with only a window?
 	SDL_GL_MakeCurrent(m_pWindow, m_GLContext);
 
-	// Enable Vsync
-	if( SDL_GL_SetSwapInterval( 1 ) < 0 ) {
+	// Enable Vsync, a headless application must not be throttled by the display
+	if( m_headless ) {
+		SDL_GL_SetSwapInterval( 0 ) ;
+	}
+	else if( SDL_GL_SetSwapInterval( 1 ) < 0 ) {
 		SDL_GL_DeleteContext(m_GLContext);
 		SDL_DestroyWindow( m_pWindow );
 		m_pWindow = NULL;
@@ -896,6 +1160,11 @@ void Application::engineTerminate()
 	GetMaterialMgr().removeAllBankItems(true) ;
 */
 	// delete singletons
+	GetShaderMgr().getCompiler().stopWorker() ;
+	JobSystem::destroySingleton() ;
+	// no other thread is left, the GL objects they released can be deleted now
+	RefCountedObject::releaseDeferred() ;
+	Profiler::shutdown() ;
 	CollisionManager::destroySingleton() ;
 	Animation2DManager::destroySingleton() ;
 	DrawItemManager::destroySingleton() ;
@@ -911,6 +1180,18 @@ void Application::engineTerminate()
 	SysTimer::destroySingleton() ;
 	Gfx::destroySingleton() ;
 	MaterialManager::destroySingleton() ;
+	InstancingManager::destroySingleton() ;
+	LightManager::destroySingleton() ;
+	SharedUniforms::destroySingleton() ;
+	ModelCache::destroySingleton() ;
+	RenderTargetPool::destroySingleton() ;
+	// last one, the singletons above may still release frame allocated objects
+	FrameAllocator::shutdown() ;
+
+#ifdef JAM_MEMORY_TRACKING
+	// objects still alive here are leaked, or owned by static objects
+	MemoryTracker::dump() ;
+#endif
 
 #ifdef JAM_PHYSIC_ENABLED
 	JAM_DELETE(m_pPhysWorld) ;
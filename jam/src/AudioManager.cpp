@@ -610,6 +610,7 @@ namespace jam
 
 	ISound* AudioManager::loadSound(const String& afilename,const String& name,bool aloopFlag/*=false*/,float avolume/*=1.0f*/,float apitch/*=0*/)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		ISound* iSound = loadSound_private(afilename,aloopFlag,avolume,apitch) ;
 		iSound->setName(name) ;
 		addObject(iSound);
@@ -618,24 +619,28 @@ namespace jam
 
 	void AudioManager::play( const String& itemName )
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		ISound* iSound = getObject(itemName) ;
 		iSound->play() ;
 	}
 
 	void AudioManager::playOnce( const String& itemName )
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		ISound* iSound = getObject(itemName) ;
 		iSound->playOnce() ;
 	}
 
 	void AudioManager::playForce( const String& itemName )
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		ISound* iSound = getObject(itemName) ;
 		iSound->playForce() ;
 	}
 
 	void AudioManager::setSoundsVolume(float aVolume)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		for( auto& n : getManagerMap() ) {
 			n.second->setVolume(aVolume) ;
 		}
@@ -643,6 +648,7 @@ namespace jam
 
 	ISound* AudioManager::loadMusic( const String& afilename, const String& name, bool aloopFlag/*=false*/, bool start/*=false*/ )
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		ISound* iSound = loadMusic_private(afilename,aloopFlag,start) ;
 		m_pMusicSound = dynamic_cast<StreamingSound*>(iSound);
 		return iSound ;
@@ -650,6 +656,7 @@ namespace jam
 
 	void AudioManager::musicOff( float fadeTime/*=0.0f*/ )
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		if (m_pMusicSound && !m_pMusicSound->isStopped()) {
 			if (fadeTime) m_pMusicSound->startFade(false, fadeTime);
 			m_pMusicSound->stop();
@@ -658,6 +665,7 @@ namespace jam
 
 	void AudioManager::musicOn( float fadeTime /*= 0.0f*/ )
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		if (m_pMusicSound && !m_pMusicSound->isPlaying()) {
 			if (fadeTime) m_pMusicSound->startFade(true, fadeTime);
 			m_pMusicSound->play();
@@ -666,6 +674,7 @@ namespace jam
 
 	void AudioManager::musicPause()
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		if (m_pMusicSound && !m_pMusicSound->isPaused()) {
 			m_pMusicSound->pause();
 		}
@@ -673,6 +682,7 @@ namespace jam
 
 	void AudioManager::setMusicVolume(float volume)
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		if (m_pMusicSound) {
 			m_pMusicSound->setVolume(volume);
 		}
@@ -680,6 +690,7 @@ namespace jam
 
 	bool AudioManager::isMusicPlaying()
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		if (m_pMusicSound) {
 			return m_pMusicSound->isPlaying();
 		}
@@ -695,6 +706,7 @@ namespace jam
 
 	void AudioManager::pauseAllSounds()
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		for(int32_t i=0; i<getMaxNumOfChannels(); i++) {
 			if( m_channels[i] ) m_channels[i]->pause() ;
 		}
@@ -702,6 +714,7 @@ namespace jam
 
 	void AudioManager::resumeAllSounds()
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		for(int32_t i=0; i<getMaxNumOfChannels(); i++) {
 			if( m_channels[i] ) m_channels[i]->resume() ;
 		}
@@ -709,6 +722,7 @@ namespace jam
 
 	void AudioManager::stopAllSounds()
 	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		for(int32_t i=0; i<getMaxNumOfChannels(); i++ ) {
 			if( m_channels[i] ) m_channels[i]->stop() ;
 			m_channels[i] = 0 ;
@@ -801,6 +815,8 @@ namespace jam
 
 	void AudioManager::update(float fTime/*=0.f*/)
 	{
+		JAM_PROFILE("AudioManager.update") ;
+		std::lock_guard<std::recursive_mutex> lock(m_mutex) ;
 		m_pUpdateTimer->update() ;
 		for( auto& n : getManagerMap() ) {
 			n.second->update(fTime) ;
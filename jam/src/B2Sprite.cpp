@@ -35,16 +35,21 @@
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 
+#include <vector>
+
 namespace jam
 {
 
+// sprites owning a body, m_bodySlot is the index of the sprite in this array
+static std::vector<B2Sprite*> s_bodySprites ;
+
 B2Sprite::B2Sprite() :
-	Sprite(), m_pBody(0)
+	Sprite(), m_pBody(0), m_bodySlot(-1), m_syncPos(0,0), m_syncAngle(0.0f)
 {
 }
 
 B2Sprite::B2Sprite( DrawItem* frame ) :
-	Sprite(frame), m_pBody(0)
+	Sprite(frame), m_pBody(0), m_bodySlot(-1), m_syncPos(0,0), m_syncAngle(0.0f)
 {
 }
 
@@ -52,6 +57,7 @@ B2Sprite::~B2Sprite()
 {
 #ifdef JAM_PHYSIC_ENABLED
 if( m_pBody ) {
+		unregisterBody() ;
 		GetAppMgr().getB2World()->DestroyBody(m_pBody) ;
 		m_pBody = 0 ;
 	}
@@ -64,33 +70,12 @@ void B2Sprite::setFrame( DrawItem* frame )
 	Sprite::setFrame(frame) ;	
 }
 
-void B2Sprite::update()
-{
-	Sprite::update() ;
-
-#ifdef JAM_PHYSIC_ENABLED
-	if( m_pBody ) {
-		if( m_pBody->IsActive() && m_pBody->IsAwake() ) {
-			// update sprite properties from physic attributes
-			const b2Vec2 pos = m_pBody->GetPosition() ;
-			float ptmRatio = GetAppMgr().getPtmRatio() ;
-			setWorldPos( pos.x * ptmRatio, pos.y * ptmRatio ) ;
-			float orientation = m_pBody->GetAngle() ;
-			setWorldRotationAngle( -ToDegree(orientation) ) ;
-		}
-		else {
-			// update physic properties from sprite attributes
-			setTransform( getWorldPos(), getWorldRotationAngle() ) ;
-		}
-	}
-#endif
-}
-
 void B2Sprite::createBody( b2BodyDef& bodyDef )
 {
 	#ifdef JAM_PHYSIC_ENABLED
 bodyDef.userData = this ;
 	m_pBody = GetAppMgr().getB2World()->CreateBody(&bodyDef) ;
+	registerBody() ;
 #endif
 }
 
@@ -158,4 +143,90 @@ Vector2 B2Sprite::getWorldCenter() const
 	return Vector2( m_pBody->GetWorldCenter().x, m_pBody->GetWorldCenter().y ) ;
 }
 
+void B2Sprite::syncBodiesFromSprites()
+{
+#ifdef JAM_PHYSIC_ENABLED
+	for( size_t i=0; i<s_bodySprites.size(); i++ ) {
+		B2Sprite* pSprite = s_bodySprites[i] ;
+		b2Body* pBody = pSprite->m_pBody ;
+		// awake bodies drive their sprites, untouched sleeping bodies are left alone
+		if( (!pBody->IsActive() || !pBody->IsAwake()) && pSprite->isMovedSinceSync() ) {
+			pSprite->setTransform( pSprite->getWorldPos(), pSprite->getWorldRotationAngle() ) ;
+			pSprite->storeSyncState() ;
+		}
+	}
+#endif
+}
+
+void B2Sprite::syncSpritesFromBodies()
+{
+#ifdef JAM_PHYSIC_ENABLED
+	JAM_PROFILE("B2Sprite.syncSpritesFromBodies") ;
+	float ptmRatio = GetAppMgr().getPtmRatio() ;
+	for( size_t i=0; i<s_bodySprites.size(); i++ ) {
+		B2Sprite* pSprite = s_bodySprites[i] ;
+		b2Body* pBody = pSprite->m_pBody ;
+		if( pBody->IsActive() && pBody->IsAwake() ) {
+			pSprite->syncFromBody( ptmRatio ) ;
+		}
+	}
+#endif
+}
+
+void B2Sprite::registerBody()
+{
+	if( m_pBody && m_bodySlot < 0 ) {
+		m_bodySlot = (int)s_bodySprites.size() ;
+		s_bodySprites.push_back( this ) ;
+		storeSyncState() ;
+	}
+}
+
+void B2Sprite::unregisterBody()
+{
+	if( m_bodySlot >= 0 ) {
+		// swap with the last one
+		B2Sprite* pLast = s_bodySprites.back() ;
+		s_bodySprites[m_bodySlot] = pLast ;
+		pLast->m_bodySlot = m_bodySlot ;
+		s_bodySprites.pop_back() ;
+		m_bodySlot = -1 ;
+	}
+}
+
+void B2Sprite::syncFromBody( float ptmRatio )
+{
+	const b2Vec2& bodyPos = m_pBody->GetPosition() ;
+	Vector2 pos( bodyPos.x * ptmRatio, bodyPos.y * ptmRatio ) ;
+	float angle = -ToDegree( m_pBody->GetAngle() ) ;
+
+	if( m_parent ) {
+		setWorldPos( pos ) ;
+		setWorldRotationAngle( angle ) ;
+	}
+	else {
+		// root sprites: world transform is the local one, invalidate once for both position and rotation
+		Matrix3 rot = createRotationMatrix2D( -angle ) ;
+		if( pos != m_local_pos || rot != m_local_rot ) {
+			m_local_pos = pos ;
+			m_local_rot = rot ;
+			invalidateLocal() ;
+		}
+	}
+
+	storeSyncState() ;
+}
+
+bool B2Sprite::isMovedSinceSync() const
+{
+	// the body is teleported to the world transform, a sprite can also be moved through its ancestors
+	return getWorldPos() != m_syncPos || getWorldRotationAngle() != m_syncAngle ;
+}
+
+void B2Sprite::storeSyncState()
+{
+	m_syncPos = getWorldPos() ;
+	m_syncAngle = getWorldRotationAngle() ;
+}
+
 }
@@ -204,6 +204,12 @@ namespace jam
 	}
 
 
+	Frustum Camera::getFrustum( const Matrix4& model )
+	{
+		update() ;
+		return Frustum( m_projMatrix * m_viewMatrix * model ) ;
+	}
+
 	void Camera::setActive()
 	{
 		m_isViewDirty = m_isProjDirty = true ;
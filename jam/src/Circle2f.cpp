@@ -37,6 +37,7 @@
 #include <glm/gtx/norm.hpp>
 
 #include <math.h>
+#include <float.h>
 
 namespace jam
 {
@@ -92,6 +93,88 @@ bool Circle2f::intersects( const Circle2f& other ) const
 	return distanceSquared <= (rr * rr) ;
 }
 
+bool Circle2f::intersects( const Circle2f& other, Vector2& normal, float& depth ) const
+{
+	Vector2 d = other.getCenter() - getCenter() ;
+	float distanceSquared = glm::length2(d) ;
+	float rr = getRadius() + other.getRadius() ;
+	if( distanceSquared > (rr * rr) ) {
+		return false ;
+	}
+
+	float distance = sqrtf(distanceSquared) ;
+	normal = (distance > 0.0f) ? d / distance : Vector2(1.0f, 0.0f) ;
+	depth = rr - distance ;
+	return true ;
+}
+
+bool Circle2f::intersects( const Polygon2f& poly, Vector2& normal, float& depth ) const
+{
+	int count = poly.getCount() ;
+	if( count == 0 ) {
+		return false ;
+	}
+
+	// the separating axis is either an edge normal or the axis through the vertex nearest to the center
+	int nearest = 0 ;
+	float nearestDistanceSquared = FLT_MAX ;
+	for( int i=0; i<count; i++ ) {
+		float distanceSquared = glm::length2(poly.getVertex(i) - m_center) ;
+		if( distanceSquared < nearestDistanceSquared ) {
+			nearestDistanceSquared = distanceSquared ;
+			nearest = i ;
+		}
+	}
+
+	normal = Vector2(0.0f) ;
+	depth = FLT_MAX ;
+	for( int j=count-1, i=0; i<=count; j=i, i++ ) {
+		Vector2 axis ;
+		if( i < count ) {
+			Vector2 edge = poly.getVertex(i) - poly.getVertex(j) ;
+			axis = Vector2(-edge.y, edge.x) ;
+		}
+		else {
+			axis = poly.getVertex(nearest) - m_center ;
+		}
+
+		float length = glm::length(axis) ;
+		if( length <= 0.0f ) {
+			continue ;
+		}
+		axis /= length ;
+
+		float minp = FLT_MAX, maxp = -FLT_MAX ;
+		for( int k=0; k<count; k++ ) {
+			float d = glm::dot(poly.getVertex(k), axis) ;
+			minp = Min(minp, d) ;
+			maxp = Max(maxp, d) ;
+		}
+		float c = glm::dot(m_center, axis) ;
+		float minc = c - m_radius ;
+		float maxc = c + m_radius ;
+		if( minc > maxp || minp > maxc ) {
+			return false ;
+		}
+
+		float overlap = Min(maxc, maxp) - Max(minc, minp) ;
+		if( overlap < depth ) {
+			depth = overlap ;
+			normal = axis ;
+		}
+	}
+
+	if( depth == FLT_MAX ) {
+		depth = 0.0f ;
+	}
+
+	if( glm::dot(poly.getVertexMean() - m_center, normal) < 0.0f ) {
+		normal = -normal ;
+	}
+
+	return true ;
+}
+
 bool Circle2f::isPointInside( const Vector2& p ) const
 {
 	Vector2 distFromCenter = p - m_center ;
@@ -33,6 +33,7 @@
 #include "jam/Application.h"
 #include "jam/Scene.h"
 #include "jam/Timer.h"
+#include "jam/JobSystem.h"
 #include "jam/core/bmkextras.hpp"
 
 #ifndef JAM_CM_QUADTREE_DISABLED
@@ -48,7 +49,8 @@ namespace jam
 CollisionManager::CollisionManager() :
 	m_maxSimultaneousColls(COLLISION_MANAGER_MAX_COLLISIONS),
 	m_maxCollsType(JAM_CM_MAX_COLL_TYPES),
-	m_isOptimized(false)
+	m_isOptimized(false),
+	m_isParallel(true)
 #ifndef JAM_CM_QUADTREE_DISABLED
 	, m_quadTree(0)
 #endif
@@ -59,6 +61,9 @@ CollisionManager::CollisionManager() :
 #endif
 
 {
+	static_assert( JAM_CM_MAX_COLL_LAYERS <= 64, "collision layers must fit in a 64 bits mask" ) ;
+	clearCollisions() ;
+
 #ifndef JAM_CM_QUADTREE_DISABLED
 	m_quadTree = new Quadtree( -Draw3DManager::HalfOriginal3DWidth, Draw3DManager::HalfOriginal3DHeight, Draw3DManager::Original3DWidth, Draw3DManager::Original3DHeight ) ;
 #endif
@@ -75,6 +80,9 @@ CollisionManager::~CollisionManager()
 	for( unsigned int i=0; i < m_freeColls.size(); i++ ){
 		JAM_DELETE( m_freeColls[i] ) ;
 	}
+#ifndef JAM_CM_QUADTREE_DISABLED
+	JAM_DELETE( m_quadTree ) ;
+#endif
 }
 
 
@@ -82,6 +90,7 @@ void CollisionManager::clearCollisions()
 {
 	for( int k=0; k<JAM_CM_MAX_COLL_TYPES; k++ ){
 		m_collInfo[k].clear();
+		m_layerMasks[k] = 0;
 	}
 }
 
@@ -101,11 +110,14 @@ void CollisionManager::setCollisions( int src_type,int dest_type,Method method,i
 
 	CollInfo co={dest_type,method,response};
 	info.push_back(co);
+	m_layerMasks[src_type] |= getLayerBit(dest_type);
 }
 
 
 void CollisionManager::update( float elapsed )
 {
+	JAM_PROFILE("CollisionManager.update") ;
+
 	// collect previusly allocated ObjCollision from used_colls and store them in free_colls for later use
 	for( ;m_usedColls.size();m_usedColls.pop_back() ){
 		m_freeColls.push_back( m_usedColls.back() );
@@ -132,6 +144,8 @@ void CollisionManager::update( float elapsed )
 		collType = n->getCollisionType() ;
 		if( collType != 0 ) {
 			n->clearCollisions();
+			n->getCollisionOBB() ;			// updates the cached bounds, hit-test jobs only read them
+			n->m_collProxy.category = getLayerBit(collType) ;
 			m_objsByType[collType].push_back(n);
 #ifndef JAM_CM_QUADTREE_DISABLED
 			m_quadTree->insert(n) ;			// insert the node in the quadtree
@@ -139,17 +153,22 @@ void CollisionManager::update( float elapsed )
 		}
 	}
 
-	// for each enabled object check if it collide
+	// for each enabled object collect the objects it could collide with
+	m_pairs.clear() ;
 	for( it = m_enabled.begin(); it != m_enabled.end(); it++ ) {
 		Node *n = *it;
 		if( n->getCollisionType() ) {
 #ifdef JAM_TRACE_COLLISIONS
 			m_numOfObjects++ ;
 #endif
-			checkCollisions( n );
+			collectPairs( n );
 		}
 	}
 
+	JAM_PROFILE_COUNTER("CollisionManager.pairs", m_pairs.size()) ;
+	testPairs() ;
+	resolvePairs() ;
+
 	for( int k=0; k<JAM_CM_MAX_COLL_TYPES; k++ ){
 		m_objsByType[k].clear();
 	}
@@ -175,7 +194,7 @@ bool CollisionManager::hitTest( Node* src, Node* dst, Method method )
 }
 
 
-void CollisionManager::collided( Node* src, Node* dest )
+void CollisionManager::collided( Node* src, Node* dest, const Vector2& normal, float depth )
 {
 #ifdef JAM_TRACE_COLLISIONS
 	m_numOfCollidedPairs++ ;
@@ -184,12 +203,16 @@ void CollisionManager::collided( Node* src, Node* dest )
 	ObjCollision *c = 0 ;
 
 	c=allocObjColl(dest) ;
+	c->normal=normal;
+	c->depth=depth;
 	src->addCollision( c );
 
 	c=allocObjColl(src) ;
+	c->normal=-normal;
+	c->depth=depth;
 	dest->addCollision( c );
 
-	CollisionEventArgs* evtArgs = CollisionEventArgs::create(src,dest) ;
+	Ref<CollisionEventArgs> evtArgs( CollisionEventArgs::create(src,dest,normal,depth) ) ;
 	src->getCollisionEvent().enqueue(evtArgs,this) ;
 }
 
@@ -211,14 +234,20 @@ ObjCollision* CollisionManager::allocObjColl( Node* with )
 }
 
 
-void CollisionManager::checkCollisions( Node* src )
+void CollisionManager::collectPairs( Node* src )
 {
 	//if (!src->canCollide()) return;	// ***GS: src Collisions are in pause
 
+	// the layers src collides with, both by the layer matrix and by its own mask
+	U64 dstLayers = m_layerMasks[src->getCollisionType()] & src->m_collProxy.mask ;
+	if( dstLayers == 0 ) {
+		return ;
+	}
+
 #ifndef JAM_CM_QUADTREE_DISABLED
-	NodesList objLst ;
-	m_quadTree->getObjects( src->getCollisionOBB(),objLst) ;
-	if( objLst.empty() ) {
+	// only nodes of those layers are returned
+	m_nearNodes.clear() ;
+	if( m_quadTree->getObjects( src->getCollisionOBB(),m_nearNodes,dstLayers) == 0 ) {
 		return ;
 	}
 #endif
@@ -226,80 +255,205 @@ void CollisionManager::checkCollisions( Node* src )
 	// gets the list of dest entity-types to be checked with source entity 
 	const vector<CollInfo>& collinfos=m_collInfo[src->getCollisionType()];
 
-	Node* coll_obj = 0;
-	vector<CollInfo>::const_iterator coll_it,coll_info;
-
-	int numOfColls = 0; 
+	vector<CollInfo>::const_iterator coll_it;
 
 	// for each dest coll-types
 	for( coll_it = collinfos.begin(); coll_it!=collinfos.end(); coll_it++ ){
 
-		vector<Node*>::const_iterator dst_it;
+		if( (getLayerBit(coll_it->dst_type) & dstLayers) == 0 ) {
+			continue;
+		}
 
-		// get the list of objects of coll-type "dest_type"
-		const vector<Node*>& dst_objs = m_objsByType[coll_it->dst_type];
+		auto addPair = [&]( Node* dst ) {
+			if( src == dst ) { 
+				return;
+			}
+
+			// dst must accept the layer of src too
+			if( (dst->m_collProxy.mask & src->m_collProxy.category) == 0 ) {
+				return;
+			}
 
-		// perform hit-test for all objects (of coll-type "dest_type") in the list
-		for( dst_it = dst_objs.begin(); dst_it != dst_objs.end(); dst_it++ ) {
+		//	if (!dst->canCollide()) { return; } // ***GS: dst Collisions are in pause
 
-			Node* dst = *dst_it;
+			m_checked[src].insert(dst) ;
+
+			// when dst has already collected (dst,src) the pair is kept as deferred: resolvePairs() tests it
+			// only if (dst,src) is dropped because dst has reached the simultaneous collisions limit
+			set<Node*>& checkedWithDst = m_checked[dst] ;
+			bool deferred = checkedWithDst.find(src) != checkedWithDst.end() ;
+#ifdef JAM_TRACE_COLLISIONS
+			if( !deferred ) {
+				m_numOfCheckedPairs++ ;
+			}
+#endif
+			CollPair pair = { src, dst, coll_it->method, coll_it->dst_type, false, src->hasStandardCollide(), deferred, 0, Vector2(0.0f), 0.0f } ;
+			m_pairs.push_back( pair ) ;
+		} ;
 
 #ifndef JAM_CM_QUADTREE_DISABLED
-			NodesList::iterator it = std::find(objLst.begin(),objLst.end(),dst) ;
-			if( it == objLst.end() ) {
-				continue;
+		// the objects of coll-type "dest_type" near src
+		for( size_t i=0; i<m_nearNodes.size(); i++ ) {
+			if( m_nearNodes[i]->getCollisionType() == coll_it->dst_type ) {
+				addPair( m_nearNodes[i] ) ;
 			}
+		}
+#else
+		// get the list of objects of coll-type "dest_type"
+		const vector<Node*>& dst_objs = m_objsByType[coll_it->dst_type];
+		for( vector<Node*>::const_iterator dst_it = dst_objs.begin(); dst_it != dst_objs.end(); dst_it++ ) {
+			addPair( *dst_it ) ;
+		}
 #endif
+	}
+}
 
-//			IwDebugTraceLinePrintf( "Checking %s with %s",src->getName().c_str(), dst->getName().c_str() );
+void CollisionManager::testPairs()
+{
+	JAM_PROFILE("CollisionManager.testPairs") ;
+
+	// standard pairs, first stage: bounding circles
+	m_narrowphase.clear() ;
+	for( size_t i=0; i<m_pairs.size(); i++ ) {
+		CollPair& pair = m_pairs[i] ;
+		if( pair.standard && !pair.deferred ) {
+			pair.test = m_narrowphase.addCircles( pair.src->getCollisionBoundingCircle(), pair.dst->getCollisionBoundingCircle() ) ;
+		}
+	}
+	m_narrowphase.run( m_isParallel ) ;
+
+	// second stage: OBBs of the pairs whose circles overlap
+	bool boxes = false ;
+	for( size_t i=0; i<m_pairs.size(); i++ ) {
+		CollPair& pair = m_pairs[i] ;
+		if( pair.standard && !pair.deferred ) {
+			pair.hit = m_narrowphase.isHit( pair.test ) ;
+			pair.normal = m_narrowphase.getNormal( pair.test ) ;
+			pair.depth = m_narrowphase.getDepth( pair.test ) ;
+			boxes = boxes || (pair.hit && pair.method != Method::BoundingSphere) ;
+		}
+	}
 
-			if( src == dst ) { 
-//				IwDebugTraceLinePrintf( "Skip" );
-				continue;
+	if( boxes ) {
+		m_narrowphase.clear() ;
+		for( size_t i=0; i<m_pairs.size(); i++ ) {
+			CollPair& pair = m_pairs[i] ;
+			if( pair.standard && pair.hit && pair.method != Method::BoundingSphere ) {
+				pair.test = m_narrowphase.addPolygons( pair.src->getCollisionOBB(), pair.dst->getCollisionOBB() ) ;
+			}
+		}
+		m_narrowphase.run( m_isParallel ) ;
+
+		for( size_t i=0; i<m_pairs.size(); i++ ) {
+			CollPair& pair = m_pairs[i] ;
+			if( pair.standard && pair.hit && pair.method != Method::BoundingSphere ) {
+				pair.hit = m_narrowphase.isHit( pair.test ) ;
+				pair.normal = m_narrowphase.getNormal( pair.test ) ;
+				pair.depth = m_narrowphase.getDepth( pair.test ) ;
 			}
+		}
+	}
+
+	// custom collide() overrides and the pixel tests of the standard pairs, which repeat the (cheap) bounding tests
+	m_collidePairs.clear() ;
+	for( size_t i=0; i<m_pairs.size(); i++ ) {
+		const CollPair& pair = m_pairs[i] ;
+		if( !pair.deferred && (!pair.standard || (pair.hit && pair.method == Method::PerPixel)) ) {
+			m_collidePairs.push_back( i ) ;
+		}
+	}
 
-		//	if (!dst->canCollide()) { continue; } // ***GS: dst Collisions are in pause
+	size_t grainSize = m_isParallel ? COLLISION_MANAGER_PAIRS_GRAIN : m_collidePairs.size() ;
+	GetJobSystem().parallelFor( m_collidePairs.size(), grainSize, [this]( size_t begin, size_t end ) {
+		for( size_t i=begin; i<end; i++ ) {
+			CollPair& pair = m_pairs[m_collidePairs[i]] ;
+			pair.hit = hitTest( pair.src, pair.dst, pair.method ) ;
+		}
+	} ) ;
+}
 
-			m_checked[src].insert(dst) ;
+void CollisionManager::testPair( CollPair& pair )
+{
+	if( pair.standard ) {
+		m_narrowphase.clear() ;
+		pair.test = m_narrowphase.addCircles( pair.src->getCollisionBoundingCircle(), pair.dst->getCollisionBoundingCircle() ) ;
+		m_narrowphase.run( false ) ;
+		pair.hit = m_narrowphase.isHit( pair.test ) ;
+		pair.normal = m_narrowphase.getNormal( pair.test ) ;
+		pair.depth = m_narrowphase.getDepth( pair.test ) ;
+
+		if( pair.hit && pair.method != Method::BoundingSphere ) {
+			m_narrowphase.clear() ;
+			pair.test = m_narrowphase.addPolygons( pair.src->getCollisionOBB(), pair.dst->getCollisionOBB() ) ;
+			m_narrowphase.run( false ) ;
+			pair.hit = m_narrowphase.isHit( pair.test ) ;
+			pair.normal = m_narrowphase.getNormal( pair.test ) ;
+			pair.depth = m_narrowphase.getDepth( pair.test ) ;
+		}
+	}
 
-			set<Node*>& checkedWithDst = m_checked[dst] ;
-			if( checkedWithDst.find(src) == checkedWithDst.end() ) {
+	if( !pair.standard || (pair.hit && pair.method == Method::PerPixel) ) {
+		pair.hit = hitTest( pair.src, pair.dst, pair.method ) ;
+	}
+}
+
+void CollisionManager::resolvePairs()
+{
+	size_t i = 0 ;
+	while( i < m_pairs.size() ) {
+		Node* src = m_pairs[i].src ;
+		const CollPair* coll_pair = 0 ;
+		int numOfColls = 0 ;
+
+		// for each dest coll-types of src
+		while( i < m_pairs.size() && m_pairs[i].src == src ) {
+			int dst_type = m_pairs[i].dst_type ;
+			bool full = false ;
+
+			for( ; i < m_pairs.size() && m_pairs[i].src == src && m_pairs[i].dst_type == dst_type; i++ ) {
+				CollPair& pair = m_pairs[i] ;
+				if( full ) {
+					// not tested from this side, so dst still tests the pair from its own side
+					m_checked[src].erase( pair.dst ) ;
+					continue ;
+				}
+
+				if( pair.deferred ) {
+					set<Node*>& checkedWithDst = m_checked[pair.dst] ;
+					if( checkedWithDst.find(src) != checkedWithDst.end() ) {
+						continue ;
+					}
 #ifdef JAM_TRACE_COLLISIONS
-				m_numOfCheckedPairs++ ;
+					m_numOfCheckedPairs++ ;
 #endif
-				if( hitTest(src,dst,coll_it->method) ) {
-					//					IwDebugTraceLinePrintf("collision detected") ;
-					coll_obj=dst;
-					coll_info=coll_it;
-					numOfColls++ ;
-					if( !m_isOptimized ) {
-						if( numOfColls < m_maxSimultaneousColls )
-							collided(src,coll_obj);
-						else
-							break ;
-					}
+					testPair( pair ) ;
+				}
+
+				if( !pair.hit ) {
+					continue ;
+				}
+
+				coll_pair = &pair ;
+				numOfColls++ ;
+				if( !m_isOptimized ) {
+					if( numOfColls < m_maxSimultaneousColls )
+						collided(src,pair.dst,pair.normal,pair.depth);
+					else
+						full = true ;
 				}
-				//else {
-				//	IwDebugTraceLinePrintf("no collision detected") ;
-				//}
 			}
-			//else {
-			//	IwDebugTraceLinePrintf( "Already checked" );
-			//}
 		}
-	}
 
-	if( numOfColls > 0 && m_isOptimized ) {
-		collided(src,coll_obj);
+		if( numOfColls > 0 && m_isOptimized ) {
+			collided(src,coll_pair->dst,coll_pair->normal,coll_pair->depth);
+		}
 	}
-
 }
 
 void CollisionManager::setRegionBounds( const AABB& aabb )
 {
 #ifndef JAM_CM_QUADTREE_DISABLED
-	JAM_DELETE(m_quadTree) ;
-	m_quadTree = new Quadtree( aabb ) ;
+	m_quadTree->reset( aabb ) ;
 #endif
 }
 
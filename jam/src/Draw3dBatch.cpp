@@ -120,6 +120,7 @@ void Draw3DBatch::end()
 void Draw3DBatch::flush()
 {
 	if( m_isBatchingInProgress && m_pVertexBuffer->getNumOfVertices() > 0 ) {
+		JAM_PROFILE("Draw3DBatch.flush") ;
 #ifdef JAM_TRACE_BATCH
 		JAM_TRACE( ("Flushing current batch: processing %d vertices", m_pVertexBuffer->getNumOfVertices()) ) ;
 #endif
@@ -34,6 +34,8 @@
 namespace jam
 {
 
+JAM_IMPLEMENT_OBJECT_ALLOCATOR( DrawItem, new PoolObjectAllocator() )
+
 const BlendMode DrawItem::DEFAULT_BLEND_MODE = BlendMode::Normal ;
 
 Material* DrawItem::getMaterial() const
@@ -69,8 +71,9 @@ void DrawItem::setShader( Shader* pShader )
 DrawItem::DrawItem() :
 	m_pMaterial(0), m_rect(), m_offsetX(0.0f), m_offsetY(0.0f),
 	m_u1(0.0f), m_v1(0.0f), m_u2(1.0f), m_v2(1.0f),
-	m_halfWidth(0), m_halfHeight(0), m_gfxScale(1.0f)
+	m_halfWidth(0), m_halfHeight(0), m_gfxScale(1.0f), m_alphaMask()
 {
+	setRefCountPolicy( RefCountPolicy::SingleThreaded ) ;
 	m_pMaterial = new Material() ;
 	Ref<Texture2D> tex( new Texture2D() ) ;
 	tex->createDefaultEmpty() ;
@@ -81,8 +84,9 @@ DrawItem::DrawItem() :
 DrawItem::DrawItem( Texture2D* pTxtr, jam::Rect* pCut /*= 0*/, float gfxScale /*= 1.0f*/ ) :
 	m_pMaterial(0), m_rect(), m_offsetX(0.0f), m_offsetY(0.0f),
 	m_u1(0.0f), m_v1(0.0f), m_u2(1.0f), m_v2(1.0f), 
-	m_halfWidth(0), m_halfHeight(0), m_gfxScale(gfxScale)
+	m_halfWidth(0), m_halfHeight(0), m_gfxScale(gfxScale), m_alphaMask()
 {
+	setRefCountPolicy( RefCountPolicy::SingleThreaded ) ;
 	m_pMaterial = new Material() ;
 	m_pMaterial->setDiffuseTexture( pTxtr ) ;
 	m_pMaterial->setBlendEnabled(true) ;
@@ -103,8 +107,9 @@ DrawItem::DrawItem( Texture2D* pTxtr, jam::Rect* pCut /*= 0*/, float gfxScale /*
 DrawItem::DrawItem( Texture2D* pTxtr, const jam::Rect& cut, float gfxScale /*= 1.0f*/ ) :
 	m_pMaterial(0), m_rect(cut), m_offsetX(0.0f), m_offsetY(0.0f),
 	m_u1(0.0f), m_v1(0.0f), m_u2(1.0f), m_v2(1.0f),
-	m_halfWidth(0), m_halfHeight(0), m_gfxScale(gfxScale)
+	m_halfWidth(0), m_halfHeight(0), m_gfxScale(gfxScale), m_alphaMask()
 {
+	setRefCountPolicy( RefCountPolicy::SingleThreaded ) ;
 	m_pMaterial = new Material() ;
 	m_pMaterial->setDiffuseTexture( pTxtr ) ;
 	m_pMaterial->setBlendEnabled(true) ;
@@ -124,6 +129,9 @@ void DrawItem::init()
 		m_v1 = 1.0f - m_rect.top / (float)pTex->getHeight() ;
 		m_u2 = m_rect.right / (float)pTex->getWidth() ;
 		m_v2 = 1.0f - m_rect.bottom / (float)pTex->getHeight() ;
+
+		// built from the texture pixels, before the rect is scaled
+		m_alphaMask = AlphaMask::create( pTex, m_rect ) ;
 	}
 
 	m_rect.scale(m_gfxScale) ;
@@ -34,6 +34,8 @@
 namespace jam
 {
 
+JAM_IMPLEMENT_OBJECT_ALLOCATOR( EventArgs, new PoolObjectAllocator() )
+
 EventDispatcher::EventEventArgsPair::EventEventArgsPair(IEvent* evt, EventArgs* args, IEventSource* evSrc) :
 	m_event(evt), m_eventArgs(nullptr), m_eventSource(evSrc)
 {
@@ -29,113 +29,111 @@
 
 #include "stdafx.h"
 #include "jam/ExtAnimator.h"
+#include "jam/Animation2dManager.h"
 #include "jam/core/bmkextras.hpp"
-#include "jam/SysTimer.h"
-
-#include <math.h>
-
-using namespace std ;
 
 namespace jam
 {
 
 	ExtAnimator::ExtAnimator(IDrawable2D* pIDrawable) :
-		m_pAnimation(0), m_defaultAnimation(0), m_timer(0), m_pIDrawable(pIDrawable), m_lastFrameIndex(0), m_speed(1.0f), m_completeFrameIndex(-100)
+		m_slot(0), m_pAnimation(0), m_pIDrawable(pIDrawable)
 	{
-		m_timer = Timer::create() ;
-		String timeMs = to_string( GetSysTimer().getTime() ) ;
-		m_timer->setName(String("ExtAnimator_")+timeMs);
-		m_defaultAnimation = Animation2D::create() ;
-		m_pAnimation = m_defaultAnimation;
+		m_slot = GetAnim2DMgr().addAnimator( this, pIDrawable ) ;
 	}
 
 
 	ExtAnimator::~ExtAnimator()
 	{
-		m_timer = nullptr ;
+		// animators released after the engine termination have no slot anymore
+		if( Animation2DManager::isSingletonCreated() ) {
+			GetAnim2DMgr().removeAnimator( m_slot ) ;
+		}
 		m_pAnimation = nullptr ;
-		m_defaultAnimation = nullptr ;
 	}
 		
 	
 	void ExtAnimator::setAnimation( const Animation2D* pAnimation, bool autoStart/*=false*/, int firstFrame/*=0*/ )
 	{
 		assert(pAnimation) ;
+		Animation2DManager::AnimatorState& state = GetAnim2DMgr().getAnimatorState( m_slot ) ;
 		if(m_pAnimation != pAnimation) {
 			m_pAnimation = pAnimation ;
-			if( m_timer->isRunning() ) {
-				m_timer->stop();
-			}
+			state.pAnimation = pAnimation ;
+			state.playing = false ;
 		}
-		if( !m_timer->isRunning() && autoStart ) {
+		if( !state.playing && autoStart ) {
 			startAnimation();
 		}
 
 		if( autoStart == false ) {
-			m_lastFrameIndex = firstFrame ;
-			AnimFrame2D* pAnimFrame = m_pAnimation->getFrame(m_lastFrameIndex) ;
+			state.frameIndex = firstFrame ;
+			AnimFrame2D* pAnimFrame = m_pAnimation->getFrame(firstFrame) ;
 			/*pAnimFrame->setFlipX(pAnimFrame->getFlipX() & m_pAnimation->getFlipAllX());
 			pAnimFrame->setFlipY(pAnimFrame->getFlipY() & m_pAnimation->getFlipAllY());*/
-			DrawItem* pFrame = pAnimFrame->getDrawItem() ;
-			m_pIDrawable->setFrame(pFrame) ;
+			if( pAnimFrame ) {
+				m_pIDrawable->setFrame( pAnimFrame->getDrawItem() ) ;
+			}
 		}
 	}
 
-	void ExtAnimator::update()
+	float ExtAnimator::getSpeed() const
 	{
-		if( m_timer->isRunning() && m_pAnimation ) {
-			m_timer->update();
-			int idx = 0 ;
-			m_pAnimation->update(*m_timer, idx, m_speed, m_lastFrameIndex);
-			
-			if( idx >= 0 ) {
-				AnimFrame2D* pAnimFrame = m_pAnimation->getFrame(idx) ;
-				m_pIDrawable->setFrame( pAnimFrame->getDrawItem() ) ;
-				m_lastFrameIndex = idx ;
-			}
-			else {
-				m_lastFrameIndex = 0 ;
-			}
+		return GetAnim2DMgr().getAnimatorState( m_slot ).speed ;
+	}
 
-			if( m_completeFrameIndex >= 0 && m_lastFrameIndex == m_completeFrameIndex ) {
-				stopAnimation() ;
-			}
-		}
+	void ExtAnimator::setSpeed( float val )
+	{
+		GetAnim2DMgr().getAnimatorState( m_slot ).speed = val ;
+	}
+
+	int ExtAnimator::getLastFrameIndex() const
+	{
+		return GetAnim2DMgr().getAnimatorState( m_slot ).frameIndex ;
 	}
 
 	void ExtAnimator::startAnimation()
 	{
-		if( !m_timer->isRunning() ) {
-			m_timer->start() ;
-			m_lastFrameIndex = 0 ;
-			m_completeFrameIndex = -100 ;
+		Animation2DManager::AnimatorState& state = GetAnim2DMgr().getAnimatorState( m_slot ) ;
+		if( !state.playing ) {
+			state.playing = true ;
+			state.phase = 0.0f ;
+			state.frameIndex = -1 ;			// forces the first frame to be set by the next update
+			state.completeFrameIndex = -1 ;
 		}
 	}
+
 	void ExtAnimator::completeAnimation( int frame/*=-1*/ )
 	{
+		// nothing to complete until setAnimation() is called
+		if( !m_pAnimation ) {
+			return ;
+		}
+
 		if( frame == -1 ) frame=m_pAnimation->getNumOfFrames()-1;
 
-		frame = Limit(frame, 0,m_pAnimation->getNumOfFrames()-1);
-		m_completeFrameIndex = frame ;
+		frame = Limit(frame, 0,(int)m_pAnimation->getNumOfFrames()-1);
+		GetAnim2DMgr().getAnimatorState( m_slot ).completeFrameIndex = frame ;
 	}
 
 	void ExtAnimator::stopAnimation()
 	{
-		m_timer->stop() ;
-		m_lastFrameIndex = 0 ;
+		Animation2DManager::AnimatorState& state = GetAnim2DMgr().getAnimatorState( m_slot ) ;
+		state.playing = false ;
+		state.frameIndex = 0 ;
 	}
 
 
 	void ExtAnimator::resetAnimation()
 	{
-		m_timer->reset() ;
-		m_lastFrameIndex = 0 ;
+		Animation2DManager::AnimatorState& state = GetAnim2DMgr().getAnimatorState( m_slot ) ;
+		state.phase = 0.0f ;
+		state.frameIndex = 0 ;
 	}
 
 
 	bool ExtAnimator::isPlaying()
 	{
-		return m_timer->isRunning() ;
+		return GetAnim2DMgr().getAnimatorState( m_slot ).playing ;
 	}
 
 }
@@ -0,0 +1,206 @@
+/**********************************************************************************
+* 
+* FrameAllocator.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/FrameAllocator.h"
+
+#include <cstdlib>
+#include <mutex>
+
+namespace jam
+{
+
+//*******************
+//
+// Helpers
+//
+//*******************
+
+static uintptr_t alignUp( uintptr_t p, size_t alignment )
+{
+	return (p + alignment - 1) & ~(uintptr_t)(alignment - 1) ;
+}
+
+/*
+	Bump allocator over a single block. Allocations not fitting in the block are served by the heap
+	until the next reset(), which enlarges the block to the whole size used in the meantime
+*/
+class FrameArena
+{
+public:
+	FrameArena() : m_pBlock(nullptr), m_size(0), m_offset(0), m_overflow(), m_overflowSize(0) {}
+	~FrameArena() { release() ; }
+
+	void* allocate( size_t size, size_t alignment )
+	{
+		if( m_pBlock ) {
+			uintptr_t base = (uintptr_t)m_pBlock ;
+			uintptr_t p = alignUp( base + m_offset, alignment ) ;
+			if( p + size <= base + m_size ) {
+				m_offset = (size_t)(p + size - base) ;
+				return (void*)p ;
+			}
+		}
+
+		U8* pChunk = (U8*)malloc( size + alignment ) ;
+		JAM_ASSERT_MSG( pChunk, "Out of memory allocating %d frame bytes", (int)size ) ;
+		m_overflow.push_back( pChunk ) ;
+		m_overflowSize += size + alignment ;
+		return (void*)alignUp( (uintptr_t)pChunk, alignment ) ;
+	}
+
+	void reset()
+	{
+		if( !m_pBlock || m_overflowSize ) {
+			size_t size = alignUp( (m_pBlock ? m_size : JAM_FRAME_ARENA_BLOCK_SIZE) + m_overflowSize, JAM_FRAME_ARENA_BLOCK_SIZE ) ;
+			release() ;
+			m_pBlock = (U8*)malloc( size ) ;
+			m_size = m_pBlock ? size : 0 ;
+		}
+		m_offset = 0 ;
+	}
+
+	void release()
+	{
+		for( U8* pChunk : m_overflow ) {
+			free( pChunk ) ;
+		}
+		m_overflow.clear() ;
+		m_overflowSize = 0 ;
+
+		free( m_pBlock ) ;
+		m_pBlock = nullptr ;
+		m_size = 0 ;
+		m_offset = 0 ;
+	}
+
+	size_t getCapacity() const { return m_size + m_overflowSize ; }
+
+private:
+	U8*						m_pBlock ;
+	size_t					m_size ;
+	size_t					m_offset ;
+	std::vector<U8*>		m_overflow ;
+	size_t					m_overflowSize ;
+};
+
+// the arena of the current frame is reset when the thread first allocates in it, its content is two frames old
+struct FrameThreadArenas {
+	FrameArena				arenas[2] ;
+	uint64_t				frame ;
+};
+
+static std::mutex							s_arenasMutex ;
+static std::vector<FrameThreadArenas*>		s_arenas ;
+static thread_local FrameThreadArenas*		t_pArenas = nullptr ;
+
+std::atomic<uint64_t>		FrameAllocator::m_frame(1) ;
+
+static FrameThreadArenas* getThreadArenas()
+{
+	if( !t_pArenas ) {
+		FrameThreadArenas* pArenas = new FrameThreadArenas() ;
+		pArenas->frame = 0 ;
+
+		std::lock_guard<std::mutex> lock(s_arenasMutex) ;
+		s_arenas.push_back( pArenas ) ;
+		t_pArenas = pArenas ;
+	}
+	return t_pArenas ;
+}
+
+//*******************
+//
+// FrameAllocator
+//
+//*******************
+
+void* FrameAllocator::allocate( size_t size, size_t alignment /*= alignof(std::max_align_t)*/ )
+{
+	FrameThreadArenas* pArenas = getThreadArenas() ;
+	uint64_t frame = getFrame() ;
+	FrameArena& arena = pArenas->arenas[frame & 1] ;
+	if( pArenas->frame != frame ) {
+		arena.reset() ;
+		pArenas->frame = frame ;
+	}
+	return arena.allocate( size ? size : 1, alignment ) ;
+}
+
+void FrameAllocator::newFrame()
+{
+	m_frame.fetch_add( 1, std::memory_order_relaxed ) ;
+}
+
+size_t FrameAllocator::getCapacity()
+{
+	std::lock_guard<std::mutex> lock(s_arenasMutex) ;
+	size_t capacity = 0 ;
+	for( FrameThreadArenas* pArenas : s_arenas ) {
+		capacity += pArenas->arenas[0].getCapacity() + pArenas->arenas[1].getCapacity() ;
+	}
+	return capacity ;
+}
+
+void FrameAllocator::shutdown()
+{
+	std::lock_guard<std::mutex> lock(s_arenasMutex) ;
+	for( FrameThreadArenas* pArenas : s_arenas ) {
+		delete pArenas ;
+	}
+	s_arenas.clear() ;
+	t_pArenas = nullptr ;
+}
+
+//*******************
+//
+// FrameAllocated
+//
+//*******************
+
+// the frame of the allocation is stored in front of the object to catch the ones released too late
+static const size_t FrameAllocatedHeaderSize = alignof(std::max_align_t) > sizeof(uint64_t) ? alignof(std::max_align_t) : sizeof(uint64_t) ;
+
+void* FrameAllocated::operator new( size_t size )
+{
+	U8* p = (U8*)FrameAllocator::allocate( size + FrameAllocatedHeaderSize ) ;
+	*(uint64_t*)p = FrameAllocator::getFrame() ;
+	return p + FrameAllocatedHeaderSize ;
+}
+
+void FrameAllocated::operator delete( void* p )
+{
+	if( p ) {
+		uint64_t frame = *(uint64_t*)((U8*)p - FrameAllocatedHeaderSize) ;
+		JAM_ASSERT_MSG( FrameAllocator::isAlive(frame), "Frame allocated object released %d frames after its allocation", (int)(FrameAllocator::getFrame() - frame) ) ;
+	}
+}
+
+}
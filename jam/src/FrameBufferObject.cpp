@@ -91,14 +91,19 @@ namespace jam
 		return glCheckFramebufferStatus(m_target) ;
 	}
 
+	// invalidation is only a hint, it's silently skipped where ARB_invalidate_subdata (GL 4.3) is not available
 	void FrameBufferObject::invalidate( GLsizei numAttachments, const GLenum *attachments )
 	{
-		glInvalidateFramebuffer( m_target, numAttachments, attachments ) ;
+		if( GLEW_ARB_invalidate_subdata ) {
+			glInvalidateFramebuffer( m_target, numAttachments, attachments ) ;
+		}
 	}
 
 	void FrameBufferObject::invalidateRegion( GLsizei numAttachments, const GLenum *attachments, GLint x, GLint y, GLsizei width, GLsizei height )
 	{
-		glInvalidateSubFramebuffer( m_target, numAttachments, attachments, x, y, width, height ) ;
+		if( GLEW_ARB_invalidate_subdata ) {
+			glInvalidateSubFramebuffer( m_target, numAttachments, attachments, x, y, width, height ) ;
+		}
 	}
 
 }
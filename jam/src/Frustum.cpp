@@ -0,0 +1,87 @@
+/**********************************************************************************
+* 
+* Frustum.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/Frustum.h"
+
+
+namespace jam
+{
+
+Frustum::Frustum()
+{
+	// no plane rejects anything
+	for( int i=0; i<6; i++ ) {
+		m_planes[i] = Vector4( 0.0f, 0.0f, 0.0f, 1.0f ) ;
+	}
+}
+
+Frustum::Frustum( const Matrix4& m )
+{
+	set( m ) ;
+}
+
+void Frustum::set( const Matrix4& m )
+{
+	// rows of the matrix (glm is column major)
+	Vector4 row0( m[0][0], m[1][0], m[2][0], m[3][0] ) ;
+	Vector4 row1( m[0][1], m[1][1], m[2][1], m[3][1] ) ;
+	Vector4 row2( m[0][2], m[1][2], m[2][2], m[3][2] ) ;
+	Vector4 row3( m[0][3], m[1][3], m[2][3], m[3][3] ) ;
+
+	m_planes[0] = row3 + row0 ;		// left
+	m_planes[1] = row3 - row0 ;		// right
+	m_planes[2] = row3 + row1 ;		// bottom
+	m_planes[3] = row3 - row1 ;		// top
+	m_planes[4] = row3 + row2 ;		// near
+	m_planes[5] = row3 - row2 ;		// far
+}
+
+bool Frustum::intersects( const Vector3& boxMin, const Vector3& boxMax ) const
+{
+	for( int i=0; i<6; i++ ) {
+		const Vector4& p = m_planes[i] ;
+		// the box corner farthest along the plane normal
+		float x = p.x >= 0.0f ? boxMax.x : boxMin.x ;
+		float y = p.y >= 0.0f ? boxMax.y : boxMin.y ;
+		float z = p.z >= 0.0f ? boxMax.z : boxMin.z ;
+		if( p.x*x + p.y*y + p.z*z + p.w < 0.0f ) {
+			return false ;
+		}
+	}
+	return true ;
+}
+
+bool Frustum::intersects( const Vector2& rectMin, const Vector2& rectMax ) const
+{
+	return intersects( Vector3(rectMin.x,rectMin.y,0.0f), Vector3(rectMax.x,rectMax.y,0.0f) ) ;
+}
+
+}
@@ -34,6 +34,8 @@
 #include "jam/StridedVertexBuffer.h"
 #include "jam/VertexArrayObject.h"
 #include "jam/Draw3DBatch.h"
+#include "jam/FrameAllocator.h"
+#include "jam/TransientVertexArena.h"
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -42,12 +44,14 @@ using namespace std ;
 namespace jam
 {
 
-Gfx::Gfx() : m_batch(0), m_renderLevel(0), m_pVBuff(0), m_handle(0), m_pType(GL_TRIANGLES), m_lastSlotID(0)
+Gfx::Gfx() : m_batch(0), m_renderLevel(0), m_pVBuff(0), m_handle(0), m_pType(GL_TRIANGLES), m_lastSlotID(0), m_pTransientArena(0),
+	m_numOfDrawCalls(0), m_lastNumOfDrawCalls(0)
 {
 }
 
 Gfx::~Gfx()
 {
+	JAM_DELETE(m_pTransientArena) ;
 }
 
 void Gfx::setViewport(int x, int y,int width,int height)
@@ -149,6 +153,7 @@ void Gfx::drawPrimitive( VertexArrayObject * pVao, size_t numOfVertices, Materia
 	pVao->bind() ;
 	pMaterial->bind() ;
 	glDrawArrays( pType, 0, (GLsizei)numOfVertices );
+	m_numOfDrawCalls++ ;
 	pMaterial->unbind() ;
 	pVao->unbind() ;
 }
@@ -158,6 +163,7 @@ void Gfx::drawIndexedPrimitive( VertexArrayObject* pVao, size_t numOfElements, M
 	pVao->bind() ;
 	pMaterial->bind() ;
 	glDrawElements( pType, (GLsizei)numOfElements, GL_UNSIGNED_SHORT, (const void*)offset );
+	m_numOfDrawCalls++ ;
 	pMaterial->unbind() ;
 	pVao->unbind() ;
 }
@@ -167,10 +173,25 @@ void Gfx::drawIndexedPrimitive( IVertexBuffer* pVBuff, Material* pMaterial, U16
 	pVBuff->bindVao() ;
 	pMaterial->bind() ;
 	glDrawElements( pType, pVBuff->getNumOfIndices(), GL_UNSIGNED_SHORT, (const void*)offset );
+	m_numOfDrawCalls++ ;
 	pMaterial->unbind() ;
 	pVBuff->unbindVao() ;
 }
 
+/**
+	Draws numOfInstances copies of the given vao with a single draw call.
+	The material state is bound using pShader, which is expected to fetch per-instance data by gl_InstanceID
+*/
+void Gfx::drawIndexedPrimitiveInstanced( VertexArrayObject* pVao, size_t numOfElements, size_t numOfInstances, Material* pMaterial, Shader* pShader, GLenum pType /*= GL_TRIANGLES */ )
+{
+	pVao->bind() ;
+	pMaterial->bind( pShader ) ;
+	glDrawElementsInstanced( pType, (GLsizei)numOfElements, GL_UNSIGNED_SHORT, (const void*)0, (GLsizei)numOfInstances );
+	m_numOfDrawCalls++ ;
+	pMaterial->unbind() ;
+	pVao->unbind() ;
+}
+
 void Gfx::setRenderLevel(int level)
 {
 	m_renderLevel = level ;
@@ -210,7 +231,11 @@ StridedVertexBuffer& Gfx::getVertexBuffer( DrawItem* handle, uint16_t vCount, ui
 		m_pVBuff = getBatch()->check(handle,vCount,iCount,m_renderLevel,pType);
 	}
 	else {
-		m_pVBuff = new StridedVertexBuffer( vCount, iCount );
+		// same index count defaults as StridedVertexBuffer, storage and buffer live in frame memory and are never uploaded
+		U16 maxIndexCount = iCount ? iCount : vCount + (vCount/2) ;
+		V3F_C4B_T2F* pVertices = FrameAllocator::allocateArray<V3F_C4B_T2F>( vCount ) ;
+		U16* pIndices = FrameAllocator::allocateArray<U16>( maxIndexCount ) ;
+		m_pVBuff = FrameAllocator::create<StridedVertexBuffer>( pVertices, vCount, pIndices, maxIndexCount ) ;
 	}
 
 	return *m_pVBuff ;
@@ -219,11 +244,32 @@ StridedVertexBuffer& Gfx::getVertexBuffer( DrawItem* handle, uint16_t vCount, ui
 void Gfx::appendOrDraw()
 {
 	if( !isBatchingInProgress() ) {
-		draw( m_pVBuff, m_handle, m_pType ) ;
-		JAM_DELETE(m_pVBuff) ;
+		getTransientArena().draw( *m_pVBuff, getMaterial(m_handle), m_pType ) ;
+		FrameAllocator::destroy( m_pVBuff ) ;
+		m_pVBuff = nullptr ;
 	}
 }
 
+TransientVertexArena& Gfx::getTransientArena()
+{
+	if( !m_pTransientArena ) {
+		m_pTransientArena = new TransientVertexArena() ;
+	}
+	return *m_pTransientArena ;
+}
+
+void Gfx::newFrame()
+{
+	if( m_pTransientArena ) {
+		m_numOfDrawCalls += m_pTransientArena->getNumOfDraws() ;
+		m_pTransientArena->newFrame() ;
+	}
+
+	JAM_PROFILE_COUNTER( "Gfx.drawCalls", m_numOfDrawCalls ) ;
+	m_lastNumOfDrawCalls = m_numOfDrawCalls ;
+	m_numOfDrawCalls = 0 ;
+}
+
 Material* Gfx::getMaterial( DrawItem* item )
 {
 	Material* pMat = item->getMaterial() ;
@@ -32,70 +32,65 @@
 #include "jam/Grabber.h"
 //#include "jam/Utilities.h"
 #include "jam/Draw3dManager.h"
+#include "jam/RenderTargetPool.h"
+#include "jam/Gfx.h"
 
 namespace jam
 {
 
-/*
-Grabber::Grabber() : m_pSurface(0)
+Grabber::Grabber() : m_clearColor(0,0,0,0), m_width(0), m_height(0), m_pTarget(0), m_prevFramebuffer(0), m_prevViewport(), m_prevClearColor()
 {
-	m_pSurface = new CIwGxSurface() ;
 }
 
 Grabber::~Grabber()
 {
-	JAM_DELETE(m_pSurface) ;
+	releaseTarget() ;
 }
-*/
 
 void Grabber::grab( jam::DrawItem* pDrawitem )
 {
-/*
-	bool succeded = m_pSurface->CreateSurface(
-		pDrawitem->getTexture(),
-		(int32)pDrawitem->getWidth(),(int32)pDrawitem->getHeight(),
-		CIwGxSurface::ALPHA_F | CIwGxSurface::CREATE_8888_SURFACE_F | CIwGxSurface::PRESERVE_FRAME_BUFFER_F ) ;
-
-	JAM_ASSERT_MSG(succeded==true, ("CreateSurface failed"));
-*/
+	m_width = (U32)pDrawitem->getWidth() ;
+	m_height = (U32)pDrawitem->getHeight() ;
 }
 
 void Grabber::beforeRender()
 {
-/*
-	m_clearColor = IwGxGetColClear() ;
-	m_pSurface->MakeCurrent() ;
-	IwGxSetColClear(0,0,0,0);
-	IwGxClear(IW_GX_COLOUR_BUFFER_F | IW_GX_DEPTH_BUFFER_F);
-	int16 w = (int16)m_pSurface->GetWidth()/2 ;
-	int16 h = (int16)m_pSurface->GetHeight()/2 ;
-	CIwSVec2 org( w, h ); 
-	IwGxSetScreenSpaceOrg(&org);
-*/
+	if( !m_pTarget ) {
+		m_pTarget = GetRenderTargetPool().acquire( m_width, m_height, GL_RGBA8, true ) ;
+	}
+
+	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &m_prevFramebuffer ) ;
+	glGetIntegerv( GL_VIEWPORT, m_prevViewport ) ;
+	glGetFloatv( GL_COLOR_CLEAR_VALUE, m_prevClearColor ) ;
+
+	m_pTarget->bind() ;
+	GetGfx().setClearColor( m_clearColor ) ;
+	GetGfx().clear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT ) ;
 }
 
 void Grabber::afterRender()
 {
-/*
-	IwGxFlush() ;
-	CIwGxSurface::MakeDisplayCurrent() ;
-	IwGxSetColClear( m_clearColor.r(), m_clearColor.g(), m_clearColor.b(), m_clearColor.a() ) ;
- 	CIwSVec2 org( (int16)Draw3DManager::HalfVPWidth, (int16)Draw3DManager::HalfVPHeight );
- 	IwGxSetScreenSpaceOrg(&org);
-*/
+	if( m_pTarget ) {
+		m_pTarget->discardDepth() ;
+	}
+	glBindFramebuffer( GL_FRAMEBUFFER, (GLuint)m_prevFramebuffer ) ;
+	GetGfx().setViewport( m_prevViewport[0], m_prevViewport[1], m_prevViewport[2], m_prevViewport[3] ) ;
+	glClearColor( m_prevClearColor[0], m_prevClearColor[1], m_prevClearColor[2], m_prevClearColor[3] ) ;
 }
 
-Texture2D* Grabber::getTexture()
+void Grabber::releaseTarget()
 {
-	Texture2D* pTexture = 0 ;
-/*
-	if( m_pSurface && m_pSurface->IsValid() ) {
-		pTexture = m_pSurface->GetTexture() ;
+	if( m_pTarget ) {
+		if( RenderTargetPool::isSingletonCreated() ) {
+			GetRenderTargetPool().release( m_pTarget ) ;
+		}
+		m_pTarget = 0 ;
 	}
+}
 
-	JAM_ASSERT_MSG(pTexture, ("CIwGxSurface::GetTexture() failed"));
-*/
-	return pTexture ;
+Texture2D* Grabber::getTexture()
+{
+	return m_pTarget ? m_pTarget->getTexture() : 0 ;
 }
 
 }
@@ -36,11 +36,25 @@
 #include "jam/DeviceManager.h"
 #include "jam/Draw3dManager.h"
 #include "jam/Gfx.h"
+#include "jam/Shader.h"
+#include "jam/Profiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 
 namespace jam
 {
+// same hash used by the grid effect shader
+static float gridHash( float n )
+{
+	float v = sinf(n) * 43758.5453f ;
+	return v - floorf(v) ;
+}
+
 // implementation of GridBase
 
+bool GridBase::s_gpuEffectsEnabled = true ;
+
 GridBase::GridBase() :
 	m_bActive(false),
 	m_nReuseGrid(false),
@@ -50,13 +64,23 @@ GridBase::GridBase() :
 	m_pGrabber(0),
 	m_bIsTextureFlipped(false),
 	m_pVertexBuffer(0),
-	m_pOriginalVertexBuffer(0)
+	m_pOriginalVertexBuffer(0),
+	m_effect(),
+	m_effectTime(0.0f),
+	m_effectSeed(0.0f),
+	m_verticesEdited(false),
+	m_verticesDirty(false),
+	m_viewMatrix(1.0f),
+	m_projMatrix(1.0f)
 {
 }
 
 GridBase::~GridBase()
 {
 	setActive(false);
+	JAM_DELETE(m_pGrabber) ;
+	JAM_DELETE(m_pVertexBuffer) ;
+	JAM_DELETE(m_pOriginalVertexBuffer) ;
 }
 
 //GridBase* GridBase::gridWithSize(const GridSize& gridSize)
@@ -135,7 +159,8 @@ bool GridBase::initWithSize(const GridSize& gridSize)
 
 	m_pDrawItem = DrawItem::create(nullptr,Rect(0,0,textureSize,textureSize));
 
-	if (initWithSize(gridSize, m_pDrawItem, m_bIsTextureFlipped)) {
+	// the grabbed frame buffer has the origin in the bottom left corner
+	if (initWithSize(gridSize, m_pDrawItem, true)) {
 		// do something
 	}
 
@@ -158,6 +183,10 @@ void GridBase::setIsTextureFlipped(bool bFlipped)
 
 void GridBase::set2DProjection()
 {
+	float halfWidth = m_pDrawItem->getHalfWidth() ;
+	float halfHeight = m_pDrawItem->getHalfHeight() ;
+	m_viewMatrix = Matrix4(1.0f) ;
+	m_projMatrix = glm::ortho( -halfWidth, halfWidth, -halfHeight, halfHeight, -1024.0f, 1024.0f ) ;
 /*
  	float winSizeWidth = (float)GetDeviceMgr().getNativeDisplayWidth() ;
  	float winSizeHeight = (float)GetDeviceMgr().getNativeDisplayHeight() ;
@@ -179,6 +208,11 @@ void GridBase::set2DProjection()
 
 void GridBase::set3DProjection()
 {
+	// 60 degrees vertical fov, the eye distance makes the z=0 plane cover exactly the whole viewport
+	float halfHeight = m_pDrawItem->getHalfHeight() ;
+	float zEye = halfHeight / tanf( glm::radians(30.0f) ) ;
+	m_viewMatrix = glm::lookAt( Vector3(0.0f,0.0f,zEye), Vector3(0.0f,0.0f,0.0f), Vector3(0.0f,1.0f,0.0f) ) ;
+	m_projMatrix = glm::perspective( glm::radians(60.0f), m_pDrawItem->getWidth() / m_pDrawItem->getHeight(), 0.5f, zEye * 2.0f ) ;
 /*
 	// The frustrum is generally initialised at the start of the application.
 	// The near and far plane clipping plane distances should be set as conservatively as possible;
@@ -223,12 +257,74 @@ void GridBase::afterDraw(Node *pTarget)
 		pBatch->begin();
 	}
 	m_pGrabber->afterRender();
-	set3DProjection();
+	if( m_effect.type == GridEffectType::NONE && !m_verticesEdited ) {
+		set2DProjection();
+	}
+	else {
+		set3DProjection();
+	}
 	blit();
+	// the grabbed texture is consumed by blit, the target can be reused by other grids
+	m_pGrabber->releaseTarget();
 }
 
 void GridBase::blit()
 {
+	JAM_PROFILE_DETAIL("GridBase.blit") ;
+
+	Texture2D* pTexture = m_pGrabber->getTexture() ;
+	if( !pTexture ) {
+		return ;
+	}
+
+	// the effect runs on the static original mesh, unless vertices have been edited or gpu effects are disabled
+	bool gpuEffect = s_gpuEffectsEnabled && !m_verticesEdited && m_effect.type != GridEffectType::NONE ;
+	if( !gpuEffect && !m_verticesEdited && m_effect.type != GridEffectType::NONE ) {
+		applyEffect() ;
+	}
+	StridedVertexBuffer* pVBuff = (gpuEffect || (!m_verticesEdited && m_effect.type == GridEffectType::NONE)) ? m_pOriginalVertexBuffer : m_pVertexBuffer ;
+	if( pVBuff == m_pVertexBuffer && m_verticesDirty && pVBuff->isUploaded() ) {
+		// update() rebinds the element buffer, no vao must be bound
+		pVBuff->unbindVao() ;
+		pVBuff->update() ;
+	}
+	m_verticesDirty = false ;
+
+	Shader* pPrevShader = GetShaderMgr().getCurrent() ;
+	Shader* pShader = GetShaderMgr().getOrCreateProgram( ShaderManager::GRID_EFFECT_PROGRAM_NAME ) ;
+	pShader->use() ;
+	pShader->setModelMatrix( Matrix4(1.0f) ) ;
+	pShader->setViewMatrix( m_viewMatrix ) ;
+	pShader->setProjectionMatrix( m_projMatrix ) ;
+
+	pShader->setUniform( "effectType", (GLint)(gpuEffect ? m_effect.type : GridEffectType::NONE) ) ;
+	if( gpuEffect ) {
+		pShader->setUniform( "effectTime", m_effectTime ) ;
+		pShader->setUniform( "effectSeed", m_effectSeed ) ;
+		pShader->setUniform( "amplitude", m_effect.amplitude ) ;
+		pShader->setUniform( "waves", m_effect.waves ) ;
+		pShader->setUniform( "center", m_effect.center.x, m_effect.center.y ) ;
+		pShader->setUniform( "radius", m_effect.radius ) ;
+		pShader->setUniform( "range", m_effect.range ) ;
+		pShader->setUniform( "gridSize", (GLint)m_sGridSize.x, (GLint)m_sGridSize.y ) ;
+		pShader->setUniform( "gridStep", m_obStep.x, m_obStep.y ) ;
+		pShader->setUniform( "gridOrigin", -m_pDrawItem->getHalfWidth(), m_pDrawItem->getHalfHeight() ) ;
+	}
+
+	glActiveTexture( GL_TEXTURE0 ) ;
+	glBindTexture( GL_TEXTURE_2D, pTexture->getId() ) ;
+	pShader->setUniform( "material_diffuse", (GLint)0 ) ;
+
+	GetGfx().setDepthTest( false ) ;
+	pVBuff->bindVao() ;
+	glDrawElements( GL_TRIANGLES, pVBuff->getNumOfIndices(), GL_UNSIGNED_SHORT, 0 ) ;
+	GetGfx().countDrawCall() ;
+	pVBuff->unbindVao() ;
+	GetGfx().setDepthTest( true ) ;
+
+	glBindTexture( GL_TEXTURE_2D, 0 ) ;
+	pPrevShader->use() ;
+
 /*
 	IwGxSetVertStreamModelSpace( m_pVertexBuffer->getVertexArray(), m_pVertexBuffer->getNumOfVertices() );
 	IwGxSetColStream( m_pVertexBuffer->getColourArray(), m_pVertexBuffer->getNumOfVertices() );
@@ -247,12 +343,106 @@ void GridBase::reuse()
 {
 	if (m_nReuseGrid > 0)
 	{
-		JAM_DELETE(m_pOriginalVertexBuffer) ;
-		m_pOriginalVertexBuffer = new StridedVertexBuffer(*m_pVertexBuffer) ;
+		// with no effect and no edits the original mesh is already the one drawn
+		if( m_verticesEdited || m_effect.type != GridEffectType::NONE ) {
+			// the gpu path never writes the warped vertices, so they are always evaluated on the cpu here
+			if( !m_verticesEdited ) {
+				applyEffect() ;
+			}
+			JAM_DELETE(m_pOriginalVertexBuffer) ;
+			m_pOriginalVertexBuffer = new StridedVertexBuffer(*m_pVertexBuffer) ;
+		}
 		--m_nReuseGrid;
 	}
 }
 
+void GridBase::setEffect(const GridEffect& effect)
+{
+	m_effect = effect ;
+	m_effectTime = 0.0f ;
+	m_verticesEdited = false ;
+}
+
+void GridBase::setEffectTime(float time)
+{
+	m_effectTime = time ;
+	// shaky effects pick new random offsets at every update
+	m_effectSeed = (float)((int)(m_effectSeed + 1.0f) % 4096) ;
+}
+
+void GridBase::invalidateVertices()
+{
+	m_verticesEdited = true ;
+	m_verticesDirty = true ;
+}
+
+void GridBase::applyEffect()
+{
+	const float pi = 3.14159265f ;
+	float phase = m_effectTime * pi * m_effect.waves * 2.0f ;
+	float originX = -m_pDrawItem->getHalfWidth() ;
+	float originY = m_pDrawItem->getHalfHeight() ;
+
+	const V3F_C4B_T2F* src = m_pOriginalVertexBuffer->getVertexArray() ;
+	V3F_C4B_T2F* dst = m_pVertexBuffer->getVertexArray() ;
+	U16 count = m_pOriginalVertexBuffer->getNumOfVertices() ;
+
+	for( U16 i=0; i<count; i++ ) {
+		Vertex3f p = src[i].vertex ;
+
+		switch( m_effect.type ) {
+		case GridEffectType::WAVES:
+			p.z += sinf( phase + (p.x + p.y) * 0.01f ) * m_effect.amplitude ;
+			break ;
+
+		case GridEffectType::RIPPLE: {
+			float dx = p.x - m_effect.center.x ;
+			float dy = p.y - m_effect.center.y ;
+			float r = sqrtf( dx*dx + dy*dy ) ;
+			if( r < m_effect.radius ) {
+				float rate = (m_effect.radius - r) / m_effect.radius ;
+				p.z += sinf( phase + r * 0.1f ) * m_effect.amplitude * rate * rate ;
+			}
+			break ;
+		}
+
+		case GridEffectType::LIQUID:
+			p.x += sinf( phase + p.x * 0.01f ) * m_effect.amplitude ;
+			p.y += sinf( phase + p.y * 0.01f ) * m_effect.amplitude ;
+			break ;
+
+		case GridEffectType::SHAKY: {
+			float n = (float)i + m_effectSeed * 7919.0f ;
+			p.x += (gridHash(n) * 2.0f - 1.0f) * m_effect.range ;
+			p.y += (gridHash(n + 17.0f) * 2.0f - 1.0f) * m_effect.range ;
+			break ;
+		}
+
+		case GridEffectType::WAVES_TILES: {
+			int tile = i / 4 ;
+			float cx = originX + ((tile % m_sGridSize.x) + 0.5f) * m_obStep.x ;
+			float cy = originY - ((tile / m_sGridSize.x) + 0.5f) * m_obStep.y ;
+			p.z += sinf( phase + (cx + cy) * 0.01f ) * m_effect.amplitude ;
+			break ;
+		}
+
+		case GridEffectType::SHAKY_TILES: {
+			float n = (float)(i / 4) + m_effectSeed * 7919.0f ;
+			p.x += (gridHash(n) * 2.0f - 1.0f) * m_effect.range ;
+			p.y += (gridHash(n + 17.0f) * 2.0f - 1.0f) * m_effect.range ;
+			break ;
+		}
+
+		default:
+			break ;
+		}
+
+		dst[i].vertex = p ;
+	}
+
+	m_verticesDirty = true ;
+}
+
 
 // implementation of Grid3D
 
@@ -284,16 +474,20 @@ Grid3D* Grid3D::gridWithSize(const GridSize& gridSize)
 
 void Grid3D::calculateVertexPoints()
 {
-	m_pVertexBuffer = new StridedVertexBuffer( 4*(m_sGridSize.x+1)*(m_sGridSize.y+1), 4*m_sGridSize.x*m_sGridSize.y ) ;
+	JAM_DELETE(m_pVertexBuffer) ;
+	JAM_DELETE(m_pOriginalVertexBuffer) ;
+	m_pVertexBuffer = new StridedVertexBuffer( (m_sGridSize.x+1)*(m_sGridSize.y+1), 6*m_sGridSize.x*m_sGridSize.y ) ;
 
+	float topV = m_bIsTextureFlipped ? m_pDrawItem->getV2() : m_pDrawItem->getV1() ;
+	float bottomV = m_bIsTextureFlipped ? m_pDrawItem->getV1() : m_pDrawItem->getV2() ;
 	float tuStep = (m_pDrawItem->getU2()-m_pDrawItem->getU1()) / m_sGridSize.x ;
-	float tvStep = (m_pDrawItem->getV2()-m_pDrawItem->getV1()) / m_sGridSize.y ;
+	float tvStep = (bottomV-topV) / m_sGridSize.y ;
 
 
 	int16_t v0, v1, v2, v3 ;
 	float ii, jj ;
 		
-	float tv1 = m_pDrawItem->getV1() ;
+	float tv1 = topV ;
 	for( uint16_t j=0; j < m_sGridSize.y+1; j++ ) {
 		jj = j * m_obStep.y ;
 		float tu1 = m_pDrawItem->getU1() ;
@@ -335,6 +529,12 @@ Vector3 Grid3D::originalVertex(const GridSize& pos)
 
 void Grid3D::setVertex(const GridSize& pos, const Vector3& vertex)
 {
+	if( !m_verticesEdited ) {
+		// edits start from the original grid, not from the last cpu evaluated effect
+		memcpy( m_pVertexBuffer->getVertexArray(), m_pOriginalVertexBuffer->getVertexArray(), m_pVertexBuffer->getNumOfVertices() * sizeof(V3F_C4B_T2F) ) ;
+	}
+	invalidateVertices() ;
+
 	int index = (pos.y * (m_sGridSize.x + 1) + pos.x) ;
 	V3F_C4B_T2F *vertArray = m_pVertexBuffer->getVertexArray();
 	vertArray[index].vertex.x = vertex.x ;
@@ -373,12 +573,16 @@ TiledGrid3D* TiledGrid3D::gridWithSize(const GridSize& gridSize)
 
 void TiledGrid3D::calculateVertexPoints()
 {
-	m_pVertexBuffer = new StridedVertexBuffer(4*m_sGridSize.x*m_sGridSize.y, 4*m_sGridSize.x*m_sGridSize.y ) ;
+	JAM_DELETE(m_pVertexBuffer) ;
+	JAM_DELETE(m_pOriginalVertexBuffer) ;
+	m_pVertexBuffer = new StridedVertexBuffer(4*m_sGridSize.x*m_sGridSize.y, 6*m_sGridSize.x*m_sGridSize.y ) ;
 
+	float topV = m_bIsTextureFlipped ? m_pDrawItem->getV2() : m_pDrawItem->getV1() ;
+	float bottomV = m_bIsTextureFlipped ? m_pDrawItem->getV1() : m_pDrawItem->getV2() ;
 	float tuStep = (m_pDrawItem->getU2()-m_pDrawItem->getU1()) / m_sGridSize.x ;
-	float tvStep = (m_pDrawItem->getV2()-m_pDrawItem->getV1()) / m_sGridSize.x ;
+	float tvStep = (bottomV-topV) / m_sGridSize.y ;
 
-	float tv1 = m_pDrawItem->getV1() ;
+	float tv1 = topV ;
 	float tv2 = tv1 + tvStep ;
 
 	float ii, jj ;
@@ -410,6 +614,12 @@ void TiledGrid3D::calculateVertexPoints()
 
 void TiledGrid3D::setTile(const GridSize& pos, const Quad3f& coords)
 {
+	if( !m_verticesEdited ) {
+		// edits start from the original grid, not from the last cpu evaluated effect
+		memcpy( m_pVertexBuffer->getVertexArray(), m_pOriginalVertexBuffer->getVertexArray(), m_pVertexBuffer->getNumOfVertices() * sizeof(V3F_C4B_T2F) ) ;
+	}
+	invalidateVertices() ;
+
 	int idx = ((m_sGridSize.x * pos.y) + pos.x) * 4 ;
 	V3F_C4B_T2F *vertArray = m_pVertexBuffer->getVertexArray();
 	vertArray[idx].vertex   = coords.tl ;
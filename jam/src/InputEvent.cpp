@@ -0,0 +1,84 @@
+/**********************************************************************************
+* 
+* InputEvent.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/InputEvent.h"
+
+
+namespace jam
+{
+
+const size_t InputEventQueue::DefaultCapacity = 1024 ;
+
+InputEventQueue::InputEventQueue( size_t capacity ) :
+	m_ring(), m_mask(0), m_head(0), m_tail(0), m_dropped(0)
+{
+	size_t size = 2 ;
+	while( size < capacity ) {
+		size <<= 1 ;
+	}
+	m_ring.resize( size ) ;
+	m_mask = size - 1 ;
+}
+
+bool InputEventQueue::push( const InputEvent& e )
+{
+	size_t tail = m_tail.load( std::memory_order_relaxed ) ;
+	if( tail - m_head.load( std::memory_order_acquire ) >= m_ring.size() ) {
+		m_dropped.fetch_add( 1, std::memory_order_relaxed ) ;
+		return false ;
+	}
+
+	m_ring[tail & m_mask] = e ;
+	// publishes the slot to the consumer
+	m_tail.store( tail + 1, std::memory_order_release ) ;
+	return true ;
+}
+
+size_t InputEventQueue::drain( std::vector<InputEvent>& out )
+{
+	size_t head = m_head.load( std::memory_order_relaxed ) ;
+	size_t tail = m_tail.load( std::memory_order_acquire ) ;
+
+	for( size_t i=head; i!=tail; i++ ) {
+		out.push_back( m_ring[i & m_mask] ) ;
+	}
+
+	// gives the slots back to the producer
+	m_head.store( tail, std::memory_order_release ) ;
+	return tail - head ;
+}
+
+U32 InputEventQueue::takeDroppedCount()
+{
+	return m_dropped.exchange( 0, std::memory_order_relaxed ) ;
+}
+
+}
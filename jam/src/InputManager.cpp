@@ -35,13 +35,17 @@
 #include "jam/Draw3dManager.h"
 #include "jam/Timer.h"
 #include "jam/SysTimer.h"
+#include "jam/Profiler.h"
 
+#include <chrono>
+#include <algorithm>
 
 namespace jam
 {
 
 // static initialization
 const uint64_t InputManager::DefaultDoubleTapMaxDelayMs = 300 ;
+const uint32_t InputManager::DefaultPollingIntervalUs = 1000 ;
 
 
 void InputManager::keyboardCallback( SDL_KeyboardEvent& e )
@@ -76,6 +80,13 @@ void InputManager::mouseButtonCallback( SDL_MouseButtonEvent& e )
 	if( action == SDL_PRESSED ) {
 		m_mouseButtonsChange[button] = true ;
 		m_mouseButtonsMap[button] = PRESSED ;
+
+		// double tap is measured between the times the presses happened, not the frames they were seen
+		if( button == SDL_BUTTON_LEFT ) {
+			uint64_t delayMs = (m_dispatchTimeNs - m_lastTapTimeNs[0]) / 1000000ULL ;
+			m_doubleTap[0] = delayMs < m_doubleTapDelay ;
+			m_lastTapTimeNs[0] = m_dispatchTimeNs ;
+		}
 	}
 	else if( action == SDL_RELEASED ) {
 		m_mouseButtonsChange[button] = true ;
@@ -97,7 +108,9 @@ void InputManager::mouseScrollCallback( SDL_MouseWheelEvent& e )
 
 InputManager::InputManager():
 	m_maxNumberOfTouches(JAM_MAX_TOUCHES), m_doubleTapDelay(DefaultDoubleTapMaxDelayMs),
-	m_pointerY(0.f), m_pointerX(0.f), m_pointerScrollX(0.f), m_pointerScrollY(0.f)
+	m_pointerY(0.f), m_pointerX(0.f), m_pointerScrollX(0.f), m_pointerScrollY(0.f),
+	m_eventQueue(), m_frameEvents(), m_stepEvents(), m_stepFirst(0), m_stepLast(0),
+	m_lastEventTimeNs(0), m_dispatchTimeNs(0), m_pollingThread(), m_pollingActive(false)
 {
 	m_pUpdateTimer = Timer::create() ;
 	if( !isMultiTouchAvailable() ) {
@@ -107,7 +120,7 @@ InputManager::InputManager():
 	for( uint16_t touchId=0; touchId<m_maxNumberOfTouches; touchId++ ) {
 		m_touchX[touchId] = -1.0f ;
 		m_touchY[touchId] = -1.0f ;
-		m_lastTapTime[touchId] = GetSysTimer().getTime() ;
+		m_lastTapTimeNs[touchId] = GetSysTimer().getTimeNs() ;
 		m_doubleTap[touchId] = false ;
 	}
 
@@ -120,11 +133,14 @@ InputManager::InputManager():
 		m_mouseButtonsMap[i] = UP ;
 		m_mouseButtonsChange[i] = false ;
 	}
-		 
+
+	m_frameEvents.reserve( m_eventQueue.getCapacity() ) ;
+	m_stepEvents.reserve( m_eventQueue.getCapacity() ) ;
 }
 
 InputManager::~InputManager()
 {
+	stopPollingThread() ;
 }
 
 InputManager::KeyStatus InputManager::getKeyState(jam::key key) const
@@ -226,11 +242,9 @@ void InputManager::touchUpdate()
 		m_touchX[touchId] = getPointerX() ;
 		m_touchY[touchId] = getPointerY() ;
 
-		if( getTouchState(touchId) == PRESSED )
-		{
-			uint64_t n = GetSysTimer().getTime() - m_lastTapTime[touchId] ;
-			m_doubleTap[touchId] = n < m_doubleTapDelay ;
-			m_lastTapTime[touchId] = GetSysTimer().getTime() ;
+		// double tap is set by the press event and lasts as long as the press
+		if( getTouchState(touchId) != PRESSED ) {
+			m_doubleTap[touchId] = false ;
 		}
 	}
 
@@ -308,9 +322,169 @@ void InputManager::keyUpdate()
 
 void InputManager::update()
 {
+	m_frameEvents.clear() ;
+	m_eventQueue.drain( m_frameEvents ) ;
+
+	U32 dropped = m_eventQueue.takeDroppedCount() ;
+	JAM_PROFILE_COUNTER( "InputManager.droppedEvents", dropped ) ;
+
+	for( size_t i=0; i<m_frameEvents.size(); i++ ) {
+		InputEvent& e = m_frameEvents[i] ;
+		// SDL timestamps have millisecond resolution, keep times monotonic
+		if( e.timeNs < m_lastEventTimeNs ) {
+			e.timeNs = m_lastEventTimeNs ;
+		}
+		m_lastEventTimeNs = e.timeNs ;
+		dispatchEvent( e ) ;
+	}
+
+	// events waiting for a fixed step, when the simulation does not run (e.g. paused) only the most recent are kept
+	m_stepEvents.insert( m_stepEvents.end(), m_frameEvents.begin(), m_frameEvents.end() ) ;
+	if( m_stepEvents.size() > m_eventQueue.getCapacity() ) {
+		m_stepEvents.erase( m_stepEvents.begin(), m_stepEvents.end() - m_eventQueue.getCapacity() ) ;
+	}
+	m_stepFirst = m_stepLast = 0 ;
+
 	touchUpdate() ;
 }
 
+void InputManager::dispatchEvent( const InputEvent& e )
+{
+	m_dispatchTimeNs = e.timeNs ;
+
+	SDL_Event ev = e.event ;
+	switch( ev.type ) {
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		mouseButtonCallback( ev.button ) ;
+		break ;
+	case SDL_MOUSEMOTION:
+		mouseMoveCallback( ev.motion ) ;
+		break ;
+	case SDL_MOUSEWHEEL:
+		mouseScrollCallback( ev.wheel ) ;
+		break ;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		keyboardCallback( ev.key ) ;
+		break ;
+	default:
+		break ;
+	}
+}
+
+void InputManager::pushEvent( const SDL_Event& e )
+{
+	// SDL stamps events with milliseconds ticks when they are queued, which can be older than the pump
+	uint64_t nowNs = GetSysTimer().getTimeNs() ;
+	uint64_t ageMs = 0 ;
+	Uint32 ticks = SDL_GetTicks() ;
+	if( ticks >= e.common.timestamp ) {
+		ageMs = ticks - e.common.timestamp ;
+	}
+
+	InputEvent ie ;
+	ie.timeNs = (ageMs * 1000000ULL < nowNs) ? nowNs - ageMs * 1000000ULL : nowNs ;
+	ie.event = e ;
+	m_eventQueue.push( ie ) ;
+}
+
+bool InputManager::isInputEvent( const SDL_Event& e )
+{
+	switch( e.type ) {
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+	case SDL_MOUSEMOTION:
+	case SDL_MOUSEWHEEL:
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		return true ;
+	default:
+		return false ;
+	}
+}
+
+bool InputManager::takeNonInputEvent( SDL_Event& e )
+{
+	// the ranges around the ones taken by pollingMain
+	return SDL_PeepEvents( &e, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_KEYDOWN-1 ) > 0 ||
+		SDL_PeepEvents( &e, 1, SDL_GETEVENT, SDL_KEYUP+1, SDL_MOUSEMOTION-1 ) > 0 ||
+		SDL_PeepEvents( &e, 1, SDL_GETEVENT, SDL_MOUSEWHEEL+1, SDL_LASTEVENT ) > 0 ;
+}
+
+InputEventRange InputManager::getFrameEvents() const
+{
+	if( m_frameEvents.empty() ) {
+		return InputEventRange() ;
+	}
+	return InputEventRange( m_frameEvents.data(), m_frameEvents.data() + m_frameEvents.size() ) ;
+}
+
+InputEventRange InputManager::getStepEvents() const
+{
+	if( m_stepFirst == m_stepLast ) {
+		return InputEventRange() ;
+	}
+	return InputEventRange( m_stepEvents.data() + m_stepFirst, m_stepEvents.data() + m_stepLast ) ;
+}
+
+void InputManager::beginStep( uint64_t stepEndNs )
+{
+	m_stepFirst = m_stepLast ;
+	while( m_stepLast < m_stepEvents.size() && m_stepEvents[m_stepLast].timeNs < stepEndNs ) {
+		m_stepLast++ ;
+	}
+}
+
+void InputManager::endSteps()
+{
+	m_stepEvents.erase( m_stepEvents.begin(), m_stepEvents.begin() + m_stepLast ) ;
+	m_stepFirst = m_stepLast = 0 ;
+}
+
+void InputManager::startPollingThread( uint32_t intervalUs )
+{
+	if( m_pollingActive.load() ) {
+		return ;
+	}
+	m_pollingActive.store( true ) ;
+	m_pollingThread = std::thread( &InputManager::pollingMain, this, intervalUs ) ;
+}
+
+void InputManager::stopPollingThread()
+{
+	if( !m_pollingActive.load() ) {
+		return ;
+	}
+	m_pollingActive.store( false ) ;
+	m_pollingThread.join() ;
+}
+
+void InputManager::pollingMain( uint32_t intervalUs )
+{
+	const int bufferSize = 64 ;
+	SDL_Event events[bufferSize] ;
+
+	while( m_pollingActive.load() ) {
+		SDL_PumpEvents() ;
+
+		// only input events are taken, the others are left in the SDL queue to the main thread
+		int n = 0 ;
+		while( (n = SDL_PeepEvents( events, bufferSize, SDL_GETEVENT, SDL_KEYDOWN, SDL_KEYUP )) > 0 ) {
+			for( int i=0; i<n; i++ ) {
+				pushEvent( events[i] ) ;
+			}
+		}
+		while( (n = SDL_PeepEvents( events, bufferSize, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEWHEEL )) > 0 ) {
+			for( int i=0; i<n; i++ ) {
+				pushEvent( events[i] ) ;
+			}
+		}
+
+		std::this_thread::sleep_for( std::chrono::microseconds(intervalUs) ) ;
+	}
+}
+
 String InputManager::keyStatusString(KeyStatus ks)
 {
 	String kss ;
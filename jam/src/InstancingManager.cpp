@@ -0,0 +1,285 @@
+/**********************************************************************************
+* 
+* InstancingManager.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include <jam/InstancingManager.h>
+#include <jam/Mesh.h>
+#include <jam/SkinnedMesh.h>
+#include <jam/Material.h>
+#include <jam/Shader.h>
+#include <jam/Application.h>
+#include <jam/Scene.h>
+#include <jam/Camera.h>
+#include <jam/Light.h>
+#include <jam/SharedUniforms.h>
+
+#include <algorithm>
+
+namespace jam
+{
+
+//*******************
+//
+// Class InstancingManager
+//
+//*******************
+
+InstancingManager::InstancingManager() :
+	m_meshBatches(),
+	m_skinnedMeshBatches(),
+	m_instancesStaging(),
+	m_bonesPalettes(),
+	m_instancesVbo(GL_TEXTURE_BUFFER),
+	m_instancesTex(0),
+	m_bonesVbo(GL_TEXTURE_BUFFER),
+	m_bonesTex(0),
+	m_maxTextureBufferTexels(0),
+	m_batchPrograms(),
+	m_numOfInstances(0),
+	m_numOfDrawCalls(0)
+{
+}
+
+InstancingManager::~InstancingManager()
+{
+	if( m_instancesTex ) {
+		glDeleteTextures( 1, &m_instancesTex ) ;
+	}
+	if( m_bonesTex ) {
+		glDeleteTextures( 1, &m_bonesTex ) ;
+	}
+}
+
+void InstancingManager::addInstance( Mesh* pMesh, const Matrix4& worldMatrix, const Color& color /*= Color::WHITE*/, Material* pMaterial /*= nullptr*/ )
+{
+	if( !pMaterial ) {
+		pMaterial = pMesh->getMaterial() ;
+	}
+
+	Batch<Mesh>& batch = m_meshBatches[std::make_pair(pMesh,pMaterial)] ;
+	batch.pMesh = pMesh ;
+	batch.pMaterial = pMaterial ;
+	batch.instances.emplace_back() ;
+	fillInstance( batch.instances.back(), worldMatrix, 0.0f, color ) ;
+	m_numOfInstances++ ;
+}
+
+void InstancingManager::addInstance( SkinnedMesh* pMesh, const Matrix4& worldMatrix, size_t bonesPaletteBase, const Color& color /*= Color::WHITE*/, Material* pMaterial /*= nullptr*/ )
+{
+	JAM_ASSERT_MSG( bonesPaletteBase < m_bonesPalettes.size(), "Invalid bones palette base" ) ;
+
+	if( !pMaterial ) {
+		pMaterial = pMesh->getMaterial() ;
+	}
+
+	Batch<SkinnedMesh>& batch = m_skinnedMeshBatches[std::make_pair(pMesh,pMaterial)] ;
+	batch.pMesh = pMesh ;
+	batch.pMaterial = pMaterial ;
+	batch.instances.emplace_back() ;
+	fillInstance( batch.instances.back(), worldMatrix, (float)bonesPaletteBase, color ) ;
+	m_numOfInstances++ ;
+}
+
+size_t InstancingManager::addBonesPalette( const std::vector<Matrix4>& bones )
+{
+	size_t base = m_bonesPalettes.size() ;
+	m_bonesPalettes.insert( m_bonesPalettes.end(), bones.begin(), bones.end() ) ;
+	return base ;
+}
+
+void InstancingManager::flush()
+{
+	m_numOfDrawCalls = 0 ;
+	if( m_numOfInstances == 0 ) {
+		return ;
+	}
+
+	JAM_PROFILE_GPU("InstancingManager.flush") ;
+	JAM_PROFILE_COUNTER("InstancingManager.instances", m_numOfInstances) ;
+
+	// gathers the instances of the whole frame into a single buffer, each batch is a contiguous range
+	m_instancesStaging.clear() ;
+	stage( m_meshBatches ) ;
+	stage( m_skinnedMeshBatches ) ;
+
+	if( m_maxTextureBufferTexels == 0 ) {
+		glGetIntegerv( GL_MAX_TEXTURE_BUFFER_SIZE, &m_maxTextureBufferTexels ) ;
+	}
+	JAM_ASSERT_MSG( m_instancesStaging.size() * INSTANCE_TEXELS <= (size_t)m_maxTextureBufferTexels, "Too many instances in a frame" ) ;
+
+	if( !m_instancesTex ) {
+		glGenTextures( 1, &m_instancesTex ) ;
+	}
+	uploadTextureBuffer( m_instancesVbo, m_instancesTex, m_instancesStaging.size() * sizeof(InstanceData), m_instancesStaging.data() ) ;
+	glActiveTexture( GL_TEXTURE0 + INSTANCE_DATA_TEXTURE_UNIT ) ;
+	glBindTexture( GL_TEXTURE_BUFFER, m_instancesTex ) ;
+
+	if( !m_bonesPalettes.empty() ) {
+		if( !m_bonesTex ) {
+			glGenTextures( 1, &m_bonesTex ) ;
+		}
+		uploadTextureBuffer( m_bonesVbo, m_bonesTex, m_bonesPalettes.size() * sizeof(Matrix4), m_bonesPalettes.data() ) ;
+		glActiveTexture( GL_TEXTURE0 + INSTANCE_BONES_TEXTURE_UNIT ) ;
+		glBindTexture( GL_TEXTURE_BUFFER, m_bonesTex ) ;
+	}
+
+	if( !m_meshBatches.empty() ) {
+		drawBatches( m_meshBatches ) ;
+	}
+	if( !m_skinnedMeshBatches.empty() ) {
+		drawBatches( m_skinnedMeshBatches ) ;
+	}
+
+	glActiveTexture( GL_TEXTURE0 + INSTANCE_BONES_TEXTURE_UNIT ) ;
+	glBindTexture( GL_TEXTURE_BUFFER, 0 ) ;
+	glActiveTexture( GL_TEXTURE0 + INSTANCE_DATA_TEXTURE_UNIT ) ;
+	glBindTexture( GL_TEXTURE_BUFFER, 0 ) ;
+	glActiveTexture( GL_TEXTURE0 ) ;
+
+	JAM_PROFILE_COUNTER("InstancingManager.drawCalls", m_numOfDrawCalls) ;
+	clear() ;
+}
+
+void InstancingManager::clear()
+{
+	// batches keep their storage, so that the next frame doesn't reallocate
+	for( auto& it : m_meshBatches ) {
+		it.second.instances.clear() ;
+	}
+	for( auto& it : m_skinnedMeshBatches ) {
+		it.second.instances.clear() ;
+	}
+	m_bonesPalettes.clear() ;
+	m_numOfInstances = 0 ;
+}
+
+void InstancingManager::fillInstance( InstanceData& out, const Matrix4& worldMatrix, float bonesPaletteBase, const Color& color )
+{
+	Matrix3 normalMatrix = computeNormalMatrix( worldMatrix ) ;
+
+	for( int i=0; i<4; i++ ) {
+		out.modelMatrix[i] = worldMatrix[i] ;
+	}
+	for( int i=0; i<3; i++ ) {
+		out.normalMatrix[i] = Vector4( normalMatrix[i], 0.0f ) ;
+	}
+	out.normalMatrix[0].w = bonesPaletteBase ;
+	out.color = color.getFloatingComponents() ;
+}
+
+void InstancingManager::uploadTextureBuffer( VertexBufferObject& vbo, GLuint tex, GLsizeiptr size, const void* data )
+{
+	vbo.bind() ;
+	// orphans the previous storage, so that we don't stall on the draws of the previous frame
+	vbo.bufferData( size, nullptr, GL_STREAM_DRAW ) ;
+	vbo.bufferData( size, data, GL_STREAM_DRAW ) ;
+	vbo.unbind() ;
+
+	glBindTexture( GL_TEXTURE_BUFFER, tex ) ;
+	glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, vbo.getId() ) ;
+	glBindTexture( GL_TEXTURE_BUFFER, 0 ) ;
+}
+
+void InstancingManager::prepareProgram( Shader* pShader )
+{
+	pShader->use() ;
+
+	Camera* pCam = GetAppMgr().getScene()->getCamera() ;
+	if( pCam ) {
+		GetSharedUniforms().setView( pCam ) ;
+	}
+	GetLightMgr().prepare( pCam ) ;
+
+	pShader->setUniformSafe( JAM_PROGRAM_UNIFORM_INSTANCE_DATA, INSTANCE_DATA_TEXTURE_UNIT ) ;
+	pShader->setUniformSafe( JAM_PROGRAM_UNIFORM_INSTANCE_BONES, INSTANCE_BONES_TEXTURE_UNIT ) ;
+}
+
+template<typename T>
+void InstancingManager::stage( BatchesMap<T>& batches )
+{
+	for( auto it = batches.begin(); it != batches.end(); ) {
+		Batch<T>& batch = it->second ;
+		if( batch.instances.empty() ) {
+			// the pair has not been used in this frame
+			it = batches.erase(it) ;
+			continue ;
+		}
+		batch.base = m_instancesStaging.size() ;
+		m_instancesStaging.insert( m_instancesStaging.end(), batch.instances.begin(), batch.instances.end() ) ;
+		++it ;
+	}
+}
+
+Shader* InstancingManager::getInstancedProgram( Mesh* pMesh, Material* pMaterial )
+{
+	// as the non instanced path, the program follows the material: normal mapping needs both the normal map and the tangents
+	bool normalMapping = pMaterial && pMaterial->getShader() == GetShaderMgr().getNormalMapping() &&
+						 pMaterial->getNormalTexture() && !pMesh->isTangentsDisabled() ;
+	return normalMapping ? GetShaderMgr().getInstancedNormalMapping() : GetShaderMgr().getInstancedLit() ;
+}
+
+Shader* InstancingManager::getInstancedProgram( SkinnedMesh*, Material* )
+{
+	return GetShaderMgr().getInstancedSkinningLit() ;
+}
+
+template<typename T>
+void InstancingManager::drawBatches( BatchesMap<T>& batches )
+{
+	m_batchPrograms.clear() ;
+	for( auto& it : batches ) {
+		Batch<T>& batch = it.second ;
+		batch.pShader = getInstancedProgram( batch.pMesh, batch.pMaterial ) ;
+		if( std::find( m_batchPrograms.begin(), m_batchPrograms.end(), batch.pShader ) == m_batchPrograms.end() ) {
+			m_batchPrograms.push_back( batch.pShader ) ;
+		}
+
+		// meshes have to be uploaded before setting the uniforms, since upload may change the current program
+		batch.pShader->use() ;
+		batch.pMesh->upload() ;
+	}
+
+	// batches are drawn grouped by program, so that each program is prepared once
+	for( Shader* pShader : m_batchPrograms ) {
+		prepareProgram( pShader ) ;
+
+		for( auto& it : batches ) {
+			Batch<T>& batch = it.second ;
+			if( batch.pShader != pShader ) {
+				continue ;
+			}
+			pShader->setUniformSafe( JAM_PROGRAM_UNIFORM_INSTANCE_BASE, (GLint)batch.base ) ;
+			batch.pMesh->drawInstanced( batch.instances.size(), pShader, batch.pMaterial ) ;
+			m_numOfDrawCalls++ ;
+		}
+	}
+}
+
+}
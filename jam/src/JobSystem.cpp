@@ -0,0 +1,241 @@
+/**********************************************************************************
+* 
+* JobSystem.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include <jam/JobSystem.h>
+
+#include <algorithm>
+
+namespace jam
+{
+
+// index of the queue owned by the calling thread, 0 for the main thread
+static thread_local size_t t_threadIndex = JobSystem::INVALID_THREAD_INDEX ;
+
+//*******************
+//
+// Class JobSystem
+//
+//*******************
+
+JobSystem::JobSystem() :
+	m_queues(),
+	m_workers(),
+	m_pending(),
+	m_numOfQueuedJobs(0),
+	m_quit(false)
+{
+	// hardware_concurrency() can return 0 when the value is not computable
+	size_t numOfThreads = (size_t)std::thread::hardware_concurrency() ;
+	numOfThreads = std::min( std::max( numOfThreads, (size_t)1 ), (size_t)JAM_MAX_JOB_THREADS ) ;
+
+	for( size_t i=0; i<numOfThreads; i++ ) {
+		m_queues.push_back( new WorkQueue() ) ;
+	}
+
+	// queue 0 belongs to the main thread, which is the one creating the job system
+	t_threadIndex = 0 ;
+	for( size_t i=1; i<numOfThreads; i++ ) {
+		m_workers.push_back( std::thread( &JobSystem::workerMain, this, i ) ) ;
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex) ;
+		m_quit = true ;
+	}
+	m_sleepCondition.notify_all() ;
+
+	for( auto& worker : m_workers ) {
+		worker.join() ;
+	}
+
+	for( auto pQueue : m_queues ) {
+		delete pQueue ;
+	}
+}
+
+void JobSystem::run( const JobFunction& job, JobCounter& counter )
+{
+	counter.m_value.fetch_add( 1, std::memory_order_relaxed ) ;
+	push( Job{job,&counter} ) ;
+}
+
+void JobSystem::run( const JobFunction& job, JobCounter& counter, const JobCounter& dependency )
+{
+	counter.m_value.fetch_add( 1, std::memory_order_relaxed ) ;
+
+	{
+		// checked under lock, so the completion of dependency cannot miss the parked job
+		std::lock_guard<std::mutex> lock(m_pendingMutex) ;
+		if( !dependency.isDone() ) {
+			m_pending.push_back( PendingJob{ Job{job,&counter}, &dependency } ) ;
+			return ;
+		}
+	}
+
+	push( Job{job,&counter} ) ;
+}
+
+void JobSystem::wait( const JobCounter& counter )
+{
+	size_t threadIndex = t_threadIndex ;
+	JAM_ASSERT_MSG( threadIndex != INVALID_THREAD_INDEX, "Only the main thread and the jobs can wait on a counter" ) ;
+	while( !counter.isDone() ) {
+		Job job ;
+		if( pop(threadIndex,job) ) {
+			execute( job ) ;
+		}
+		else {
+			std::this_thread::yield() ;
+		}
+	}
+}
+
+void JobSystem::parallelFor( size_t count, size_t grainSize, const JobRangeFunction& func )
+{
+	// func may index per thread data by getThreadIndex(), even when it runs inline
+	JAM_ASSERT_MSG( t_threadIndex != INVALID_THREAD_INDEX, "Only the main thread and the jobs can run a parallel for" ) ;
+	if( count == 0 ) {
+		return ;
+	}
+
+	grainSize = std::max( grainSize, (size_t)1 ) ;
+	if( m_queues.size() == 1 || count <= grainSize ) {
+		func( 0, count ) ;
+		return ;
+	}
+
+	JobCounter counter ;
+	for( size_t begin = grainSize; begin < count; begin += grainSize ) {
+		size_t end = std::min( begin + grainSize, count ) ;
+		run( [&func,begin,end]() { func(begin,end) ; }, counter ) ;
+	}
+
+	// the calling thread takes the first chunk, then helps with the others
+	func( 0, grainSize ) ;
+	wait( counter ) ;
+}
+
+size_t JobSystem::getThreadIndex()
+{
+	return t_threadIndex ;
+}
+
+void JobSystem::push( const Job& job )
+{
+	JAM_ASSERT_MSG( t_threadIndex != INVALID_THREAD_INDEX, "Only the main thread and the jobs can queue jobs" ) ;
+	WorkQueue* pQueue = m_queues[t_threadIndex] ;
+	{
+		std::lock_guard<std::mutex> lock(pQueue->mutex) ;
+		pQueue->jobs.push_back( job ) ;
+		m_numOfQueuedJobs.fetch_add( 1, std::memory_order_release ) ;
+	}
+
+	// notify under lock, otherwise a worker could test the predicate and sleep right after the notification
+	std::lock_guard<std::mutex> lock(m_sleepMutex) ;
+	m_sleepCondition.notify_one() ;
+}
+
+bool JobSystem::pop( size_t threadIndex, Job& job )
+{
+	size_t numOfQueues = m_queues.size() ;
+
+	// own queue first, newest job (its data is likely still in cache)
+	{
+		WorkQueue* pQueue = m_queues[threadIndex] ;
+		std::lock_guard<std::mutex> lock(pQueue->mutex) ;
+		if( !pQueue->jobs.empty() ) {
+			job = std::move( pQueue->jobs.back() ) ;
+			pQueue->jobs.pop_back() ;
+			m_numOfQueuedJobs.fetch_sub( 1, std::memory_order_relaxed ) ;
+			return true ;
+		}
+	}
+
+	// steal the oldest job of another thread
+	for( size_t k=1; k<numOfQueues; k++ ) {
+		WorkQueue* pQueue = m_queues[(threadIndex + k) % numOfQueues] ;
+		std::lock_guard<std::mutex> lock(pQueue->mutex) ;
+		if( !pQueue->jobs.empty() ) {
+			job = std::move( pQueue->jobs.front() ) ;
+			pQueue->jobs.pop_front() ;
+			m_numOfQueuedJobs.fetch_sub( 1, std::memory_order_relaxed ) ;
+			return true ;
+		}
+	}
+
+	return false ;
+}
+
+void JobSystem::execute( Job& job )
+{
+	job.function() ;
+
+	// the last job of a group releases the jobs depending on it
+	if( job.pCounter->m_value.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+		schedulePending() ;
+	}
+}
+
+void JobSystem::schedulePending()
+{
+	std::lock_guard<std::mutex> lock(m_pendingMutex) ;
+	for( size_t i=0; i<m_pending.size(); ) {
+		if( m_pending[i].pDependency->isDone() ) {
+			push( m_pending[i].job ) ;
+			m_pending[i] = m_pending.back() ;
+			m_pending.pop_back() ;
+		}
+		else {
+			i++ ;
+		}
+	}
+}
+
+void JobSystem::workerMain( size_t threadIndex )
+{
+	t_threadIndex = threadIndex ;
+
+	while( !m_quit ) {
+		Job job ;
+		if( pop(threadIndex,job) ) {
+			execute( job ) ;
+			continue ;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex) ;
+		m_sleepCondition.wait( lock, [this]() { return m_quit || m_numOfQueuedJobs.load(std::memory_order_acquire) > 0 ; } ) ;
+	}
+}
+
+}
@@ -31,6 +31,12 @@
 
 #include <jam/Light.h>
 #include <jam/Shader.h>
+#include <jam/Camera.h>
+#include <jam/FrameAllocator.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 namespace jam
 {
@@ -58,39 +64,8 @@ namespace jam
 
 	void Light::update( int16_t idx )
 	{
-		static char uniformName[64] = { 0 } ;
-		Shader* pShader = GetShaderMgr().getCurrent() ;
-
-		sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_TYPE, idx ) ;
-		if( pShader->uniformLocation(uniformName) >= 0 ) {
-			pShader->setUniform(uniformName, (int32_t)m_type) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_POSITION, idx ) ;
-			pShader->setUniform(uniformName, m_position) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_DIRECTION, idx ) ;
-			pShader->setUniform(uniformName, m_direction ) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_CONSTANT, idx ) ;
-			pShader->setUniform(uniformName, m_constant) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_LINEAR, idx ) ;
-			pShader->setUniform(uniformName, m_linear) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_QUADRATIC, idx ) ;
-			pShader->setUniform(uniformName, m_quadratic) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_AMBIENT, idx ) ;
-			Vector3 ambient = Vector3(m_ambient.getFloatingComponents()) ;
-			//JAM_TRACE( "%d %d %d\n", m_ambient.r, m_ambient.g, m_ambient.b ) ;
-			pShader->setUniform(uniformName, ambient ) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_DIFFUSE, idx ) ;
-			pShader->setUniform(uniformName, Vector3(m_diffuse.getFloatingComponents()) ) ;
-
-			sprintf( uniformName, JAM_PROGRAM_UNIFORM_LIGHT_SPECULAR, idx ) ;
-			pShader->setUniform(uniformName, Vector3(m_specular.getFloatingComponents()) ) ;
-		}
+		// lights are shared by all the programs through the LightsBlock uniform block
+		GetLightMgr().setActiveLight( (size_t)idx, this ) ;
 	}
 
 	void Light::dump()
@@ -160,4 +135,277 @@ namespace jam
 		m_specular = specular ;
 	}
 
+	float Light::getRange() const
+	{
+		// solves intensity / (constant + linear*d + quadratic*d^2) = 1/256 for the brightest diffuse component
+		Vector4 diffuse = m_diffuse.getFloatingComponents() ;
+		float threshold = 256.0f * std::max( diffuse.r, std::max(diffuse.g, diffuse.b) ) ;
+		if( m_quadratic > 0.0f ) {
+			float delta = m_linear * m_linear - 4.0f * m_quadratic * (m_constant - threshold) ;
+			return delta > 0.0f ? (-m_linear + std::sqrt(delta)) / (2.0f * m_quadratic) : 0.0f ;
+		}
+		if( m_linear > 0.0f ) {
+			return std::max( (threshold - m_constant) / m_linear, 0.0f ) ;
+		}
+		// not attenuated
+		return FLT_MAX ;
+	}
+
+
+	//*******************
+	//
+	// Class LightManager
+	//
+	//*******************
+
+	static int toCluster( float v, int numOfClusters )
+	{
+		return std::min( std::max( (int)std::floor(v), 0 ), numOfClusters - 1 ) ;
+	}
+
+	LightManager::LightManager() :
+		NamedObjectManager<Light>(),
+		m_activeLights(),
+		m_block(),
+		m_lightClusters(),
+		m_grid(),
+		m_blockUbo(GL_UNIFORM_BUFFER),
+		m_gridVbo(GL_TEXTURE_BUFFER),
+		m_gridTex(0),
+		m_pPackedCamera(0),
+		m_dirty(true)
+	{
+	}
+
+	LightManager::~LightManager()
+	{
+		if( m_gridTex ) {
+			glDeleteTextures( 1, &m_gridTex ) ;
+		}
+	}
+
+	void LightManager::addActiveLight( Light* pLight )
+	{
+		JAM_ASSERT_MSG( m_activeLights.size() < JAM_LIGHTS_MAX, "Too many active lights" ) ;
+		m_activeLights.push_back( Ref<Light>(pLight,true) ) ;
+		m_dirty = true ;
+	}
+
+	void LightManager::removeActiveLight( Light* pLight )
+	{
+		for( size_t i=0; i<m_activeLights.size(); i++ ) {
+			if( m_activeLights[i].get() == pLight ) {
+				m_activeLights.erase( m_activeLights.begin() + i ) ;
+				m_dirty = true ;
+				return ;
+			}
+		}
+	}
+
+	void LightManager::setActiveLight( size_t idx, Light* pLight )
+	{
+		JAM_ASSERT_MSG( idx < JAM_LIGHTS_MAX, "Too many active lights" ) ;
+		if( idx >= m_activeLights.size() ) {
+			m_activeLights.resize( idx + 1 ) ;
+		}
+		if( m_activeLights[idx].get() != pLight ) {
+			m_activeLights[idx] = Ref<Light>(pLight,true) ;
+			m_dirty = true ;
+		}
+	}
+
+	void LightManager::clearActiveLights()
+	{
+		m_activeLights.clear() ;
+		m_dirty = true ;
+	}
+
+	void LightManager::newFrame()
+	{
+		m_dirty = true ;
+	}
+
+	void LightManager::prepare( Camera* pCam )
+	{
+		// the buffers are only refilled, their bindings are global and set once per frame by bind()
+		if( m_dirty || pCam != m_pPackedCamera ) {
+			pack( pCam ) ;
+			upload() ;
+			m_pPackedCamera = pCam ;
+			m_dirty = false ;
+		}
+	}
+
+	void LightManager::bind( Camera* pCam )
+	{
+		prepare( pCam ) ;
+
+		glBindBufferBase( GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING, m_blockUbo.getId() ) ;
+		glActiveTexture( GL_TEXTURE0 + GRID_TEXTURE_UNIT ) ;
+		glBindTexture( GL_TEXTURE_BUFFER, m_gridTex ) ;
+		glActiveTexture( GL_TEXTURE0 ) ;
+	}
+
+	void LightManager::pack( Camera* pCam )
+	{
+		JAM_PROFILE("LightManager.pack") ;
+
+		const int numOfClusters = JAM_LIGHTS_CLUSTERS_X * JAM_LIGHTS_CLUSTERS_Y * JAM_LIGHTS_CLUSTERS_Z ;
+
+		Matrix4 view = pCam ? pCam->getViewMatrix() : Matrix4(1.0f) ;
+		Matrix4 proj = pCam ? pCam->getProjectionMatrix() : Matrix4(1.0f) ;
+		// exponential slices need a positive near plane, e.g. orthographic cameras may have a negative one
+		float zNear = pCam ? std::max( pCam->getZNear(), 0.01f ) : 0.01f ;
+		float zFar = pCam ? std::max( pCam->getZFar(), zNear * 2.0f ) : 1.0f ;
+
+		GLint viewport[4] ;
+		glGetIntegerv( GL_VIEWPORT, viewport ) ;
+
+		m_block.lightsInfo[1] = JAM_LIGHTS_CLUSTERS_X ;
+		m_block.lightsInfo[2] = JAM_LIGHTS_CLUSTERS_Y ;
+		m_block.lightsInfo[3] = JAM_LIGHTS_CLUSTERS_Z ;
+		m_block.clusterParams = Vector4( zNear, JAM_LIGHTS_CLUSTERS_Z / std::log(zFar / zNear), 0.0f, 0.0f ) ;
+		m_block.clusterViewport = Vector4( (float)viewport[0], (float)viewport[1], (float)viewport[2], (float)viewport[3] ) ;
+		m_block.clusterView = view ;
+
+		// directional lights come first, they light every cluster
+		size_t numOfLights = 0 ;
+		for( auto& rLight : m_activeLights ) {
+			if( rLight && rLight->getType() == Light::Type::DIRECTIONAL ) {
+				packLight( m_block.lights[numOfLights++], rLight.get() ) ;
+			}
+		}
+		m_block.lightsInfo[0] = (I32)numOfLights ;
+
+		// point lights are binned by the clusters their bounding sphere overlaps,
+		// spot lights are not supported by the lit shaders yet
+		m_lightClusters.clear() ;
+		for( auto& rLight : m_activeLights ) {
+			if( rLight && rLight->getType() == Light::Type::POINT ) {
+				LightClusters clusters ;
+				if( computeClusters( clusters, rLight.get(), view, proj, zNear, zFar ) ) {
+					clusters.light = (U16)numOfLights ;
+					packLight( m_block.lights[numOfLights++], rLight.get() ) ;
+					m_lightClusters.push_back( clusters ) ;
+				}
+			}
+		}
+
+		// counts the lights of each cluster, then turns the counts into offsets
+		m_grid.assign( numOfClusters, 0 ) ;
+		for( const LightClusters& lc : m_lightClusters ) {
+			for( int z=lc.minZ; z<=lc.maxZ; z++ ) {
+				for( int y=lc.minY; y<=lc.maxY; y++ ) {
+					for( int x=lc.minX; x<=lc.maxX; x++ ) {
+						m_grid[(z * JAM_LIGHTS_CLUSTERS_Y + y) * JAM_LIGHTS_CLUSTERS_X + x]++ ;
+					}
+				}
+			}
+		}
+
+		const U32 maxOffset = numOfClusters + JAM_LIGHTS_MAX_INDICES ;
+		U32 offset = numOfClusters ;
+		for( int i=0; i<numOfClusters; i++ ) {
+			// lights beyond the indices budget are dropped
+			U32 count = std::min( m_grid[i], maxOffset - offset ) ;
+			m_grid[i] = (offset << 16) | count ;
+			offset += count ;
+		}
+		JAM_PROFILE_COUNTER( "LightManager.lightIndices", offset - numOfClusters ) ;
+
+		// fills the light indices of each cluster
+		m_grid.resize( offset ) ;
+		FrameVector<U16> filled( numOfClusters, 0 ) ;
+		for( const LightClusters& lc : m_lightClusters ) {
+			for( int z=lc.minZ; z<=lc.maxZ; z++ ) {
+				for( int y=lc.minY; y<=lc.maxY; y++ ) {
+					for( int x=lc.minX; x<=lc.maxX; x++ ) {
+						int cluster = (z * JAM_LIGHTS_CLUSTERS_Y + y) * JAM_LIGHTS_CLUSTERS_X + x ;
+						U32 header = m_grid[cluster] ;
+						if( filled[cluster] < (header & 0xFFFF) ) {
+							m_grid[(header >> 16) + filled[cluster]++] = lc.light ;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void LightManager::packLight( LightData& out, const Light* pLight )
+	{
+		Vector4 ambient = pLight->getAmbientColor().getFloatingComponents() ;
+		Vector4 diffuse = pLight->getDiffuseColor().getFloatingComponents() ;
+		Vector4 specular = pLight->getSpecularColor().getFloatingComponents() ;
+
+		out.positionType = Vector4( pLight->getPosition(), (float)pLight->getType() ) ;
+		out.directionRange = Vector4( pLight->getDirection(), pLight->getRange() ) ;
+		out.ambientConstant = Vector4( Vector3(ambient), pLight->getConstantAttenuationFactor() ) ;
+		out.diffuseLinear = Vector4( Vector3(diffuse), pLight->getLinearAttenuationFactor() ) ;
+		out.specularQuadratic = Vector4( Vector3(specular), pLight->getQuadraticAttenuationFactor() ) ;
+	}
+
+	bool LightManager::computeClusters( LightClusters& out, const Light* pLight, const Matrix4& view, const Matrix4& proj, float zNear, float zFar )
+	{
+		float range = pLight->getRange() ;
+		Vector3 center = Vector3( view * Vector4(pLight->getPosition(), 1.0f) ) ;
+		float depth = -center.z ;
+		if( range <= 0.0f || depth + range < zNear || depth - range > zFar ) {
+			return false ;
+		}
+
+		// slice = log(depth/near) * slices / log(far/near)
+		float sliceScale = m_block.clusterParams.y ;
+		out.minZ = (U8)toCluster( std::log(std::max(depth - range, zNear) / zNear) * sliceScale, JAM_LIGHTS_CLUSTERS_Z ) ;
+		out.maxZ = (U8)toCluster( std::log(std::min(depth + range, zFar) / zNear) * sliceScale, JAM_LIGHTS_CLUSTERS_Z ) ;
+
+		if( depth - range <= zNear ) {
+			// the sphere crosses the near plane, so it may cover the whole screen
+			out.minX = out.minY = 0 ;
+			out.maxX = JAM_LIGHTS_CLUSTERS_X - 1 ;
+			out.maxY = JAM_LIGHTS_CLUSTERS_Y - 1 ;
+			return true ;
+		}
+
+		// the projected corners of the view space box around the sphere bound the light on screen
+		Vector2 minNdc( FLT_MAX, FLT_MAX ) ;
+		Vector2 maxNdc( -FLT_MAX, -FLT_MAX ) ;
+		for( int i=0; i<8; i++ ) {
+			Vector3 corner = center + Vector3( (i & 1) ? range : -range, (i & 2) ? range : -range, (i & 4) ? range : -range ) ;
+			Vector4 clip = proj * Vector4( corner, 1.0f ) ;
+			Vector2 ndc = Vector2(clip) / clip.w ;
+			minNdc = glm::min( minNdc, ndc ) ;
+			maxNdc = glm::max( maxNdc, ndc ) ;
+		}
+		if( maxNdc.x < -1.0f || minNdc.x > 1.0f || maxNdc.y < -1.0f || minNdc.y > 1.0f ) {
+			return false ;
+		}
+
+		out.minX = (U8)toCluster( (minNdc.x * 0.5f + 0.5f) * JAM_LIGHTS_CLUSTERS_X, JAM_LIGHTS_CLUSTERS_X ) ;
+		out.maxX = (U8)toCluster( (maxNdc.x * 0.5f + 0.5f) * JAM_LIGHTS_CLUSTERS_X, JAM_LIGHTS_CLUSTERS_X ) ;
+		out.minY = (U8)toCluster( (minNdc.y * 0.5f + 0.5f) * JAM_LIGHTS_CLUSTERS_Y, JAM_LIGHTS_CLUSTERS_Y ) ;
+		out.maxY = (U8)toCluster( (maxNdc.y * 0.5f + 0.5f) * JAM_LIGHTS_CLUSTERS_Y, JAM_LIGHTS_CLUSTERS_Y ) ;
+		return true ;
+	}
+
+	void LightManager::upload()
+	{
+		// orphans the previous storage, so that we don't stall on the draws of the previous frame
+		m_blockUbo.bind() ;
+		m_blockUbo.bufferData( sizeof(LightsBlock), nullptr, GL_STREAM_DRAW ) ;
+		m_blockUbo.bufferData( sizeof(LightsBlock), &m_block, GL_STREAM_DRAW ) ;
+		m_blockUbo.unbind() ;
+
+		m_gridVbo.bind() ;
+		m_gridVbo.bufferData( m_grid.size() * sizeof(U32), nullptr, GL_STREAM_DRAW ) ;
+		m_gridVbo.bufferData( m_grid.size() * sizeof(U32), m_grid.data(), GL_STREAM_DRAW ) ;
+		m_gridVbo.unbind() ;
+
+		if( !m_gridTex ) {
+			glGenTextures( 1, &m_gridTex ) ;
+		}
+		glBindTexture( GL_TEXTURE_BUFFER, m_gridTex ) ;
+		glTexBuffer( GL_TEXTURE_BUFFER, GL_R32UI, m_gridVbo.getId() ) ;
+		glBindTexture( GL_TEXTURE_BUFFER, 0 ) ;
+	}
+
 }
@@ -256,6 +256,11 @@ namespace jam
 	}
 	
 	void Material::bind()
+	{
+		bind( getShader() ) ;
+	}
+
+	void Material::bind( Shader* pProgram )
 	{
 		static char uniformName[64] = { 0 } ;
 
@@ -268,7 +273,6 @@ namespace jam
 			glDisable(GL_DEPTH_TEST) ;
 		}
 
-		Shader* pProgram = getShader() ;
 		pProgram->use();
 
 		GLint shininessLocIdx = pProgram->uniformLocation(JAM_PROGRAM_UNIFORM_MATERIAL_SHININESS) ;
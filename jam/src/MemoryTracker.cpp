@@ -0,0 +1,277 @@
+/**********************************************************************************
+* 
+* MemoryTracker.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/MemoryTracker.h"
+#include "jam/RefCountedObject.h"
+#include "jam/core/bmkextras.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace jam
+{
+
+struct TrackedBlock {
+	size_t					size ;
+	uint64_t				frame ;			// frame of the allocation
+	RefCountedObject*		pObj ;			// first object constructed in the block, i.e. the allocated one
+	const std::type_info*	pType ;			// set by release(), just before the deletion
+};
+
+struct TrackedType {
+	uint64_t				released ;
+	uint64_t				frameReleased ;	// released objects allocated in frame
+	uint64_t				frame ;
+};
+
+struct MemoryTrackerState {
+	std::mutex									mutex ;
+	std::map<const U8*,TrackedBlock>			blocks ;		// ordered, to find the block containing an object
+	std::unordered_map<std::type_index,TrackedType>	types ;
+	MemoryStats									stats ;
+	uint64_t									frame ;
+	uint64_t									frameAllocations ;
+	uint64_t									frameBytes ;
+
+	MemoryTrackerState() : mutex(), blocks(), types(), stats(), frame(0), frameAllocations(0), frameBytes(0) {}
+};
+
+//*******************
+//
+// Helpers
+//
+//*******************
+
+// objects can be allocated by static constructors and released by static destructors, so the state is never destroyed
+static MemoryTrackerState& getState()
+{
+	static MemoryTrackerState* s_pState = new MemoryTrackerState() ;
+	return *s_pState ;
+}
+
+static std::map<const U8*,TrackedBlock>::iterator findBlock( MemoryTrackerState& state, const void* p )
+{
+	auto it = state.blocks.upper_bound( (const U8*)p ) ;
+	if( it == state.blocks.begin() ) {
+		return state.blocks.end() ;
+	}
+	--it ;
+	return ((const U8*)p < it->first + it->second.size) ? it : state.blocks.end() ;
+}
+
+//*******************
+//
+// Class MemoryTracker
+//
+//*******************
+
+bool MemoryTracker::isEnabled()
+{
+#ifdef JAM_MEMORY_TRACKING
+	return true ;
+#else
+	return false ;
+#endif
+}
+
+void MemoryTracker::newFrame()
+{
+	if( !isEnabled() ) {
+		return ;
+	}
+
+	MemoryTrackerState& state = getState() ;
+	std::unique_lock<std::mutex> lock(state.mutex) ;
+	state.stats.frameAllocations = state.frameAllocations ;
+	state.stats.frameBytes = state.frameBytes ;
+	state.frameAllocations = 0 ;
+	state.frameBytes = 0 ;
+	state.frame++ ;
+	MemoryStats stats = state.stats ;
+	lock.unlock() ;
+
+	JAM_PROFILE_COUNTER( "MemoryTracker.frameAllocations", stats.frameAllocations ) ;
+	JAM_PROFILE_COUNTER( "MemoryTracker.liveBytes", stats.liveBytes ) ;
+}
+
+void MemoryTracker::getStats( MemoryStats& stats )
+{
+	MemoryTrackerState& state = getState() ;
+	std::lock_guard<std::mutex> lock(state.mutex) ;
+	stats = state.stats ;
+}
+
+void MemoryTracker::getTypeStats( std::vector<ObjectTypeStats>& stats )
+{
+	stats.clear() ;
+
+	MemoryTrackerState& state = getState() ;
+	std::lock_guard<std::mutex> lock(state.mutex) ;
+
+	std::unordered_map<std::type_index,size_t> indices ;
+	auto typeStats = [&]( std::type_index type ) -> ObjectTypeStats& {
+		auto it = indices.insert( std::make_pair( type, stats.size() ) ).first ;
+		if( it->second == stats.size() ) {
+			ObjectTypeStats s ;
+			s.name = type.name() ;
+			s.liveObjects = 0 ;
+			s.liveBytes = 0 ;
+			s.released = 0 ;
+			s.frameAllocations = 0 ;
+			stats.push_back( s ) ;
+		}
+		return stats[it->second] ;
+	} ;
+
+	for( const auto& it : state.blocks ) {
+		const TrackedBlock& block = it.second ;
+		// a block whose object is still being constructed has no type yet
+		if( !block.pObj ) {
+			continue ;
+		}
+		ObjectTypeStats& s = typeStats( std::type_index(typeid(*block.pObj)) ) ;
+		s.liveObjects++ ;
+		s.liveBytes += block.size ;
+		if( block.frame == state.frame ) {
+			s.frameAllocations++ ;
+		}
+	}
+
+	for( const auto& it : state.types ) {
+		const TrackedType& type = it.second ;
+		ObjectTypeStats& s = typeStats( it.first ) ;
+		s.released = type.released ;
+		if( type.frame == state.frame ) {
+			s.frameAllocations += type.frameReleased ;
+		}
+	}
+
+	std::sort( stats.begin(), stats.end(), []( const ObjectTypeStats& a, const ObjectTypeStats& b ) {
+		return a.liveBytes != b.liveBytes ? a.liveBytes > b.liveBytes : strcmp( a.name, b.name ) < 0 ;
+	} ) ;
+}
+
+void MemoryTracker::dump()
+{
+	MemoryStats stats ;
+	getStats( stats ) ;
+	std::vector<ObjectTypeStats> typeStats ;
+	getTypeStats( typeStats ) ;
+
+	JAM_TRACE( "--------- memory ---------" ) ;
+	JAM_TRACE( "live objects: %d, live bytes: %d, peak bytes: %d, allocations: %d",
+		(int)stats.liveObjects, (int)stats.liveBytes, (int)stats.peakLiveBytes, (int)stats.allocations ) ;
+	for( const ObjectTypeStats& s : typeStats ) {
+		JAM_TRACE( "%.160s: live %d (%d bytes), released %d",
+			s.name, (int)s.liveObjects, (int)s.liveBytes, (int)s.released ) ;
+	}
+}
+
+void MemoryTracker::trackAllocation( void* p, size_t size )
+{
+	MemoryTrackerState& state = getState() ;
+	std::lock_guard<std::mutex> lock(state.mutex) ;
+
+	TrackedBlock block ;
+	block.size = size ;
+	block.frame = state.frame ;
+	block.pObj = nullptr ;
+	block.pType = nullptr ;
+	state.blocks[(const U8*)p] = block ;
+
+	state.stats.liveObjects++ ;
+	state.stats.liveBytes += size ;
+	state.stats.peakLiveBytes = Max( state.stats.peakLiveBytes, state.stats.liveBytes ) ;
+	state.stats.allocations++ ;
+	state.frameAllocations++ ;
+	state.frameBytes += size ;
+}
+
+void MemoryTracker::trackDeallocation( void* p )
+{
+	MemoryTrackerState& state = getState() ;
+	std::lock_guard<std::mutex> lock(state.mutex) ;
+
+	auto it = state.blocks.find( (const U8*)p ) ;
+	if( it == state.blocks.end() ) {
+		return ;
+	}
+
+	const TrackedBlock& block = it->second ;
+	state.stats.liveObjects-- ;
+	state.stats.liveBytes -= block.size ;
+
+	if( block.pType ) {
+		TrackedType& type = state.types[std::type_index(*block.pType)] ;
+		type.released++ ;
+		if( type.frame != state.frame ) {
+			type.frame = state.frame ;
+			type.frameReleased = 0 ;
+		}
+		if( block.frame == state.frame ) {
+			type.frameReleased++ ;
+		}
+	}
+
+	state.blocks.erase( it ) ;
+}
+
+void MemoryTracker::trackConstruction( RefCountedObject* pObj )
+{
+	MemoryTrackerState& state = getState() ;
+	std::lock_guard<std::mutex> lock(state.mutex) ;
+
+	// objects on the stack or members of other objects are not in a block, or their block is already bound
+	auto it = findBlock( state, pObj ) ;
+	if( it != state.blocks.end() && !it->second.pObj ) {
+		it->second.pObj = pObj ;
+	}
+}
+
+void MemoryTracker::trackRelease( RefCountedObject* pObj )
+{
+	const std::type_info& type = typeid(*pObj) ;
+
+	MemoryTrackerState& state = getState() ;
+	std::lock_guard<std::mutex> lock(state.mutex) ;
+
+	auto it = findBlock( state, pObj ) ;
+	if( it != state.blocks.end() && it->second.pObj == pObj ) {
+		it->second.pType = &type ;
+	}
+}
+
+}
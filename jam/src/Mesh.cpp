@@ -53,10 +53,14 @@ Mesh::Mesh() :
 	m_vbos(),
 	m_elementsVbo(),
 	m_vao(),
+	m_numOfElements(0),
 	m_uploaded(false),
 	m_tangentsDisabled(true),
 	m_needsCalculateTangents(true)
 {
+	// buffers and vertex array can be deleted only by the main thread
+	setRefCountPolicy( RefCountPolicy::Deferred ) ;
+
 	m_pMaterial = new Material() ;
 	for( size_t i=0; i<m_vbos.length()-1; i++ ) {
 		m_vbos[i].setTarget(GL_ARRAY_BUFFER) ;
@@ -164,6 +168,57 @@ void Mesh::upload()
 	m_vbos[vboIdx].unbind() ;
 	m_elementsVbo.unbind() ;
 
+	m_numOfElements = m_elements.length() ;
+	m_uploaded = true ;
+}
+
+/**
+	Uploads an interleaved vertex stream and its indices straight to GPU memory
+	\remark no copy is kept in the cpu-side arrays, so the source buffers can be released right after the call
+*/
+void Mesh::uploadInterleaved( const MeshVertex* pVertices, size_t numOfVertices, const U16* pElements, size_t numOfElements )
+{
+	if( m_uploaded ) {
+		return ;
+	}
+
+	Shader* pShader = m_pMaterial->getShader() ;
+	pShader->use();
+
+	m_vbos[0].create() ;
+	m_elementsVbo.create() ;
+	m_vao.create() ;
+
+	// bind vao
+	// all glBindBuffer, glVertexAttribPointer, and glEnableVertexAttribArray calls are tracked and stored in the vao
+	m_vao.bind() ;
+
+	GLsizei stride = sizeof(MeshVertex) ;
+	m_vbos[0].bind() ;
+	m_vbos[0].bufferData( numOfVertices * stride, pVertices ) ;
+	pShader->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(MeshVertex,position)) ;
+	pShader->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_POSITION) ;
+	pShader->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(MeshVertex,normal)) ;
+	pShader->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_NORMAL) ;
+	pShader->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_TEXCOORDS, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(MeshVertex,texCoords)) ;
+	pShader->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_TEXCOORDS) ;
+	if( !m_tangentsDisabled ) {
+		pShader->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_TANGENT, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(MeshVertex,tangent)) ;
+		pShader->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_TANGENT) ;
+	}
+
+	// upload indices
+	m_elementsVbo.bind() ;
+	m_elementsVbo.bufferData( numOfElements * sizeof(U16), pElements ) ;
+
+	// unbind vao
+ 	m_vao.unbind() ;
+
+	m_vbos[0].unbind() ;
+	m_elementsVbo.unbind() ;
+
+	m_numOfElements = numOfElements ;
+	m_needsCalculateTangents = false ;
 	m_uploaded = true ;
 }
 
@@ -172,7 +227,19 @@ void Mesh::draw()
 	if( !isUploaded() ) {
 		upload() ;
 	}
-	GetGfx().drawIndexedPrimitive( &m_vao, getElementsArray().length(), m_pMaterial ) ;
+	GetGfx().drawIndexedPrimitive( &m_vao, m_numOfElements, m_pMaterial ) ;
+}
+
+/**
+	Draws numOfInstances copies of the mesh with a single draw call, using the given instancing program
+	\remark if pMaterial is null the mesh material is used
+*/
+void Mesh::drawInstanced( size_t numOfInstances, Shader* pShader, Material* pMaterial /*= nullptr*/ )
+{
+	if( !isUploaded() ) {
+		upload() ;
+	}
+	GetGfx().drawIndexedPrimitiveInstanced( &m_vao, m_numOfElements, numOfInstances, pMaterial ? pMaterial : m_pMaterial.get(), pShader ) ;
 }
 
 void jam::Mesh::disableTangents( bool value )
@@ -34,6 +34,9 @@
 #include <jam/Application.h>
 #include <jam/Scene.h>
 #include <jam/Camera.h>
+#include <jam/InstancingManager.h>
+#include <jam/Light.h>
+#include <jam/SharedUniforms.h>
 #include <jam/core/filesystem.h>
 
 namespace jam
@@ -66,17 +69,57 @@ namespace jam
 
 			pShader->setModelMatrix(getTransform().getWorldTformMatrix()) ;
 
-			// the 3 following commands are needed if camera is changed since last frame
-			// OR gpu program / uniforms are uninitialized
-			pShader->setViewMatrix(pCam->getViewMatrix()) ;
-			pShader->setProjectionMatrix(pCam->getProjectionMatrix()) ;
-			pShader->setViewPosition( pCam->getPosition() ) ;
+			// the view is shared by all the programs, it's written only if the camera has changed
+			GetSharedUniforms().setView( pCam ) ;
+			GetLightMgr().prepare( pCam ) ;
 	
 			pMesh->draw();
 		}
 	}
 
+	void Model::addInstance( const Matrix4& worldMatrix, const Color& color /*= Color::WHITE*/ )
+	{
+		for( auto& rMesh : m_meshes ) {
+			GetInstancingMgr().addInstance( rMesh.get(), worldMatrix, color ) ;
+		}
+	}
+
 	void Model::load(const String& modelPath)
+	{
+		m_folder = jam::getDirname( modelPath );
+
+		ModelCache& cache = GetModelCache() ;
+		ModelData* pData = cache.findModel( modelPath ) ;
+		if( !pData ) {
+			std::vector<U8> blob ;
+			if( !cache.readCooked( modelPath, false, blob ) ) {
+				cook( modelPath, blob ) ;
+				cache.writeCooked( modelPath, blob ) ;
+			}
+
+			CookedModelView view ;
+			if( !ModelCache::parse( blob, view ) ) {
+				JAM_ERROR( "Invalid cooked model %s", modelPath.c_str() ) ;
+			}
+
+			Ref<ModelData> rData( new ModelData() ) ;
+			std::map<String,Ref<Texture2D>> textures ;
+			for( auto& meshView : view.meshes ) {
+				Ref<Mesh> rMesh( new Mesh() ) ;
+				rMesh->getMaterial()->setShader( GetShaderMgr().getNormalMapping() ) ;
+				cache.setupMaterial( rMesh->getMaterial(), *meshView.pHeader, m_folder, textures ) ;
+				rMesh->uploadInterleaved( (const MeshVertex*)meshView.pVertices, meshView.pHeader->numOfVertices, meshView.pElements, meshView.pHeader->numOfElements ) ;
+				rData->getMeshes().push_back( rMesh ) ;
+			}
+
+			cache.addModel( modelPath, rData ) ;
+			pData = rData ;
+		}
+
+		m_meshes = pData->getMeshes() ;
+	}
+
+	void Model::cook( const String& modelPath, std::vector<U8>& blob )
 	{
 		Assimp::Importer import;
 		const aiScene *scene = import.ReadFile(modelPath.c_str(), 
@@ -89,152 +132,114 @@ namespace jam
 			JAM_ERROR( "assimp error: %s", import.GetErrorString() ) ;
 		}
 
-		m_folder = jam::getDirname( modelPath );
+		CookedModelHeader header ;
+		memset( &header, 0, sizeof(header) ) ;
+		header.magic = JAM_COOKED_MODEL_MAGIC ;
+		header.version = JAM_COOKED_MODEL_VERSION ;
+		header.sourceSize = (U32)getFileSize( modelPath.c_str() ) ;
+		header.sourceTime = getFileModificationTime( modelPath.c_str() ) ;
+		header.globalInverseTransform = Matrix4(1.0f) ;
 
-		processNode(scene->mRootNode, scene);
+		blob.clear() ;
+		CookedModelWriter writer( blob ) ;
+		writer.write( header ) ;
+
+		processNode(scene->mRootNode, scene, writer);
 	}
 	
-	void Model::processNode(aiNode* node, const aiScene* scene)
+	void Model::processNode(aiNode* node, const aiScene* scene, CookedModelWriter& writer)
 	{
 		// process all the node's meshes (if any)
 		for(unsigned int i = 0; i < node->mNumMeshes; i++)
 		{
 			aiMesh *mesh = scene->mMeshes[node->mMeshes[i]]; 
-			Ref<Mesh> rMesh( processMesh(mesh, scene), true ) ;
-			m_meshes.push_back(rMesh);			
+			processMesh(mesh, scene, writer);
+			writer.at<CookedModelHeader>(0)->numOfMeshes++ ;
 		}
 		// then do the same for each of its children
 		for(unsigned int i = 0; i < node->mNumChildren; i++)
 		{
-			processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], scene, writer);
 		}	
 	}
 	
-	Mesh* Model::processMesh(aiMesh* pAiMesh, const aiScene* scene)
+	void Model::processMesh(aiMesh* pAiMesh, const aiScene* scene, CookedModelWriter& writer)
 	{
 		unsigned int numOfVertices = pAiMesh->mNumVertices ;
+		JAM_ASSERT_MSG( numOfVertices <= 65536, "Too many vertices for 16 bits indices" ) ;
 
-		unsigned int numOfIndices = 0 ;
-		for( unsigned int i=0; i<pAiMesh->mNumFaces; i++ ) {
-			// check that faces are triangles
-			JAM_ASSERT( (pAiMesh->mFaces[i].mNumIndices == 3) ) ;
-			numOfIndices += pAiMesh->mFaces[i].mNumIndices ;
-		}
-
-		Mesh* pMesh = new Mesh() ;
-
-		pMesh->create(numOfVertices, numOfIndices) ;
-
-		HeapArray<Vector3>& verticesArray = pMesh->getVerticesArray() ;
-		HeapArray<Vector3>& normalsArray = pMesh->getNormalsArray() ;
-		HeapArray<Vector2>& texCoordsArray = pMesh->getTexCoordsArray() ;
-		HeapArray<uint16_t>& elementsArray = pMesh->getElementsArray() ;
-
-		aiVector3D* aiVertices = pAiMesh->mVertices ;
-		aiVector3D* aiNormals = pAiMesh->mNormals ;
-		size_t bytesize = numOfVertices * sizeof(Vector3) ;
-
-		verticesArray.copyFrom( (Vector3*)aiVertices ) ;
-		normalsArray.copyFrom( (Vector3*)aiNormals ) ;
-
-		// get only first set of texture coords (there are a total of 8 sets)
-		aiVector3D* aiTextureCoords = pAiMesh->mTextureCoords[0] ;
-
-		for( unsigned int i = 0; i <numOfVertices; i++ )
-		{
-			texCoordsArray[i].x = aiTextureCoords[i].x ;
-			texCoordsArray[i].y = aiTextureCoords[i].y ;
-		}
-
-		// process tangent and bitangent values
-		pMesh->getTangentsArray().copyFrom( (Vector3*)pAiMesh->mTangents ) ;
-		pMesh->getBitangentsArray().copyFrom( (Vector3*)pAiMesh->mBitangents ) ;
-		pMesh->doNotCalculateTangents() ;
-		pMesh->getMaterial()->setShader( GetShaderMgr().getNormalMapping() ) ;
-
-		// process indices
-		unsigned int idx = 0 ;
-		unsigned int* aiIndices = 0 ;
-		for(unsigned int i = 0; i < pAiMesh->mNumFaces; i++)
-		{
-			aiIndices = pAiMesh->mFaces[i].mIndices;
-			idx = i*3 ;
-			elementsArray[idx]   = aiIndices[0] ;
-			elementsArray[idx+1] = aiIndices[1] ;
-			elementsArray[idx+2] = aiIndices[2] ;
-		}  
+		CookedMeshHeader meshHeader ;
+		memset( &meshHeader, 0, sizeof(meshHeader) ) ;
+		meshHeader.numOfVertices = numOfVertices ;
+		meshHeader.numOfElements = pAiMesh->mNumFaces * 3 ;
+		meshHeader.vertexStride = sizeof(MeshVertex) ;
+		meshHeader.shininess = -1.0f ;
 
 		// process material
 		if(pAiMesh->mMaterialIndex >= 0)
 		{
 			aiMaterial *pAiMaterial = scene->mMaterials[pAiMesh->mMaterialIndex];
 
-			Material* pMaterial = pMesh->getMaterial() ;
-
 			float matShininess = 0.0f ;
 			if( AI_SUCCESS == (pAiMaterial->Get( AI_MATKEY_SHININESS, matShininess )) ) {
-				pMaterial->setShininess( matShininess ) ;
-			}
-
-			std::vector<Texture2D*> diffuseMaps ;
-			loadMaterialTextures(pAiMaterial, aiTextureType_DIFFUSE, diffuseMaps);
-			if( diffuseMaps.size() > 0 ) {
-				pMaterial->setDiffuseTexture( diffuseMaps[0] ) ;
-			}
-			else {
-				pMaterial->setDiffuseTexture( nullptr ) ;
+				meshHeader.shininess = matShininess ;
 			}
 
-			std::vector<Texture2D*> specularMaps ;
-			loadMaterialTextures(pAiMaterial, aiTextureType_SPECULAR, specularMaps);
-			if( specularMaps.size() > 0 ) {
-				pMaterial->setSpecularTexture( specularMaps[0] ) ;
-			}
-			else {
-				pMaterial->setSpecularTexture( nullptr ) ;
-			}
+			loadMaterialTexture(pAiMaterial, aiTextureType_DIFFUSE, meshHeader.diffuseTexture);
+			loadMaterialTexture(pAiMaterial, aiTextureType_SPECULAR, meshHeader.specularTexture);
 
 			// The wavefront object format (.obj) exports normal maps slightly different 
 			// as Assimp's aiTextureType_NORMAL doesn't load its normal maps
 			// while aiTextureType_HEIGHT does so I often load them.
 			// Of course this is different for each type of loaded model and file format.
-			std::vector<Texture2D*> normalMaps ;
-			loadMaterialTextures(pAiMaterial, aiTextureType_HEIGHT, normalMaps);
-			if( normalMaps.size() > 0 ) {
-				pMaterial->setNormalTexture( normalMaps[0] ) ;
+			loadMaterialTexture(pAiMaterial, aiTextureType_HEIGHT, meshHeader.normalTexture);
+		}
+
+		writer.write( meshHeader ) ;
+
+		// interleave the vertex streams,
+		// get only first set of texture coords (there are a total of 8 sets)
+		aiVector3D* aiTextureCoords = pAiMesh->mTextureCoords[0] ;
+		MeshVertex vertex ;
+		memset( &vertex, 0, sizeof(vertex) ) ;
+		for( unsigned int i = 0; i <numOfVertices; i++ )
+		{
+			vertex.position = Vector3( pAiMesh->mVertices[i].x, pAiMesh->mVertices[i].y, pAiMesh->mVertices[i].z ) ;
+			if( pAiMesh->mNormals ) {
+				vertex.normal = Vector3( pAiMesh->mNormals[i].x, pAiMesh->mNormals[i].y, pAiMesh->mNormals[i].z ) ;
 			}
-			else {
-				pMaterial->setNormalTexture( nullptr ) ;
+			if( aiTextureCoords ) {
+				vertex.texCoords = Vector2( aiTextureCoords[i].x, aiTextureCoords[i].y ) ;
 			}
+			if( pAiMesh->mTangents ) {
+				vertex.tangent = Vector3( pAiMesh->mTangents[i].x, pAiMesh->mTangents[i].y, pAiMesh->mTangents[i].z ) ;
+				vertex.bitangent = Vector3( pAiMesh->mBitangents[i].x, pAiMesh->mBitangents[i].y, pAiMesh->mBitangents[i].z ) ;
+			}
+			writer.write( vertex ) ;
 		}
 
-		return pMesh ;
+		// process indices
+		unsigned int* aiIndices = 0 ;
+		for(unsigned int i = 0; i < pAiMesh->mNumFaces; i++)
+		{
+			// check that faces are triangles
+			JAM_ASSERT( (pAiMesh->mFaces[i].mNumIndices == 3) ) ;
+			aiIndices = pAiMesh->mFaces[i].mIndices;
+			writer.write( (U16)aiIndices[0] ) ;
+			writer.write( (U16)aiIndices[1] ) ;
+			writer.write( (U16)aiIndices[2] ) ;
+		}
+		writer.align() ;
 	}
 	
-	void Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::vector<Texture2D*>& out )
+	void Model::loadMaterialTexture(aiMaterial* mat, aiTextureType type, char* pOut )
 	{
-		unsigned int textureCountForType = mat->GetTextureCount(type) ;
-		if( textureCountForType > 0 ) {
-			for(unsigned int i = 0; i < textureCountForType; i++)
-			{
-				Texture2D* texture = new Texture2D() ;
-
-				aiString str;
-				mat->GetTexture(type, i, &str);
-				texture->load( jam::appendPath(m_folder, str.C_Str()) ) ;
-				out.push_back(texture);
-
-				// we wont to load more that 1 texture
-				break;
-			}
+		// we wont to load more that 1 texture
+		if( mat->GetTextureCount(type) > 0 ) {
+			aiString str;
+			mat->GetTexture(type, 0, &str);
+			CookedModelWriter::copyName( pOut, str.C_Str() ) ;
 		}
-/*
-		else {
- 			Texture2D* texture = new Texture2D() ;
- 			texture->createDefaultEmpty() ;
- 			out.push_back(texture);
- 		}
-*/
 	}
 
 }
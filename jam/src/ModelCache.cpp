@@ -0,0 +1,326 @@
+/**********************************************************************************
+* 
+* ModelCache.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include <jam/ModelCache.h>
+#include <jam/Shader.h>
+#include <jam/core/filesystem.h>
+
+#include <cstring>
+#include <cstdio>
+
+namespace jam
+{
+
+	//*******************
+	//
+	// Class CookedModelWriter
+	//
+	//*******************
+
+	CookedModelWriter::CookedModelWriter( std::vector<U8>& out ) :
+		m_out(out)
+	{
+	}
+
+	size_t CookedModelWriter::tell() const
+	{
+		return m_out.size() ;
+	}
+
+	void CookedModelWriter::write( const void* pData, size_t size )
+	{
+		const U8* pBytes = (const U8*)pData ;
+		m_out.insert( m_out.end(), pBytes, pBytes + size ) ;
+	}
+
+	void CookedModelWriter::align()
+	{
+		while( m_out.size() & 3 ) {
+			m_out.push_back(0) ;
+		}
+	}
+
+	void CookedModelWriter::copyName( char* pDest, const char* pSrc )
+	{
+		strncpy( pDest, pSrc, JAM_COOKED_MAX_NAME_LENGTH-1 ) ;
+		pDest[JAM_COOKED_MAX_NAME_LENGTH-1] = 0 ;
+	}
+
+
+	//*******************
+	//
+	// Class ModelCache
+	//
+	//*******************
+
+	ModelCache::ModelCache() :
+		m_models(),
+		m_skinnedModels(),
+		m_cookingEnabled(true)
+	{
+	}
+
+	ModelCache::~ModelCache()
+	{
+		removeAll() ;
+	}
+
+	ModelData* ModelCache::findModel( const String& modelPath )
+	{
+		auto it = m_models.find( getKey(modelPath) ) ;
+		return (it != m_models.end()) ? it->second.get() : nullptr ;
+	}
+
+	void ModelCache::addModel( const String& modelPath, ModelData* pData )
+	{
+		m_models[getKey(modelPath)] = Ref<ModelData>(pData,true) ;
+	}
+
+	SkinnedModelData* ModelCache::findSkinnedModel( const String& modelPath )
+	{
+		auto it = m_skinnedModels.find( getKey(modelPath) ) ;
+		return (it != m_skinnedModels.end()) ? it->second.get() : nullptr ;
+	}
+
+	void ModelCache::addSkinnedModel( const String& modelPath, SkinnedModelData* pData )
+	{
+		m_skinnedModels[getKey(modelPath)] = Ref<SkinnedModelData>(pData,true) ;
+	}
+
+	void ModelCache::purgeUnused()
+	{
+		for( auto it = m_models.begin(); it != m_models.end(); ) {
+			bool unused = true ;
+			for( auto& rMesh : it->second->getMeshes() ) {
+				if( rMesh->getRefCount() > 1 ) {
+					unused = false ;
+					break ;
+				}
+			}
+			it = unused ? m_models.erase(it) : ++it ;
+		}
+
+		for( auto it = m_skinnedModels.begin(); it != m_skinnedModels.end(); ) {
+			it = (it->second->getRefCount() == 1) ? m_skinnedModels.erase(it) : ++it ;
+		}
+	}
+
+	void ModelCache::removeAll()
+	{
+		m_models.clear() ;
+		m_skinnedModels.clear() ;
+	}
+
+	String ModelCache::getCookedPathName( const String& modelPath )
+	{
+		return modelPath + JAM_COOKED_MODEL_EXTENSION ;
+	}
+
+	String ModelCache::getKey( const String& modelPath )
+	{
+		return makeLower( normalizePathName(modelPath) ) ;
+	}
+
+	bool ModelCache::readCooked( const String& modelPath, bool skinned, std::vector<U8>& blob )
+	{
+		if( !m_cookingEnabled ) {
+			return false ;
+		}
+
+		String cookedPath = getCookedPathName(modelPath) ;
+		if( !exists(cookedPath) ) {
+			return false ;
+		}
+
+		FILE* fp = fopen( cookedPath.c_str(), "rb" ) ;
+		if( !fp ) {
+			return false ;
+		}
+
+		// the whole file is read with a single call, meshes are uploaded straight from this buffer
+		fseek( fp, 0, SEEK_END ) ;
+		long fileSize = ftell( fp ) ;
+		fseek( fp, 0, SEEK_SET ) ;
+
+		bool ok = false ;
+		if( fileSize >= (long)sizeof(CookedModelHeader) ) {
+			blob.resize( (size_t)fileSize ) ;
+			ok = (fread( blob.data(), 1, blob.size(), fp ) == blob.size()) ;
+		}
+		fclose( fp ) ;
+
+		if( ok ) {
+			const CookedModelHeader* pHeader = (const CookedModelHeader*)blob.data() ;
+			// without the source asset (e.g. shipped cooked only) the cooked file is always used
+			bool hasSource = exists(modelPath) ;
+			int64_t sourceSize = hasSource ? getFileSize(modelPath.c_str()) : pHeader->sourceSize ;
+			int64_t sourceTime = hasSource ? getFileModificationTime(modelPath.c_str()) : pHeader->sourceTime ;
+			ok = pHeader->magic == JAM_COOKED_MODEL_MAGIC &&
+				 pHeader->version == JAM_COOKED_MODEL_VERSION &&
+				 pHeader->skinned == (skinned ? 1u : 0u) &&
+				 pHeader->sourceSize == (U32)sourceSize &&
+				 pHeader->sourceTime == sourceTime ;
+		}
+
+		if( !ok ) {
+			JAM_TRACE( "Ignoring stale or invalid cooked model %s", cookedPath.c_str() ) ;
+			blob.clear() ;
+		}
+
+		return ok ;
+	}
+
+	bool ModelCache::writeCooked( const String& modelPath, const std::vector<U8>& blob )
+	{
+		if( !m_cookingEnabled ) {
+			return false ;
+		}
+
+		String cookedPath = getCookedPathName(modelPath) ;
+		FILE* fp = fopen( cookedPath.c_str(), "wb" ) ;
+		if( !fp ) {
+			// read-only locations simply keep importing from source
+			JAM_TRACE( "Cannot write cooked model %s", cookedPath.c_str() ) ;
+			return false ;
+		}
+
+		bool ok = (fwrite( blob.data(), 1, blob.size(), fp ) == blob.size()) ;
+		fclose( fp ) ;
+
+		if( !ok ) {
+			remove( cookedPath.c_str() ) ;
+		}
+
+		return ok ;
+	}
+
+	bool ModelCache::parse( const std::vector<U8>& blob, CookedModelView& view )
+	{
+		const U8* pBase = blob.data() ;
+		size_t offset = 0 ;
+		size_t size = blob.size() ;
+
+		// returns the next block of the given size, or null if the blob is truncated
+		auto fetch = [&]( size_t bytes ) -> const U8* {
+			if( offset + bytes > size ) {
+				return nullptr ;
+			}
+			const U8* p = pBase + offset ;
+			offset += (bytes + 3) & ~(size_t)3 ;
+			return p ;
+		} ;
+
+		view.pHeader = (const CookedModelHeader*)fetch( sizeof(CookedModelHeader) ) ;
+		if( !view.pHeader || view.pHeader->magic != JAM_COOKED_MODEL_MAGIC || view.pHeader->version != JAM_COOKED_MODEL_VERSION ) {
+			return false ;
+		}
+
+		const CookedModelHeader& header = *view.pHeader ;
+		size_t vertexStride = header.skinned ? sizeof(SkinnedMeshVertex) : sizeof(MeshVertex) ;
+
+		view.meshes.resize( header.numOfMeshes ) ;
+		for( auto& mesh : view.meshes ) {
+			mesh.pHeader = (const CookedMeshHeader*)fetch( sizeof(CookedMeshHeader) ) ;
+			if( !mesh.pHeader || mesh.pHeader->vertexStride != vertexStride ) {
+				return false ;
+			}
+			mesh.pVertices = fetch( (size_t)mesh.pHeader->numOfVertices * vertexStride ) ;
+			mesh.pElements = (const U16*)fetch( (size_t)mesh.pHeader->numOfElements * sizeof(U16) ) ;
+			if( !mesh.pVertices || !mesh.pElements ) {
+				return false ;
+			}
+		}
+
+		view.pBoneOffsets = (const Matrix4*)fetch( header.numOfBones * sizeof(Matrix4) ) ;
+		view.pNodes = (const CookedNode*)fetch( header.numOfNodes * sizeof(CookedNode) ) ;
+		if( !view.pBoneOffsets || !view.pNodes ) {
+			return false ;
+		}
+
+		view.clips.resize( header.numOfClips ) ;
+		for( auto& clip : view.clips ) {
+			clip.pHeader = (const CookedClipHeader*)fetch( sizeof(CookedClipHeader) ) ;
+			if( !clip.pHeader ) {
+				return false ;
+			}
+
+			clip.nodeChannels.assign( header.numOfNodes, -1 ) ;
+			clip.channels.resize( clip.pHeader->numOfChannels ) ;
+			for( size_t i=0; i<clip.channels.size(); i++ ) {
+				CookedChannelView& channel = clip.channels[i] ;
+				channel.pHeader = (const CookedChannelHeader*)fetch( sizeof(CookedChannelHeader) ) ;
+				if( !channel.pHeader || channel.pHeader->nodeIndex < 0 || (U32)channel.pHeader->nodeIndex >= header.numOfNodes ||
+					!channel.pHeader->numOfPositionKeys || !channel.pHeader->numOfRotationKeys || !channel.pHeader->numOfScalingKeys ) {
+					return false ;
+				}
+				channel.pPositions = (const CookedVectorKey*)fetch( channel.pHeader->numOfPositionKeys * sizeof(CookedVectorKey) ) ;
+				channel.pRotations = (const CookedQuatKey*)fetch( channel.pHeader->numOfRotationKeys * sizeof(CookedQuatKey) ) ;
+				channel.pScalings = (const CookedVectorKey*)fetch( channel.pHeader->numOfScalingKeys * sizeof(CookedVectorKey) ) ;
+				if( !channel.pPositions || !channel.pRotations || !channel.pScalings ) {
+					return false ;
+				}
+				clip.nodeChannels[channel.pHeader->nodeIndex] = (I32)i ;
+			}
+		}
+
+		return true ;
+	}
+
+	void ModelCache::setupMaterial( Material* pMaterial, const CookedMeshHeader& header, const String& folder, std::map<String,Ref<Texture2D>>& textures )
+	{
+		if( header.shininess >= 0.0f ) {
+			pMaterial->setShininess( header.shininess ) ;
+		}
+		pMaterial->setDiffuseTexture( getTexture(header.diffuseTexture, folder, textures) ) ;
+		pMaterial->setSpecularTexture( getTexture(header.specularTexture, folder, textures) ) ;
+		pMaterial->setNormalTexture( getTexture(header.normalTexture, folder, textures) ) ;
+	}
+
+	Texture2D* ModelCache::getTexture( const char* pName, const String& folder, std::map<String,Ref<Texture2D>>& textures )
+	{
+		if( !pName[0] ) {
+			return nullptr ;
+		}
+
+		String pathName = appendPath( folder, pName ) ;
+		auto it = textures.find( pathName ) ;
+		if( it != textures.end() ) {
+			return it->second.get() ;
+		}
+
+		Ref<Texture2D> rTexture( new Texture2D() ) ;
+		rTexture->load( pathName ) ;
+		textures[pathName] = rTexture ;
+
+		return rTexture.get() ;
+	}
+
+}
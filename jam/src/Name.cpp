@@ -0,0 +1,229 @@
+/**********************************************************************************
+* 
+* Name.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/Name.h"
+
+#include <mutex>
+#include <vector>
+#include <cctype>
+#include <cstring>
+
+namespace jam
+{
+
+/*
+	Chained hash table of the interned strings. Entries are allocated once and never moved,
+	so a Name can keep a plain pointer to them. Buckets are rehashed by relinking entries.
+*/
+class NameTable
+{
+public:
+	NameTable() : m_buckets(InitialBuckets,nullptr), m_count(0) {}
+
+	const Name::Entry* find( const char* str, size_t len ) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex) ;
+		const Name::Entry* e = lookup( str, len, hashExact(str,len) ) ;
+		// a case variant never interned still matches the (always interned) lowercase entry
+		return e ? e : lookupFolded( str, len, hashFolded(str,len) ) ;
+	}
+
+	const Name::Entry* intern( const char* str, size_t len )
+	{
+		std::lock_guard<std::mutex> lock(m_mutex) ;
+		return insert( str, len, hashExact(str,len) ) ;
+	}
+
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex) ;
+		return m_count ;
+	}
+
+	static NameTable& get()
+	{
+		// function static, Names may be built during static initialization
+		static NameTable table ;
+		return table ;
+	}
+
+private:
+	static const size_t		InitialBuckets = 1024 ;
+
+	// FNV-1a
+	static size_t hashExact( const char* str, size_t len )
+	{
+		U64 h = 14695981039346656037ull ;
+		for( size_t i=0; i<len; i++ ) {
+			h = (h ^ (U8)str[i]) * 1099511628211ull ;
+		}
+		return (size_t)h ;
+	}
+
+	static size_t hashFolded( const char* str, size_t len )
+	{
+		U64 h = 14695981039346656037ull ;
+		for( size_t i=0; i<len; i++ ) {
+			h = (h ^ (U8)tolower((U8)str[i])) * 1099511628211ull ;
+		}
+		return (size_t)h ;
+	}
+
+	const Name::Entry* lookup( const char* str, size_t len, size_t hash ) const
+	{
+		const Name::Entry* e = m_buckets[hash & (m_buckets.size()-1)] ;
+		while( e ) {
+			if( e->hash == hash && e->str.size() == len && memcmp(e->str.data(),str,len) == 0 ) {
+				return e ;
+			}
+			e = e->pNext ;
+		}
+		return nullptr ;
+	}
+
+	const Name::Entry* lookupFolded( const char* str, size_t len, size_t foldedHash ) const
+	{
+		const Name::Entry* e = m_buckets[foldedHash & (m_buckets.size()-1)] ;
+		while( e ) {
+			if( e->hash == foldedHash && e->pFolded == e && e->str.size() == len ) {
+				size_t i = 0 ;
+				while( i<len && (U8)e->str[i] == tolower((U8)str[i]) ) {
+					i++ ;
+				}
+				if( i == len ) {
+					return e ;
+				}
+			}
+			e = e->pNext ;
+		}
+		return nullptr ;
+	}
+
+	const Name::Entry* insert( const char* str, size_t len, size_t hash )
+	{
+		const Name::Entry* pFound = lookup( str, len, hash ) ;
+		if( pFound ) {
+			return pFound ;
+		}
+
+		// the lowercase form is interned first, case variants share its entry for comparisons
+		const Name::Entry* pFolded = nullptr ;
+		bool hasUpper = false ;
+		for( size_t i=0; i<len && !hasUpper; i++ ) {
+			hasUpper = tolower((U8)str[i]) != (U8)str[i] ;
+		}
+		if( hasUpper ) {
+			String lower( str, len ) ;
+			makeLowerInplace( lower ) ;
+			pFolded = insert( lower.data(), len, hashExact(lower.data(),len) ) ;
+		}
+
+		Name::Entry* e = new Name::Entry() ;
+		e->str.assign( str, len ) ;
+		e->pFolded = pFolded ? pFolded : e ;
+		e->hash = hash ;
+		e->foldedHash = pFolded ? pFolded->foldedHash : hashFolded( str, len ) ;
+
+		if( m_count >= m_buckets.size() ) {
+			rehash( m_buckets.size() * 2 ) ;
+		}
+		size_t b = hash & (m_buckets.size()-1) ;
+		e->pNext = m_buckets[b] ;
+		m_buckets[b] = e ;
+		m_count++ ;
+		return e ;
+	}
+
+	void rehash( size_t numOfBuckets )
+	{
+		std::vector<Name::Entry*> buckets( numOfBuckets, nullptr ) ;
+		for( Name::Entry* e : m_buckets ) {
+			while( e ) {
+				Name::Entry* pNext = e->pNext ;
+				size_t b = e->hash & (numOfBuckets-1) ;
+				e->pNext = buckets[b] ;
+				buckets[b] = e ;
+				e = pNext ;
+			}
+		}
+		m_buckets.swap( buckets ) ;
+	}
+
+private:
+	std::vector<Name::Entry*>	m_buckets ;
+	size_t						m_count ;
+	mutable std::mutex			m_mutex ;
+};
+
+
+Name::Name( const String& str ) : m_pEntry(nullptr), m_id(0)
+{
+	if( !str.empty() ) {
+		m_pEntry = NameTable::get().intern( str.data(), str.size() ) ;
+	}
+}
+
+Name::Name( const char* str ) : m_pEntry(nullptr), m_id(0)
+{
+	if( str && *str ) {
+		m_pEntry = NameTable::get().intern( str, strlen(str) ) ;
+	}
+}
+
+Name Name::find( const String& str )
+{
+	return str.empty() ? Name() : Name( NameTable::get().find(str.data(),str.size()) ) ;
+}
+
+Name Name::find( const char* str )
+{
+	return (!str || !*str) ? Name() : Name( NameTable::get().find(str,strlen(str)) ) ;
+}
+
+Name Name::fromId( const void* p )
+{
+	Name n ;
+	n.m_id = (uintptr_t)p ;
+	return n ;
+}
+
+const String& Name::str() const
+{
+	static const String empty ;
+	return m_pEntry ? m_pEntry->str : empty ;
+}
+
+size_t Name::getNumOfInterned()
+{
+	return NameTable::get().size() ;
+}
+
+}
@@ -0,0 +1,414 @@
+/**********************************************************************************
+* 
+* Narrowphase.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+#include "stdafx.h"
+#include "jam/Narrowphase.h"
+#include "jam/JobSystem.h"
+
+#include <math.h>
+#include <float.h>
+
+#if !defined(JAM_SIMD_DISABLED) && (defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__))
+#define JAM_NARROWPHASE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace jam
+{
+
+namespace
+{
+	// four lanes of floats, comparisons return masks to be used with select() and maskBits()
+#ifdef JAM_NARROWPHASE_SSE2
+	struct F4
+	{
+		__m128 v ;
+
+		F4() {}
+		F4( __m128 x ) : v(x) {}
+		explicit F4( float x ) : v(_mm_set1_ps(x)) {}
+
+		static F4 load( const float* p ) { return _mm_loadu_ps(p) ; }
+		void store( float* p ) const { _mm_storeu_ps(p, v) ; }
+	};
+
+	JAM_INLINE F4 operator+( F4 a, F4 b ) { return _mm_add_ps(a.v, b.v) ; }
+	JAM_INLINE F4 operator-( F4 a, F4 b ) { return _mm_sub_ps(a.v, b.v) ; }
+	JAM_INLINE F4 operator*( F4 a, F4 b ) { return _mm_mul_ps(a.v, b.v) ; }
+	JAM_INLINE F4 operator/( F4 a, F4 b ) { return _mm_div_ps(a.v, b.v) ; }
+	JAM_INLINE F4 operator-( F4 a ) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) ; }
+	JAM_INLINE F4 min4( F4 a, F4 b ) { return _mm_min_ps(a.v, b.v) ; }
+	JAM_INLINE F4 max4( F4 a, F4 b ) { return _mm_max_ps(a.v, b.v) ; }
+	JAM_INLINE F4 sqrt4( F4 a ) { return _mm_sqrt_ps(a.v) ; }
+	JAM_INLINE F4 cmpLess( F4 a, F4 b ) { return _mm_cmplt_ps(a.v, b.v) ; }
+	JAM_INLINE F4 maskAnd( F4 a, F4 b ) { return _mm_and_ps(a.v, b.v) ; }
+	JAM_INLINE F4 maskOr( F4 a, F4 b ) { return _mm_or_ps(a.v, b.v) ; }
+	JAM_INLINE F4 select( F4 mask, F4 a, F4 b ) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) ; }
+	JAM_INLINE int maskBits( F4 mask ) { return _mm_movemask_ps(mask.v) ; }
+#else
+	// scalar fallback, masks are stored as 1.0f (true) and 0.0f (false)
+	struct F4
+	{
+		float v[4] ;
+
+		F4() {}
+		explicit F4( float x ) { v[0] = v[1] = v[2] = v[3] = x ; }
+
+		static F4 load( const float* p ) { F4 r ; for( int i=0; i<4; i++ ) r.v[i] = p[i] ; return r ; }
+		void store( float* p ) const { for( int i=0; i<4; i++ ) p[i] = v[i] ; }
+	};
+
+	#define JAM_F4_OP(expr)		F4 r ; for( int i=0; i<4; i++ ) { r.v[i] = (expr) ; } return r ;
+
+	JAM_INLINE F4 operator+( F4 a, F4 b ) { JAM_F4_OP( a.v[i] + b.v[i] ) }
+	JAM_INLINE F4 operator-( F4 a, F4 b ) { JAM_F4_OP( a.v[i] - b.v[i] ) }
+	JAM_INLINE F4 operator*( F4 a, F4 b ) { JAM_F4_OP( a.v[i] * b.v[i] ) }
+	JAM_INLINE F4 operator/( F4 a, F4 b ) { JAM_F4_OP( a.v[i] / b.v[i] ) }
+	JAM_INLINE F4 operator-( F4 a ) { JAM_F4_OP( -a.v[i] ) }
+	JAM_INLINE F4 min4( F4 a, F4 b ) { JAM_F4_OP( a.v[i] < b.v[i] ? a.v[i] : b.v[i] ) }
+	JAM_INLINE F4 max4( F4 a, F4 b ) { JAM_F4_OP( a.v[i] > b.v[i] ? a.v[i] : b.v[i] ) }
+	JAM_INLINE F4 sqrt4( F4 a ) { JAM_F4_OP( sqrtf(a.v[i]) ) }
+	JAM_INLINE F4 cmpLess( F4 a, F4 b ) { JAM_F4_OP( a.v[i] < b.v[i] ? 1.0f : 0.0f ) }
+	JAM_INLINE F4 maskAnd( F4 a, F4 b ) { JAM_F4_OP( (a.v[i] != 0.0f && b.v[i] != 0.0f) ? 1.0f : 0.0f ) }
+	JAM_INLINE F4 maskOr( F4 a, F4 b ) { JAM_F4_OP( (a.v[i] != 0.0f || b.v[i] != 0.0f) ? 1.0f : 0.0f ) }
+	JAM_INLINE F4 select( F4 mask, F4 a, F4 b ) { JAM_F4_OP( mask.v[i] != 0.0f ? a.v[i] : b.v[i] ) }
+	JAM_INLINE int maskBits( F4 mask ) { int bits = 0 ; for( int i=0; i<4; i++ ) { if( mask.v[i] != 0.0f ) bits |= 1 << i ; } return bits ; }
+
+	#undef JAM_F4_OP
+#endif
+
+	// axes shorter than this are skipped (degenerate edges, coincident centers)
+	const float MinAxisLength = 1e-6f ;
+
+	// state of the separating axis tests of four pairs
+	struct SatState
+	{
+		F4 separated ;
+		F4 depth ;
+		F4 nx, ny ;
+
+		SatState() : separated(0.0f), depth(FLT_MAX), nx(0.0f), ny(0.0f) {}
+
+		// keeps the axis if its overlap is the minimum so far, axes of valid == false are ignored
+		JAM_INLINE void addAxis( F4 valid, F4 axisX, F4 axisY, F4 overlap )
+		{
+			separated = maskOr( separated, maskAnd(valid, cmpLess(overlap, F4(0.0f))) ) ;
+			F4 better = maskAnd( valid, cmpLess(overlap, depth) ) ;
+			depth = select( better, overlap, depth ) ;
+			nx = select( better, axisX, nx ) ;
+			ny = select( better, axisY, ny ) ;
+		}
+	};
+
+	// normalizes the axis, returning the mask of the lanes where it isn't degenerate
+	JAM_INLINE F4 normalizeAxis( F4& x, F4& y )
+	{
+		F4 length = sqrt4( x*x + y*y ) ;
+		F4 valid = cmpLess( F4(MinAxisLength), length ) ;
+		F4 inv = F4(1.0f) / max4( length, F4(MinAxisLength) ) ;
+		x = x * inv ;
+		y = y * inv ;
+		return valid ;
+	}
+
+	JAM_INLINE void projectQuad( const F4* x, const F4* y, F4 axisX, F4 axisY, F4& minp, F4& maxp )
+	{
+		minp = maxp = x[0]*axisX + y[0]*axisY ;
+		for( int k=1; k<4; k++ ) {
+			F4 d = x[k]*axisX + y[k]*axisY ;
+			minp = min4( minp, d ) ;
+			maxp = max4( maxp, d ) ;
+		}
+	}
+
+	// tests the edge normals of the quad (ex,ey) projecting the quads a and b
+	JAM_INLINE void testQuadEdges( const F4* ex, const F4* ey, const F4* ax, const F4* ay, const F4* bx, const F4* by, SatState& sat )
+	{
+		for( int j=3, i=0; i<4; j=i, i++ ) {
+			F4 axisX = ey[j] - ey[i] ;
+			F4 axisY = ex[i] - ex[j] ;
+			F4 valid = normalizeAxis( axisX, axisY ) ;
+
+			F4 mina, maxa, minb, maxb ;
+			projectQuad( ax, ay, axisX, axisY, mina, maxa ) ;
+			projectQuad( bx, by, axisX, axisY, minb, maxb ) ;
+			sat.addAxis( valid, axisX, axisY, min4(maxa, maxb) - max4(mina, minb) ) ;
+		}
+	}
+
+	// the normal points along (dx,dy), the direction from the first shape towards the second one
+	JAM_INLINE void orientNormal( F4 dx, F4 dy, SatState& sat )
+	{
+		F4 flip = cmpLess( dx*sat.nx + dy*sat.ny, F4(0.0f) ) ;
+		sat.nx = select( flip, -sat.nx, sat.nx ) ;
+		sat.ny = select( flip, -sat.ny, sat.ny ) ;
+		// only degenerate shapes have no axis
+		sat.depth = select( cmpLess(sat.depth, F4(FLT_MAX)), sat.depth, F4(0.0f) ) ;
+	}
+
+	JAM_INLINE F4 quadMean( const F4* v )
+	{
+		return (v[0] + v[1] + v[2] + v[3]) * F4(0.25f) ;
+	}
+
+	// writes the results of the used lanes of a batch
+	template<typename Results>
+	JAM_INLINE void storeResults( Results& results, const size_t* tests, size_t count, F4 separated, F4 nx, F4 ny, F4 depth )
+	{
+		float outNx[NARROWPHASE_BATCH_LANES], outNy[NARROWPHASE_BATCH_LANES], outDepth[NARROWPHASE_BATCH_LANES] ;
+		nx.store( outNx ) ;
+		ny.store( outNy ) ;
+		depth.store( outDepth ) ;
+		int separatedBits = maskBits( separated ) ;
+
+		for( size_t lane=0; lane<count; lane++ ) {
+			auto& r = results[tests[lane]] ;
+			r.hit = (separatedBits & (1 << lane)) == 0 ;
+			r.normal = Vector2( outNx[lane], outNy[lane] ) ;
+			r.depth = outDepth[lane] ;
+		}
+	}
+}
+
+
+Narrowphase::Narrowphase() :
+	m_results(), m_circleBatches(), m_quadBatches(), m_circleQuadBatches(), m_polygonTests(), m_circlePolygonTests()
+{
+}
+
+void Narrowphase::clear()
+{
+	m_results.clear() ;
+	m_circleBatches.clear() ;
+	m_quadBatches.clear() ;
+	m_circleQuadBatches.clear() ;
+	m_polygonTests.clear() ;
+	m_circlePolygonTests.clear() ;
+}
+
+size_t Narrowphase::addCircles( const Circle2f& a, const Circle2f& b )
+{
+	size_t test = addResult() ;
+	size_t lane = nextLane( m_circleBatches, test ) ;
+	CircleBatch& batch = m_circleBatches.back() ;
+	batch.ax[lane] = a.getCenter().x ;
+	batch.ay[lane] = a.getCenter().y ;
+	batch.ar[lane] = a.getRadius() ;
+	batch.bx[lane] = b.getCenter().x ;
+	batch.by[lane] = b.getCenter().y ;
+	batch.br[lane] = b.getRadius() ;
+	return test ;
+}
+
+size_t Narrowphase::addPolygons( const Polygon2f& a, const Polygon2f& b )
+{
+	size_t test = addResult() ;
+	if( a.getCount() != 4 || b.getCount() != 4 ) {
+		PolygonTest polygonTest = { a, b, test } ;
+		m_polygonTests.push_back( polygonTest ) ;
+		return test ;
+	}
+
+	size_t lane = nextLane( m_quadBatches, test ) ;
+	QuadBatch& batch = m_quadBatches.back() ;
+	for( int v=0; v<4; v++ ) {
+		batch.ax[v][lane] = a.getVertex(v).x ;
+		batch.ay[v][lane] = a.getVertex(v).y ;
+		batch.bx[v][lane] = b.getVertex(v).x ;
+		batch.by[v][lane] = b.getVertex(v).y ;
+	}
+	return test ;
+}
+
+size_t Narrowphase::addCirclePolygon( const Circle2f& a, const Polygon2f& b )
+{
+	size_t test = addResult() ;
+	if( b.getCount() != 4 ) {
+		CirclePolygonTest circlePolygonTest = { a, b, test } ;
+		m_circlePolygonTests.push_back( circlePolygonTest ) ;
+		return test ;
+	}
+
+	size_t lane = nextLane( m_circleQuadBatches, test ) ;
+	CircleQuadBatch& batch = m_circleQuadBatches.back() ;
+	batch.ax[lane] = a.getCenter().x ;
+	batch.ay[lane] = a.getCenter().y ;
+	batch.ar[lane] = a.getRadius() ;
+	for( int v=0; v<4; v++ ) {
+		batch.bx[v][lane] = b.getVertex(v).x ;
+		batch.by[v][lane] = b.getVertex(v).y ;
+	}
+	return test ;
+}
+
+void Narrowphase::run( bool parallel )
+{
+	JAM_PROFILE("Narrowphase.run") ;
+
+	// every batch writes only the results of its own tests
+	size_t numOfBatches = m_circleBatches.size() + m_quadBatches.size() + m_circleQuadBatches.size() ;
+	size_t grainSize = parallel ? NARROWPHASE_BATCHES_GRAIN : numOfBatches ;
+	GetJobSystem().parallelFor( numOfBatches, grainSize, [this]( size_t begin, size_t end ) {
+		for( size_t i=begin; i<end; i++ ) {
+			size_t idx = i ;
+			if( idx < m_circleBatches.size() ) {
+				runCircles( m_circleBatches[idx] ) ;
+				continue ;
+			}
+			idx -= m_circleBatches.size() ;
+			if( idx < m_quadBatches.size() ) {
+				runQuads( m_quadBatches[idx] ) ;
+				continue ;
+			}
+			idx -= m_quadBatches.size() ;
+			runCircleQuads( m_circleQuadBatches[idx] ) ;
+		}
+	} ) ;
+
+	for( size_t i=0; i<m_polygonTests.size(); i++ ) {
+		const PolygonTest& t = m_polygonTests[i] ;
+		Result& r = m_results[t.test] ;
+		r.hit = t.a.intersects( t.b, r.normal, r.depth ) ;
+	}
+
+	for( size_t i=0; i<m_circlePolygonTests.size(); i++ ) {
+		const CirclePolygonTest& t = m_circlePolygonTests[i] ;
+		Result& r = m_results[t.test] ;
+		r.hit = t.a.intersects( t.b, r.normal, r.depth ) ;
+	}
+}
+
+template<typename Batch>
+size_t Narrowphase::nextLane( std::vector<Batch>& batches, size_t test )
+{
+	if( batches.empty() || batches.back().count == NARROWPHASE_BATCH_LANES ) {
+		// value-initialized: unused lanes hold zeros, degenerate tests whose results aren't written
+		batches.push_back( Batch() ) ;
+	}
+
+	Batch& batch = batches.back() ;
+	size_t lane = batch.count++ ;
+	batch.tests[lane] = test ;
+	return lane ;
+}
+
+size_t Narrowphase::addResult()
+{
+	Result r = { Vector2(0.0f), 0.0f, false } ;
+	m_results.push_back( r ) ;
+	return m_results.size() - 1 ;
+}
+
+void Narrowphase::runCircles( const CircleBatch& batch )
+{
+	F4 dx = F4::load(batch.bx) - F4::load(batch.ax) ;
+	F4 dy = F4::load(batch.by) - F4::load(batch.ay) ;
+	F4 rr = F4::load(batch.ar) + F4::load(batch.br) ;
+
+	F4 distanceSquared = dx*dx + dy*dy ;
+	F4 separated = cmpLess( rr*rr, distanceSquared ) ;
+
+	// coincident centers get the x axis, like Circle2f::intersects
+	F4 distance = sqrt4( distanceSquared ) ;
+	F4 valid = cmpLess( F4(0.0f), distance ) ;
+	F4 inv = F4(1.0f) / max4( distance, F4(MinAxisLength) ) ;
+	F4 nx = select( valid, dx*inv, F4(1.0f) ) ;
+	F4 ny = select( valid, dy*inv, F4(0.0f) ) ;
+	F4 depth = rr - distance ;
+
+	storeResults( m_results, batch.tests, batch.count, separated, nx, ny, depth ) ;
+}
+
+void Narrowphase::runQuads( const QuadBatch& batch )
+{
+	F4 ax[4], ay[4], bx[4], by[4] ;
+	for( int v=0; v<4; v++ ) {
+		ax[v] = F4::load( batch.ax[v] ) ;
+		ay[v] = F4::load( batch.ay[v] ) ;
+		bx[v] = F4::load( batch.bx[v] ) ;
+		by[v] = F4::load( batch.by[v] ) ;
+	}
+
+	SatState sat ;
+	testQuadEdges( ax, ay, ax, ay, bx, by, sat ) ;
+	testQuadEdges( bx, by, ax, ay, bx, by, sat ) ;
+	orientNormal( quadMean(bx) - quadMean(ax), quadMean(by) - quadMean(ay), sat ) ;
+
+	storeResults( m_results, batch.tests, batch.count, sat.separated, sat.nx, sat.ny, sat.depth ) ;
+}
+
+void Narrowphase::runCircleQuads( const CircleQuadBatch& batch )
+{
+	F4 cx = F4::load( batch.ax ) ;
+	F4 cy = F4::load( batch.ay ) ;
+	F4 radius = F4::load( batch.ar ) ;
+	F4 bx[4], by[4] ;
+	for( int v=0; v<4; v++ ) {
+		bx[v] = F4::load( batch.bx[v] ) ;
+		by[v] = F4::load( batch.by[v] ) ;
+	}
+
+	SatState sat ;
+
+	// edge normals of the quad
+	for( int j=3, i=0; i<4; j=i, i++ ) {
+		F4 axisX = by[j] - by[i] ;
+		F4 axisY = bx[i] - bx[j] ;
+		F4 valid = normalizeAxis( axisX, axisY ) ;
+
+		F4 minp, maxp ;
+		projectQuad( bx, by, axisX, axisY, minp, maxp ) ;
+		F4 c = cx*axisX + cy*axisY ;
+		sat.addAxis( valid, axisX, axisY, min4(c + radius, maxp) - max4(c - radius, minp) ) ;
+	}
+
+	// axis through the vertex nearest to the center
+	F4 nearestX = bx[0], nearestY = by[0] ;
+	F4 nearestDistanceSquared = (bx[0]-cx)*(bx[0]-cx) + (by[0]-cy)*(by[0]-cy) ;
+	for( int v=1; v<4; v++ ) {
+		F4 distanceSquared = (bx[v]-cx)*(bx[v]-cx) + (by[v]-cy)*(by[v]-cy) ;
+		F4 nearer = cmpLess( distanceSquared, nearestDistanceSquared ) ;
+		nearestDistanceSquared = select( nearer, distanceSquared, nearestDistanceSquared ) ;
+		nearestX = select( nearer, bx[v], nearestX ) ;
+		nearestY = select( nearer, by[v], nearestY ) ;
+	}
+
+	F4 axisX = nearestX - cx ;
+	F4 axisY = nearestY - cy ;
+	F4 valid = normalizeAxis( axisX, axisY ) ;
+	F4 minp, maxp ;
+	projectQuad( bx, by, axisX, axisY, minp, maxp ) ;
+	F4 c = cx*axisX + cy*axisY ;
+	sat.addAxis( valid, axisX, axisY, min4(c + radius, maxp) - max4(c - radius, minp) ) ;
+
+	orientNormal( quadMean(bx) - cx, quadMean(by) - cy, sat ) ;
+
+	storeResults( m_results, batch.tests, batch.count, sat.separated, sat.nx, sat.ny, sat.depth ) ;
+}
+
+}
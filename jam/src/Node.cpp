@@ -43,6 +43,7 @@
 #include "jam/Timer.h"
 #include "jam/Gfx.h"
 #include "jam/Camera.h"
+#include "jam/SharedUniforms.h"
 #include "jam/core/geom.h"
 
 #ifdef JAM_DEBUG
@@ -53,6 +54,7 @@
 #include <glm/vec3.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/matrix_transform_2d.hpp>
+#include <glm/common.hpp>
 
 #include <typeinfo>
 #include <sstream>
@@ -85,6 +87,11 @@ Camera* Node::m_pCurrentCamera = 0 ;
 
 bool Node::VisitInProgress = false ;
 
+// view used to cull the subtrees in the current frame
+static Frustum	s_cullingFrustum ;
+static Camera*	s_pCullingCamera = 0 ;
+static U32		s_culledSubtrees = 0 ;
+
 // ctor
 Node::Node() :
 	m_local_tform_dirty(true),
@@ -97,6 +104,11 @@ Node::Node() :
 	m_world_pos(0,0),
 	m_world_rot(1.0f),
 	m_world_scl(1,1),
+	m_interpolated(false),
+	m_prev_pos(0,0),
+	m_prev_angle(0.0f),
+	m_prev_scl(1,1),
+	m_renderObb(),
 	m_hspot(0,0),
 	m_enabled(true),
 	m_visible(true),
@@ -110,6 +122,7 @@ Node::Node() :
 	m_attributes(),
 	m_collType(0),
 	m_savedCollType(0),
+	m_collProxy(),
 	m_justCollisionPaused(false),
 	m_colls(),
 	m_aabb(),
@@ -126,12 +139,20 @@ Node::Node() :
 	m_pGrid(0),
 	m_actionSpeed(1.0f),
 	m_is_in_view(false), m_isInViewCalculated(false)
+	,m_cullingEnabled(false)
+	,m_subtreeBoundsDirty(true)
+	,m_subtreeMin(0.0f)
+	,m_subtreeMax(0.0f)
+	,m_renderLevelNode(-1)
 	,m_pCamera(0)
 #ifdef JAM_CHECK_SINGLE_UPDATE_CALL
 	,m_lastUpdate(0)
 	,m_lastRender(0)
 #endif
 {
+	// nodes are owned by the main thread and referenced on every visit
+	setRefCountPolicy( RefCountPolicy::SingleThreaded ) ;
+
 	m_lifeTime = GetAppMgr().getTotalElapsedMs() ;
 
 	for(int i=0; i<JAM_MAX_TOUCHES; i++) {
@@ -249,6 +270,8 @@ Node* Node::addChild( Node* child, int zOrder, bool global /*=true*/ )
 		
 	child->setParent(this);
 	child->invalidateWorld();
+	// the world bounds depend on the new parent
+	child->invalidateOBB();
 
 	// recalculate world transform
 	if( global ) {
@@ -626,7 +649,7 @@ void Node::visit()
 	m_isInViewCalculated=false;
 	m_is_in_view=false;
 
-	JAM_PROFILE("Node.visit") ;
+	JAM_PROFILE_DETAIL("Node.visit") ;
 
 	// quick return if not enabled (if the node is marked for destroy it is also not enabled)
 	//2GZ: Non ho trovato il punto in cui lo se  marked allora  !enabled
@@ -646,16 +669,24 @@ void Node::visit()
 	}
 
 	Node* pNode;
-	NodesList::const_iterator it;
+	FrameVector<Ref<Node>>::const_iterator it;
 
-	bool isLayerOrScene = typeid(Layer) == typeid(*this) || typeid(ColorLayer) == typeid(*this) || typeid(Scene) == typeid(*this) ;
+	// the dynamic type never changes, it is checked only on the first visit
+	if( m_renderLevelNode < 0 ) {
+		m_renderLevelNode = (typeid(Layer) == typeid(*this) || typeid(ColorLayer) == typeid(*this) || typeid(Scene) == typeid(*this)) ? 1 : 0 ;
+	}
+	bool isLayerOrScene = m_renderLevelNode == 1 ;
 	if( isLayerOrScene ) {
 		GetGfx().setRenderLevel( getZOrder() ) ;
 	}
 
-	// The children list could change and the iterator could become invalid, so we copy it
-	NodesList appo( m_children.size() ) ;
-	std::copy( m_children.begin(),m_children.end(), appo.begin() );
+	// The children list could change and the iterator could become invalid, so we copy it (in frame memory)
+	FrameVector<Ref<Node>> appo( m_children.begin(), m_children.end() ) ;
+
+	Camera* pCullingCamera = 0 ;
+	if( m_cullingEnabled ) {
+		pCullingCamera = this->getCamera() ? this->getCamera() : this->getAncestorCamera() ;
+	}
 
 	if( appo.size() > 0) {
 		// draw children zOrder < 0 (the ones behind the current node)
@@ -663,7 +694,9 @@ void Node::visit()
 			pNode = const_cast<Node*>( (*it).get() );
 
 			if ( pNode && pNode->m_ZOrder < 0 ) {
-				pNode->visit();
+				if( !pCullingCamera || pNode->isInCullingView(pCullingCamera) ) {
+					pNode->visit();
+				}
 			}
 			else {
 				break;
@@ -689,6 +722,7 @@ void Node::visit()
 
 			pCamera->setActive() ;
 			Node::setCurrentCamera(pCamera) ;
+			GetSharedUniforms().setView( pCamera ) ;
 			GetShaderMgr().getCurrent()->setModelMatrix( Matrix4(1.0f) ) ;
 	  
 			if(pBatch && batchInProgress) { pBatch->begin() ; }
@@ -706,7 +740,7 @@ void Node::visit()
 	if ( appo.size() > 0) {
 		for ( ; it!=appo.end(); it++ ) {
 			pNode = const_cast<Node*>( (*it).get() );
-			if (pNode) {
+			if (pNode && (!pCullingCamera || pNode->isInCullingView(pCullingCamera)) ) {
 				pNode->visit();
 			}
 		}
@@ -720,7 +754,7 @@ void Node::visit()
 
 void Node::update()
 {
-	JAM_PROFILE("Node.upd") ;
+	JAM_PROFILE_DETAIL("Node.upd") ;
 
 #ifdef JAM_CHECK_SINGLE_UPDATE_CALL
 	JAM_ASSERT_MSG( m_lastUpdate != GetAppMgr().getTotalElapsedMs(), ("Update called twice") ) ;
@@ -754,6 +788,8 @@ void Node::updateTouches()
 {
 	if( m_touchable )
 	{
+		Scene* pScene = GetAppMgr().getScene() ;
+
 		for(uint32_t i=0; i<GetInputMgr().getMaxNumberOfTouches(); i++) {
 			m_released[i] = false ;
 			m_down[i] = false ;
@@ -762,28 +798,22 @@ void Node::updateTouches()
 
 		for(uint32_t touchId=0; touchId<GetInputMgr().getMaxNumberOfTouches(); touchId++)
 		{
-			// un touch non viene propagato ai nodi sottostanti
-			if( GetAppMgr().getScene()->getTouches(touchId) == true ) {
-				continue ;
-			}
-
 			if( GetInputMgr().isTouchUp(touchId) ) {
 				continue ;
 			}
 
-			if( GetInputMgr().isTouchReleased(touchId)) {
+			// un touch non viene propagato ai nodi sottostanti, the scene picks the topmost node under it
+			m_inside[touchId] = pScene->getTouchedNode(touchId) == this ;
+
+			if( GetInputMgr().isTouchReleased(touchId) && (m_inside[touchId] || m_wasDownLastFrame[touchId]) ) {
 				m_wasDownLastFrame[touchId] = false ;
 				m_released[touchId] = true ;
 			}
 
 			Vector2 mousePos = Vector2( GetInputMgr().getTouchX(touchId), GetInputMgr().getTouchY(touchId) ) ;
-			m_inside[touchId] = getTransformedAABB().isPointInsideQuad(mousePos) ;
 
 			if( m_inside[touchId] )
 			{
-				GetAppMgr().getScene()->setTouches(touchId, true) ;
-				GetAppMgr().getScene()->setTouchedNode(touchId, this) ;
-
 				m_wasInsideLastFrame[touchId] = true ;
 
 				m_pressed[touchId] = GetInputMgr().isTouchPressed(touchId) ;
@@ -822,6 +852,16 @@ void Node::updateTouches()
 	}
 }
 
+bool Node::hasTouchState() const
+{
+	for(uint32_t i=0; i<GetInputMgr().getMaxNumberOfTouches(); i++) {
+		if( m_wasDownLastFrame[i] || m_down[i] || m_released[i] || m_pressed[i] || m_inside[i] ) {
+			return true ;
+		}
+	}
+	return false ;
+}
+
 /// Override this method in children classes
 void Node::render()
 {
@@ -844,10 +884,13 @@ Action* Node::runAction( Action* action,  const TagType& tag)
 
 void Node::stopActionsByTag(const TagType& tag)
 {
+	// stopping an action erases it from the tags map, so the range is copied first
  	std::vector<Action*> actions ;
 	auto range = GetActionMgr().findObjectsByTag(tag) ;
  	for( auto k = range.first; k!=range.second; k++ )
- 		stopAction((*k).second);
+ 		actions.push_back((*k).second);
+	for( Action* action : actions )
+		stopAction(action);
 }
 
 
@@ -910,6 +953,8 @@ String Node::getAttribute( const String& key )const
 
 void Node::setCollisionType( int collType, bool recursive/*=false*/ )
 {
+	JAM_ASSERT_MSG( collType>=0 && collType<JAM_CM_MAX_COLL_TYPES, "collType must be in the range 0-%d", JAM_CM_MAX_COLL_LAYERS ) ;
+
 	m_savedCollType = collType;	// avoid resume before pause issue
 	m_justCollisionPaused=false;
 
@@ -1043,12 +1088,88 @@ void Node::invalidateOBB()
 {
 	if( !m_obbDirty ) {
 		m_obbDirty = true ;
+		invalidateSubtreeBounds() ;
 		for( NodesList::iterator it = m_children.begin(); it != m_children.end(); it++ ) {
 			(*it)->invalidateOBB() ;
 		}
 	}
 }
 
+void Node::invalidateSubtreeBounds()
+{
+	// a node with dirty bounds has dirty ancestors, so the walk stops at the first dirty one
+	Node* pNode = this ;
+	while( pNode && !pNode->m_subtreeBoundsDirty ) {
+		pNode->m_subtreeBoundsDirty = true ;
+		pNode = pNode->m_parent ;
+	}
+}
+
+void Node::getSubtreeBounds( Vector2& boundsMin, Vector2& boundsMax ) const
+{
+	if( m_subtreeBoundsDirty ) {
+		const Polygon2f& obb = getTransformedAABB() ;
+		if( obb.getCount() > 0 ) {
+			m_subtreeMin = m_subtreeMax = obb.getVertex(0) ;
+			for( int i=1; i<obb.getCount(); i++ ) {
+				const Vector2& v = obb.getVertex(i) ;
+				m_subtreeMin = glm::min( m_subtreeMin, v ) ;
+				m_subtreeMax = glm::max( m_subtreeMax, v ) ;
+			}
+		}
+		else {
+			m_subtreeMin = m_subtreeMax = getTranslate( getWorldTform() ) ;
+		}
+
+		Vector2 childMin, childMax ;
+		for( NodesList::const_iterator it = m_children.begin(); it != m_children.end(); it++ ) {
+			(*it)->getSubtreeBounds( childMin, childMax ) ;
+			m_subtreeMin = glm::min( m_subtreeMin, childMin ) ;
+			m_subtreeMax = glm::max( m_subtreeMax, childMax ) ;
+		}
+
+		m_subtreeBoundsDirty = false ;
+	}
+
+	boundsMin = m_subtreeMin ;
+	boundsMax = m_subtreeMax ;
+}
+
+bool Node::isInCullingView( Camera* pCamera ) const
+{
+	// a child with its own camera is drawn with a different view
+	if( m_pCamera ) {
+		return true ;
+	}
+
+	// the frustum is computed once per frame and camera, in the 2d space scaled by the global ratio
+	if( pCamera != s_pCullingCamera ) {
+		Matrix4 globalScaleMat = jam::createScaleMatrix3D( Vector3(Draw3DManager::RatioX, Draw3DManager::RatioY, 1.0f) ) ;
+		s_cullingFrustum = pCamera->getFrustum( globalScaleMat ) ;
+		s_pCullingCamera = pCamera ;
+	}
+
+	Vector2 boundsMin, boundsMax ;
+	getSubtreeBounds( boundsMin, boundsMax ) ;
+	if( s_cullingFrustum.intersects( boundsMin, boundsMax ) ) {
+		return true ;
+	}
+
+	s_culledSubtrees++ ;
+	return false ;
+}
+
+void Node::resetCulling()
+{
+	s_pCullingCamera = 0 ;
+	s_culledSubtrees = 0 ;
+}
+
+U32 Node::getNumOfCulledSubtrees()
+{
+	return s_culledSubtrees ;
+}
+
 void Node::setAABB( const AABB& aabb )
 {
 	m_aabb = aabb ;
@@ -1064,6 +1185,11 @@ void Node::onEnter()
 
 	GetActionMgr().resumeTarget(this);
 
+	if( m_interpolated && !m_running ) {
+		resetInterpolation() ;
+		GetAppMgr().getScene()->addInterpolatedNode(this) ;
+	}
+
 	m_running = true;
 }
 
@@ -1071,6 +1197,10 @@ void Node::onExit()
 {
 	GetActionMgr().pauseTarget(this);
 
+	if( m_interpolated && m_running ) {
+		GetAppMgr().getScene()->removeInterpolatedNode(this) ;
+	}
+
 	m_running = false;
 
 	for( NodesList::iterator it = m_children.begin(); it != m_children.end(); it++ ) {
@@ -1078,6 +1208,79 @@ void Node::onExit()
 	}
 }
 
+void Node::setInterpolated( bool val /*= true*/ )
+{
+	if( val == m_interpolated ) {
+		return ;
+	}
+
+	m_interpolated = val ;
+	if( m_running ) {
+		if( m_interpolated ) {
+			resetInterpolation() ;
+			GetAppMgr().getScene()->addInterpolatedNode(this) ;
+		}
+		else {
+			GetAppMgr().getScene()->removeInterpolatedNode(this) ;
+		}
+	}
+}
+
+void Node::resetInterpolation()
+{
+	m_prev_pos = m_local_pos ;
+	m_prev_angle = getRotationAngle() ;
+	m_prev_scl = m_local_scl ;
+}
+
+void Node::storeSimulationState()
+{
+	resetInterpolation() ;
+}
+
+bool Node::isInterpolationActive() const
+{
+	for( const Node* pNode = this; pNode != 0; pNode = pNode->m_parent ) {
+		if( pNode->m_interpolated ) {
+			return true ;
+		}
+	}
+	return false ;
+}
+
+Matrix3 Node::getRenderTform() const
+{
+	if( !isInterpolationActive() ) {
+		return getWorldTform() ;
+	}
+
+	Matrix3 local = getLocalTform() ;
+	if( m_interpolated ) {
+		float alpha = GetAppMgr().getInterpolationAlpha() ;
+
+		// rotate along the shortest arc
+		float deltaAngle = fmodf( getRotationAngle() - m_prev_angle + 540.0f, 360.0f ) - 180.0f ;
+
+		local = jam::createScaleMatrix2D( glm::mix(m_prev_scl, m_local_scl, alpha) ) ;
+		local *= createRotationMatrix2D( -(m_prev_angle + deltaAngle * alpha) ) ;
+		jam::setTranslate( local, glm::mix(m_prev_pos, m_local_pos, alpha) ) ;
+	}
+
+	// inverted mul order
+	return m_parent ? m_parent->getRenderTform() * local : local ;
+}
+
+const Polygon2f& Node::getRenderTransformedAABB() const
+{
+	if( !isInterpolationActive() ) {
+		return getTransformedAABB() ;
+	}
+
+	m_renderObb = Polygon2f(m_aabb) ;
+	m_renderObb.transform( getRenderTform() ) ;
+	return m_renderObb ;
+}
+
 uint64_t Node::getLifeTime() const
 {
 	return GetAppMgr().getTotalElapsedMs() - m_lifeTime;
@@ -1108,6 +1311,7 @@ void Node::insertChild( Node* child, int z )
 	{
 		m_children.push_back(Ref<Node>(child,true));
 	}
+	invalidateSubtreeBounds() ;
 
 	child->setZOrder(z);
 }
@@ -1138,6 +1342,7 @@ void Node::detachChild( Node *child, bool doCleanup )
 
 	Ref<Node> rChild(child,true) ;
 	m_children.remove(rChild);
+	invalidateSubtreeBounds() ;
 
 	// set parent nil at the end
 	child->setParent(nullptr);
@@ -1393,9 +1598,9 @@ Camera* Node::getAncestorCamera()
 	return m_pCamera ;
 }
 	
-CollisionEventArgs* CollisionEventArgs::create( Node* src, Node* dst )
+CollisionEventArgs* CollisionEventArgs::create( Node* src, Node* dst, const Vector2& normal, float depth )
 {
-	CollisionEventArgs* collEvtArgs = new CollisionEventArgs(src,dst) ;
+	CollisionEventArgs* collEvtArgs = new CollisionEventArgs(src,dst,normal,depth) ;
 	return collEvtArgs ;
 }
 
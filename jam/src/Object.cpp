@@ -42,47 +42,49 @@ namespace jam
 	{
 	}
 */
-	NamedObject::NamedObject()
+	NamedObject::NamedObject() :
+		m_name( Name::fromId(this) )
 	{
-		m_name = generateID(this) ;
 	}
 	String NamedObject::getName() const
 	{
-		return m_name ;
+		// anonymous names are materialized only when asked for
+		return m_name.isAnonymous() ? generateID(this) : m_name.str() ;
 	}
 	void NamedObject::setName(const String& name)
 	{
-		m_name = name ;
+		m_name = Name(name) ;
 	}
 
 	String TaggedObject::getTag() const
 	{
-		return m_tag ;
+		return m_tag.str() ;
 	}
 	void TaggedObject::setTag(const String& tag)
 	{
-		m_tag = tag ;
+		m_tag = Name(tag) ;
 	}
 
-	NamedTaggedObject::NamedTaggedObject()
+	NamedTaggedObject::NamedTaggedObject() :
+		m_name( Name::fromId(this) ),
+		m_tag()
 	{
-		m_name = generateID(this) ;
 	}
 
 	String NamedTaggedObject::getName() const
 	{
-		return m_name ;
+		return m_name.isAnonymous() ? generateID(this) : m_name.str() ;
 	}
 	void NamedTaggedObject::setName(const String& name)
 	{
-		m_name = name ;
+		m_name = Name(name) ;
 	}
 	String NamedTaggedObject::getTag() const
 	{
-		return m_tag;
+		return m_tag.str() ;
 	}
 	void NamedTaggedObject::setTag(const String& tag)
 	{
-		m_tag = tag ;
+		m_tag = Name(tag) ;
 	}
 }
@@ -0,0 +1,197 @@
+/**********************************************************************************
+* 
+* ObjectAllocator.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/ObjectAllocator.h"
+#include "jam/core/bmkextras.hpp"
+
+#include <new>
+
+namespace jam
+{
+
+ObjectAllocator& ObjectAllocator::getDefault()
+{
+	// never destroyed, see ObjectAllocator
+	static ObjectAllocator* s_pDefault = new HeapObjectAllocator() ;
+	return *s_pDefault ;
+}
+
+//*******************
+//
+// Class HeapObjectAllocator
+//
+//*******************
+
+void* HeapObjectAllocator::allocate( size_t size )
+{
+	void* p = ::operator new( size ) ;
+	m_numOfBlocks.fetch_add( 1, std::memory_order_relaxed ) ;
+	return p ;
+}
+
+void HeapObjectAllocator::deallocate( void* p, size_t size )
+{
+	if( p ) {
+		m_numOfBlocks.fetch_sub( 1, std::memory_order_relaxed ) ;
+		::operator delete( p ) ;
+	}
+}
+
+//*******************
+//
+// Class FixedSizePool
+//
+//*******************
+
+FixedSizePool::FixedSizePool( size_t blockSize, size_t blocksPerChunk ) :
+	m_chunks(),
+	m_pFreeList(nullptr),
+	m_blockSize( Max(blockSize, sizeof(FreeBlock)) ),
+	m_blocksPerChunk( Max(blocksPerChunk, (size_t)1) ),
+	m_numOfBlocks(0)
+{
+}
+
+FixedSizePool::~FixedSizePool()
+{
+	JAM_ASSERT_MSG( m_numOfBlocks == 0, "FixedSizePool destroyed with %d live blocks", (int)m_numOfBlocks ) ;
+	for( U8* pChunk : m_chunks ) {
+		::operator delete( pChunk ) ;
+	}
+}
+
+void* FixedSizePool::allocate()
+{
+	if( !m_pFreeList ) {
+		// blocks are linked in address order, so consecutive allocations are contiguous
+		U8* pChunk = (U8*)::operator new( m_blockSize * m_blocksPerChunk ) ;
+		m_chunks.push_back( pChunk ) ;
+		for( size_t i=m_blocksPerChunk; i>0; i-- ) {
+			FreeBlock* pBlock = (FreeBlock*)(pChunk + (i-1) * m_blockSize) ;
+			pBlock->next = m_pFreeList ;
+			m_pFreeList = pBlock ;
+		}
+	}
+
+	FreeBlock* pBlock = m_pFreeList ;
+	m_pFreeList = pBlock->next ;
+	m_numOfBlocks++ ;
+	return pBlock ;
+}
+
+void FixedSizePool::deallocate( void* p )
+{
+	JAM_ASSERT( m_numOfBlocks > 0 ) ;
+	FreeBlock* pBlock = (FreeBlock*)p ;
+	pBlock->next = m_pFreeList ;
+	m_pFreeList = pBlock ;
+	m_numOfBlocks-- ;
+}
+
+//*******************
+//
+// Class PoolObjectAllocator
+//
+//*******************
+
+PoolObjectAllocator::PoolObjectAllocator( size_t blocksPerChunk /*= JAM_OBJECT_POOL_BLOCKS_PER_CHUNK*/ ) :
+	m_blocksPerChunk(blocksPerChunk),
+	m_heap(),
+	m_mutex()
+{
+	for( size_t i=0; i<NumOfPools; i++ ) {
+		m_pools[i] = nullptr ;
+	}
+}
+
+PoolObjectAllocator::~PoolObjectAllocator()
+{
+	for( size_t i=0; i<NumOfPools; i++ ) {
+		JAM_DELETE( m_pools[i] ) ;
+	}
+}
+
+void* PoolObjectAllocator::allocate( size_t size )
+{
+	if( size == 0 || size > JAM_OBJECT_POOL_MAX_SIZE ) {
+		return m_heap.allocate( size ) ;
+	}
+
+	size_t idx = (size - 1) / JAM_OBJECT_POOL_GRANULARITY ;
+	std::lock_guard<std::mutex> lock(m_mutex) ;
+	if( !m_pools[idx] ) {
+		m_pools[idx] = new FixedSizePool( (idx + 1) * JAM_OBJECT_POOL_GRANULARITY, m_blocksPerChunk ) ;
+	}
+	return m_pools[idx]->allocate() ;
+}
+
+void PoolObjectAllocator::deallocate( void* p, size_t size )
+{
+	if( !p ) {
+		return ;
+	}
+
+	if( size == 0 || size > JAM_OBJECT_POOL_MAX_SIZE ) {
+		m_heap.deallocate( p, size ) ;
+		return ;
+	}
+
+	size_t idx = (size - 1) / JAM_OBJECT_POOL_GRANULARITY ;
+	std::lock_guard<std::mutex> lock(m_mutex) ;
+	JAM_ASSERT_MSG( m_pools[idx], "PoolObjectAllocator::deallocate() : block of %d bytes not allocated by this allocator", (int)size ) ;
+	m_pools[idx]->deallocate( p ) ;
+}
+
+size_t PoolObjectAllocator::getNumOfBlocks() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex) ;
+	size_t numOfBlocks = m_heap.getNumOfBlocks() ;
+	for( size_t i=0; i<NumOfPools; i++ ) {
+		if( m_pools[i] ) {
+			numOfBlocks += m_pools[i]->getNumOfBlocks() ;
+		}
+	}
+	return numOfBlocks ;
+}
+
+size_t PoolObjectAllocator::getCapacity() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex) ;
+	size_t capacity = 0 ;
+	for( size_t i=0; i<NumOfPools; i++ ) {
+		if( m_pools[i] ) {
+			capacity += m_pools[i]->getCapacity() * m_pools[i]->getBlockSize() ;
+		}
+	}
+	return capacity ;
+}
+
+}
@@ -0,0 +1,262 @@
+/**********************************************************************************
+* 
+* PickGrid.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/PickGrid.h"
+#include "jam/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace jam
+{
+
+const float PickGrid::DefaultCellSize = 128.0f ;
+const size_t PickGrid::DefaultNumOfBuckets = 1024 ;
+const I32 PickGrid::MaxCellsPerNode = 64 ;
+
+PickGrid::PickGrid( float cellSize, size_t numOfBuckets ) :
+	m_nodes(), m_buckets(), m_largeNodes(), m_bucketMask(0),
+	m_cellSize(cellSize), m_invCellSize(1.0f/cellSize), m_frame(1), m_order(0)
+{
+	size_t size = 1 ;
+	while( size < numOfBuckets ) {
+		size <<= 1 ;
+	}
+	m_buckets.resize( size ) ;
+	m_bucketMask = size - 1 ;
+}
+
+PickGrid::~PickGrid()
+{
+	clear() ;
+}
+
+void PickGrid::newFrame()
+{
+	m_frame++ ;
+	m_order = 0 ;
+}
+
+void PickGrid::update( Node* pNode )
+{
+	PickProxy& proxy = pNode->m_pickProxy ;
+	proxy.frame = m_frame ;
+	proxy.order = m_order++ ;
+
+	const Polygon2f& bounds = pNode->getTransformedAABB() ;
+	if( bounds.getCount() == 0 ) {
+		return ;
+	}
+
+	Vector2 minP = bounds.getVertex(0) ;
+	Vector2 maxP = minP ;
+	for( int i=1; i<bounds.getCount(); i++ ) {
+		const Vector2& v = bounds.getVertex(i) ;
+		minP.x = Min( minP.x, v.x ) ;
+		minP.y = Min( minP.y, v.y ) ;
+		maxP.x = Max( maxP.x, v.x ) ;
+		maxP.y = Max( maxP.y, v.y ) ;
+	}
+
+	I32 minX = (I32)floorf( minP.x * m_invCellSize ) ;
+	I32 minY = (I32)floorf( minP.y * m_invCellSize ) ;
+	I32 maxX = (I32)floorf( maxP.x * m_invCellSize ) ;
+	I32 maxY = (I32)floorf( maxP.y * m_invCellSize ) ;
+
+	if( proxy.slot >= 0 ) {
+		// most nodes do not leave their cells from a frame to the next
+		if( minX == proxy.minX && minY == proxy.minY && maxX == proxy.maxX && maxY == proxy.maxY ) {
+			return ;
+		}
+		removeCells( pNode ) ;
+	}
+	else {
+		proxy.slot = (I32)m_nodes.size() ;
+		m_nodes.push_back( Ref<Node>(pNode,true) ) ;
+	}
+
+	proxy.minX = minX ;
+	proxy.minY = minY ;
+	proxy.maxX = maxX ;
+	proxy.maxY = maxY ;
+	insertCells( pNode ) ;
+}
+
+void PickGrid::removeStale()
+{
+	JAM_PROFILE("PickGrid.removeStale") ;
+
+	for( size_t i=0; i<m_nodes.size(); ) {
+		Node* pNode = m_nodes[i].get() ;
+		if( pNode->m_pickProxy.frame != m_frame ) {
+			remove( pNode ) ;		// the last node takes slot i
+		}
+		else {
+			i++ ;
+		}
+	}
+}
+
+void PickGrid::remove( Node* pNode )
+{
+	PickProxy& proxy = pNode->m_pickProxy ;
+	if( proxy.slot < 0 ) {
+		return ;
+	}
+
+	removeCells( pNode ) ;
+
+	size_t slot = (size_t)proxy.slot ;
+	proxy.slot = -1 ;
+	if( slot != m_nodes.size() - 1 ) {
+		m_nodes[slot] = m_nodes.back() ;
+		m_nodes[slot]->m_pickProxy.slot = (I32)slot ;
+	}
+	// may delete the node, proxy must not be used after this line
+	m_nodes.pop_back() ;
+}
+
+void PickGrid::clear()
+{
+	for( size_t i=0; i<m_nodes.size(); i++ ) {
+		m_nodes[i]->m_pickProxy.slot = -1 ;
+	}
+	for( size_t i=0; i<m_buckets.size(); i++ ) {
+		m_buckets[i].clear() ;
+	}
+	m_largeNodes.clear() ;
+	m_nodes.clear() ;
+}
+
+Node* PickGrid::pick( const Vector2& p ) const
+{
+	Node* pTop = 0 ;
+	U32 topOrder = 0 ;
+
+	const std::vector<Node*>& bucket = m_buckets[getBucket( (I32)floorf(p.x*m_invCellSize), (I32)floorf(p.y*m_invCellSize) )] ;
+	for( size_t i=0; i<bucket.size(); i++ ) {
+		Node* pNode = bucket[i] ;
+		if( (!pTop || pNode->m_pickProxy.order > topOrder) && hit(pNode,p) ) {
+			pTop = pNode ;
+			topOrder = pNode->m_pickProxy.order ;
+		}
+	}
+
+	for( size_t i=0; i<m_largeNodes.size(); i++ ) {
+		Node* pNode = m_largeNodes[i] ;
+		if( (!pTop || pNode->m_pickProxy.order > topOrder) && hit(pNode,p) ) {
+			pTop = pNode ;
+			topOrder = pNode->m_pickProxy.order ;
+		}
+	}
+
+	return pTop ;
+}
+
+void PickGrid::pickAll( const Vector2& p, std::vector<Node*>& results ) const
+{
+	size_t first = results.size() ;
+
+	const std::vector<Node*>& bucket = m_buckets[getBucket( (I32)floorf(p.x*m_invCellSize), (I32)floorf(p.y*m_invCellSize) )] ;
+	for( size_t i=0; i<bucket.size(); i++ ) {
+		if( hit(bucket[i],p) ) {
+			results.push_back( bucket[i] ) ;
+		}
+	}
+	for( size_t i=0; i<m_largeNodes.size(); i++ ) {
+		if( hit(m_largeNodes[i],p) ) {
+			results.push_back( m_largeNodes[i] ) ;
+		}
+	}
+
+	std::sort( results.begin() + first, results.end(),
+		[]( const Node* a, const Node* b ) { return a->m_pickProxy.order > b->m_pickProxy.order ; } ) ;
+	// cells of the same node can share a bucket
+	results.erase( std::unique( results.begin() + first, results.end() ), results.end() ) ;
+}
+
+size_t PickGrid::getBucket( I32 cx, I32 cy ) const
+{
+	return ( (size_t)((U32)cx * 73856093u) ^ (size_t)((U32)cy * 19349663u) ) & m_bucketMask ;
+}
+
+bool PickGrid::isLarge( const PickProxy& proxy ) const
+{
+	return (I64)(proxy.maxX - proxy.minX + 1) * (I64)(proxy.maxY - proxy.minY + 1) > MaxCellsPerNode ;
+}
+
+void PickGrid::insertCells( Node* pNode )
+{
+	const PickProxy& proxy = pNode->m_pickProxy ;
+	if( isLarge(proxy) ) {
+		m_largeNodes.push_back( pNode ) ;
+		return ;
+	}
+
+	for( I32 cy=proxy.minY; cy<=proxy.maxY; cy++ ) {
+		for( I32 cx=proxy.minX; cx<=proxy.maxX; cx++ ) {
+			m_buckets[getBucket(cx,cy)].push_back( pNode ) ;
+		}
+	}
+}
+
+void PickGrid::removeCells( Node* pNode )
+{
+	const PickProxy& proxy = pNode->m_pickProxy ;
+	if( isLarge(proxy) ) {
+		auto it = std::find( m_largeNodes.begin(), m_largeNodes.end(), pNode ) ;
+		if( it != m_largeNodes.end() ) {
+			*it = m_largeNodes.back() ;
+			m_largeNodes.pop_back() ;
+		}
+		return ;
+	}
+
+	// a node is pushed once per cell, so it is removed once per cell
+	for( I32 cy=proxy.minY; cy<=proxy.maxY; cy++ ) {
+		for( I32 cx=proxy.minX; cx<=proxy.maxX; cx++ ) {
+			std::vector<Node*>& bucket = m_buckets[getBucket(cx,cy)] ;
+			auto it = std::find( bucket.begin(), bucket.end(), pNode ) ;
+			if( it != bucket.end() ) {
+				*it = bucket.back() ;
+				bucket.pop_back() ;
+			}
+		}
+	}
+}
+
+bool PickGrid::hit( const Node* pNode, const Vector2& p ) const
+{
+	return pNode->m_pickProxy.frame == m_frame && pNode->getTransformedAABB().isPointInsideQuad(p) ;
+}
+
+}
@@ -35,6 +35,7 @@
 #include <jam/core/geom.h>
 
 #include <math.h>
+#include <float.h>
 
 #define JAM_POLYGON2D_ORDERCW
 
@@ -158,6 +159,31 @@ namespace jam
 		return true;
 	}
 
+	bool Polygon2f::intersects( const Polygon2f& poly, Vector2& normal, float& depth ) const
+	{
+		normal = Vector2(0.0f) ;
+		depth = FLT_MAX ;
+
+		if( m_count==0 || poly.m_count==0 ) {
+			return false ;
+		}
+
+		if( !findMinimumOverlap(poly, normal, depth) || !poly.findMinimumOverlap(*this, normal, depth) ) {
+			return false ;
+		}
+
+		// only degenerate polygons have no axis
+		if( depth == FLT_MAX ) {
+			depth = 0.0f ;
+		}
+
+		if( glm::dot(poly.getVertexMean() - getVertexMean(), normal) < 0.0f ) {
+			normal = -normal ;
+		}
+
+		return true ;
+	}
+
 	bool Polygon2f::intersects( const Vector2& p0, const Vector2& p1 )
 	{
 		// for algorithm see: http://softsurfer.com/algorithm_archive.htm
@@ -319,6 +345,46 @@ namespace jam
 		return intervalsSeparated(mina, maxa, minb, maxb);
 	}
 
+	bool Polygon2f::findMinimumOverlap(const Polygon2f& poly, Vector2& normal, float& depth) const
+	{
+		for(int j = m_count-1, i = 0; i < m_count; j = i, i ++)
+		{
+			Vector2 edge = m_vertices[i] - m_vertices[j] ;
+			float length = glm::length(edge) ;
+			if( length <= 0.0f ) {
+				continue ;
+			}
+
+			// unit axis, so that overlaps along different axes can be compared
+			Vector2 axis = Vector2(-edge.y, edge.x) / length ;
+
+			float mina, maxa;
+			float minb, maxb;
+			calculateInterval(axis, mina, maxa);
+			poly.calculateInterval(axis, minb, maxb);
+			if( intervalsSeparated(mina, maxa, minb, maxb) ) {
+				return false ;
+			}
+
+			float overlap = Min(maxa, maxb) - Max(mina, minb) ;
+			if( overlap < depth ) {
+				depth = overlap ;
+				normal = axis ;
+			}
+		}
+
+		return true ;
+	}
+
+	Vector2 Polygon2f::getVertexMean() const
+	{
+		Vector2 sum(0.0f) ;
+		for( int i=0; i<m_count; i++ ) {
+			sum += m_vertices[i] ;
+		}
+		return m_count ? sum / (float)m_count : sum ;
+	}
+
 	bool clockwise( const Vector2 &O, const Vector2 &A, const Vector2 &B )
 	{
 		return (A.x - O.x) * (B.y - O.y) - (A.y - O.y) * (B.x - O.x) <= 0; 
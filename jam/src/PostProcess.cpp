@@ -0,0 +1,351 @@
+/**********************************************************************************
+* 
+* PostProcess.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/PostProcess.h"
+#include "jam/RenderTargetPool.h"
+#include "jam/Shader.h"
+#include "jam/Texture2D.h"
+#include "jam/DeviceManager.h"
+#include "jam/Gfx.h"
+#include "jam/Profiler.h"
+
+#include <algorithm>
+
+namespace jam
+{
+
+// postfx programs are made of a fragment shader linked with the screen vertex shader, they are loaded on first use
+static Shader* getPostProcessShader( const String& name )
+{
+	return GetShaderMgr().getOrCreateProgram( name, ShaderManager::SCREEN_PROGRAM_NAME ) ;
+}
+
+//*******************
+//
+// Class PostProcessPass
+//
+//*******************
+
+PostProcessPass::PostProcessPass() : m_enabled(true)
+{
+}
+
+PostProcessPass::~PostProcessPass()
+{
+}
+
+
+//*******************
+//
+// Class ShaderPass
+//
+//*******************
+
+ShaderPass::ShaderPass( Shader* pShader ) : PostProcessPass(), m_pShader(pShader)
+{
+}
+
+void ShaderPass::render( PostProcessChain& chain, Texture2D* pSource, RenderTarget* pTarget )
+{
+	m_pShader->use() ;
+	chain.bindTexture( m_pShader, "material_diffuse", pSource, 0 ) ;
+	setUniforms( m_pShader ) ;
+	chain.drawFullscreen( m_pShader, pTarget ) ;
+}
+
+void ShaderPass::setUniforms( Shader* pShader )
+{
+}
+
+
+//*******************
+//
+// Class ColorGradingPass
+//
+//*******************
+
+ColorGradingPass::ColorGradingPass() :
+	ShaderPass( getPostProcessShader(ShaderManager::POSTFX_COLOR_GRADING_PROGRAM_NAME) ),
+	m_exposure(1.0f), m_contrast(1.0f), m_saturation(1.0f), m_tint(Color::WHITE)
+{
+}
+
+void ColorGradingPass::setUniforms( Shader* pShader )
+{
+	glm::vec4 tint = m_tint.getFloatingComponents() ;
+	pShader->setUniform( "exposure", m_exposure ) ;
+	pShader->setUniform( "contrast", m_contrast ) ;
+	pShader->setUniform( "saturation", m_saturation ) ;
+	pShader->setUniform( "tint", Vector3(tint.r,tint.g,tint.b) ) ;
+}
+
+
+//*******************
+//
+// Class BloomPass
+//
+//*******************
+
+BloomPass::BloomPass() : PostProcessPass(),
+	m_threshold(0.7f), m_intensity(1.0f), m_downsample(2), m_blurIterations(2)
+{
+}
+
+void BloomPass::setDownsample( U32 val )
+{
+	JAM_ASSERT_MSG( val > 0, "BloomPass::setDownsample() : downsample must be greater than 0" ) ;
+	m_downsample = val ;
+}
+
+void BloomPass::render( PostProcessChain& chain, Texture2D* pSource, RenderTarget* pTarget )
+{
+	U32 w = std::max( chain.getWidth() / m_downsample, 1U ) ;
+	U32 h = std::max( chain.getHeight() / m_downsample, 1U ) ;
+	RenderTarget* pBright = chain.acquireTarget( w, h ) ;
+	RenderTarget* pBlur = chain.acquireTarget( w, h ) ;
+
+	// bright areas, downsampled
+	Shader* pShader = getPostProcessShader( ShaderManager::POSTFX_BRIGHT_PROGRAM_NAME ) ;
+	pShader->use() ;
+	chain.bindTexture( pShader, "material_diffuse", pSource, 0 ) ;
+	pShader->setUniform( "threshold", m_threshold ) ;
+	chain.drawFullscreen( pShader, pBright ) ;
+
+	// separable blur, ping-ponging between the two targets
+	pShader = getPostProcessShader( ShaderManager::POSTFX_BLUR_PROGRAM_NAME ) ;
+	pShader->use() ;
+	for( int i=0; i<m_blurIterations; i++ ) {
+		chain.bindTexture( pShader, "material_diffuse", pBright->getTexture(), 0 ) ;
+		pShader->setUniform( "direction", 1.0f / w, 0.0f ) ;
+		chain.drawFullscreen( pShader, pBlur ) ;
+
+		chain.bindTexture( pShader, "material_diffuse", pBlur->getTexture(), 0 ) ;
+		pShader->setUniform( "direction", 0.0f, 1.0f / h ) ;
+		chain.drawFullscreen( pShader, pBright ) ;
+	}
+	chain.releaseTarget( pBlur ) ;
+
+	// composite
+	pShader = getPostProcessShader( ShaderManager::POSTFX_BLOOM_PROGRAM_NAME ) ;
+	pShader->use() ;
+	chain.bindTexture( pShader, "material_diffuse", pSource, 0 ) ;
+	chain.bindTexture( pShader, "bloom_texture", pBright->getTexture(), 1 ) ;
+	pShader->setUniform( "intensity", m_intensity ) ;
+	chain.drawFullscreen( pShader, pTarget ) ;
+	chain.releaseTarget( pBright ) ;
+}
+
+
+//*******************
+//
+// Class PostProcessChain
+//
+//*******************
+
+PostProcessChain::PostProcessChain() :
+	m_passes(),
+	m_format(GL_RGBA8),
+	m_width(0),
+	m_height(0),
+	m_pSceneTarget(0),
+	m_pOutput(0),
+	m_vao(),
+	m_vbo(GL_ARRAY_BUFFER),
+	m_uploaded(false)
+{
+}
+
+PostProcessChain::~PostProcessChain()
+{
+	JAM_ASSERT_MSG( m_pSceneTarget == 0, "PostProcessChain destroyed between begin() and end()" ) ;
+	if( m_uploaded ) {
+		m_vao.destroy() ;
+		m_vbo.destroy() ;
+	}
+}
+
+void PostProcessChain::addPass( PostProcessPass* pPass )
+{
+	m_passes.push_back( Ref<PostProcessPass>(pPass,true) ) ;
+}
+
+void PostProcessChain::removePass( PostProcessPass* pPass )
+{
+	for( auto it = m_passes.begin(); it != m_passes.end(); ++it ) {
+		if( it->get() == pPass ) {
+			m_passes.erase( it ) ;
+			break ;
+		}
+	}
+}
+
+void PostProcessChain::removeAllPasses()
+{
+	m_passes.clear() ;
+}
+
+bool PostProcessChain::begin()
+{
+	JAM_ASSERT_MSG( m_pSceneTarget == 0, "PostProcessChain::begin() called twice" ) ;
+
+	bool anyEnabled = false ;
+	for( size_t i=0; i<m_passes.size() && !anyEnabled; i++ ) {
+		anyEnabled = m_passes[i]->isEnabled() ;
+	}
+	if( !anyEnabled ) {
+		return false ;
+	}
+
+	m_width = (U32)GetDeviceMgr().getNativeDisplayWidth() ;
+	m_height = (U32)GetDeviceMgr().getNativeDisplayHeight() ;
+	m_pSceneTarget = GetRenderTargetPool().acquire( m_width, m_height, m_format, true ) ;
+	m_pSceneTarget->bind() ;
+	GetGfx().clear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT ) ;
+	return true ;
+}
+
+void PostProcessChain::end( RenderTarget* pOutput /*= 0*/ )
+{
+	if( !m_pSceneTarget ) {
+		return ;
+	}
+
+	JAM_PROFILE_GPU("PostProcessChain.end") ;
+
+	// depth is not read by the passes, it doesn't need to be stored
+	m_pSceneTarget->discardDepth() ;
+
+	m_pOutput = pOutput ;
+	GLboolean blending = glIsEnabled( GL_BLEND ) ;
+	glDisable( GL_BLEND ) ;
+	GetGfx().setDepthTest( false ) ;
+
+	size_t lastPass = m_passes.size() ;
+	for( size_t i=0; i<m_passes.size(); i++ ) {
+		if( m_passes[i]->isEnabled() ) {
+			lastPass = i ;
+		}
+	}
+
+	RenderTarget* pSource = m_pSceneTarget ;
+	for( size_t i=0; i<=lastPass; i++ ) {
+		PostProcessPass* pPass = m_passes[i].get() ;
+		if( !pPass->isEnabled() ) {
+			continue ;
+		}
+
+		RenderTarget* pTarget = (i == lastPass) ? 0 : acquireTarget( m_width, m_height ) ;
+		pPass->render( *this, pSource->getTexture(), pTarget ) ;
+		releaseTarget( pSource ) ;
+		pSource = pTarget ;
+	}
+	m_pSceneTarget = 0 ;
+	m_pOutput = 0 ;
+
+	glActiveTexture( GL_TEXTURE1 ) ;
+	glBindTexture( GL_TEXTURE_2D, 0 ) ;
+	glActiveTexture( GL_TEXTURE0 ) ;
+	glBindTexture( GL_TEXTURE_2D, 0 ) ;
+	GetGfx().setDepthTest( true ) ;
+	if( blending ) {
+		glEnable( GL_BLEND ) ;
+	}
+}
+
+RenderTarget* PostProcessChain::acquireTarget( U32 width, U32 height )
+{
+	return GetRenderTargetPool().acquire( width, height, m_format, false ) ;
+}
+
+void PostProcessChain::releaseTarget( RenderTarget* pTarget )
+{
+	GetRenderTargetPool().release( pTarget ) ;
+}
+
+void PostProcessChain::bindTexture( Shader* pShader, const char* uniformName, Texture2D* pTexture, int unit )
+{
+	glActiveTexture( GL_TEXTURE0 + unit ) ;
+	glBindTexture( GL_TEXTURE_2D, pTexture->getId() ) ;
+	pShader->setUniform( uniformName, (GLint)unit ) ;
+}
+
+void PostProcessChain::drawFullscreen( Shader* pShader, RenderTarget* pTarget )
+{
+	if( !pTarget ) {
+		pTarget = m_pOutput ;
+	}
+
+	if( pTarget ) {
+		pTarget->bind() ;
+		// every pixel is overwritten, so the previous content doesn't need to be loaded nor cleared
+		pTarget->discard() ;
+	}
+	else {
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 ) ;
+		GetGfx().setViewport( 0, 0, m_width, m_height ) ;
+	}
+
+	if( !m_uploaded ) {
+		upload() ;
+	}
+
+	// attribute locations can differ between programs, so pointers are set for every draw
+	m_vao.bind() ;
+	m_vbo.bind() ;
+	pShader->setVertexAttribPointer( JAM_PROGRAM_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), 0 ) ;
+	pShader->enableVertexAttribArray( JAM_PROGRAM_ATTRIB_POSITION ) ;
+	pShader->setVertexAttribPointer( JAM_PROGRAM_ATTRIB_TEXCOORDS, 2, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), (const GLvoid*)(2*sizeof(GLfloat)) ) ;
+	pShader->enableVertexAttribArray( JAM_PROGRAM_ATTRIB_TEXCOORDS ) ;
+	glDrawArrays( GL_TRIANGLES, 0, 3 ) ;
+	GetGfx().countDrawCall() ;
+	m_vbo.unbind() ;
+	m_vao.unbind() ;
+}
+
+void PostProcessChain::upload()
+{
+	// a single triangle covering the screen, avoids the diagonal seam of a quad
+	static const GLfloat fullscreenTriangle[] = {
+	//	  x      y     u     v
+		-1.0f, -1.0f, 0.0f, 0.0f,
+		 3.0f, -1.0f, 2.0f, 0.0f,
+		-1.0f,  3.0f, 0.0f, 2.0f,
+	} ;
+
+	m_vao.create() ;
+	m_vbo.create() ;
+	m_vbo.bind() ;
+	m_vbo.bufferData( sizeof(fullscreenTriangle), fullscreenTriangle ) ;
+	m_vbo.unbind() ;
+	m_uploaded = true ;
+}
+
+}
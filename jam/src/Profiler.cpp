@@ -0,0 +1,423 @@
+/**********************************************************************************
+* 
+* Profiler.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include <jam/Profiler.h>
+#include <jam/SysTimer.h>
+
+#include <GL/glew.h>
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jam
+{
+
+enum class ProfileEventType : U8 {
+	Zone,
+	GpuZone,
+	Counter
+};
+
+struct ProfileEvent {
+	const char*			name ;
+	uint64_t			startNs ;
+	uint64_t			durationNs ;
+	double				value ;
+	ProfileEventType	type ;
+};
+
+// events of a single thread: only the owner thread writes, the count is published with release semantic
+struct ProfileThreadBuffer {
+	std::vector<ProfileEvent>	events ;
+	std::atomic<size_t>			count ;
+	std::atomic<size_t>			dropped ;
+	U32							threadId ;
+	std::thread::id				owner ;
+};
+
+struct GpuProfileZoneQueries {
+	const char*			name ;
+	GLuint				queries[2] ;
+};
+
+struct GpuProfileFrame {
+	GpuProfileZoneQueries	zones[JAM_PROFILER_GPU_ZONES_PER_FRAME] ;
+	size_t					numOfZones ;
+	int64_t					gpuToCpuNs ;		// offset from GPU to CPU timeline
+};
+
+static std::mutex							s_buffersMutex ;
+static std::vector<ProfileThreadBuffer*>	s_buffers ;
+static thread_local ProfileThreadBuffer*	t_pBuffer = nullptr ;
+
+// GPU zones are only recorded by the GL thread, no need to synchronize
+static GpuProfileFrame		s_gpuFrames[JAM_PROFILER_GPU_LATENCY+1] ;
+static size_t				s_gpuFrameIdx = 0 ;
+static bool					s_gpuQueriesCreated = false ;
+static size_t				s_gpuZonesStack[JAM_PROFILER_GPU_ZONES_PER_FRAME] ;
+static size_t				s_gpuZonesStackSize = 0 ;
+
+static std::thread::id		s_mainThreadId ;
+static size_t				s_framesToCapture = 0 ;
+static std::string			s_captureFileName ;
+
+std::atomic<bool>			Profiler::m_capturing(false) ;
+std::atomic<bool>			Profiler::m_detailEnabled(true) ;
+
+//*******************
+//
+// Helpers
+//
+//*******************
+
+static ProfileThreadBuffer* getThreadBuffer()
+{
+	if( !t_pBuffer ) {
+		ProfileThreadBuffer* pBuffer = new ProfileThreadBuffer() ;
+		pBuffer->events.resize( JAM_PROFILER_EVENTS_PER_THREAD ) ;
+		pBuffer->count = 0 ;
+		pBuffer->dropped = 0 ;
+		pBuffer->owner = std::this_thread::get_id() ;
+
+		std::lock_guard<std::mutex> lock(s_buffersMutex) ;
+		pBuffer->threadId = (U32)s_buffers.size() + 1 ;		// 0 is the GPU track
+		s_buffers.push_back( pBuffer ) ;
+		t_pBuffer = pBuffer ;
+	}
+	return t_pBuffer ;
+}
+
+static void recordEvent( const char* name, uint64_t startNs, uint64_t durationNs, double value, ProfileEventType type )
+{
+	ProfileThreadBuffer* pBuffer = getThreadBuffer() ;
+	size_t n = pBuffer->count.load( std::memory_order_relaxed ) ;
+	if( n >= pBuffer->events.size() ) {
+		pBuffer->dropped.fetch_add( 1, std::memory_order_relaxed ) ;
+		return ;
+	}
+
+	ProfileEvent& evt = pBuffer->events[n] ;
+	evt.name = name ;
+	evt.startNs = startNs ;
+	evt.durationNs = durationNs ;
+	evt.value = value ;
+	evt.type = type ;
+	pBuffer->count.store( n + 1, std::memory_order_release ) ;
+}
+
+static bool isGpuTimerAvailable()
+{
+	return GLEW_VERSION_3_3 || GLEW_ARB_timer_query ;
+}
+
+static void writeJsonString( FILE* fp, const char* s )
+{
+	fputc( '"', fp ) ;
+	for( ; *s; s++ ) {
+		if( *s == '"' || *s == '\\' ) {
+			fputc( '\\', fp ) ;
+			fputc( *s, fp ) ;
+		}
+		else if( (unsigned char)*s < 0x20 ) {
+			fprintf( fp, "\\u%04x", (unsigned)*s ) ;
+		}
+		else {
+			fputc( *s, fp ) ;
+		}
+	}
+	fputc( '"', fp ) ;
+}
+
+//*******************
+//
+// Class Profiler
+//
+//*******************
+
+void Profiler::start()
+{
+	m_capturing.store( true, std::memory_order_relaxed ) ;
+}
+
+void Profiler::stop()
+{
+	m_capturing.store( false, std::memory_order_relaxed ) ;
+}
+
+void Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex) ;
+	for( auto pBuffer : s_buffers ) {
+		pBuffer->count.store( 0, std::memory_order_relaxed ) ;
+		pBuffer->dropped.store( 0, std::memory_order_relaxed ) ;
+	}
+}
+
+void Profiler::captureFrames( size_t numOfFrames, const std::string& fileName )
+{
+	clear() ;
+	s_framesToCapture = numOfFrames ;
+	s_captureFileName = fileName ;
+	start() ;
+}
+
+bool Profiler::exportChromeTrace( const std::string& fileName )
+{
+	FILE* fp = fopen( fileName.c_str(), "wb" ) ;
+	if( !fp ) {
+		JAM_TRACE( "Cannot write trace file %s", fileName.c_str() ) ;
+		return false ;
+	}
+
+	fprintf( fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" ) ;
+	fprintf( fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}" ) ;
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex) ;
+	for( auto pBuffer : s_buffers ) {
+		if( pBuffer->owner == s_mainThreadId ) {
+			fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Main\"}}", pBuffer->threadId ) ;
+		}
+		else {
+			fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}", pBuffer->threadId, pBuffer->threadId ) ;
+		}
+
+		size_t numOfEvents = pBuffer->count.load( std::memory_order_acquire ) ;
+		for( size_t i=0; i<numOfEvents; i++ ) {
+			const ProfileEvent& evt = pBuffer->events[i] ;
+			fprintf( fp, ",\n{\"name\":" ) ;
+			writeJsonString( fp, evt.name ) ;
+
+			// timestamps are in microseconds
+			switch( evt.type )
+			{
+			case ProfileEventType::Zone:
+				fprintf( fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					pBuffer->threadId, evt.startNs / 1000.0, evt.durationNs / 1000.0 ) ;
+				break ;
+			case ProfileEventType::GpuZone:
+				fprintf( fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+					evt.startNs / 1000.0, evt.durationNs / 1000.0 ) ;
+				break ;
+			case ProfileEventType::Counter:
+				fprintf( fp, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.17g}}",
+					pBuffer->threadId, evt.startNs / 1000.0, evt.value ) ;
+				break ;
+			}
+		}
+	}
+
+	fprintf( fp, "\n]}\n" ) ;
+	bool ok = (ferror(fp) == 0) ;
+	fclose( fp ) ;
+	return ok ;
+}
+
+void Profiler::getStats( std::vector<ProfileStats>& stats )
+{
+	stats.clear() ;
+
+	// names are compared by content, the same literal can have different addresses in different modules
+	std::map<std::pair<int,std::string>,size_t> indices ;
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex) ;
+	for( auto pBuffer : s_buffers ) {
+		size_t numOfEvents = pBuffer->count.load( std::memory_order_acquire ) ;
+		for( size_t i=0; i<numOfEvents; i++ ) {
+			const ProfileEvent& evt = pBuffer->events[i] ;
+			ProfileStats::Type type = (evt.type == ProfileEventType::Zone) ? ProfileStats::Type::Zone :
+									  (evt.type == ProfileEventType::GpuZone) ? ProfileStats::Type::GpuZone : ProfileStats::Type::Counter ;
+			double value = (type == ProfileStats::Type::Counter) ? evt.value : (double)evt.durationNs ;
+
+			auto it = indices.insert( std::make_pair( std::make_pair((int)type, std::string(evt.name)), stats.size() ) ).first ;
+			if( it->second == stats.size() ) {
+				ProfileStats s ;
+				s.name = evt.name ;
+				s.type = type ;
+				s.count = 0 ;
+				s.total = 0.0 ;
+				s.min = value ;
+				s.max = value ;
+				stats.push_back( s ) ;
+			}
+
+			ProfileStats& s = stats[it->second] ;
+			s.count++ ;
+			s.total += value ;
+			s.min = (value < s.min) ? value : s.min ;
+			s.max = (value > s.max) ? value : s.max ;
+		}
+	}
+
+	// reorders the stats as the map, i.e. by type and name
+	std::vector<ProfileStats> sorted ;
+	sorted.reserve( stats.size() ) ;
+	for( const auto& it : indices ) {
+		sorted.push_back( stats[it.second] ) ;
+	}
+	stats.swap( sorted ) ;
+}
+
+void Profiler::newFrame()
+{
+	s_mainThreadId = std::this_thread::get_id() ;
+
+	// reads back the queries of the oldest frame, that is going to be reused
+	size_t nextIdx = (s_gpuFrameIdx + 1) % (JAM_PROFILER_GPU_LATENCY+1) ;
+	GpuProfileFrame& oldest = s_gpuFrames[nextIdx] ;
+	for( size_t i=0; i<oldest.numOfZones; i++ ) {
+		const GpuProfileZoneQueries& zone = oldest.zones[i] ;
+		GLuint64 startGpuNs = 0, endGpuNs = 0 ;
+		glGetQueryObjectui64v( zone.queries[0], GL_QUERY_RESULT, &startGpuNs ) ;
+		glGetQueryObjectui64v( zone.queries[1], GL_QUERY_RESULT, &endGpuNs ) ;
+		if( isCapturing() && endGpuNs >= startGpuNs ) {
+			recordEvent( zone.name, (uint64_t)((int64_t)startGpuNs + oldest.gpuToCpuNs), endGpuNs - startGpuNs, 0.0, ProfileEventType::GpuZone ) ;
+		}
+	}
+	oldest.numOfZones = 0 ;
+	s_gpuFrameIdx = nextIdx ;
+	s_gpuZonesStackSize = 0 ;
+
+	if( s_gpuQueriesCreated ) {
+		GLint64 gpuNowNs = 0 ;
+		glGetInteger64v( GL_TIMESTAMP, &gpuNowNs ) ;
+		oldest.gpuToCpuNs = (int64_t)GetSysTimer().getTimeNs() - gpuNowNs ;
+	}
+
+	// frames capture
+	if( !s_captureFileName.empty() ) {
+		if( s_framesToCapture == 0 ) {
+			stop() ;
+			exportChromeTrace( s_captureFileName ) ;
+			clear() ;
+			s_captureFileName.clear() ;
+		}
+		else {
+			s_framesToCapture-- ;
+		}
+	}
+}
+
+void Profiler::counter( const char* name, double value )
+{
+	if( isCapturing() ) {
+		recordEvent( name, GetSysTimer().getTimeNs(), 0, value, ProfileEventType::Counter ) ;
+	}
+}
+
+size_t Profiler::getNumOfDroppedEvents()
+{
+	size_t dropped = 0 ;
+	std::lock_guard<std::mutex> lock(s_buffersMutex) ;
+	for( auto pBuffer : s_buffers ) {
+		dropped += pBuffer->dropped.load( std::memory_order_relaxed ) ;
+	}
+	return dropped ;
+}
+
+void Profiler::shutdown()
+{
+	stop() ;
+
+	if( s_gpuQueriesCreated ) {
+		for( auto& frame : s_gpuFrames ) {
+			for( auto& zone : frame.zones ) {
+				glDeleteQueries( 2, zone.queries ) ;
+			}
+			frame.numOfZones = 0 ;
+		}
+		s_gpuQueriesCreated = false ;
+	}
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex) ;
+	for( auto pBuffer : s_buffers ) {
+		delete pBuffer ;
+	}
+	s_buffers.clear() ;
+	t_pBuffer = nullptr ;
+}
+
+uint64_t Profiler::beginZone()
+{
+	return GetSysTimer().getTimeNs() ;
+}
+
+void Profiler::endZone( const char* name, uint64_t startNs )
+{
+	// a zone still open when the capture stops is discarded
+	if( isCapturing() ) {
+		recordEvent( name, startNs, GetSysTimer().getTimeNs() - startNs, 0.0, ProfileEventType::Zone ) ;
+	}
+}
+
+bool Profiler::beginGpuZone( const char* name )
+{
+	if( !isGpuTimerAvailable() ) {
+		return false ;
+	}
+
+	if( !s_gpuQueriesCreated ) {
+		for( auto& frame : s_gpuFrames ) {
+			for( auto& zone : frame.zones ) {
+				glGenQueries( 2, zone.queries ) ;
+			}
+			frame.numOfZones = 0 ;
+			frame.gpuToCpuNs = 0 ;
+		}
+		GLint64 gpuNowNs = 0 ;
+		glGetInteger64v( GL_TIMESTAMP, &gpuNowNs ) ;
+		s_gpuFrames[s_gpuFrameIdx].gpuToCpuNs = (int64_t)GetSysTimer().getTimeNs() - gpuNowNs ;
+		s_gpuQueriesCreated = true ;
+	}
+
+	GpuProfileFrame& frame = s_gpuFrames[s_gpuFrameIdx] ;
+	if( frame.numOfZones == JAM_PROFILER_GPU_ZONES_PER_FRAME ) {
+		return false ;
+	}
+
+	size_t zoneIdx = frame.numOfZones++ ;
+	GpuProfileZoneQueries& zone = frame.zones[zoneIdx] ;
+	zone.name = name ;
+	glQueryCounter( zone.queries[0], GL_TIMESTAMP ) ;
+	s_gpuZonesStack[s_gpuZonesStackSize++] = zoneIdx ;
+	return true ;
+}
+
+void Profiler::endGpuZone()
+{
+	JAM_ASSERT( s_gpuZonesStackSize > 0 ) ;
+	size_t zoneIdx = s_gpuZonesStack[--s_gpuZonesStackSize] ;
+	glQueryCounter( s_gpuFrames[s_gpuFrameIdx].zones[zoneIdx].queries[1], GL_TIMESTAMP ) ;
+}
+
+}
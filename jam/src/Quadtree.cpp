@@ -30,257 +30,419 @@
 #include "stdafx.h"
 
 #include <jam/Quadtree.h>
-#include <algorithm>
+#include <jam/core/bmkextras.hpp>
+
+#include <math.h>
 
 namespace jam
 {
 
-Quadtree::Quadtree( const AABB& rect ) :
-	m_objects(),
-	m_rect(rect),
-	m_childTL(0),
-	m_childTR(0),
-	m_childBL(0),
-	m_childBR(0)
+namespace
 {
+	JAM_INLINE bool matches( U64 category, U64 categories )
+	{
+		return categories == Quadtree::AllCategories || (category & categories) != 0 ;
+	}
+
+	JAM_INLINE float boxDistanceSquared( float minX, float minY, float maxX, float maxY, const Vector2& p )
+	{
+		float dx = p.x < minX ? minX - p.x : (p.x > maxX ? p.x - maxX : 0.0f) ;
+		float dy = p.y < minY ? minY - p.y : (p.y > maxY ? p.y - maxY : 0.0f) ;
+		return dx*dx + dy*dy ;
+	}
+}
+
 
+Quadtree::Quadtree( const AABB& rect, size_t quadsCapacity, size_t objectsCapacity ) :
+	m_quads(),
+	m_entries(),
+	m_freeEntry(-1),
+	m_numOfObjects(0),
+	m_rect(rect)
+{
+	m_quads.reserve( quadsCapacity ) ;
+	m_entries.reserve( objectsCapacity ) ;
+	initRoot() ;
 }
 
 Quadtree::Quadtree( int x, int y, int width, int height ) :
-	m_objects(),
-	m_rect(),
-	m_childTL(0),
-	m_childTR(0),
-	m_childBL(0),
-	m_childBR(0)
+	m_quads(),
+	m_entries(),
+	m_freeEntry(-1),
+	m_numOfObjects(0),
+	m_rect()
 {
 	m_rect.setBounds( (float)x,(float)y,(float)(x+width),(float)(y-height) ) ;
+	m_quads.reserve( DefaultQuadsCapacity ) ;
+	m_entries.reserve( DefaultObjectsCapacity ) ;
+	initRoot() ;
 }
 
 
 Quadtree::~Quadtree()
 {
-	JAM_DELETE(m_childTL);
-	JAM_DELETE(m_childTR);
-	JAM_DELETE(m_childBL);
-	JAM_DELETE(m_childBR);
+}
+
+void Quadtree::reset( const AABB& rect )
+{
+	m_rect = rect ;
+	clear() ;
 }
 
 void Quadtree::clear()
 {
-	// Clear out the children, if we have any
-	if (m_childTL != 0)
-	{
-		m_childTL->clear();
-		m_childTR->clear();
-		m_childBL->clear();
-		m_childBR->clear();
+	// keeps the capacity of the pools
+	m_entries.clear() ;
+	m_freeEntry = -1 ;
+	m_numOfObjects = 0 ;
+	initRoot() ;
+}
+
+void Quadtree::erase( Node* item )
+{
+	for( I32 idx=0; idx<(I32)m_entries.size(); idx++ ) {
+		Entry& e = m_entries[idx] ;
+		if( e.quad < 0 || e.item != item ) {
+			continue ;
+		}
+
+		// unlink from its quad, the categories of the quads are left as they are
+		Quad& q = m_quads[e.quad] ;
+		I32* link = &q.firstEntry ;
+		while( *link != idx ) {
+			link = &m_entries[*link].next ;
+		}
+		*link = e.next ;
+		q.numOfEntries-- ;
+
+		e.item = 0 ;
+		e.quad = -1 ;
+		e.next = m_freeEntry ;
+		m_freeEntry = idx ;
+		m_numOfObjects-- ;
+		return ;
 	}
+}
 
-	// Clear any objects at this level
-	if (m_objects.size())
-	{
-		m_objects.clear();
+void Quadtree::insert( Node* item )
+{
+	const Polygon2f& poly = item->getCollisionOBB() ;
+
+	I32 idx = allocEntry() ;
+	Entry& e = m_entries[idx] ;
+	e.item = item ;
+	e.category = item->getCollisionCategory() ;
+	e.minX = e.minY = FLT_MAX ;
+	e.maxX = e.maxY = -FLT_MAX ;
+	for( int i=0; i<poly.getCount(); i++ ) {
+		const Vector2& v = poly.getVertex(i) ;
+		e.minX = Min( e.minX, v.x ) ;
+		e.minY = Min( e.minY, v.y ) ;
+		e.maxX = Max( e.maxX, v.x ) ;
+		e.maxY = Max( e.maxY, v.y ) ;
+	}
+	if( poly.getCount() == 0 ) {
+		e.minX = e.minY = e.maxX = e.maxY = 0.0f ;
 	}
 
-	// Set the children to null
-	JAM_DELETE(m_childTL) ;
-	JAM_DELETE(m_childTR) ;
-	JAM_DELETE(m_childBL) ;
-	JAM_DELETE(m_childBR) ;
+	place( 0, idx ) ;
+	m_numOfObjects++ ;
 }
 
-void Quadtree::erase( Node* item )
+size_t Quadtree::getObjects( const Polygon2f& rect, std::vector<Node*>& results, U64 categories ) const
 {
-	// If this level contains the object, remove it
-	bool objectRemoved = false;
-	if (m_objects.size() )
-	{
-		NodesList::iterator it = std::find(m_objects.begin(),m_objects.end(),item) ;
-		if( it!=m_objects.end() )
-		{
-			m_objects.erase(it);
-			objectRemoved = true;
-		}
+	if( rect.getCount() == 0 ) {
+		return 0 ;
 	}
 
-	// If we didn't find the object in this tree, try to delete from its children
-	if (m_childTL != 0 && !objectRemoved)
-	{
-		m_childTL->erase(item);
-		m_childTR->erase(item);
-		m_childBL->erase(item);
-		m_childBR->erase(item);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX ;
+	for( int i=0; i<rect.getCount(); i++ ) {
+		const Vector2& v = rect.getVertex(i) ;
+		minX = Min( minX, v.x ) ;
+		minY = Min( minY, v.y ) ;
+		maxX = Max( maxX, v.x ) ;
+		maxY = Max( maxY, v.y ) ;
 	}
 
-	if (m_childTL != 0)
-	{
-		// If all the children are empty, delete all the children
-		if (m_childTL->getCount() == 0 &&
-			m_childTR->getCount() == 0 &&
-			m_childBL->getCount() == 0 &&
-			m_childBR->getCount() == 0)
-		{
-			JAM_DELETE(m_childTL);
-			JAM_DELETE(m_childTR);
-			JAM_DELETE(m_childBL);
-			JAM_DELETE(m_childBR);
-		}
-	}
+	return query( minX, minY, maxX, maxY, categories, [&rect]( const Entry& e ) {
+		return rect.intersects( e.item->getCollisionOBB() ) ;
+	}, results ) ;
+}
 
+size_t Quadtree::getObjectsInRadius( const Vector2& center, float radius, std::vector<Node*>& results, U64 categories ) const
+{
+	float radiusSquared = radius * radius ;
+	return query( center.x - radius, center.y - radius, center.x + radius, center.y + radius, categories, [&center,radiusSquared]( const Entry& e ) {
+		return boxDistanceSquared( e.minX, e.minY, e.maxX, e.maxY, center ) <= radiusSquared ;
+	}, results ) ;
 }
 
-void Quadtree::insert( Node* item )
+size_t Quadtree::getObjectsAt( const Vector2& p, std::vector<Node*>& results, U64 categories ) const
 {
-	// If this quad doesn't intersect the items rectangle, do nothing
-	const Polygon2f& poly = item->getCollisionOBB() ;
+	return query( p.x, p.y, p.x, p.y, categories, [&p]( const Entry& e ) {
+		return e.item->getCollisionOBB().isPointInside( p ) ;
+	}, results ) ;
+}
 
-	if (!m_rect.intersects(poly)) {
-		return;
+size_t Quadtree::getNearest( const Vector2& p, size_t k, std::vector<Node*>& results, U64 categories, float maxDistance ) const
+{
+	JAM_ASSERT_MSG( k <= MaxNearest, "k must be less or equal than %d", (int)MaxNearest ) ;
+	if( k > MaxNearest ) {
+		k = MaxNearest ;
 	}
-
-	if (m_objects.empty() || 
-		(m_childTL == 0 && m_objects.size() + 1 <= MAX_OBJECTS_PER_NODE))
-	{
-		// If there's room to add the object, just add it
-		add(item);
+	if( k == 0 ) {
+		return 0 ;
 	}
-	else
-	{
-		// No quads, create them and bump objects down where appropriate
-		if (m_childTL == 0) {
-			subdivide();
+
+	// the k nearest found so far, ordered by distance
+	Node* nearest[MaxNearest] ;
+	float nearestDistance[MaxNearest] ;
+	size_t count = 0 ;
+	float limit = (maxDistance < FLT_MAX) ? maxDistance * maxDistance : FLT_MAX ;
+
+	I32 stack[MaxStackSize] ;
+	size_t top = 0 ;
+	stack[top++] = 0 ;
+	while( top > 0 ) {
+		I32 quad = stack[--top] ;
+		float bound = (count == k) ? nearestDistance[k-1] : limit ;
+		const Quad& q = m_quads[quad] ;
+		if( !matches(q.categories, categories) || distanceSquared(quad, p) > bound ) {
+			continue ;
 		}
 
-		// Find out which tree this object should go in and add it there
-		Quadtree* destTree = getDestinationTree(item);
-		if (destTree == this) {
-			add(item);
+		for( I32 idx = q.firstEntry; idx >= 0; idx = m_entries[idx].next ) {
+			const Entry& e = m_entries[idx] ;
+			if( !matches(e.category, categories) ) {
+				continue ;
+			}
+
+			float d = boxDistanceSquared( e.minX, e.minY, e.maxX, e.maxY, p ) ;
+			if( d > limit || (count == k && d >= nearestDistance[k-1]) ) {
+				continue ;
+			}
+
+			size_t i = (count < k) ? count++ : k-1 ;
+			for( ; i > 0 && nearestDistance[i-1] > d; i-- ) {
+				nearest[i] = nearest[i-1] ;
+				nearestDistance[i] = nearestDistance[i-1] ;
+			}
+			nearest[i] = e.item ;
+			nearestDistance[i] = d ;
 		}
-		else {
-			destTree->insert(item);
+
+		if( q.firstChild >= 0 ) {
+			// the nearest child is pushed last, so it is visited first
+			I32 children[4] ;
+			float childDistance[4] ;
+			for( I32 c=0; c<4; c++ ) {
+				I32 child = q.firstChild + c ;
+				float d = distanceSquared( child, p ) ;
+				I32 i = c ;
+				for( ; i > 0 && childDistance[i-1] < d; i-- ) {
+					children[i] = children[i-1] ;
+					childDistance[i] = childDistance[i-1] ;
+				}
+				children[i] = child ;
+				childDistance[i] = d ;
+			}
+			for( I32 c=0; c<4; c++ ) {
+				stack[top++] = children[c] ;
+			}
 		}
 	}
 
+	results.insert( results.end(), nearest, nearest + count ) ;
+	return count ;
 }
 
-void Quadtree::getObjects( const Polygon2f& rect, NodesList& results )
+size_t Quadtree::getAllObjects( std::vector<Node*>& results, U64 categories ) const
 {
-	if( rect.contains(Polygon2f(m_rect)) ) {
-		// If the search area completely contains this quad, just get every object this quad and all it's children have
-		getAllObjects(results);
-	}
-	else if (rect.intersects(Polygon2f(m_rect))) {
-		// Otherwise, if the quad isn't fully contained, only add objects that intersect with the search rectangle
-		if (m_objects.size()) {
-			for (NodesList::iterator it=m_objects.begin(); it!=m_objects.end(); it++ ) {
-				const Polygon2f& poly = (*it)->getCollisionOBB() ;
-
-				if (rect.intersects(poly)) {
-					results.push_back(*it);
-				}
+	return query( -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX, categories, []( const Entry& ) { return true ; }, results ) ;
+}
+
+template<typename Filter>
+size_t Quadtree::query( float minX, float minY, float maxX, float maxY, U64 categories, const Filter& accept, std::vector<Node*>& results ) const
+{
+	size_t count = 0 ;
+
+	I32 stack[MaxStackSize] ;
+	size_t top = 0 ;
+	stack[top++] = 0 ;
+	while( top > 0 ) {
+		const Quad& q = m_quads[stack[--top]] ;
+		if( !matches(q.categories, categories) ) {
+			continue ;
+		}
+
+		for( I32 idx = q.firstEntry; idx >= 0; idx = m_entries[idx].next ) {
+			const Entry& e = m_entries[idx] ;
+			if( matches(e.category, categories) &&
+				e.maxX >= minX && e.minX <= maxX && e.maxY >= minY && e.minY <= maxY &&
+				accept(e) )
+			{
+				results.push_back( e.item ) ;
+				count++ ;
 			}
 		}
 
-		// Get the objects for the search rectangle from the children
-		if (m_childTL != 0) {
-			m_childTL->getObjects(rect, results);
-			m_childTR->getObjects(rect, results);
-			m_childBL->getObjects(rect, results);
-			m_childBR->getObjects(rect, results);
+		if( q.firstChild >= 0 ) {
+			for( I32 c=0; c<4; c++ ) {
+				if( overlaps(q.firstChild + c, minX, minY, maxX, maxY) ) {
+					stack[top++] = q.firstChild + c ;
+				}
+			}
 		}
 	}
+
+	return count ;
 }
 
-void Quadtree::getAllObjects( NodesList& results )
+void Quadtree::initRoot()
 {
-	// If this Quad has objects, add them
-	if( m_objects.size() ) {
-		results.insert( results.end(), m_objects.begin(), m_objects.end() ) ;
-	}
+	Quad root ;
+	root.cx = (m_rect.x1 + m_rect.x2) * 0.5f ;
+	root.cy = (m_rect.y1 + m_rect.y2) * 0.5f ;
+	root.hw = fabsf(m_rect.x2 - m_rect.x1) * 0.5f ;
+	root.hh = fabsf(m_rect.y1 - m_rect.y2) * 0.5f ;
+	root.firstChild = -1 ;
+	root.firstEntry = -1 ;
+	root.numOfEntries = 0 ;
+	root.depth = 0 ;
+	root.categories = 0 ;
+
+	m_quads.clear() ;
+	m_quads.push_back( root ) ;
+}
 
-	// If we have children, get their objects too
-	if (m_childTL != 0)	{
-		m_childTL->getAllObjects(results);
-		m_childTR->getAllObjects(results);
-		m_childBL->getAllObjects(results);
-		m_childBR->getAllObjects(results);
+I32 Quadtree::allocEntry()
+{
+	if( m_freeEntry >= 0 ) {
+		I32 idx = m_freeEntry ;
+		m_freeEntry = m_entries[idx].next ;
+		return idx ;
 	}
+
+	m_entries.push_back( Entry() ) ;
+	return (I32)m_entries.size() - 1 ;
 }
 
-void Quadtree::add( Node* item )
+void Quadtree::link( I32 quad, I32 entry )
 {
-	Ref<Node> rItem(item,true) ;
-	m_objects.push_back(rItem) ;
+	Quad& q = m_quads[quad] ;
+	Entry& e = m_entries[entry] ;
+	e.next = q.firstEntry ;
+	e.quad = quad ;
+	q.firstEntry = entry ;
+	q.numOfEntries++ ;
 }
 
-// void jam::Quadtree::remove( Node* item )
-// {
-// 	if( m_objects.size() ) {
-// 		NodesList::iterator it = std::find(m_objects.begin(), m_objects.end(), item ) ;
-// 		if( it != m_objects.end() ) m_objects.erase(it) ;
-// 	}
-// }
-
-size_t Quadtree::getObjectCount() const
+void Quadtree::place( I32 quad, I32 entry )
 {
-	size_t count = 0 ;
-	count = m_objects.size() ;
+	// indices only: subdivide() can grow the quads pool
+	for( ;; ) {
+		m_quads[quad].categories |= m_entries[entry].category ;
+
+		if( m_quads[quad].firstChild < 0 ) {
+			// If there's room to add the object, just add it
+			if( m_quads[quad].numOfEntries < MaxObjectsPerQuad || m_quads[quad].depth >= MaxDepth ) {
+				link( quad, entry ) ;
+				return ;
+			}
+			subdivide( quad ) ;
+		}
 
-	if( m_childTL != 0 ) {
-		count += m_childTL->getObjectCount() ;
-		count += m_childTR->getObjectCount() ;
-		count += m_childBL->getObjectCount() ;
-		count += m_childBR->getObjectCount() ;
+		// Find out which tree this object should go in
+		I32 child = getDestinationChild( quad, m_entries[entry] ) ;
+		if( child < 0 ) {
+			link( quad, entry ) ;
+			return ;
+		}
+		quad = child ;
 	}
-
-	return count ;
 }
 
-void Quadtree::subdivide()
+void Quadtree::subdivide( I32 quad )
 {
-	Vertex2f size( m_rect.hfWidth, m_rect.hfHeight ) ;
-	Vertex2f mid( m_rect.x1 + size.x, m_rect.y1 + size.y ) ;
-	
-	m_childTL = new Quadtree(AABB(m_rect.x1, m_rect.y1, size.x, size.y));
-	m_childTR = new Quadtree(AABB(mid.x, m_rect.y1, size.x, size.y));
-	m_childBL = new Quadtree(AABB(m_rect.x1, mid.y, size.x, size.y));
-	m_childBR = new Quadtree(AABB(mid.x, mid.y, size.x, size.y));
-
-	// If they're completely contained by the quad, bump objects down
-	for( NodesList::iterator it = m_objects.begin(); it != m_objects.end(); it++ )
-	{
-		Quadtree* destTree = getDestinationTree(*it);
+	I32 firstChild = (I32)m_quads.size() ;
+	for( I32 c=0; c<4; c++ ) {
+		const Quad& q = m_quads[quad] ;
+		Quad child ;
+		child.hw = q.hw * 0.5f ;
+		child.hh = q.hh * 0.5f ;
+		child.cx = q.cx + ((c & 1) ? child.hw : -child.hw) ;		// left, right
+		child.cy = q.cy + ((c & 2) ? -child.hh : child.hh) ;		// top, bottom
+		child.firstChild = -1 ;
+		child.firstEntry = -1 ;
+		child.numOfEntries = 0 ;
+		child.depth = q.depth + 1 ;
+		child.categories = 0 ;
+		m_quads.push_back( child ) ;
+	}
 
-		if (destTree != this) {
-			// Insert to the appropriate tree, remove the object, and back up one in the loop
-			destTree->insert(*it);
-			it = m_objects.erase(it) ;
+	// bump objects down where appropriate
+	Quad& q = m_quads[quad] ;
+	q.firstChild = firstChild ;
+	I32 idx = q.firstEntry ;
+	q.firstEntry = -1 ;
+	q.numOfEntries = 0 ;
+	while( idx >= 0 ) {
+		I32 next = m_entries[idx].next ;
+		I32 child = getDestinationChild( quad, m_entries[idx] ) ;
+		if( child >= 0 ) {
+			m_quads[child].categories |= m_entries[idx].category ;
+			link( child, idx ) ;
+		}
+		else {
+			link( quad, idx ) ;
 		}
+		idx = next ;
 	}
 }
 
-Quadtree* Quadtree::getDestinationTree( Node* item )
+I32 Quadtree::getDestinationChild( I32 quad, const Entry& e ) const
 {
-	// If a child can't contain an object, it will live in this Quad
-	Quadtree* destTree = this;
+	const Quad& q = m_quads[quad] ;
+	float ex = (e.maxX - e.minX) * 0.5f ;
+	float ey = (e.maxY - e.minY) * 0.5f ;
 
-	const Polygon2f& poly = item->getCollisionOBB() ;
-
-	if( m_childTL->getQuadRect().contains(poly) ) {
-		destTree = m_childTL;
+	// too large for the loose bounds of a child
+	if( ex > q.hw * 0.5f || ey > q.hh * 0.5f ) {
+		return -1 ;
 	}
-	else if( m_childTR->getQuadRect().contains(poly) ) {
-		destTree = m_childTR;
+
+	float ecx = (e.minX + e.maxX) * 0.5f ;
+	float ecy = (e.minY + e.maxY) * 0.5f ;
+	I32 child = q.firstChild + (ecx >= q.cx ? 1 : 0) + (ecy < q.cy ? 2 : 0) ;
+
+	// the center can be outside the cell of the child only outside the root
+	const Quad& c = m_quads[child] ;
+	if( fabsf(ecx - c.cx) + ex > 2.0f * c.hw || fabsf(ecy - c.cy) + ey > 2.0f * c.hh ) {
+		return -1 ;
 	}
-	else if( m_childBL->getQuadRect().contains(poly) ) {
-		destTree = m_childBL;
+
+	return child ;
+}
+
+bool Quadtree::overlaps( I32 quad, float minX, float minY, float maxX, float maxY ) const
+{
+	if( quad == 0 ) {
+		return true ;
 	}
-	else if( m_childBR->getQuadRect().contains(poly) ) {
-		destTree = m_childBR;
+
+	const Quad& q = m_quads[quad] ;
+	return	q.cx + 2.0f * q.hw >= minX && q.cx - 2.0f * q.hw <= maxX &&
+			q.cy + 2.0f * q.hh >= minY && q.cy - 2.0f * q.hh <= maxY ;
+}
+
+float Quadtree::distanceSquared( I32 quad, const Vector2& p ) const
+{
+	if( quad == 0 ) {
+		return 0.0f ;
 	}
 
-	return destTree;
+	const Quad& q = m_quads[quad] ;
+	return boxDistanceSquared( q.cx - 2.0f * q.hw, q.cy - 2.0f * q.hh, q.cx + 2.0f * q.hw, q.cy + 2.0f * q.hh, p ) ;
 }
 
 } // namespace jam
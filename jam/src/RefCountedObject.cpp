@@ -31,44 +31,112 @@
 
 #include "jam/jam.h"
 #include "jam/RefCountedObject.h"
+#include "jam/MemoryTracker.h"
 #include <sstream>
 #include <climits>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 namespace jam
 {
 
+// the engine is initialized by the thread which runs the static initializers
+static std::thread::id		s_mainThreadId = std::this_thread::get_id() ;
+
+// objects with RefCountPolicy::Deferred released by other threads, waiting for releaseDeferred()
+static std::mutex& getDeferredMutex()
+{
+	static std::mutex* pMutex = new std::mutex() ;
+	return *pMutex ;
+}
+
+static std::vector<RefCountedObject*>& getDeferredObjects()
+{
+	static std::vector<RefCountedObject*>* pObjects = new std::vector<RefCountedObject*>() ;
+	return *pObjects ;
+}
+
 
 RefCountedObject::RefCountedObject() : 
-	m_refCount(1)
+	m_refCount(1), m_refCountPolicy(RefCountPolicy::ThreadSafe)
 #ifdef JAM_DEBUG
 	, m_file(), m_line(0)
 #endif
 {
+#ifdef JAM_MEMORY_TRACKING
+	MemoryTracker::trackConstruction( this ) ;
+#endif
 }
 
 RefCountedObject::~RefCountedObject()
 {
 }
 
-void RefCountedObject::addRef()
+void RefCountedObject::setRefCountPolicy( RefCountPolicy policy )
+{
+	JAM_ASSERT_MSG( m_refCount.load(std::memory_order_relaxed)==1, "the policy can be changed only before the object is shared" ) ;
+	m_refCountPolicy = policy ;
+}
+
+void RefCountedObject::destroy()
 {
-	JAM_ASSERT_MSG(m_refCount>0, "m_refCount should be greater than 0");
-	m_refCount++;
+	if( m_refCountPolicy == RefCountPolicy::Deferred && !isMainThread() ) {
+		std::lock_guard<std::mutex> lock( getDeferredMutex() ) ;
+		getDeferredObjects().push_back( this ) ;
+		return ;
+	}
+
+#ifdef JAM_MEMORY_TRACKING
+	MemoryTracker::trackRelease( this ) ;
+#endif
+	delete this ;
 }
 
-void RefCountedObject::release()
+void RefCountedObject::releaseDeferred()
 {
-	// if something goes wrong with memory, m_refCount become garbagled and generally a very high value (absolute value)
-	JAM_ASSERT_MSG(m_refCount>0 && m_refCount<INT_MAX, "m_refCount=%d (should be > 0)", (int32_t)m_refCount );
-	if( --m_refCount == 0 ) {
-		delete this ;
+	JAM_ASSERT_MSG( isMainThread(), "deferred objects must be released by the main thread" ) ;
+
+	std::vector<RefCountedObject*> objects ;
+	{
+		std::lock_guard<std::mutex> lock( getDeferredMutex() ) ;
+		objects.swap( getDeferredObjects() ) ;
+	}
+	JAM_PROFILE_COUNTER( "RefCountedObject.deferredReleases", objects.size() ) ;
+
+	// a destructor can drop the last reference of other objects, they are deleted right away
+	for( RefCountedObject* pObj : objects ) {
+		pObj->destroy() ;
 	}
 }
 
+bool RefCountedObject::isMainThread()
+{
+	// objects released by static initializers of other modules may come before s_mainThreadId is set
+	return std::this_thread::get_id() == s_mainThreadId || s_mainThreadId == std::thread::id() ;
+}
+
+void* RefCountedObject::allocate( size_t size, ObjectAllocator& allocator )
+{
+	void* p = allocator.allocate( size ) ;
+#ifdef JAM_MEMORY_TRACKING
+	MemoryTracker::trackAllocation( p, size ) ;
+#endif
+	return p ;
+}
+
+void RefCountedObject::deallocate( void* p, size_t size, ObjectAllocator& allocator )
+{
+#ifdef JAM_MEMORY_TRACKING
+	MemoryTracker::trackDeallocation( p ) ;
+#endif
+	allocator.deallocate( p, size ) ;
+}
+
 int32_t RefCountedObject::getRefCount() const
 {
-	return m_refCount ;
+	return m_refCount.load( std::memory_order_relaxed ) ;
 }
 
 #ifdef JAM_DEBUG
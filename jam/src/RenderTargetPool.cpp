@@ -0,0 +1,201 @@
+/**********************************************************************************
+* 
+* RenderTargetPool.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/RenderTargetPool.h"
+#include "jam/RenderBufferObject.h"
+#include "jam/Gfx.h"
+
+namespace jam
+{
+
+//*******************
+//
+// Class RenderTarget
+//
+//*******************
+
+RenderTarget::RenderTarget( U32 width, U32 height, GLenum internalFormat, bool depth ) :
+	m_width(width), m_height(height), m_internalFormat(internalFormat),
+	m_fbo(), m_pTexture(), m_pDepth(0),
+	m_inUse(false), m_lastUsedFrame(0)
+{
+	m_pTexture = Ref<Texture2D>( new Texture2D() ) ;
+	m_pTexture->createRenderTarget( width, height, internalFormat ) ;
+
+	m_fbo.bind() ;
+	m_fbo.attachTexture2D( m_pTexture, GL_COLOR_ATTACHMENT0, 0 ) ;
+
+	if( depth ) {
+		m_pDepth = new RenderBufferObject() ;
+		m_pDepth->create() ;
+		m_pDepth->bind() ;
+		m_pDepth->setStorage( GL_DEPTH24_STENCIL8, width, height ) ;
+		m_pDepth->unbind() ;
+		m_fbo.attachRenderBuffer( m_pDepth, GL_DEPTH_STENCIL_ATTACHMENT ) ;
+	}
+
+	JAM_ASSERT_MSG( m_fbo.isGood(), "Incomplete render target %ux%u", width, height ) ;
+	m_fbo.unbind() ;
+}
+
+RenderTarget::~RenderTarget()
+{
+	JAM_DELETE(m_pDepth) ;
+}
+
+void RenderTarget::bind()
+{
+	m_fbo.bind() ;
+	GetGfx().setViewport( 0, 0, m_width, m_height ) ;
+}
+
+void RenderTarget::discard()
+{
+	static const GLenum colorAndDepth[] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT } ;
+	m_fbo.invalidate( m_pDepth ? 2 : 1, colorAndDepth ) ;
+}
+
+void RenderTarget::discardDepth()
+{
+	if( m_pDepth ) {
+		static const GLenum depthOnly[] = { GL_DEPTH_STENCIL_ATTACHMENT } ;
+		m_fbo.invalidate( 1, depthOnly ) ;
+	}
+}
+
+size_t RenderTarget::getByteSize() const
+{
+	size_t pixels = (size_t)m_width * m_height ;
+	return pixels * (m_pTexture->getBitCount() / 8) + (m_pDepth ? pixels * 4 : 0) ;
+}
+
+
+//*******************
+//
+// Class RenderTargetPool
+//
+//*******************
+
+RenderTargetPool::RenderTargetPool() : m_targets(), m_frame(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	for( size_t i=0; i<m_targets.size(); i++ ) {
+		JAM_ASSERT_MSG( !m_targets[i]->m_inUse, "Render target still in use on pool destruction" ) ;
+		delete m_targets[i] ;
+	}
+	m_targets.clear() ;
+}
+
+RenderTarget* RenderTargetPool::acquire( U32 width, U32 height, GLenum internalFormat /*= GL_RGBA8*/, bool depth /*= false*/ )
+{
+	RenderTarget* pTarget = 0 ;
+	for( size_t i=0; i<m_targets.size(); i++ ) {
+		RenderTarget* p = m_targets[i] ;
+		if( !p->m_inUse && p->m_width == width && p->m_height == height &&
+			p->m_internalFormat == internalFormat && p->hasDepth() == depth ) {
+			pTarget = p ;
+			break ;
+		}
+	}
+
+	if( !pTarget ) {
+		pTarget = new RenderTarget( width, height, internalFormat, depth ) ;
+		m_targets.push_back( pTarget ) ;
+	}
+
+	pTarget->m_inUse = true ;
+	pTarget->m_lastUsedFrame = m_frame ;
+	return pTarget ;
+}
+
+void RenderTargetPool::release( RenderTarget* pTarget )
+{
+	if( pTarget ) {
+		JAM_ASSERT_MSG( pTarget->m_inUse, "Render target released twice" ) ;
+		pTarget->m_inUse = false ;
+		pTarget->m_lastUsedFrame = m_frame ;
+	}
+}
+
+void RenderTargetPool::newFrame()
+{
+	m_frame++ ;
+	for( size_t i=0; i<m_targets.size(); ) {
+		RenderTarget* p = m_targets[i] ;
+		if( !p->m_inUse && m_frame - p->m_lastUsedFrame > JAM_RENDER_TARGET_MAX_IDLE_FRAMES ) {
+			delete p ;
+			m_targets[i] = m_targets.back() ;
+			m_targets.pop_back() ;
+		}
+		else {
+			i++ ;
+		}
+	}
+}
+
+void RenderTargetPool::purge()
+{
+	for( size_t i=0; i<m_targets.size(); ) {
+		if( !m_targets[i]->m_inUse ) {
+			delete m_targets[i] ;
+			m_targets[i] = m_targets.back() ;
+			m_targets.pop_back() ;
+		}
+		else {
+			i++ ;
+		}
+	}
+}
+
+size_t RenderTargetPool::getNumOfTargetsInUse() const
+{
+	size_t count = 0 ;
+	for( size_t i=0; i<m_targets.size(); i++ ) {
+		if( m_targets[i]->m_inUse ) {
+			count++ ;
+		}
+	}
+	return count ;
+}
+
+size_t RenderTargetPool::getByteSize() const
+{
+	size_t bytes = 0 ;
+	for( size_t i=0; i<m_targets.size(); i++ ) {
+		bytes += m_targets[i]->getByteSize() ;
+	}
+	return bytes ;
+}
+
+}
@@ -36,6 +36,8 @@
 #include "jam/core/geom.h"
 #include "jam/Camera.h"
 
+#include <algorithm>
+
 namespace jam
 {
 
@@ -43,8 +45,15 @@ namespace jam
 		m_fogOfViewRing(),
 		m_fogOfViewInnerRadius(0.0f),
 		m_fogOfViewOuterRadius(0.0f),
-		m_fogOfViewEnabled(false)
+		m_fogOfViewEnabled(false),
+		m_interpolatedNodes(),
+		m_pickGrid(),
+		m_touchNodes()
 	{
+		for( size_t i=0; i<JAM_MAX_TOUCHES; i++ ) {
+			m_touches[i] = false ;
+			m_touchedNodes[i] = 0 ;
+		}
 	}
 
 	void Scene::init()
@@ -67,6 +76,8 @@ namespace jam
 
 	void Scene::visitGraph( Draw3DBatch* pBatch )
 	{
+		JAM_PROFILE_GPU("Scene.visitGraph") ;
+
 		Matrix4 globalScaleMat = jam::createScaleMatrix3D( Vector3(Draw3DManager::RatioX, Draw3DManager::RatioY, 1.0f) ) ;
 		GetShaderMgr().getCurrent()->setModelMatrix(globalScaleMat) ;
 
@@ -75,8 +86,10 @@ namespace jam
 #endif
 
 		Node::VisitInProgress = true ;
+		Node::resetCulling() ;
 		if( pBatch ) pBatch->begin() ;
 		visit() ;
+		JAM_PROFILE_COUNTER( "Scene.culledSubtrees", Node::getNumOfCulledSubtrees() ) ;
 		game::State* gState = game::GetStateMachine().isStarted() ? game::GetStateMachine().getCurrentState() : 0 ;
 		if( gState ) {
 			gState->extraRender() ;
@@ -96,6 +109,11 @@ namespace jam
 			Node* n = m_children.front() ;
 			n->destroy() ;	// destroy also remove from m_children
 		}
+		m_touchNodes.clear() ;
+		m_pickGrid.clear() ;
+		for( size_t i=0; i<JAM_MAX_TOUCHES; i++ ) {
+			m_touchedNodes[i] = 0 ;
+		}
 	}
 
 	void Scene::resetFogOfView()
@@ -125,14 +143,37 @@ namespace jam
 
 	void Scene::addTouchableNode( Node* pNode )
 	{
-		Ref<Node> rNode( pNode, true ) ;
-		m_touchableNodes.push_front(rNode) ;
+		m_pickGrid.update( pNode ) ;
+	}
+
+
+	void Scene::addInterpolatedNode( Node* pNode )
+	{
+		m_interpolatedNodes.push_back( pNode ) ;
+	}
+
+
+	void Scene::removeInterpolatedNode( Node* pNode )
+	{
+		auto it = std::find( m_interpolatedNodes.begin(), m_interpolatedNodes.end(), pNode ) ;
+		if( it != m_interpolatedNodes.end() ) {
+			*it = m_interpolatedNodes.back() ;
+			m_interpolatedNodes.pop_back() ;
+		}
+	}
+
+
+	void Scene::storeSimulationState()
+	{
+		for( Node* pNode : m_interpolatedNodes ) {
+			pNode->storeSimulationState() ;
+		}
 	}
 
 
 	void Scene::clearTouchableNodes()
 	{
-		m_touchableNodes.clear() ;
+		m_pickGrid.newFrame() ;
 		for( size_t i=0; i<JAM_MAX_TOUCHES; i++ ) {
 			m_touches[i] = false ;
 			m_touchedNodes[i] = 0 ;
@@ -142,9 +183,47 @@ namespace jam
 
 	void Scene::updateTouchableNodes()
 	{
-		size_t n = m_touchableNodes.size() ;
-		for( NodesList::iterator it = m_touchableNodes.begin(); it != m_touchableNodes.end(); it++) {
-			(*it)->updateTouches() ;
+		JAM_PROFILE("Scene.updateTouchableNodes") ;
+
+		// touchable nodes not visited in this frame are not touchable anymore
+		m_pickGrid.removeStale() ;
+
+		// a touch is given only to the topmost touchable node under it
+		for( uint32_t touchId=0; touchId<GetInputMgr().getMaxNumberOfTouches(); touchId++ ) {
+			if( GetInputMgr().isTouchUp(touchId) ) {
+				continue ;
+			}
+
+			Vector2 touchPos( GetInputMgr().getTouchX(touchId), GetInputMgr().getTouchY(touchId) ) ;
+			Node* pNode = m_pickGrid.pick( touchPos ) ;
+			if( pNode ) {
+				m_touches[touchId] = true ;
+				m_touchedNodes[touchId] = pNode ;
+
+				bool found = false ;
+				for( size_t i=0; i<m_touchNodes.size() && !found; i++ ) {
+					found = m_touchNodes[i].get() == pNode ;
+				}
+				if( !found ) {
+					m_touchNodes.push_back( Ref<Node>(pNode,true) ) ;
+				}
+			}
+		}
+
+		// only the touched nodes and the ones with a state left by previous touches (e.g. down, leaving) need an update
+		for( size_t i=0; i<m_touchNodes.size(); ) {
+			Node* pNode = m_touchNodes[i].get() ;
+			if( m_pickGrid.contains(pNode) ) {
+				pNode->updateTouches() ;
+			}
+
+			if( !m_pickGrid.contains(pNode) || !pNode->hasTouchState() ) {
+				m_touchNodes[i] = m_touchNodes.back() ;
+				m_touchNodes.pop_back() ;
+			}
+			else {
+				i++ ;
+			}
 		}
 	}
 
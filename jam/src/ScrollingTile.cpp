@@ -34,6 +34,7 @@
 #include "jam/DrawItemManager.h"
 #include "jam/Gfx.h"
 #include "jam/core/bmkextras.hpp"
+#include "jam/FrameAllocator.h"
 
 #include <list>
 
@@ -189,7 +190,7 @@ void ScrollingMap::renderLayerFast( int layer, int x_offset, int y_offset )
 	int sy = -(y_offset % m_tmxLoader.getTileHeight());
 	int counter=0;
 	int showed=0;
-	DrawItem** items = new DrawItem*[m_tmxLoader.getColumns()] ;
+	DrawItem** items = FrameAllocator::allocateArray<DrawItem*>( m_tmxLoader.getColumns() ) ;
 	setPos(x_offset, y_offset, layer);
 	int origtx = x_offset / m_tmxLoader.getTileWidth();
 	int origsx = -(x_offset % m_tmxLoader.getTileWidth());
@@ -227,7 +228,6 @@ void ScrollingMap::renderLayerFast( int layer, int x_offset, int y_offset )
 		ty++;
 		sy += m_tmxLoader.getTileHeight();
 	}
-	JAM_DELETE_ARRAY(items) ;
 
 	int remain=counter-showed;
 }
@@ -35,6 +35,8 @@
 //#include "jam/Utilities.h"
 #include "jam/ResourceManager.h"
 #include "jam/Application.h"
+#include "jam/Light.h"
+#include "jam/SharedUniforms.h"
 
 #include <stdexcept>
 #include <glm/gtc/type_ptr.hpp>
@@ -48,8 +50,16 @@ namespace jam
 
 Shader::Shader() :
     m_object(0),
-	m_shaderFiles()
+	m_shaderFiles(),
+	m_buildState(BUILD_NONE),
+	m_buildError(),
+	m_usesViewBlock(false),
+	m_usesObjectBlock(false),
+	m_modelMatrix(1.0f),
+	m_hasModelMatrix(false)
 {
+	// the program object can be deleted only by the main thread
+	setRefCountPolicy( RefCountPolicy::Deferred ) ;
 }
 
 Shader::~Shader() {
@@ -82,18 +92,57 @@ void Shader::setShaderFiles( const std::vector<Ref<ShaderFile>>& shaderFiles )
 
 void Shader::compile()
 {
-    if( m_shaderFiles.size() == 0 )
-        JAM_ERROR("No shaders were provided to create the program");
-    
+	String msg ;
+	if( !link(msg) ) {
+		m_buildState = BUILD_FAILED ;
+		JAM_ERROR(msg.c_str());
+	}
+
+	bindUniformBlocks() ;
+	m_buildState = BUILD_LINKED ;
+}
+
+bool Shader::link( String& errorMsg, bool retrievable )
+{
+    if( m_shaderFiles.size() == 0 ) {
+        errorMsg = "No shaders were provided to create the program" ;
+		return false ;
+	}
+
+	// the files are compiled here, so that a background build compiles them on the worker too
+	for(unsigned i = 0; i < m_shaderFiles.size(); ++i) {
+		if( !m_shaderFiles[i]->isCompiled() && !m_shaderFiles[i]->tryCompile(errorMsg) ) {
+			m_shaderFiles.clear() ;
+			return false ;
+		}
+	}
+
     //create the program object
     m_object = glCreateProgram();
-    if(m_object == 0)
-        JAM_ERROR("glCreateProgram failed");
+    if(m_object == 0) {
+        errorMsg = "glCreateProgram failed" ;
+		m_shaderFiles.clear() ;
+		return false ;
+	}
     
     //attach all the shaders
     for(unsigned i = 0; i < m_shaderFiles.size(); ++i)
         glAttachShader(m_object, m_shaderFiles[i]->objectID());
 
+	// standard attributes get the same location in every program, so that a vao set up
+	// with one program (e.g. Mesh::upload) can be drawn with another (e.g. its instanced variant)
+	static const GLchar* standardAttribs[] = {
+		JAM_PROGRAM_ATTRIB_POSITION, JAM_PROGRAM_ATTRIB_NORMAL, JAM_PROGRAM_ATTRIB_COLOR, JAM_PROGRAM_ATTRIB_TEXCOORDS,
+		JAM_PROGRAM_ATTRIB_TANGENT, JAM_PROGRAM_ATTRIB_BITANGENT, JAM_PROGRAM_ATTRIB_BONESID, JAM_PROGRAM_ATTRIB_WEIGHTS
+	} ;
+	for( GLuint i = 0; i < sizeof(standardAttribs)/sizeof(standardAttribs[0]); i++ ) {
+		glBindAttribLocation( m_object, i, standardAttribs[i] ) ;
+	}
+
+	if( retrievable ) {
+		glProgramParameteri( m_object, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE ) ;
+	}
+
 	JAM_TRACE( "Linking program \"%s\"\n", getName().c_str() ) ;
 
     //link the shaders together
@@ -105,26 +154,105 @@ void Shader::compile()
 
 	m_shaderFiles.clear() ;
     
-    //throw exception if linking failed
     GLint status;
     glGetProgramiv(m_object, GL_LINK_STATUS, &status);
     if (status == GL_FALSE) {
-        std::string msg("Program linking failure: ");
+        errorMsg = "Program linking failure: " ;
         
         GLint infoLogLength;
         glGetProgramiv(m_object, GL_INFO_LOG_LENGTH, &infoLogLength);
         char* strInfoLog = new char[infoLogLength + 1];
         glGetProgramInfoLog(m_object, infoLogLength, NULL, strInfoLog);
-        msg += strInfoLog;
+        errorMsg += strInfoLog;
         delete[] strInfoLog;
         
         glDeleteProgram(m_object); m_object = 0;
-        JAM_ERROR(msg.c_str());
+        return false ;
     }
+
+	return true ;
+}
+
+bool Shader::linkBinary( GLenum format, const void* pBinary, GLsizei length )
+{
+	m_object = glCreateProgram() ;
+	if( m_object == 0 ) {
+		return false ;
+	}
+
+	glProgramBinary( m_object, format, pBinary, length ) ;
+
+	GLint status = GL_FALSE ;
+	glGetProgramiv( m_object, GL_LINK_STATUS, &status ) ;
+	if( status == GL_FALSE ) {
+		glDeleteProgram(m_object); m_object = 0;
+		return false ;
+	}
+
+	// sources are not needed anymore, they were never compiled
+	m_shaderFiles.clear() ;
+	return true ;
+}
+
+void Shader::bindUniformBlocks()
+{
+	// uniform blocks shared by all the programs
+	static const struct { const GLchar* name; GLuint binding; } sharedBlocks[] = {
+		{ JAM_PROGRAM_UNIFORM_BLOCK_LIGHTS, LightManager::UNIFORM_BLOCK_BINDING },
+		{ JAM_PROGRAM_UNIFORM_BLOCK_FRAME, SharedUniforms::FRAME_BLOCK_BINDING },
+		{ JAM_PROGRAM_UNIFORM_BLOCK_VIEW, SharedUniforms::VIEW_BLOCK_BINDING },
+		{ JAM_PROGRAM_UNIFORM_BLOCK_OBJECT, SharedUniforms::OBJECT_BLOCK_BINDING }
+	} ;
+	for( const auto& block : sharedBlocks ) {
+		GLuint blockIdx = glGetUniformBlockIndex( m_object, block.name ) ;
+		if( blockIdx != GL_INVALID_INDEX ) {
+			glUniformBlockBinding( m_object, blockIdx, block.binding ) ;
+		}
+	}
+	// the clusters texture is always bound to the same unit, so the sampler is set once
+	GLint gridLocation = glGetUniformLocation( m_object, JAM_PROGRAM_UNIFORM_LIGHT_GRID ) ;
+	if( gridLocation != -1 ) {
+		// the program may be linked on the worker context or while another program is in use
+		GLint prevProgram = 0 ;
+		glGetIntegerv( GL_CURRENT_PROGRAM, &prevProgram ) ;
+		glUseProgram( m_object ) ;
+		glUniform1i( gridLocation, LightManager::GRID_TEXTURE_UNIT ) ;
+		glUseProgram( (GLuint)prevProgram ) ;
+	}
+
+	m_usesViewBlock = glGetUniformBlockIndex( m_object, JAM_PROGRAM_UNIFORM_BLOCK_VIEW ) != GL_INVALID_INDEX ;
+	m_usesObjectBlock = glGetUniformBlockIndex( m_object, JAM_PROGRAM_UNIFORM_BLOCK_OBJECT ) != GL_INVALID_INDEX ;
+}
+
+void Shader::setBuildResult( bool linked, const String& errorMsg )
+{
+	m_buildError = errorMsg ;
+	m_buildState.store( linked ? BUILD_LINKED : BUILD_FAILED, std::memory_order_release ) ;
+}
+
+void Shader::ensureLinked() const
+{
+	int state = m_buildState.load( std::memory_order_acquire ) ;
+	if( state == BUILD_PENDING ) {
+		GetShaderMgr().getCompiler().wait( const_cast<Shader*>(this) ) ;
+		state = m_buildState.load( std::memory_order_acquire ) ;
+	}
+
+	if( state == BUILD_FAILED ) {
+		JAM_ERROR( "Program \"%s\" build failure: %s", getName().c_str(), m_buildError.c_str() ) ;
+	}
 }
 
 void Shader::setModelMatrix(const Matrix4& mat)
 {
+	ensureLinked() ;
+	if( m_usesObjectBlock ) {
+		m_modelMatrix = mat ;
+		m_hasModelMatrix = true ;
+		GetSharedUniforms().setModelMatrix( mat ) ;
+		return ;
+	}
+
 	GLint modelMatrix_locIdx = uniformLocation(JAM_PROGRAM_UNIFORM_MODEL_MATRIX) ;
 	if( modelMatrix_locIdx != -1 ) {
 		glUniformMatrix4fv( modelMatrix_locIdx, 1, GL_FALSE, glm::value_ptr(mat) ) ;
@@ -132,18 +260,28 @@ void Shader::setModelMatrix(const Matrix4& mat)
 
 	GLint normalMatrix_locIdx = uniformLocation(JAM_PROGRAM_UNIFORM_NORMAL_MATRIX) ;
 	if( normalMatrix_locIdx != -1 ) {
-		Matrix3 normalMatrix = Matrix3( glm::transpose( glm::inverse(mat) ) ) ;
+		Matrix3 normalMatrix = computeNormalMatrix( mat ) ;
 		glUniformMatrix3fv( normalMatrix_locIdx, 1, GL_FALSE, glm::value_ptr(normalMatrix) ) ;
 	}
 }
 	
 void Shader::setViewMatrix( const Matrix4& mat )
 {
+	ensureLinked() ;
+	if( m_usesViewBlock ) {
+		GetSharedUniforms().setViewMatrix( mat ) ;
+		return ;
+	}
 	setUniformSafe( JAM_PROGRAM_UNIFORM_VIEW_MATRIX, mat ) ;
 }
 	
 void Shader::setProjectionMatrix( const Matrix4& mat )
 {
+	ensureLinked() ;
+	if( m_usesViewBlock ) {
+		GetSharedUniforms().setProjectionMatrix( mat ) ;
+		return ;
+	}
 	setUniformSafe(JAM_PROGRAM_UNIFORM_PROJ_MATRIX,mat) ;
 }
 
@@ -154,19 +292,30 @@ void Shader::setNormalMatrix(const Matrix3 & mat)
 
 void Shader::setViewPosition(const Vector3 & pos)
 {
+	ensureLinked() ;
+	if( m_usesViewBlock ) {
+		GetSharedUniforms().setViewPosition( pos ) ;
+		return ;
+	}
 	setUniformSafe( JAM_PROGRAM_UNIFORM_VIEW_POS, pos ) ;
 }
 
 
 GLuint Shader::objectID() const {
+	ensureLinked() ;
     return m_object;
 }
 
 void Shader::use() const {
+	ensureLinked() ;
 	JAM_ASSERT_MSG( m_object != 0, "GPU program is null" ) ;
 	if( !isInUse() ) {
 		glUseProgram(m_object);
 		GetShaderMgr().setCurrent( const_cast<Shader*>(this) ) ;
+		// no-op unless another program has bound a different model matrix meanwhile
+		if( m_hasModelMatrix ) {
+			GetSharedUniforms().setModelMatrix( m_modelMatrix ) ;
+		}
 	}
 }
 
@@ -185,6 +334,7 @@ GLint Shader::attrib(const GLchar* attribName) const {
     if(!attribName)
         JAM_ERROR("attribName was NULL");
     
+	ensureLinked() ;
     GLint attrib = glGetAttribLocation(m_object, attribName);
     if(attrib == -1)
         JAM_ERROR("Program attribute not found: %s", attribName);
@@ -196,6 +346,7 @@ GLint Shader::uniform(const GLchar* uniformName) const {
     if(!uniformName)
         JAM_ERROR("uniformName was NULL");
     
+	ensureLinked() ;
     GLint uniform = glGetUniformLocation(m_object, uniformName);
     if(uniform == -1)
         JAM_ERROR("Program uniform not found: %s", uniformName);
@@ -207,6 +358,7 @@ GLint Shader::attribLocation(const GLchar* attribName) const {
     if(!attribName)
         JAM_ERROR("attribName was NULL");
     
+	ensureLinked() ;
     return glGetAttribLocation(m_object, attribName);
 }
 
@@ -214,6 +366,7 @@ GLint Shader::uniformLocation(const GLchar* uniformName) const {
     if(!uniformName)
         JAM_ERROR("uniformName was NULL");
     
+	ensureLinked() ;
     return glGetUniformLocation(m_object, uniformName);
 }
 
@@ -496,12 +649,23 @@ const String ShaderManager::SKINNIG_PROGRAM_LIT_NAME = "skinning_shader_lit" ;
 const String ShaderManager::SKYBOX_PROGRAM_NAME = "skybox_shader" ;
 const String ShaderManager::NORMAL_MAPPING_PROGRAM_NAME = "normal_mapping_shader" ;
 const String ShaderManager::SCREEN_PROGRAM_NAME = "screen_shader" ;
+const String ShaderManager::INSTANCED_NORMAL_MAPPING_PROGRAM_NAME = "normal_mapping_instanced_shader" ;
+const String ShaderManager::INSTANCED_SKINNING_PROGRAM_LIT_NAME = "skinning_instanced_shader_lit" ;
+const String ShaderManager::INSTANCED_PROGRAM_LIT_NAME = "default_instanced_shader_lit" ;
+const String ShaderManager::POSTFX_BRIGHT_PROGRAM_NAME = "postfx_bright" ;
+const String ShaderManager::POSTFX_BLUR_PROGRAM_NAME = "postfx_blur" ;
+const String ShaderManager::POSTFX_BLOOM_PROGRAM_NAME = "postfx_bloom" ;
+const String ShaderManager::POSTFX_COLOR_GRADING_PROGRAM_NAME = "postfx_color_grading" ;
+const String ShaderManager::GRID_EFFECT_PROGRAM_NAME = "grid_effect_shader" ;
 // TODO: FIXIT !!!
 //const String ShaderManager::DEFAULT_SHADERS_PATH	= "../../../../jam/shaders" ;
 const String ShaderManager::DEFAULT_SHADERS_PATH	= "../../jam/shaders" ;
 
 ShaderManager::ShaderManager() : 
-	m_pCurrentShader(nullptr)
+	m_pCurrentShader(nullptr),
+	m_compiler(),
+	m_programsByKey(),
+	m_aliases()
 {
 }
 
@@ -535,6 +699,21 @@ void ShaderManager::createScreen()
 	loadAndCreateProgram(SCREEN_PROGRAM_NAME) ;
 }
 
+void ShaderManager::createInstancedNormalMapping()
+{
+	loadAndCreateProgram(INSTANCED_NORMAL_MAPPING_PROGRAM_NAME) ;
+}
+
+void ShaderManager::createInstancedSkinningLit()
+{
+	loadAndCreateProgram(INSTANCED_SKINNING_PROGRAM_LIT_NAME) ;
+}
+
+void ShaderManager::createInstancedLit()
+{
+	loadAndCreateProgram(INSTANCED_PROGRAM_LIT_NAME) ;
+}
+
 Shader*	ShaderManager::getDefaultUnlit()
 {
 	return getShader(DEFAULT_PROGRAM_UNLIT_NAME) ;
@@ -565,36 +744,137 @@ Shader* ShaderManager::getScreen()
 	return getShader(SCREEN_PROGRAM_NAME) ;
 }
 
+Shader* ShaderManager::getInstancedNormalMapping()
+{
+	return getShader(INSTANCED_NORMAL_MAPPING_PROGRAM_NAME) ;
+}
+
+Shader* ShaderManager::getInstancedSkinningLit()
+{
+	return getShader(INSTANCED_SKINNING_PROGRAM_LIT_NAME) ;
+}
+
+Shader* ShaderManager::getInstancedLit()
+{
+	return getShader(INSTANCED_PROGRAM_LIT_NAME) ;
+}
+
 Shader* ShaderManager::getShader(const String& name)
 {
-	try {
-		return getObject(name) ;
-	}
-	catch( std::out_of_range& e ) {
+	Shader* pShader = findProgram(name) ;
+	if( !pShader ) {
 		JAM_ERROR("Shader \"%s\" not found", name.c_str()) ;
 	}
+	return pShader ;
 }
 
 void ShaderManager::loadAndCreateProgram( const String& shaderName )
 {
-	std::vector<Ref<ShaderFile>> shadersFiles ;
+	loadAndCreateProgram( shaderName, shaderName ) ;
+}
+
+void ShaderManager::loadAndCreateProgram( const String& shaderName, const String& vertexShaderName )
+{
+	loadAndCreateProgram( shaderName, vertexShaderName, std::vector<String>() ) ;
+}
+
+void ShaderManager::loadAndCreateProgram( const String& shaderName, const String& vertexShaderName, const std::vector<String>& defines )
+{
+	Shader* program = nullptr ;
+	U64 key = 0 ;
+
+	// the references to the shader files must be gone before the worker may release them
+	{
+		// the sources are only read here, compiling them is up to the compiler
+		Resource vsResource( vertexShaderName + ".vert" ) ;
+		ResHandle* vsHandle( Application::getSingleton().getResourceManager().getHandle(&vsResource) ) ;
+		Ref<ShaderFile> rVertexShader( new ShaderFile(vsHandle,GL_VERTEX_SHADER), true ) ;
+
+		Resource psResource( shaderName + ".frag" ) ;
+		ResHandle* psHandle( Application::getSingleton().getResourceManager().getHandle(&psResource) ) ;
+		Ref<ShaderFile> rPixelShader( new ShaderFile(psHandle,GL_FRAGMENT_SHADER), true ) ;
 
-	Resource vsResource( shaderName + ".vert" ) ;
-	ResHandle* vsHandle( Application::getSingleton().getResourceManager().getHandle(&vsResource) ) ;
-	Ref<ShaderFile> rVertexShader( ShaderFile::shaderFromFile(vsHandle,GL_VERTEX_SHADER), true ) ;
-	shadersFiles.push_back(rVertexShader) ;
+		if( !defines.empty() ) {
+			rVertexShader->setSource( injectDefines(rVertexShader->getSource(), defines) ) ;
+			rPixelShader->setSource( injectDefines(rPixelShader->getSource(), defines) ) ;
+		}
+
+		key = ShaderCompiler::computeKey( rVertexShader->getSource(), rPixelShader->getSource(), defines ) ;
+		auto it = m_programsByKey.find( key ) ;
+		if( it != m_programsByKey.end() ) {
+			JAM_TRACE( "Program \"%s\" is identical to \"%s\"\n", shaderName.c_str(), it->second->getName().c_str() ) ;
+			m_aliases[shaderName] = it->second ;
+			return ;
+		}
 
-	Resource psResource( shaderName + ".frag" ) ;
-	ResHandle* psHandle( Application::getSingleton().getResourceManager().getHandle(&psResource) ) ;
-	Ref<ShaderFile> rPixelShader( ShaderFile::shaderFromFile(psHandle,GL_FRAGMENT_SHADER), true ) ;
-	shadersFiles.push_back(rPixelShader) ;
+		std::vector<Ref<ShaderFile>> shadersFiles ;
+		shadersFiles.push_back(rVertexShader) ;
+		shadersFiles.push_back(rPixelShader) ;
 
-	Shader* program( new Shader() ) ;
-	program->setName(shaderName) ;
-	program->setShaderFiles( shadersFiles ) ;
-	program->compile() ;
+		program = new Shader() ;
+		program->setName(shaderName) ;
+		program->setShaderFiles( shadersFiles ) ;
+	}
 
 	addObject( program ) ;
+	m_programsByKey[key] = program ;
+
+	m_compiler.submit( program, key ) ;
+}
+
+Shader* ShaderManager::getOrCreateProgram( const String& shaderName )
+{
+	return getOrCreateProgram( shaderName, shaderName ) ;
+}
+
+Shader* ShaderManager::getOrCreateProgram( const String& shaderName, const String& vertexShaderName )
+{
+	return getOrCreateProgram( shaderName, vertexShaderName, std::vector<String>() ) ;
+}
+
+Shader* ShaderManager::getOrCreateProgram( const String& shaderName, const String& vertexShaderName, const std::vector<String>& defines )
+{
+	Shader* pShader = findProgram( shaderName ) ;
+	if( !pShader ) {
+		loadAndCreateProgram( shaderName, vertexShaderName, defines ) ;
+		pShader = getShader( shaderName ) ;
+	}
+	return pShader ;
+}
+
+Shader* ShaderManager::findProgram( const String& name )
+{
+	Shader* pShader = findObject( name ) ;
+	if( !pShader ) {
+		auto it = m_aliases.find( name ) ;
+		if( it != m_aliases.end() ) {
+			pShader = it->second ;
+		}
+	}
+	return pShader ;
+}
+
+String ShaderManager::injectDefines( const String& source, const std::vector<String>& defines )
+{
+	String block ;
+	for( const String& define : defines ) {
+		block += "#define " + define + "\n" ;
+	}
+
+	// #version must stay the first directive
+	size_t pos = 0 ;
+	if( source.compare(0, 8, "#version") == 0 ) {
+		pos = source.find( '\n' ) ;
+		pos = (pos == String::npos) ? source.size() : pos + 1 ;
+	}
+
+	String result( source, 0, pos ) ;
+	if( pos == source.size() && pos > 0 && source[pos-1] != '\n' ) {
+		result += "\n" ;
+	}
+	result += block ;
+	result.append( source, pos, String::npos ) ;
+	return result ;
 }
 
 Shader*	ShaderManager::getCurrent()
@@ -0,0 +1,376 @@
+/**********************************************************************************
+* 
+* ShaderCompiler.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+#include "stdafx.h"
+#include "jam/ShaderCompiler.h"
+#include "jam/Shader.h"
+#include "jam/core/filesystem.h"
+
+#include <cstdio>
+
+#define JAM_PROGRAM_BINARY_MAGIC			0x47525042		// "BPRG"
+#define JAM_PROGRAM_BINARY_VERSION			1
+#define JAM_PROGRAM_BINARY_EXTENSION		".jprg"
+
+namespace jam
+{
+
+struct ProgramBinaryHeader
+{
+	U32						magic ;
+	U32						version ;
+	U64						key ;
+	U64						driverHash ;
+	U32						format ;
+	U32						length ;
+};
+
+static String glString( GLenum name )
+{
+	const GLubyte* pStr = glGetString( name ) ;
+	return pStr ? String( (const char*)pStr ) : String() ;
+}
+
+ShaderCompiler::ShaderCompiler() :
+	m_jobs(),
+	m_pBuilding(nullptr),
+	m_mutex(),
+	m_jobsCondition(),
+	m_doneCondition(),
+	m_quit(false),
+	m_worker(),
+	m_pWorkerContext(nullptr),
+	m_workerState(0),
+	m_binaryCacheFolder(),
+	m_driverHash(0),
+	m_binaryCacheEnabled(false)
+{
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	stopWorker() ;
+}
+
+bool ShaderCompiler::startWorker( SDL_Window* pWindow, SDL_GLContext mainContext )
+{
+	if( m_pWorkerContext ) {
+		return true ;
+	}
+
+	SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1 ) ;
+	SDL_GLContext workerContext = SDL_GL_CreateContext( pWindow ) ;
+	SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0 ) ;
+
+	// SDL_GL_CreateContext() makes the new context current
+	SDL_GL_MakeCurrent( pWindow, mainContext ) ;
+
+	if( !workerContext ) {
+		JAM_TRACE( "Shared GL context not available, shaders are built synchronously: %s", SDL_GetError() ) ;
+		return false ;
+	}
+
+	m_pWorkerContext = workerContext ;
+	m_workerState = 0 ;
+	m_quit = false ;
+	m_worker = std::thread( &ShaderCompiler::workerMain, this, pWindow ) ;
+
+	// some platforms refuse to make a context current on a second thread
+	std::unique_lock<std::mutex> lock( m_mutex ) ;
+	m_doneCondition.wait( lock, [this]{ return m_workerState != 0 ; } ) ;
+	if( m_workerState < 0 ) {
+		lock.unlock() ;
+		m_worker.join() ;
+		SDL_GL_DeleteContext( m_pWorkerContext ) ;
+		m_pWorkerContext = nullptr ;
+		JAM_TRACE( "Cannot use the shared GL context on a worker thread, shaders are built synchronously" ) ;
+		return false ;
+	}
+
+	return true ;
+}
+
+void ShaderCompiler::stopWorker()
+{
+	if( !m_pWorkerContext ) {
+		return ;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex ) ;
+		m_quit = true ;
+	}
+	m_jobsCondition.notify_all() ;
+	m_worker.join() ;
+
+	SDL_GL_DeleteContext( m_pWorkerContext ) ;
+	m_pWorkerContext = nullptr ;
+	m_quit = false ;
+}
+
+bool ShaderCompiler::enableBinaryCache( const String& folder )
+{
+	GLint numOfFormats = 0 ;
+	if( GLEW_ARB_get_program_binary ) {
+		glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numOfFormats ) ;
+	}
+
+	if( numOfFormats <= 0 ) {
+		JAM_TRACE( "Program binaries not supported by the driver, binary cache disabled" ) ;
+		m_binaryCacheEnabled = false ;
+		return false ;
+	}
+
+	// a binary can be loaded only by the driver which produced it
+	String driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION) ;
+	m_driverHash = hash( driver, 14695981039346656037ull ) ;
+	m_binaryCacheFolder = folder ;
+	m_binaryCacheEnabled = true ;
+
+	return true ;
+}
+
+void ShaderCompiler::disableBinaryCache()
+{
+	waitAll() ;
+	m_binaryCacheEnabled = false ;
+}
+
+void ShaderCompiler::submit( Shader* pShader, U64 key )
+{
+	pShader->m_buildState = Shader::BUILD_PENDING ;
+
+	Job job ;
+	job.pShader = pShader ;
+	job.key = key ;
+
+	if( !m_pWorkerContext ) {
+		build( job, false ) ;
+		return ;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex ) ;
+		m_jobs.push_back( job ) ;
+	}
+	m_jobsCondition.notify_one() ;
+}
+
+void ShaderCompiler::wait( Shader* pShader )
+{
+	std::unique_lock<std::mutex> lock( m_mutex ) ;
+	for( auto it = m_jobs.begin(); it != m_jobs.end(); ++it ) {
+		if( it->pShader == pShader ) {
+			// not started yet, the main thread builds it rather than waiting for the queue ahead of it
+			Job job = *it ;
+			m_jobs.erase( it ) ;
+			lock.unlock() ;
+			build( job, false ) ;
+			return ;
+		}
+	}
+
+	m_doneCondition.wait( lock, [this,pShader]{ return m_pBuilding != pShader ; } ) ;
+}
+
+void ShaderCompiler::waitAll()
+{
+	std::unique_lock<std::mutex> lock( m_mutex ) ;
+	while( !m_jobs.empty() ) {
+		Job job = m_jobs.front() ;
+		m_jobs.pop_front() ;
+		lock.unlock() ;
+		build( job, false ) ;
+		lock.lock() ;
+	}
+
+	m_doneCondition.wait( lock, [this]{ return m_pBuilding == nullptr ; } ) ;
+}
+
+U64 ShaderCompiler::computeKey( const String& vertexSource, const String& fragmentSource, const std::vector<String>& defines )
+{
+	U64 h = 14695981039346656037ull ;
+	h = hash( vertexSource, h ) ;
+	h = hash( fragmentSource, h ) ;
+	for( const String& define : defines ) {
+		h = hash( define, h ) ;
+	}
+	return h ;
+}
+
+U64 ShaderCompiler::hash( const String& s, U64 h )
+{
+	// FNV-1a, the terminator is hashed too so that the concatenation of different strings can't collide
+	const char* p = s.c_str() ;
+	do {
+		h ^= (U8)*p ;
+		h *= 1099511628211ull ;
+	} while( *p++ ) ;
+	return h ;
+}
+
+void ShaderCompiler::build( const Job& job, bool onWorker )
+{
+	Shader* pShader = job.pShader ;
+	String errorMsg ;
+
+	bool linked = m_binaryCacheEnabled && loadBinary( job ) ;
+	if( !linked ) {
+		linked = pShader->link( errorMsg, m_binaryCacheEnabled ) ;
+		if( linked && m_binaryCacheEnabled ) {
+			storeBinary( job ) ;
+		}
+	}
+
+	if( linked ) {
+		pShader->bindUniformBlocks() ;
+	}
+
+	// the main context may use the program as soon as it is marked as linked
+	if( onWorker ) {
+		glFinish() ;
+	}
+
+	pShader->setBuildResult( linked, errorMsg ) ;
+}
+
+bool ShaderCompiler::loadBinary( const Job& job )
+{
+	String pathName = getBinaryPathName( job.key ) ;
+	FILE* fp = fopen( pathName.c_str(), "rb" ) ;
+	if( !fp ) {
+		return false ;
+	}
+
+	ProgramBinaryHeader header ;
+	std::vector<U8> binary ;
+	bool ok = fread( &header, sizeof(header), 1, fp ) == 1 &&
+			  header.magic == JAM_PROGRAM_BINARY_MAGIC &&
+			  header.version == JAM_PROGRAM_BINARY_VERSION &&
+			  header.key == job.key &&
+			  header.driverHash == m_driverHash &&
+			  header.length > 0 ;
+	if( ok ) {
+		binary.resize( header.length ) ;
+		ok = fread( binary.data(), 1, binary.size(), fp ) == binary.size() ;
+	}
+	fclose( fp ) ;
+
+	// the driver may still refuse the binary, e.g. after an update not reflected by its version string
+	ok = ok && job.pShader->linkBinary( (GLenum)header.format, binary.data(), (GLsizei)binary.size() ) ;
+	if( !ok ) {
+		JAM_TRACE( "Ignoring stale or invalid program binary %s", pathName.c_str() ) ;
+	}
+
+	return ok ;
+}
+
+void ShaderCompiler::storeBinary( const Job& job )
+{
+	GLuint program = job.pShader->m_object ;
+
+	GLint length = 0 ;
+	glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length ) ;
+	if( length <= 0 ) {
+		return ;
+	}
+
+	std::vector<U8> binary( (size_t)length ) ;
+	GLenum format = 0 ;
+	glGetProgramBinary( program, length, &length, &format, binary.data() ) ;
+	if( length <= 0 ) {
+		return ;
+	}
+
+	ProgramBinaryHeader header ;
+	header.magic = JAM_PROGRAM_BINARY_MAGIC ;
+	header.version = JAM_PROGRAM_BINARY_VERSION ;
+	header.key = job.key ;
+	header.driverHash = m_driverHash ;
+	header.format = (U32)format ;
+	header.length = (U32)length ;
+
+	String pathName = getBinaryPathName( job.key ) ;
+	FILE* fp = fopen( pathName.c_str(), "wb" ) ;
+	if( !fp ) {
+		// read-only locations simply keep compiling from source
+		JAM_TRACE( "Cannot write program binary %s", pathName.c_str() ) ;
+		return ;
+	}
+
+	bool ok = fwrite( &header, sizeof(header), 1, fp ) == 1 &&
+			  fwrite( binary.data(), 1, (size_t)length, fp ) == (size_t)length ;
+	fclose( fp ) ;
+
+	if( !ok ) {
+		remove( pathName.c_str() ) ;
+	}
+}
+
+String ShaderCompiler::getBinaryPathName( U64 key ) const
+{
+	char fileName[32] ;
+	snprintf( fileName, sizeof(fileName), "%016llx" JAM_PROGRAM_BINARY_EXTENSION, (unsigned long long)key ) ;
+	return appendPath( m_binaryCacheFolder, fileName ) ;
+}
+
+void ShaderCompiler::workerMain( SDL_Window* pWindow )
+{
+	bool current = SDL_GL_MakeCurrent( pWindow, m_pWorkerContext ) == 0 ;
+
+	std::unique_lock<std::mutex> lock( m_mutex ) ;
+	m_workerState = current ? 1 : -1 ;
+	m_doneCondition.notify_all() ;
+	if( !current ) {
+		return ;
+	}
+
+	for(;;) {
+		// queued programs are still built when quitting, someone may be waiting for them
+		m_jobsCondition.wait( lock, [this]{ return m_quit || !m_jobs.empty() ; } ) ;
+		if( m_jobs.empty() ) {
+			break ;
+		}
+
+		Job job = m_jobs.front() ;
+		m_jobs.pop_front() ;
+		m_pBuilding = job.pShader ;
+		lock.unlock() ;
+
+		build( job, true ) ;
+
+		lock.lock() ;
+		m_pBuilding = nullptr ;
+		m_doneCondition.notify_all() ;
+	}
+
+	lock.unlock() ;
+	SDL_GL_MakeCurrent( pWindow, nullptr ) ;
+}
+
+}
@@ -39,7 +39,7 @@
 namespace jam
 {
 ShaderFile::ShaderFile( GLenum shaderType ) :
-    m_objectID(0), m_shaderType(shaderType), m_compiled(false), m_sourceCode(), m_resHandle()
+    m_objectID(0), m_shaderType(shaderType), m_compiled(false), m_sourceCode(), m_resHandle(), m_sourceName()
 {
 }
 
@@ -48,6 +48,7 @@ ShaderFile::ShaderFile( ResHandle* resHandle, GLenum shaderType ) :
 {
 	m_resHandle = resHandle ;
 	if( m_resHandle ) {
+		m_sourceName = m_resHandle->getResource().getName() ;
 		setSource( m_resHandle->getBuffer() ) ;
 	}
 }
@@ -60,32 +61,52 @@ ShaderFile::~ShaderFile()
 }
 
 void ShaderFile::compile()
+{
+	String msg ;
+	if( !tryCompile(msg) ) {
+		JAM_ERROR(msg.c_str());
+	}
+}
+
+bool ShaderFile::tryCompile( String& errorMsg )
 {
 	if( !m_compiled ) {
+		if( m_objectID == 0) {
+			//create the shader object
+			m_objectID = glCreateShader(m_shaderType);
+			if(m_objectID == 0) {
+				errorMsg = "glCreateShader failed" ;
+				return false ;
+			}
+		}
+
 		//compile
-		JAM_TRACE( "Compiling shader \"%s\"\n", m_resHandle->getResource().getName().c_str() ) ;
+		JAM_TRACE( "Compiling shader \"%s\"\n", m_sourceName.c_str() ) ;
 
+		const char* code = m_sourceCode.c_str();
+		glShaderSource(m_objectID, 1, (const GLchar**)&code, NULL);
 		glCompileShader(m_objectID);
     
-		//throw exception if compile error occurred
 		GLint status;
 		glGetShaderiv(m_objectID, GL_COMPILE_STATUS, &status);
 		if (status == GL_FALSE) {
-			String msg("Compile failure in shader: \"" + m_resHandle->getResource().getName() + "\"\n");
+			errorMsg = "Compile failure in shader: \"" + m_sourceName + "\"\n" ;
         
 			GLint infoLogLength;
 			glGetShaderiv(m_objectID, GL_INFO_LOG_LENGTH, &infoLogLength);
 			char* strInfoLog = new char[infoLogLength + 1];
 			glGetShaderInfoLog(m_objectID, infoLogLength, NULL, strInfoLog);
-			msg += strInfoLog;
+			errorMsg += strInfoLog;
 			delete[] strInfoLog;
         
 			glDeleteShader(m_objectID); m_objectID = 0;
-			JAM_ERROR(msg.c_str());
+			return false ;
 		}
 
 		m_compiled = true ;
 	}
+
+	return true ;
 }
 
 GLuint ShaderFile::objectID() const {
@@ -100,17 +121,7 @@ ShaderFile* ShaderFile::shaderFromFile( ResHandle* resHandle, GLenum shaderType
 
 void ShaderFile::setSource( const String& shaderCode )
 {
-	if( m_objectID == 0) {
-		//create the shader object
-		m_objectID = glCreateShader(m_shaderType);
-		if(m_objectID == 0) {
-			JAM_ERROR("glCreateShader failed");
-		}
-	}
-
 	m_sourceCode = shaderCode ;
-    const char* code = m_sourceCode.c_str();
-    glShaderSource(m_objectID, 1, (const GLchar**)&code, NULL);
 	m_compiled = false ;
 }
 
@@ -0,0 +1,187 @@
+/**********************************************************************************
+* 
+* SharedUniforms.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/SharedUniforms.h"
+#include "jam/Camera.h"
+
+namespace jam
+{
+
+//*******************
+//
+// Class SharedUniforms
+//
+//*******************
+
+SharedUniforms::SharedUniforms() :
+	m_frameUbo(GL_UNIFORM_BUFFER),
+	m_views(),
+	m_objects(),
+	m_frame(),
+	m_view(),
+	m_object(),
+	m_hasView(false),
+	m_hasObject(false),
+	m_numOfObjectWrites(0)
+{
+	m_frame.time = Vector4( 0.0f ) ;
+	m_view.viewMatrix = m_view.projMatrix = Matrix4(1.0f) ;
+	m_view.viewPos = Vector4( 0.0f ) ;
+	m_object.modelMatrix = Matrix4(1.0f) ;
+}
+
+void SharedUniforms::newFrame()
+{
+	JAM_PROFILE_COUNTER( "SharedUniforms.objectWrites", m_numOfObjectWrites ) ;
+	m_numOfObjectWrites = 0 ;
+
+	// the bound blocks are written again in the new storage, so that they stay valid across frames
+	if( m_views.next ) {
+		m_views.next = m_views.numOfSlots ;
+		if( m_hasView ) commitView() ;
+	}
+	if( m_objects.next ) {
+		m_objects.next = m_objects.numOfSlots ;
+		if( m_hasObject ) commitObject() ;
+	}
+}
+
+void SharedUniforms::setFrame( float totalTime, float deltaTime )
+{
+	m_frame.time = Vector4( totalTime, deltaTime, m_frame.time.z + 1.0f, 0.0f ) ;
+
+	m_frameUbo.bind() ;
+	m_frameUbo.bufferData( sizeof(FrameData), nullptr, GL_STREAM_DRAW ) ;
+	m_frameUbo.bufferData( sizeof(FrameData), &m_frame, GL_STREAM_DRAW ) ;
+	m_frameUbo.unbind() ;
+	glBindBufferBase( GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_frameUbo.getId() ) ;
+}
+
+void SharedUniforms::setView( Camera* pCam )
+{
+	setView( pCam->getViewMatrix(), pCam->getProjectionMatrix(), pCam->getPosition() ) ;
+}
+
+void SharedUniforms::setView( const Matrix4& viewMatrix, const Matrix4& projMatrix, const Vector3& viewPos )
+{
+	if( m_hasView && m_view.viewMatrix == viewMatrix && m_view.projMatrix == projMatrix && Vector3(m_view.viewPos) == viewPos ) {
+		return ;
+	}
+	m_view.viewMatrix = viewMatrix ;
+	m_view.projMatrix = projMatrix ;
+	m_view.viewPos = Vector4( viewPos, 1.0f ) ;
+	commitView() ;
+}
+
+void SharedUniforms::setViewMatrix( const Matrix4& mat )
+{
+	setView( mat, m_view.projMatrix, Vector3(m_view.viewPos) ) ;
+}
+
+void SharedUniforms::setProjectionMatrix( const Matrix4& mat )
+{
+	setView( m_view.viewMatrix, mat, Vector3(m_view.viewPos) ) ;
+}
+
+void SharedUniforms::setViewPosition( const Vector3& pos )
+{
+	setView( m_view.viewMatrix, m_view.projMatrix, pos ) ;
+}
+
+void SharedUniforms::setModelMatrix( const Matrix4& mat )
+{
+	if( m_hasObject && m_object.modelMatrix == mat ) {
+		return ;
+	}
+
+	m_object.modelMatrix = mat ;
+	Matrix3 normalMatrix = computeNormalMatrix( mat ) ;
+	for( int i=0; i<3; i++ ) {
+		m_object.normalMatrix[i] = Vector4( normalMatrix[i], 0.0f ) ;
+	}
+	commitObject() ;
+}
+
+void SharedUniforms::commitView()
+{
+	if( !m_views.numOfSlots ) {
+		createRing( m_views, sizeof(ViewData), JAM_SHARED_UNIFORMS_VIEW_SLOTS ) ;
+	}
+	GLintptr offset = write( m_views, &m_view, sizeof(ViewData) ) ;
+	glBindBufferRange( GL_UNIFORM_BUFFER, VIEW_BLOCK_BINDING, m_views.ubo.getId(), offset, sizeof(ViewData) ) ;
+	m_hasView = true ;
+}
+
+void SharedUniforms::commitObject()
+{
+	if( !m_objects.numOfSlots ) {
+		createRing( m_objects, sizeof(ObjectData), JAM_SHARED_UNIFORMS_OBJECT_SLOTS ) ;
+	}
+	GLintptr offset = write( m_objects, &m_object, sizeof(ObjectData) ) ;
+	glBindBufferRange( GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, m_objects.ubo.getId(), offset, sizeof(ObjectData) ) ;
+	m_hasObject = true ;
+	m_numOfObjectWrites++ ;
+}
+
+void SharedUniforms::createRing( Ring& ring, size_t dataSize, size_t numOfSlots )
+{
+	// bound ranges must start at a multiple of the offset alignment
+	GLint alignment = 256 ;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment ) ;
+
+	ring.ubo.setTarget( GL_UNIFORM_BUFFER ) ;
+	ring.slotSize = (dataSize + alignment - 1) / alignment * alignment ;
+	ring.numOfSlots = numOfSlots ;
+	ring.next = 0 ;
+
+	ring.ubo.bind() ;
+	ring.ubo.bufferData( ring.slotSize * ring.numOfSlots, nullptr, GL_STREAM_DRAW ) ;
+	ring.ubo.unbind() ;
+}
+
+GLintptr SharedUniforms::write( Ring& ring, const void* pData, size_t size )
+{
+	ring.ubo.bind() ;
+	if( ring.next == ring.numOfSlots ) {
+		// orphans the storage, the draws already issued keep reading the previous one
+		ring.ubo.bufferData( ring.slotSize * ring.numOfSlots, nullptr, GL_STREAM_DRAW ) ;
+		ring.next = 0 ;
+	}
+
+	GLintptr offset = (GLintptr)(ring.next * ring.slotSize) ;
+	ring.ubo.bufferSubData( offset, size, pData ) ;
+	ring.ubo.unbind() ;
+	ring.next++ ;
+
+	return offset ;
+}
+
+}
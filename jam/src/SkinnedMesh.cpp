@@ -53,6 +53,7 @@ namespace jam
 		m_elements(0),
 		m_vbos(),
 		m_vao(),
+		m_numOfElements(0),
 		m_uploaded(false)
 	{
 		m_pMaterial = new Material() ;
@@ -153,6 +154,58 @@ namespace jam
 		m_vbos[4].unbind() ;
 		m_vbos[5].unbind() ;
 
+		m_numOfElements = m_elements.length() ;
+		m_uploaded = true ;
+	}
+
+	/**
+		Uploads an interleaved vertex stream and its indices straight to GPU memory
+		\remark no copy is kept in the cpu-side arrays, so the source buffers can be released right after the call
+	*/
+	void SkinnedMesh::uploadInterleaved( const SkinnedMeshVertex* pVertices, size_t numOfVertices, const U16* pElements, size_t numOfElements )
+	{
+		if( m_uploaded ) {
+			return ;
+		}
+
+		Shader* pProg = m_pMaterial->getShader() ;
+		pProg->use() ;
+
+		VertexBufferObject& vbo = m_vbos[0] ;
+		VertexBufferObject& ebo = m_vbos[m_vbos.length()-1] ;
+		vbo.create() ;
+		ebo.create() ;
+		m_vao.create() ;
+
+		// bind vao
+		// all glBindBuffer, glVertexAttribPointer, and glEnableVertexAttribArray calls are tracked and stored in the vao
+		m_vao.bind() ;
+
+		GLsizei stride = sizeof(SkinnedMeshVertex) ;
+		vbo.bind() ;
+		vbo.bufferData( numOfVertices * stride, pVertices ) ;
+		pProg->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(SkinnedMeshVertex,position)) ;
+		pProg->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_POSITION) ;
+		pProg->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(SkinnedMeshVertex,normal)) ;
+		pProg->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_NORMAL) ;
+		pProg->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_TEXCOORDS, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(SkinnedMeshVertex,texCoords)) ;
+		pProg->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_TEXCOORDS) ;
+		pProg->setVertexAttribIntegerPointer(JAM_PROGRAM_ATTRIB_BONESID, 4, GL_INT, stride, (const GLvoid*)offsetof(SkinnedMeshVertex,bonesId)) ;
+		pProg->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_BONESID) ;
+		pProg->setVertexAttribPointer(JAM_PROGRAM_ATTRIB_WEIGHTS, 4, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(SkinnedMeshVertex,weights)) ;
+		pProg->enableVertexAttribArray(JAM_PROGRAM_ATTRIB_WEIGHTS) ;
+
+		// upload indices
+		ebo.bind() ;
+		ebo.bufferData( numOfElements * sizeof(U16), pElements ) ;
+
+		// unbind vao
+ 		m_vao.unbind() ;
+
+		vbo.unbind() ;
+		ebo.unbind() ;
+
+		m_numOfElements = numOfElements ;
 		m_uploaded = true ;
 	}
 
@@ -161,7 +214,19 @@ namespace jam
 		if( !isUploaded() ) {
 			upload() ;
 		}
-		GetGfx().drawIndexedPrimitive( &m_vao, getElementsArray().length(), m_pMaterial ) ;
+		GetGfx().drawIndexedPrimitive( &m_vao, m_numOfElements, m_pMaterial ) ;
+	}
+
+	/**
+		Draws numOfInstances copies of the mesh with a single draw call, using the given instancing program
+		\remark if pMaterial is null the mesh material is used
+	*/
+	void SkinnedMesh::drawInstanced( size_t numOfInstances, Shader* pShader, Material* pMaterial /*= nullptr*/ )
+	{
+		if( !isUploaded() ) {
+			upload() ;
+		}
+		GetGfx().drawIndexedPrimitiveInstanced( &m_vao, m_numOfElements, numOfInstances, pMaterial ? pMaterial : m_pMaterial, pShader ) ;
 	}
 
 }
@@ -35,9 +35,15 @@
 #include <jam/Scene.h>
 #include <jam/Camera.h>
 #include <jam/Transform.h>
+#include <jam/InstancingManager.h>
+#include <jam/Light.h>
+#include <jam/SharedUniforms.h>
+#include <jam/JobSystem.h>
 #include <jam/core/filesystem.h>
 #include <jam/core/geom.h>
 
+#include <algorithm>
+
 namespace jam
 {
 
@@ -49,15 +55,12 @@ namespace jam
 
 	SkinnedModel::SkinnedModel() :
 		GameObject(),
-		m_meshes(),
+		m_data(),
 		m_folder(),
-		m_numBones(0),
-		m_globalInverseTransform(),
-		m_boneInfo(),
-		m_pScene(0),
-		m_import(),
-		m_boneMapping(),
-		m_animMapping()
+		m_nodeTransforms(),
+		m_instanceTransforms(),
+		m_instancesPalettes(),
+		m_threadNodeTransforms()
 	{
 	}
 
@@ -82,9 +85,10 @@ namespace jam
         
 		bool boneTransformSet = false ;
 
+		std::vector<Ref<SkinnedMesh>>& meshes = m_data->getMeshes() ;
 		Shader* pProg = nullptr ;
-		for( size_t i = 0; i < m_meshes.size(); i++ ) {
-			pMesh = m_meshes[i] ;
+		for( size_t i = 0; i < meshes.size(); i++ ) {
+			pMesh = meshes[i] ;
 			pMaterial = pMesh->getMaterial() ;
 			pProg = pMaterial->getShader() ;
 			pProg->use();
@@ -100,186 +104,314 @@ namespace jam
 
 			pProg->setModelMatrix(getTransform().getWorldTformMatrix()) ;
 
-			// the 3 following commands are needed if camera is changed since last frame
-			// OR gpu program / uniforms are uninitialized
-			pProg->setViewMatrix(pCam->getViewMatrix()) ;
-			pProg->setProjectionMatrix(pCam->getProjectionMatrix()) ;
-			pProg->setViewPosition( pCam->getPosition() ) ;
+			// the view is shared by all the programs, it's written only if the camera has changed
+			GetSharedUniforms().setView( pCam ) ;
+			GetLightMgr().prepare( pCam ) ;
 
-			m_meshes[i]->draw();
+			pMesh->draw();
 		}
 	}
 
-	void SkinnedModel::load(const String& modelPath)
+	void SkinnedModel::addInstance( const Matrix4& worldMatrix, float timeInSeconds, size_t animationIdx /*= 0*/, const Color& color /*= Color::WHITE*/ )
 	{
-		m_pScene = m_import.ReadFile(modelPath.c_str(), aiProcess_LimitBoneWeights | aiProcess_GenNormals | aiProcess_Triangulate | aiProcess_FlipWindingOrder );	
-	
-		if( !m_pScene || m_pScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !m_pScene->mRootNode ) 
-		{
-			JAM_ERROR( "assimp error: %s", m_import.GetErrorString() ) ;
-			return;
+		boneTransform( timeInSeconds, animationIdx, m_instanceTransforms ) ;
+
+		// all the meshes of the instance share the same bones palette
+		size_t bonesPaletteBase = GetInstancingMgr().addBonesPalette( m_instanceTransforms ) ;
+		for( auto& rMesh : m_data->getMeshes() ) {
+			GetInstancingMgr().addInstance( rMesh.get(), worldMatrix, bonesPaletteBase, color ) ;
+		}
+	}
+
+	void SkinnedModel::addInstances( const Matrix4* pWorldMatrices, const float* pTimesInSeconds, size_t numOfInstances, size_t animationIdx /*= 0*/, const Color& color /*= Color::WHITE*/ )
+	{
+		if( m_instancesPalettes.size() < numOfInstances ) {
+			m_instancesPalettes.resize( numOfInstances ) ;
+		}
+		m_threadNodeTransforms.resize( GetJobSystem().getNumOfThreads() ) ;
+
+		// sampling only reads the shared clips, every instance writes its own palette
+		GetJobSystem().parallelFor( numOfInstances, 8, [&]( size_t begin, size_t end ) {
+			std::vector<Matrix4>& nodeTransforms = m_threadNodeTransforms[JobSystem::getThreadIndex()] ;
+			for( size_t i=begin; i<end; i++ ) {
+				sampleBones( pTimesInSeconds[i], animationIdx, nodeTransforms, m_instancesPalettes[i] ) ;
+			}
+		} ) ;
+
+		// InstancingManager isn't thread-safe, instances are queued by the calling thread
+		for( size_t i=0; i<numOfInstances; i++ ) {
+			size_t bonesPaletteBase = GetInstancingMgr().addBonesPalette( m_instancesPalettes[i] ) ;
+			for( auto& rMesh : m_data->getMeshes() ) {
+				GetInstancingMgr().addInstance( rMesh.get(), pWorldMatrices[i], bonesPaletteBase, color ) ;
+			}
 		}
+	}
+
+	void SkinnedModel::load(const String& modelPath)
+	{
 		m_folder = jam::getDirname( modelPath );
 
-		// we take the model (root) matrix and invert it
-		m_globalInverseTransform = glm::inverse( assimpToGlmMatrix(m_pScene->mRootNode->mTransformation) ) ;
+		ModelCache& cache = GetModelCache() ;
+		SkinnedModelData* pData = cache.findSkinnedModel( modelPath ) ;
+		if( !pData ) {
+			Ref<SkinnedModelData> rData( new SkinnedModelData() ) ;
+			std::vector<U8>& blob = rData->getBlob() ;
+			if( !cache.readCooked( modelPath, true, blob ) ) {
+				cook( modelPath, blob ) ;
+				cache.writeCooked( modelPath, blob ) ;
+			}
 
-		if( getNumOfAnimations() == 0 ) {
-			JAM_ERROR( "No animations found" ) ;
+			CookedModelView& view = rData->getView() ;
+			if( !ModelCache::parse( blob, view ) ) {
+				JAM_ERROR( "Invalid cooked model %s", modelPath.c_str() ) ;
+			}
+
+			if( view.clips.empty() ) {
+				JAM_ERROR( "No animations found" ) ;
+			}
+
+			std::map<String,Ref<Texture2D>> textures ;
+			for( auto& meshView : view.meshes ) {
+				Ref<SkinnedMesh> rMesh( new SkinnedMesh() ) ;
+				rMesh->getMaterial()->setShader( GetShaderMgr().getSkinningLit() ) ;
+				cache.setupMaterial( rMesh->getMaterial(), *meshView.pHeader, m_folder, textures ) ;
+				rMesh->uploadInterleaved( (const SkinnedMeshVertex*)meshView.pVertices, meshView.pHeader->numOfVertices, meshView.pElements, meshView.pHeader->numOfElements ) ;
+				rData->getMeshes().push_back( rMesh ) ;
+			}
+
+			cache.addSkinnedModel( modelPath, rData ) ;
+			pData = rData ;
 		}
 
-		storeAnim() ;
-		processNode(m_pScene->mRootNode);
+		m_data.assign( pData, true ) ;
 	}
 
 	int SkinnedModel::getNumOfAnimations() const
 	{
-		return ((m_pScene != 0) ? m_pScene->mNumAnimations : -1) ;
+		return (m_data.isNull() ? -1 : (int)m_data->getView().clips.size()) ;
 	}
 	
 	void SkinnedModel::boneTransform(float TimeInSeconds, size_t animationIdx, std::vector<Matrix4>& Transforms)
 	{
-		Matrix4 Identity(1.0f);
-    
-		float TicksPerSecond = (float)(m_pScene->mAnimations[animationIdx]->mTicksPerSecond != 0 ? m_pScene->mAnimations[animationIdx]->mTicksPerSecond : 25.0f);
+		sampleBones( TimeInSeconds, animationIdx, m_nodeTransforms, Transforms ) ;
+	}
+
+	void SkinnedModel::sampleBones( float TimeInSeconds, size_t animationIdx, std::vector<Matrix4>& nodeTransforms, std::vector<Matrix4>& Transforms ) const
+	{
+		const CookedModelView& view = m_data->getView() ;
+		const CookedModelHeader& header = *view.pHeader ;
+		const CookedClipView& clip = view.clips[animationIdx] ;
+
+		float TicksPerSecond = (clip.pHeader->ticksPerSecond != 0.0f) ? clip.pHeader->ticksPerSecond : 25.0f ;
 		float TimeInTicks = TimeInSeconds * TicksPerSecond;
-		float AnimationTime = fmod(TimeInTicks, (float)m_pScene->mAnimations[animationIdx]->mDuration);
+		float AnimationTime = fmod(TimeInTicks, clip.pHeader->duration);
+
+		nodeTransforms.resize( header.numOfNodes ) ;
+		Transforms.assign( header.numOfBones, Matrix4(1.0f) ) ;
 
-		readNodeHeirarchy(AnimationTime, m_pScene->mRootNode, Identity, animationIdx);
+		// nodes are stored parents first, so a single forward pass replaces the recursive visit
+		for( size_t i = 0; i < header.numOfNodes; i++ ) {
+			const CookedNode& node = view.pNodes[i] ;
+
+			Matrix4 NodeTransformation = node.transform ;
+			I32 channelIdx = clip.nodeChannels[i] ;
+			if( channelIdx >= 0 ) {
+				const CookedChannelView& channel = clip.channels[channelIdx] ;
+				Vector3 Translation = calcInterpolated( channel.pPositions, channel.pHeader->numOfPositionKeys, AnimationTime ) ;
+				Quaternion RotationQ = calcInterpolated( channel.pRotations, channel.pHeader->numOfRotationKeys, AnimationTime ) ;
+				Vector3 Scaling = calcInterpolated( channel.pScalings, channel.pHeader->numOfScalingKeys, AnimationTime ) ;
+
+				// Combine the above transformations
+				NodeTransformation = glm::translate( Matrix4(1.0f), Translation ) * glm::mat4_cast( RotationQ ) * glm::scale( Matrix4(1.0f), Scaling ) ;
+			}
 
-		Transforms.resize(m_numBones);
-		for( size_t i = 0 ; i < m_numBones ; i++ ) {
-			Transforms[i] = m_boneInfo[i].FinalTransformation;
+			nodeTransforms[i] = (node.parent >= 0) ? nodeTransforms[node.parent] * NodeTransformation : NodeTransformation ;
+
+			if( node.boneIndex >= 0 ) {
+				Transforms[node.boneIndex] = header.globalInverseTransform * nodeTransforms[i] * view.pBoneOffsets[node.boneIndex] ;
+			}
 		}
 	}
 
-	void SkinnedModel::processNode(aiNode* node)
+	Vector3 SkinnedModel::calcInterpolated( const CookedVectorKey* pKeys, size_t numOfKeys, float AnimationTime )
+	{
+		if( numOfKeys == 1 ) {
+			return pKeys[0].value ;
+		}
+
+		// first key whose time is greater than AnimationTime
+		const CookedVectorKey* pNext = std::upper_bound( pKeys + 1, pKeys + numOfKeys - 1, AnimationTime,
+			[]( float t, const CookedVectorKey& key ) { return t < key.time ; } ) ;
+		const CookedVectorKey* pPrev = pNext - 1 ;
+
+		float DeltaTime = pNext->time - pPrev->time ;
+		float Factor = glm::clamp( (AnimationTime - pPrev->time) / DeltaTime, 0.0f, 1.0f ) ;
+		return glm::mix( pPrev->value, pNext->value, Factor ) ;
+	}
+
+	Quaternion SkinnedModel::calcInterpolated( const CookedQuatKey* pKeys, size_t numOfKeys, float AnimationTime )
+	{
+		// we need at least two values to interpolate...
+		if( numOfKeys == 1 ) {
+			return Quaternion( pKeys[0].value.w, pKeys[0].value.x, pKeys[0].value.y, pKeys[0].value.z ) ;
+		}
+
+		const CookedQuatKey* pNext = std::upper_bound( pKeys + 1, pKeys + numOfKeys - 1, AnimationTime,
+			[]( float t, const CookedQuatKey& key ) { return t < key.time ; } ) ;
+		const CookedQuatKey* pPrev = pNext - 1 ;
+
+		float DeltaTime = pNext->time - pPrev->time ;
+		float Factor = glm::clamp( (AnimationTime - pPrev->time) / DeltaTime, 0.0f, 1.0f ) ;
+		Quaternion StartRotationQ( pPrev->value.w, pPrev->value.x, pPrev->value.y, pPrev->value.z ) ;
+		Quaternion EndRotationQ( pNext->value.w, pNext->value.x, pNext->value.y, pNext->value.z ) ;
+		return glm::normalize( glm::slerp( StartRotationQ, EndRotationQ, Factor ) ) ;
+	}
+
+	void SkinnedModel::cook( const String& modelPath, std::vector<U8>& blob )
+	{
+		Assimp::Importer import ;
+		const aiScene* pScene = import.ReadFile(modelPath.c_str(), aiProcess_LimitBoneWeights | aiProcess_GenNormals | aiProcess_Triangulate | aiProcess_FlipWindingOrder );	
+	
+		if( !pScene || pScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !pScene->mRootNode ) 
+		{
+			JAM_ERROR( "assimp error: %s", import.GetErrorString() ) ;
+			return;
+		}
+
+		if( pScene->mNumAnimations == 0 ) {
+			JAM_ERROR( "No animations found" ) ;
+		}
+
+		CookedModelHeader header ;
+		memset( &header, 0, sizeof(header) ) ;
+		header.magic = JAM_COOKED_MODEL_MAGIC ;
+		header.version = JAM_COOKED_MODEL_VERSION ;
+		header.skinned = 1 ;
+		header.sourceSize = (U32)getFileSize( modelPath.c_str() ) ;
+		header.sourceTime = getFileModificationTime( modelPath.c_str() ) ;
+
+		// we take the model (root) matrix and invert it
+		header.globalInverseTransform = glm::inverse( assimpToGlmMatrix(pScene->mRootNode->mTransformation) ) ;
+
+		blob.clear() ;
+		CookedModelWriter writer( blob ) ;
+		writer.write( header ) ;
+
+		// meshes, bones are numbered as they are met
+		BonesMap boneMapping ;
+		std::vector<Matrix4> boneOffsets ;
+		processNode( pScene, pScene->mRootNode, writer, boneMapping, boneOffsets ) ;
+
+		writer.at<CookedModelHeader>(0)->numOfBones = (U32)boneOffsets.size() ;
+		for( auto& offset : boneOffsets ) {
+			writer.write( offset ) ;
+		}
+
+		// skeleton
+		std::map<String,I32> nodeMapping ;
+		U32 numOfNodes = 0 ;
+		processNodeHierarchy( pScene->mRootNode, -1, writer, boneMapping, nodeMapping, numOfNodes ) ;
+		writer.at<CookedModelHeader>(0)->numOfNodes = numOfNodes ;
+
+		// clips
+		writer.at<CookedModelHeader>(0)->numOfClips = pScene->mNumAnimations ;
+		for( unsigned int i = 0; i < pScene->mNumAnimations; i++ ) {
+			processAnimation( pScene->mAnimations[i], writer, nodeMapping ) ;
+		}
+	}
+
+	void SkinnedModel::processNode(const aiScene* pScene, aiNode* node, CookedModelWriter& writer, BonesMap& boneMapping, std::vector<Matrix4>& boneOffsets)
 	{
 		// process all the node's meshes (if any)
 		for( size_t i = 0; i < node->mNumMeshes; i++ )
 		{
-			aiMesh *mesh = m_pScene->mMeshes[node->mMeshes[i]]; 
-			m_meshes.push_back(processMesh(mesh));			
+			aiMesh *mesh = pScene->mMeshes[node->mMeshes[i]]; 
+			processMesh(pScene, mesh, writer, boneMapping, boneOffsets);
+			writer.at<CookedModelHeader>(0)->numOfMeshes++ ;
 		}
 		// then do the same for each of its children
 		for( size_t i = 0; i < node->mNumChildren; i++ )
 		{
-			processNode(node->mChildren[i]);
+			processNode(pScene, node->mChildren[i], writer, boneMapping, boneOffsets);
 		}	
 	}
 	
-	SkinnedMesh* SkinnedModel::processMesh(aiMesh* pAiMesh)
+	void SkinnedModel::processMesh(const aiScene* pScene, aiMesh* pAiMesh, CookedModelWriter& writer, BonesMap& boneMapping, std::vector<Matrix4>& boneOffsets)
 	{
 		size_t numOfVertices = pAiMesh->mNumVertices ;
+		JAM_ASSERT_MSG( numOfVertices <= 65536, "Too many vertices for 16 bits indices" ) ;
 
-		size_t numOfIndices = 0 ;
-		for( size_t i=0; i<pAiMesh->mNumFaces; i++ ) {
-			// check that faces are triangles
-			JAM_ASSERT(pAiMesh->mFaces[i].mNumIndices == 3) ;
-			numOfIndices += pAiMesh->mFaces[i].mNumIndices ;
-		}
-
-		SkinnedMesh* pMesh = new SkinnedMesh() ;
-		pMesh->getMaterial()->setShader( GetShaderMgr().getSkinningLit() ) ;
+		CookedMeshHeader meshHeader ;
+		memset( &meshHeader, 0, sizeof(meshHeader) ) ;
+		meshHeader.numOfVertices = (U32)numOfVertices ;
+		meshHeader.numOfElements = pAiMesh->mNumFaces * 3 ;
+		meshHeader.vertexStride = sizeof(SkinnedMeshVertex) ;
+		meshHeader.shininess = -1.0f ;
 
-		pMesh->create(numOfVertices, numOfIndices) ;
+		// process material
+		if(pAiMesh->mMaterialIndex >= 0)
+		{
+			aiMaterial *pAiMaterial = pScene->mMaterials[pAiMesh->mMaterialIndex];
 
-		HeapArray<Vector3>& verticesArray = pMesh->getVerticesArray() ;
-		HeapArray<Vector3>& normalsArray = pMesh->getNormalsArray() ;
-		HeapArray<Vector2>& texCoordsArray = pMesh->getTexCoordsArray() ;
-		HeapArray<uint16_t>& elementsArray = pMesh->getElementsArray() ;
+			float matShininess = 0.0f ;
+			if( AI_SUCCESS == (pAiMaterial->Get( AI_MATKEY_SHININESS, matShininess )) ) {
+				meshHeader.shininess = matShininess ;
+			}
 
-		aiVector3D* aiVertices = pAiMesh->mVertices ;
-		aiVector3D* aiNormals = pAiMesh->mNormals ;
-		size_t bytesize = numOfVertices * sizeof(Vector3) ;
+			loadMaterialTexture(pAiMaterial, aiTextureType_DIFFUSE, meshHeader.diffuseTexture);
+			loadMaterialTexture(pAiMaterial, aiTextureType_SPECULAR, meshHeader.specularTexture);
+		}
 
-		memcpy( verticesArray.data(), aiVertices, bytesize ) ;
-		memcpy( normalsArray.data(), aiNormals, bytesize ) ;
+		writer.write( meshHeader ) ;
 
+		// interleave the vertex streams,
 		// get only first set of texture coords (there are a total of 8 sets)
+		std::vector<SkinnedMeshVertex> vertices( numOfVertices ) ;
+		memset( vertices.data(), 0, vertices.size() * sizeof(SkinnedMeshVertex) ) ;
 		aiVector3D* aiTextureCoords = pAiMesh->mTextureCoords[0] ;
-
 		for( size_t i = 0; i <numOfVertices; i++ )
 		{
-			texCoordsArray[i].x = aiTextureCoords[i].x ;
-			texCoordsArray[i].y = aiTextureCoords[i].y ;
+			SkinnedMeshVertex& vertex = vertices[i] ;
+			vertex.position = Vector3( pAiMesh->mVertices[i].x, pAiMesh->mVertices[i].y, pAiMesh->mVertices[i].z ) ;
+			if( pAiMesh->mNormals ) {
+				vertex.normal = Vector3( pAiMesh->mNormals[i].x, pAiMesh->mNormals[i].y, pAiMesh->mNormals[i].z ) ;
+			}
+			if( aiTextureCoords ) {
+				vertex.texCoords = Vector2( aiTextureCoords[i].x, aiTextureCoords[i].y ) ;
+			}
 		}
 
 		if( pAiMesh->HasBones() ) {
-			loadBones( pAiMesh, pMesh ) ;
+			loadBones( pAiMesh, vertices, boneMapping, boneOffsets ) ;
 		}
 
+		writer.write( vertices.data(), vertices.size() * sizeof(SkinnedMeshVertex) ) ;
+
 		// process indices
-		unsigned int idx = 0 ;
 		unsigned int* aiIndices = 0 ;
 		for(unsigned int i = 0; i < pAiMesh->mNumFaces; i++)
 		{
+			// check that faces are triangles
+			JAM_ASSERT(pAiMesh->mFaces[i].mNumIndices == 3) ;
 			aiIndices = pAiMesh->mFaces[i].mIndices;
-			idx = i*3 ;
-			elementsArray[idx]   = aiIndices[0] ;
-			elementsArray[idx+1] = aiIndices[1] ;
-			elementsArray[idx+2] = aiIndices[2] ;
-		}  
-
-		// process material
-		if(pAiMesh->mMaterialIndex >= 0)
-		{
-			aiMaterial *pAiMaterial = m_pScene->mMaterials[pAiMesh->mMaterialIndex];
-
-			Material* pMaterial = pMesh->getMaterial() ;
-
-			float matShininess = 0.0f ;
-			if( AI_SUCCESS == (pAiMaterial->Get( AI_MATKEY_SHININESS, matShininess )) ) {
-				pMaterial->setShininess( matShininess ) ;
-			}
-
-			std::vector<Texture2D*> diffuseMaps ;
-			loadMaterialTextures(pAiMaterial, aiTextureType_DIFFUSE, diffuseMaps);
-			if( diffuseMaps.size() > 0 ) {
-				pMaterial->setDiffuseTexture( diffuseMaps[0] ) ;
-			}
-			else {
-				pMaterial->setDiffuseTexture( nullptr ) ;
-			}
-
-			std::vector<Texture2D*> specularMaps ;
-			loadMaterialTextures(pAiMaterial, aiTextureType_SPECULAR, specularMaps);
-			if( specularMaps.size() > 0 ) {
-				pMaterial->setSpecularTexture( specularMaps[0] ) ;
-			}
-			else {
-				pMaterial->setSpecularTexture( nullptr ) ;
-			}
+			writer.write( (U16)aiIndices[0] ) ;
+			writer.write( (U16)aiIndices[1] ) ;
+			writer.write( (U16)aiIndices[2] ) ;
 		}
-
-		return pMesh ;
+		writer.align() ;
 	}
 	
-	void SkinnedModel::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::vector<Texture2D*>& out )
+	void SkinnedModel::loadMaterialTexture(aiMaterial* mat, aiTextureType type, char* pOut )
 	{
-		unsigned int textureCountForType = mat->GetTextureCount(type) ;
-		if( textureCountForType > 0 ) {
-			for( size_t i = 0; i < textureCountForType; i++ )
-			{
-				Texture2D* texture = new Texture2D() ;
-
-				aiString str;
-				mat->GetTexture(type, (unsigned int)i, &str);
-				texture->load( appendPath(m_folder, str.C_Str()) ) ;
-				out.push_back(texture);
-
-				// we wont to load more that 1 texture
-				break;
-			}
+		// we wont to load more that 1 texture
+		if( mat->GetTextureCount(type) > 0 ) {
+			aiString str;
+			mat->GetTexture(type, 0, &str);
+			CookedModelWriter::copyName( pOut, str.C_Str() ) ;
 		}
-// 		else {
-// 			Texture2D* texture = new Texture2D() ;
-// 			texture->createDefaultEmpty() ;
-// 			out.push_back(texture);
-// 		}
 	}
 
-	void SkinnedModel::loadBones( const aiMesh* pMesh, SkinnedMesh* pSkinnedMesh )
+	void SkinnedModel::loadBones( const aiMesh* pMesh, std::vector<SkinnedMeshVertex>& vertices, BonesMap& boneMapping, std::vector<Matrix4>& boneOffsets )
 	{
 		BonesMap::iterator it ;
 		unsigned int boneId = 0;        
@@ -288,21 +420,16 @@ namespace jam
 		unsigned int i, k ;
 		size_t j ;
 
-		glm::ivec4* pBonesId = pSkinnedMesh->getBonesIdArray().data() ;
-		glm::vec4*  pWeights = pSkinnedMesh->getWeightsArray().data() ;
-
 		for ( i = 0 ; i < pMesh->mNumBones ; i++) {                
 			String boneName = pMesh->mBones[i]->mName.data ;
         
-			it = m_boneMapping.find(boneName) ;
-			if( it == m_boneMapping.end() ) {
+			it = boneMapping.find(boneName) ;
+			if( it == boneMapping.end() ) {
 				// Allocate an index for a new bone
-				boneId = m_numBones;
-				m_numBones++;            
-				BoneInfo bi;			
-				bi.BoneOffset = assimpToGlmMatrix( pMesh->mBones[i]->mOffsetMatrix );            
-				m_boneInfo.push_back(bi);
-				m_boneMapping[boneName] = boneId;
+				boneId = (unsigned int)boneOffsets.size() ;
+				// brings the vertices from their local space position into their node space
+				boneOffsets.push_back( assimpToGlmMatrix( pMesh->mBones[i]->mOffsetMatrix ) ) ;
+				boneMapping[boneName] = boneId;
 			}
 			else {
 				boneId = it->second ;
@@ -313,10 +440,11 @@ namespace jam
 				vertexIdx = pAiWeights[j].mVertexId;
 				weight    = pAiWeights[j].mWeight; 
 
+				SkinnedMeshVertex& vertex = vertices[vertexIdx] ;
 				for( k = 0 ; k < 4 ; k++ ) {
-					if (pWeights[vertexIdx][k] == 0.0f) {
-						pBonesId[vertexIdx][k] = boneId ;
-						pWeights[vertexIdx][k] = weight ;
+					if (vertex.weights[k] == 0.0f) {
+						vertex.bonesId[k] = boneId ;
+						vertex.weights[k] = weight ;
 						break ;
 					}
 
@@ -329,207 +457,88 @@ namespace jam
 		}
 	}
 
-	Matrix4 SkinnedModel::assimpToGlmMatrix( const aiMatrix4x4& m )
+	void SkinnedModel::processNodeHierarchy( const aiNode* pNode, I32 parent, CookedModelWriter& writer, const BonesMap& boneMapping, std::map<String,I32>& nodeMapping, U32& numOfNodes )
 	{
-		Matrix4 out (
-			m.a1, m.b1, m.c1, m.d1,		// <- first column
-			m.a2, m.b2, m.c2, m.d2,
-			m.a3, m.b3, m.c3, m.d3,
-			m.a4, m.b4, m.c4, m.d4 );
-
-		return out ;
-	}
-
-	Matrix4 SkinnedModel::assimpToGlmMatrix( const aiMatrix3x3& m )
-	{
-		Matrix4 out (
-			m.a1, m.b1, m.c1, 0.0f,
-			m.a2, m.b2, m.c2, 0.0f,
-			m.a3, m.b3, m.c3, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f);
-
-		return out ;
-	}
-
-	size_t SkinnedModel::findPosition(float AnimationTime, const aiNodeAnim* pNodeAnim)
-	{    
-		for( size_t i = 0 ; i < pNodeAnim->mNumPositionKeys - 1 ; i++ ) {
-			if( AnimationTime < (float)pNodeAnim->mPositionKeys[i + 1].mTime ) {
-				return i;
-			}
+		String nodeName = pNode->mName.data ;
+		// every node gets its own index, the names are only used to bind the animation channels
+		I32 nodeIdx = (I32)numOfNodes++ ;
+		if( !nodeName.empty() && !nodeMapping.insert( std::make_pair(nodeName,nodeIdx) ).second ) {
+			JAM_TRACE( "SkinnedModel: duplicate node name %s, animation channels are bound to the first one\n", nodeName.c_str() ) ;
 		}
-    
-		JAM_ASSERT(0);
-
-		return 0;
-	}
-
 
-	size_t SkinnedModel::findRotation(float AnimationTime, const aiNodeAnim* pNodeAnim)
-	{
-		JAM_ASSERT(pNodeAnim->mNumRotationKeys > 0);
+		CookedNode node ;
+		node.parent = parent ;
+		auto it = boneMapping.find(nodeName) ;
+		node.boneIndex = (it != boneMapping.end()) ? (I32)it->second : -1 ;
+		node.transform = assimpToGlmMatrix( pNode->mTransformation ) ;
+		writer.write( node ) ;
 
-		for( size_t i = 0 ; i < pNodeAnim->mNumRotationKeys - 1 ; i++ ) {
-			if( AnimationTime < (float)pNodeAnim->mRotationKeys[i + 1].mTime ) {
-				return i;
-			}
-		}
-    
-		JAM_ASSERT(0);
-
-		return 0;
-	}
-
-
-	size_t SkinnedModel::findScaling(float AnimationTime, const aiNodeAnim* pNodeAnim)
-	{
-		JAM_ASSERT(pNodeAnim->mNumScalingKeys > 0);
-    
-		for( size_t i = 0 ; i < pNodeAnim->mNumScalingKeys - 1 ; i++ ) {
-			if( AnimationTime < (float)pNodeAnim->mScalingKeys[i + 1].mTime ) {
-				return i;
-			}
-		}
-    
-		JAM_ASSERT(0);
-
-		return 0;
-	}
-
-
-	void SkinnedModel::calcInterpolatedPosition(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim)
-	{
-		if( pNodeAnim->mNumPositionKeys == 1 ) {
-			Out = pNodeAnim->mPositionKeys[0].mValue;
-			return;
+		// pre-order visit, so parents always precede their children
+		for( size_t i = 0 ; i < pNode->mNumChildren ; i++ ) {
+			processNodeHierarchy( pNode->mChildren[i], nodeIdx, writer, boneMapping, nodeMapping, numOfNodes ) ;
 		}
-            
-		size_t PositionIndex = findPosition(AnimationTime, pNodeAnim);
-		size_t NextPositionIndex = (PositionIndex + 1);
-		JAM_ASSERT(NextPositionIndex < pNodeAnim->mNumPositionKeys);
-		float DeltaTime = (float)(pNodeAnim->mPositionKeys[NextPositionIndex].mTime - pNodeAnim->mPositionKeys[PositionIndex].mTime);
-		float Factor = (AnimationTime - (float)pNodeAnim->mPositionKeys[PositionIndex].mTime) / DeltaTime;
-		JAM_ASSERT(Factor >= 0.0f && Factor <= 1.0f);
-		const aiVector3D& Start = pNodeAnim->mPositionKeys[PositionIndex].mValue;
-		const aiVector3D& End = pNodeAnim->mPositionKeys[NextPositionIndex].mValue;
-		aiVector3D Delta = End - Start;
-		Out = Start + Factor * Delta;
 	}
 
-
-	void SkinnedModel::calcInterpolatedRotation(aiQuaternion& Out, float AnimationTime, const aiNodeAnim* pNodeAnim)
+	void SkinnedModel::processAnimation( const aiAnimation* pAnimation, CookedModelWriter& writer, const std::map<String,I32>& nodeMapping )
 	{
-		// we need at least two values to interpolate...
-		if( pNodeAnim->mNumRotationKeys == 1 ) {
-			Out = pNodeAnim->mRotationKeys[0].mValue;
-			return;
-		}
-    
-		size_t RotationIndex = findRotation(AnimationTime, pNodeAnim);
-		size_t NextRotationIndex = (RotationIndex + 1);
-		JAM_ASSERT(NextRotationIndex < pNodeAnim->mNumRotationKeys);
-		float DeltaTime = (float)(pNodeAnim->mRotationKeys[NextRotationIndex].mTime - pNodeAnim->mRotationKeys[RotationIndex].mTime);
-		float Factor = (AnimationTime - (float)pNodeAnim->mRotationKeys[RotationIndex].mTime) / DeltaTime;
-		JAM_ASSERT(Factor >= 0.0f && Factor <= 1.0f);
-		const aiQuaternion& StartRotationQ = pNodeAnim->mRotationKeys[RotationIndex].mValue;
-		const aiQuaternion& EndRotationQ   = pNodeAnim->mRotationKeys[NextRotationIndex].mValue;    
-		aiQuaternion::Interpolate(Out, StartRotationQ, EndRotationQ, Factor);
-		Out = Out.Normalize();
-	}
+		CookedClipHeader clipHeader ;
+		memset( &clipHeader, 0, sizeof(clipHeader) ) ;
+		CookedModelWriter::copyName( clipHeader.name, pAnimation->mName.C_Str() ) ;
+		clipHeader.duration = (F32)pAnimation->mDuration ;
+		clipHeader.ticksPerSecond = (F32)pAnimation->mTicksPerSecond ;
 
+		size_t clipOffset = writer.tell() ;
+		writer.write( clipHeader ) ;
 
-	void SkinnedModel::calcInterpolatedScaling(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim)
-	{
-		if( pNodeAnim->mNumScalingKeys == 1 ) {
-			Out = pNodeAnim->mScalingKeys[0].mValue;
-			return;
-		}
-
-		size_t ScalingIndex = findScaling(AnimationTime, pNodeAnim);
-		size_t NextScalingIndex = (ScalingIndex + 1);
-		JAM_ASSERT(NextScalingIndex < pNodeAnim->mNumScalingKeys);
-		float DeltaTime = (float)(pNodeAnim->mScalingKeys[NextScalingIndex].mTime - pNodeAnim->mScalingKeys[ScalingIndex].mTime);
-		float Factor = (AnimationTime - (float)pNodeAnim->mScalingKeys[ScalingIndex].mTime) / DeltaTime;
-		JAM_ASSERT(Factor >= 0.0f && Factor <= 1.0f);
-		const aiVector3D& Start = pNodeAnim->mScalingKeys[ScalingIndex].mValue;
-		const aiVector3D& End   = pNodeAnim->mScalingKeys[NextScalingIndex].mValue;
-		aiVector3D Delta = End - Start;
-		Out = Start + Factor * Delta;
-	}
-
-
-	void SkinnedModel::readNodeHeirarchy(float AnimationTime, const aiNode* pNode, const Matrix4& ParentTransform, size_t animationIdx)
-	{    
-		Matrix4 NodeTransformation = assimpToGlmMatrix( pNode->mTransformation );
-     
-		const aiAnimation* pAnimation = m_pScene->mAnimations[animationIdx];
-		const char* NodeName = pNode->mName.data ;
-		const aiNodeAnim* pNodeAnim = findNodeAnim(animationIdx, NodeName);
-    
-		if( pNodeAnim ) {
-			// Interpolate scaling and generate scaling transformation matrix
-			aiVector3D Scaling;
-			calcInterpolatedScaling(Scaling, AnimationTime, pNodeAnim);
-			Matrix4 ScalingM(1.0f);
-			ScalingM = glm::scale(ScalingM,Vector3(Scaling.x, Scaling.y, Scaling.z)) ;
-        
-			// Interpolate rotation and generate rotation transformation matrix
-			aiQuaternion RotationQ;
-			calcInterpolatedRotation(RotationQ, AnimationTime, pNodeAnim);       
-			Matrix4 RotationM(1.0f);
-			RotationM = assimpToGlmMatrix( RotationQ.GetMatrix() );
-
-			// Interpolate translation and generate translation transformation matrix
-			aiVector3D Translation;
-			calcInterpolatedPosition(Translation, AnimationTime, pNodeAnim);
-			Matrix4 TranslationM(1.0f);
-			TranslationM = glm::translate(TranslationM,Vector3(Translation.x, Translation.y, Translation.z)) ;
-        
-			// Combine the above transformations
-			NodeTransformation = TranslationM * RotationM * ScalingM ;
-		}
+		for( size_t i = 0 ; i < pAnimation->mNumChannels ; i++ ) {
+			const aiNodeAnim* pNodeAnim = pAnimation->mChannels[i];
+			auto it = nodeMapping.find( String(pNodeAnim->mNodeName.data) ) ;
+			if( it == nodeMapping.end() || !pNodeAnim->mNumPositionKeys || !pNodeAnim->mNumRotationKeys || !pNodeAnim->mNumScalingKeys ) {
+				continue ;
+			}
 
-		Matrix4  GlobalTransformation = ParentTransform * NodeTransformation;
-    
-		if( m_boneMapping.find(NodeName) != m_boneMapping.end() ) {
-			size_t BoneIndex = m_boneMapping[NodeName];
-			m_boneInfo[BoneIndex].FinalTransformation = m_globalInverseTransform * GlobalTransformation * m_boneInfo[BoneIndex].BoneOffset;
-		}
-   
-		for( size_t i = 0 ; i < pNode->mNumChildren ; i++ ) {
-			readNodeHeirarchy(AnimationTime, pNode->mChildren[i], GlobalTransformation, animationIdx);
-		}
-	}
+			CookedChannelHeader channelHeader ;
+			channelHeader.nodeIndex = it->second ;
+			channelHeader.numOfPositionKeys = pNodeAnim->mNumPositionKeys ;
+			channelHeader.numOfRotationKeys = pNodeAnim->mNumRotationKeys ;
+			channelHeader.numOfScalingKeys = pNodeAnim->mNumScalingKeys ;
+			writer.write( channelHeader ) ;
+
+			CookedVectorKey vectorKey ;
+			for( unsigned int k = 0 ; k < pNodeAnim->mNumPositionKeys ; k++ ) {
+				const aiVectorKey& key = pNodeAnim->mPositionKeys[k] ;
+				vectorKey.time = (F32)key.mTime ;
+				vectorKey.value = Vector3( key.mValue.x, key.mValue.y, key.mValue.z ) ;
+				writer.write( vectorKey ) ;
+			}
 
+			CookedQuatKey quatKey ;
+			for( unsigned int k = 0 ; k < pNodeAnim->mNumRotationKeys ; k++ ) {
+				const aiQuatKey& key = pNodeAnim->mRotationKeys[k] ;
+				quatKey.time = (F32)key.mTime ;
+				quatKey.value = Vector4( key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w ) ;
+				writer.write( quatKey ) ;
+			}
 
-	const aiNodeAnim* SkinnedModel::findNodeAnim(size_t animIdx, const String& NodeName)
-	{
-		const aiNodeAnim* out = 0 ;
+			for( unsigned int k = 0 ; k < pNodeAnim->mNumScalingKeys ; k++ ) {
+				const aiVectorKey& key = pNodeAnim->mScalingKeys[k] ;
+				vectorKey.time = (F32)key.mTime ;
+				vectorKey.value = Vector3( key.mValue.x, key.mValue.y, key.mValue.z ) ;
+				writer.write( vectorKey ) ;
+			}
 
-		auto it = m_animMapping[animIdx].find(NodeName) ;
-		if( it != m_animMapping[animIdx].end() ) {
-			out = it->second ;
+			writer.at<CookedClipHeader>(clipOffset)->numOfChannels++ ;
 		}
-
-		return out;
 	}
 
-	void SkinnedModel::storeAnim()
+	Matrix4 SkinnedModel::assimpToGlmMatrix( const aiMatrix4x4& m )
 	{
-		size_t numOfAnimations = m_pScene->mNumAnimations ;
-		m_animMapping.create(numOfAnimations) ;
-		for( size_t i=0; i<numOfAnimations; i++ ) {
-			storeNodeAnim( m_pScene->mAnimations[i], m_animMapping[i] ) ;
-		}
-	}
+		Matrix4 out (
+			m.a1, m.b1, m.c1, m.d1,		// <- first column
+			m.a2, m.b2, m.c2, m.d2,
+			m.a3, m.b3, m.c3, m.d3,
+			m.a4, m.b4, m.c4, m.d4 );
 
-	void SkinnedModel::storeNodeAnim( const aiAnimation* pAnimation, AnimationsMap& animMap )
-	{
-		for( size_t i = 0 ; i < pAnimation->mNumChannels ; i++ ) {
-			const aiNodeAnim* pNodeAnim = pAnimation->mChannels[i];
-			if( pNodeAnim->mNodeName.data ) {
-				animMap[String(pNodeAnim->mNodeName.data)] = pNodeAnim ;
-			}
-		}
+		return out ;
 	}
 }
@@ -201,6 +201,7 @@ void SkyBox::draw()
 	pShader->setUniform( JAM_PROGRAM_UNIFORM_MATERIAL_DIFFUSE, 0 ) ;
 
 	glDrawArrays( GL_TRIANGLES, 0, getVerticesArray().length() );
+	GetGfx().countDrawCall() ;
 
 	// unbind cubemap texture
 	glActiveTexture( GL_TEXTURE0 );	// select active texture unit
@@ -108,16 +108,15 @@ ExtAnimator* Sprite::createAnimator()
 
 void Sprite::update()
 {
-	JAM_PROFILE("Sprite.upd") ;
-
-	if( m_pAnimator!=0 )	m_pAnimator->update();
+	JAM_PROFILE_DETAIL("Sprite.upd") ;
 
+	// the animator is advanced by Animation2DManager::updateAnimators()
 	Node::update();
 }
 
 void Sprite::render()
 {
-	JAM_PROFILE("Sprite.render") ;
+	JAM_PROFILE_DETAIL("Sprite.render") ;
 
 #ifdef JAM_CHECK_SINGLE_UPDATE_CALL
 	JAM_ASSERT_MSG( m_lastRender != GetAppMgr().getTotalElapsedMs(), ("Render called twice") ) ;
@@ -141,23 +140,11 @@ void Sprite::render()
 			}
 		}
 
-		bool flipX = m_flipX ;
-		bool flipY = m_flipY ;
-
-		if( !isAnimatorNull() ) {
-			const Animation2D* anim = m_pAnimator->getAnimation() ;
-			if( anim ) {
-				int li = m_pAnimator->getLastFrameIndex() ;
-				AnimFrame2D* frame = anim->getFrame(li) ;
-				if( frame ) {
-					flipX = frame->getFlipX();
-					flipY = frame->getFlipY();
-				}
-			}
-		}
+		bool flipX, flipY ;
+		getDrawnFlips( flipX, flipY ) ;
 
 		// TODO IMPORTANT! test with non-zero hot-spot
-		GetDraw3DMgr().DrawTransformedQuad3D( m_pFrame, getTransformedAABB(), (m_touchable ? -1 : 0), &c, flipX,flipY ) ;
+		GetDraw3DMgr().DrawTransformedQuad3D( m_pFrame, getRenderTransformedAABB(), (m_touchable ? -1 : 0), &c, flipX,flipY ) ;
 
 #ifdef JAM_DEBUG
 		// DEBUG DRAW
@@ -194,7 +181,7 @@ bool Sprite::collide( Node* other, CollisionManager::Method m ) const
 	const Circle2f& c2 = other->getCollisionBoundingCircle();
 	isInCollision = c1.intersects(c2) ;
 
-	if( isInCollision && m == CollisionManager::Method::BoundingBox ) {
+	if( isInCollision && (m == CollisionManager::Method::BoundingBox || m == CollisionManager::Method::PerPixel) ) {
 		const Polygon2f& p1 = getCollisionOBB();
 		const Polygon2f& p2 = other->getCollisionOBB();
 		isInCollision = p1.intersects(p2) ;
@@ -219,59 +206,55 @@ ExtAnimator& Sprite::getAnimator()
 
 void Sprite::destroyAnimator()
 {
-	m_pAnimator = nullptr ;
+	JAM_RELEASE_NULL( m_pAnimator ) ;
 }
 
-bool Sprite::intersectPixelsSlow( Sprite* other ) const
+void Sprite::getDrawnFlips( bool& flipX, bool& flipY ) const
 {
-/*
-	Matrix2f transformA = this->getWorldTform() ;
-	DrawItem* pDrawItemA = this->getFrame() ;
-	Matrix2f transformB = other->getWorldTform() ;
-	DrawItem* pDrawItemB = other->getFrame() ;
-
-	// Calculate a matrix which transforms from A's local space into
-	// world space and then into B's local space
-	Matrix2f transformAToB = transformA * transformB.getInverse() ;
-
-	uint32* dataA = (uint32*)pDrawItemA->getTexture()->GetTexels() ;
-	uint32* dataB = (uint32*)pDrawItemB->getTexture()->GetTexels() ;
-	uint32 m_widthA = pDrawItemA->getTexture()->GetWidth() ;
-	uint32 m_widthB = pDrawItemB->getTexture()->GetWidth() ;
-
-	uint32 colorA_alpha ;
-	uint32 colorB_alpha ;
-
-	// For each row of pixels in A
-	for (int yA = 0; yA < pDrawItemA->getRect().getHeight(); yA++) {
-		// For each pixel in this row
-		for (int xA = 0; xA < pDrawItemA->getRect().getWidth(); xA++) {
-			// Calculate this pixel's location in B
-			Vector2f positionInB = transformAToB.transformVec( Vector2f((float)xA,(float)-yA) ) ;
-
-			// Round to the nearest pixel
-			int xB = (int)roundf(positionInB.x);
-			int yB = (int)roundf(-positionInB.y);
-
-			// If the pixel lies within the bounds of B
-			if ((xB >= 0 && xB <= pDrawItemB->getRect().getWidth()) &&
-				(yB >= 0 && yB <= pDrawItemB->getRect().getHeight()) )
-			{
-				// Get the colors of the overlapping pixels
-				colorA_alpha = dataA[(pDrawItemA->getRect().left+xA) + (pDrawItemA->getRect().top+yA) * m_widthA] >> 24;
-				colorB_alpha = dataB[(pDrawItemB->getRect().left+xB) + (pDrawItemB->getRect().top+yB) * m_widthB] >> 24;
-
-				// If both pixels are not completely transparent,
-				if (colorA_alpha != 0 && colorB_alpha != 0) {
-					// then an intersection has been found
-					return true;
-				}
+	flipX = m_flipX ;
+	flipY = m_flipY ;
+
+	if( !isAnimatorNull() ) {
+		const Animation2D* anim = m_pAnimator->getAnimation() ;
+		if( anim ) {
+			int li = m_pAnimator->getLastFrameIndex() ;
+			AnimFrame2D* frame = anim->getFrame(li) ;
+			if( frame ) {
+				flipX = frame->getFlipX();
+				flipY = frame->getFlipY();
 			}
 		}
 	}
-*/
-	// No intersection found
-	return false;
+}
+
+Matrix3 Sprite::getPixelToWorldTform( const AlphaMask& mask ) const
+{
+	bool flipX, flipY ;
+	getDrawnFlips( flipX, flipY ) ;
+
+	// the frame is drawn over the aabb, its first pixel row at the top (y1) unless flipped
+	const AABB& aabb = getAABB() ;
+	float sx = aabb.width / mask.getWidth() ;
+	float sy = aabb.height / mask.getHeight() ;
+
+	Matrix3 pixelToLocal(1.0f) ;
+	pixelToLocal[0][0] = flipX ? -sx : sx ;
+	pixelToLocal[1][1] = flipY ? sy : -sy ;
+	pixelToLocal[2][0] = flipX ? aabb.x2 : aabb.x1 ;
+	pixelToLocal[2][1] = flipY ? aabb.y2 : aabb.y1 ;
+
+	return getWorldTform() * pixelToLocal ;
+}
+
+bool Sprite::intersectPixelsSlow( Sprite* other ) const
+{
+	const AlphaMask* pMaskA = m_pFrame ? m_pFrame->getAlphaMask() : nullptr ;
+	const AlphaMask* pMaskB = other->getFrame() ? other->getFrame()->getAlphaMask() : nullptr ;
+	if( !pMaskA || !pMaskB ) {
+		return true ;
+	}
+
+	return AlphaMask::intersectsSlow( *pMaskA, getPixelToWorldTform(*pMaskA), *pMaskB, other->getPixelToWorldTform(*pMaskB) ) ;
 }
 
 /*
@@ -280,79 +263,15 @@ bool Sprite::intersectPixelsSlow( Sprite* other ) const
 */
 bool Sprite::intersectPixels( Sprite* other ) const
 {
-/*
-	// transformA World transform of the first sprite
-	// widthA Width of the first sprite's texture
-	// heightA Height of the first sprite's texture
-	// dataA Pixel color data of the first sprite
-	// transformB World transform of the second sprite
-	// widthB Width of the second sprite's texture
-	// heightB Height of the second sprite's texture
-	// dataB Pixel color data of the second sprite
-
-	Matrix2f transformA = this->getWorldTform() ;
-	DrawItem* pDrawItemA = this->getFrame() ;
-	Matrix2f transformB = other->getWorldTform() ;
-	DrawItem* pDrawItemB = other->getFrame() ;
-
-	// Calculate a matrix which transforms from A's local space into
-	// world space and then into B's local space
-	Matrix2f transformAToB = transformA * transformB.getInverse() ;
-
-	// When a point moves in A's local space, it moves in B's local space with a
-	// fixed direction and distance proportional to the movement in A.
-	// This algorithm steps through A one pixel at a time along A's X and Y axes
-	// Calculate the analogous steps in B:
-	Vector2f stepX = transformAToB.transformNormal(Vector2f::UnitX);
-	Vector2f stepY = transformAToB.transformNormal(-Vector2f::UnitY);
-
-	// Calculate the top left corner of A in B's local space
-	// This variable will be reused to keep track of the start of each row
-	Vector2f yPosInB = transformAToB.transformVec(Vector2f::Zero);
-
-	uint32* dataA = (uint32*)pDrawItemA->getTexture()->GetTexels() ;
-	uint32* dataB = (uint32*)pDrawItemB->getTexture()->GetTexels() ;
-	uint32 m_widthA = pDrawItemA->getTexture()->GetWidth() ;
-	uint32 m_widthB = pDrawItemB->getTexture()->GetWidth() ;
-
-	uint32 colorA_alpha ;
-	uint32 colorB_alpha ;
-
-	// For each row of pixels in A
-	for (int yA = 0; yA < pDrawItemA->getRect().getHeight(); yA++)
-	{
-		// Start at the beginning of the row
-		Vector2f posInB = yPosInB;
-		// For each pixel in this row
-		for (int xA = 0; xA < pDrawItemA->getRect().getWidth(); xA++)
-		{
-			// Round to the nearest pixel
-			int xB = (int)roundf(posInB.x);
-			int yB = (int)roundf(-posInB.y);
-			// If the pixel lies within the bounds of B
-			if ( (xB>=0 && xB <= pDrawItemB->getRect().getWidth()) &&
-				(yB >= 0 && yB <= pDrawItemB->getRect().getHeight()) )
-			{
-				// Get the colors of the overlapping pixels
-				colorA_alpha = dataA[(pDrawItemA->getRect().left+xA) + (pDrawItemA->getRect().top+yA) * m_widthA] >> 24;
-				colorB_alpha = dataB[(pDrawItemB->getRect().left+xB) + (pDrawItemB->getRect().top+yB) * m_widthB] >> 24;
-				// If both pixels are not completely transparent,
-				if (colorA_alpha != 0 && colorB_alpha != 0)
-				{
-					// then an intersection has been found
-					return true;
-				}
-			}
-			// Move to the next pixel in the row
-			posInB += stepX;
-		}
+	const AlphaMask* pMaskA = m_pFrame ? m_pFrame->getAlphaMask() : nullptr ;
+	const AlphaMask* pMaskB = other->getFrame() ? other->getFrame()->getAlphaMask() : nullptr ;
 
-		// Move to the next row
-		yPosInB += stepY;
+	// frames without client pixels (e.g. render targets) are as solid as their bounding box, already tested
+	if( !pMaskA || !pMaskB ) {
+		return true ;
 	}
-*/
-	// No intersection found
-	return false;
+
+	return AlphaMask::intersects( *pMaskA, getPixelToWorldTform(*pMaskA), *pMaskB, other->getPixelToWorldTform(*pMaskB) ) ;
 }
 
 
@@ -368,7 +368,7 @@ void SpriteBatch::Draw(Texture2D* texture,Vector2 position,Rect* sourceRectangle
     CheckValid(texture) ;
 
     auto item = _batcher->CreateBatchItem();
-    item->Texture = Ref<Texture2D>(texture,true);
+    item->Texture = texture;
 
     // set SortKey based on SpriteSortMode.
     switch ( _sortMode )
@@ -457,6 +457,8 @@ void SpriteBatch::Draw(Texture2D* texture,Vector2 position,Rect* sourceRectangle
 
 void SpriteBatch::End()
 {
+	JAM_PROFILE("SpriteBatch.End") ;
+
     if (!_beginCalled)
         JAM_ERROR("Begin must be called before calling End.");
 
@@ -55,6 +55,7 @@ StridedVertexBuffer::StridedVertexBuffer( U16 vertexCount /*= Draw3DStream::Defa
 	m_maxVertexCount(vertexCount),
 	m_maxIndexCount(0),
 	m_vbo(0),
+	m_ownsStorage(true),
 	IVertexBuffer()
 {
 	if( indexCount == 0 ) {
@@ -74,6 +75,41 @@ StridedVertexBuffer::StridedVertexBuffer( U16 vertexCount /*= Draw3DStream::Defa
 }
 
 
+StridedVertexBuffer::StridedVertexBuffer( V3F_C4B_T2F* pVertices, U16 vertexCount, U16* pIndices, U16 indexCount ) :
+	m_vertices(pVertices),
+	m_index(pIndices),
+	m_vertexCount(0),
+	m_indexCount(0),
+	m_startVertexCount(0),
+	m_startIndexCount(0),
+	m_maxVertexCount(vertexCount),
+	m_maxIndexCount(indexCount),
+	m_vbo(0),
+	m_ownsStorage(false),
+	IVertexBuffer()
+{
+}
+
+
+StridedVertexBuffer::StridedVertexBuffer( const StridedVertexBuffer& other ) :
+	m_vertices(0),
+	m_index(0),
+	m_vertexCount(other.m_vertexCount),
+	m_indexCount(other.m_indexCount),
+	m_startVertexCount(other.m_startVertexCount),
+	m_startIndexCount(other.m_startIndexCount),
+	m_maxVertexCount(other.m_maxVertexCount),
+	m_maxIndexCount(other.m_maxIndexCount),
+	m_vbo(0),
+	m_ownsStorage(true),
+	IVertexBuffer()
+{
+	m_vertices = new V3F_C4B_T2F[m_maxVertexCount] ;
+	m_index = new U16[m_maxIndexCount] ;
+	memcpy( m_vertices, other.m_vertices, m_maxVertexCount * sizeof(V3F_C4B_T2F) ) ;
+	memcpy( m_index, other.m_index, m_maxIndexCount * sizeof(U16) ) ;
+}
+
 StridedVertexBuffer::~StridedVertexBuffer()
 {
 	if( m_ebo ) {
@@ -91,8 +127,10 @@ StridedVertexBuffer::~StridedVertexBuffer()
 		m_vao = 0 ;
 	}
 
-	JAM_DELETE(m_vertices) ;
-	JAM_DELETE(m_index) ;
+	if( m_ownsStorage ) {
+		JAM_DELETE_ARRAY(m_vertices) ;
+		JAM_DELETE_ARRAY(m_index) ;
+	}
 }
 
 
@@ -41,11 +41,29 @@ namespace jam
 	{
 		// sets the timescale as milliseconds
 		m_unitsPerSecond = 1000UL ;
+
+		m_counterFrequency = SDL_GetPerformanceFrequency() ;
+		m_counterStart = SDL_GetPerformanceCounter() ;
+	}
+
+	uint64_t SysTimer::getTimeNs()
+	{
+		uint64_t ticks = SDL_GetPerformanceCounter() - m_counterStart ;
+
+		// split in seconds and remainder to avoid overflowing when scaling to nanoseconds
+		uint64_t secs = ticks / m_counterFrequency ;
+		uint64_t rem = ticks % m_counterFrequency ;
+		return secs * 1000000000ULL + (rem * 1000000000ULL) / m_counterFrequency ;
+	}
+
+	double SysTimer::getTimeSecs()
+	{
+		return (double)(SDL_GetPerformanceCounter() - m_counterStart) / (double)m_counterFrequency ;
 	}
 
 	uint64_t SysTimer::getTimeMs()
 	{
-		return SDL_GetTicks() ;
+		return getTimeNs() / 1000000ULL ;
 	}
 
 }
@@ -94,7 +94,7 @@ namespace jam
 
 	void TextNode::update()
 	{
-		JAM_PROFILE("TextNode.upd") ;
+		JAM_PROFILE_DETAIL("TextNode.upd") ;
 		if (m_time>0)
 		{
 			m_time -= (int64_t)jam::GetAppMgr().getElapsedMs();
@@ -109,7 +109,7 @@ namespace jam
 
 	void TextNode::render()
 	{
-		JAM_PROFILE("TextNode.render") ;
+		JAM_PROFILE_DETAIL("TextNode.render") ;
 #ifdef JAM_CHECK_SINGLE_UPDATE_CALL
 		JAM_ASSERT_MSG( m_lastRender != GetAppMgr().getTotalElapsedMs(), ("Render called twice") ) ;
 		m_lastRender = GetAppMgr().getTotalElapsedMs() ;
@@ -120,7 +120,17 @@ namespace jam
 			//GetDraw3DMgr().DrawQuad3D(m_obb) ;
 			Color tmp = Draw3DManager::ColorT3D ;
 			Draw3DManager::ColorT3D = m_color ;
-			GetDraw3DMgr().Text3D(m_drawItemName,getWorldPos().x,getWorldPos().y,m_text, (float)m_align, 0, getWorldRotationAngle(),m_kerning,getWorldScale().x, getWorldScale().y,m_fastParse);
+			if( isInterpolationActive() ) {
+				Matrix3 m = getRenderTform() ;
+				Vector2 pos = getTranslate(m) ;
+				Vector2 scl = getScale(m) ;
+				Matrix3 rot = getRotate(m) ;
+				float angle = ToDegree( atan2f(rot[1][0],rot[1][1]) ) ;
+				GetDraw3DMgr().Text3D(m_drawItemName,pos.x,pos.y,m_text, (float)m_align, 0, angle,m_kerning,scl.x, scl.y,m_fastParse);
+			}
+			else {
+				GetDraw3DMgr().Text3D(m_drawItemName,getWorldPos().x,getWorldPos().y,m_text, (float)m_align, 0, getWorldRotationAngle(),m_kerning,getWorldScale().x, getWorldScale().y,m_fastParse);
+			}
 			Draw3DManager::ColorT3D = tmp ;
 		}
 	}
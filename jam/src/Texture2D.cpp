@@ -49,6 +49,9 @@ namespace jam
 		m_data(nullptr),
 		m_freeClientMemoryWithStbi(true)
 	{
+		// the texture object can be deleted only by the main thread
+		setRefCountPolicy( RefCountPolicy::Deferred ) ;
+
 		_sortingKey = ++_lastSortingKey ;
 	}
 	
@@ -78,6 +81,52 @@ namespace jam
 		}
 	}
 
+	void Texture2D::createRenderTarget( U32 width, U32 height, GLenum internalFormat )
+	{
+		if( m_data || m_GLid ) { destroy(); }
+
+		m_width = width ;
+		m_height = height ;
+		m_data = 0 ;
+		m_freeClientMemoryWithStbi = false ;
+
+		// format and type are only used to validate the (null) pixel data
+		GLenum format = GL_RGBA ;
+		GLenum type = GL_UNSIGNED_BYTE ;
+		switch( internalFormat ) {
+		case GL_RGBA16F:
+			m_bitCount = 64 ;
+			type = GL_HALF_FLOAT ;
+			break ;
+
+		case GL_R11F_G11F_B10F:
+			m_bitCount = 32 ;
+			format = GL_RGB ;
+			type = GL_FLOAT ;
+			break ;
+
+		case GL_RGB8:
+			m_bitCount = 24 ;
+			format = GL_RGB ;
+			break ;
+
+		default:
+			m_bitCount = 32 ;
+			break ;
+		}
+
+		glGenTextures(1, &m_GLid);
+		glBindTexture( GL_TEXTURE_2D, m_GLid );
+		glTexImage2D( GL_TEXTURE_2D, 0, internalFormat, (GLsizei)m_width, (GLsizei)m_height, 0, format, type, 0 ) ;
+
+		// sampled as a whole by post processing passes, so no mipmaps and no wrapping
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture( GL_TEXTURE_2D, 0 );
+	}
+
 	void Texture2D::createDefaultEmpty( Color color /*= Color::WHITE*/, bool fUpload /*= true*/ )
 	{
 		if( m_data || m_GLid ) { destroy(); }
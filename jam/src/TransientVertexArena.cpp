@@ -0,0 +1,219 @@
+/**********************************************************************************
+* 
+* TransientVertexArena.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include "stdafx.h"
+
+#include "jam/TransientVertexArena.h"
+#include "jam/StridedVertexBuffer.h"
+#include "jam/Material.h"
+#include "jam/Shader.h"
+
+#include <cstring>
+
+namespace jam
+{
+
+static const size_t VertexSegmentSize = JAM_TRANSIENT_ARENA_VERTICES_PER_FRAME * sizeof(V3F_C4B_T2F) ;
+static const size_t IndexSegmentSize = JAM_TRANSIENT_ARENA_INDICES_PER_FRAME * sizeof(U16) ;
+
+TransientVertexArena::TransientVertexArena() :
+	m_vao(0), m_vbo(0), m_ebo(0),
+	m_segment(0), m_vertexCount(0), m_indexCount(0),
+	m_numOfDraws(0), m_numOfBytes(0), m_numOfOrphans(0)
+{
+	for( size_t i=0; i<JAM_TRANSIENT_ARENA_FRAMES; i++ ) {
+		m_fences[i] = 0 ;
+	}
+}
+
+TransientVertexArena::~TransientVertexArena()
+{
+	for( size_t i=0; i<JAM_TRANSIENT_ARENA_FRAMES; i++ ) {
+		if( m_fences[i] ) {
+			glDeleteSync( m_fences[i] ) ;
+			m_fences[i] = 0 ;
+		}
+	}
+
+	if( m_ebo ) {
+		glDeleteBuffers( 1, &m_ebo ) ;
+		m_ebo = 0 ;
+	}
+
+	if( m_vbo ) {
+		glDeleteBuffers( 1, &m_vbo ) ;
+		m_vbo = 0 ;
+	}
+
+	if( m_vao ) {
+		glDeleteVertexArrays( 1, &m_vao ) ;
+		m_vao = 0 ;
+	}
+}
+
+void TransientVertexArena::create()
+{
+	// standard attributes have the same location in every program (see Shader::compile), so the vao fits any of them
+	Shader* p = GetShaderMgr().getCurrent() ;
+
+	glGenVertexArrays( 1, &m_vao ) ;
+	glGenBuffers( 1, &m_vbo ) ;
+	glGenBuffers( 1, &m_ebo ) ;
+
+	glBindVertexArray( m_vao ) ;
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_vbo ) ;
+	glBufferData( GL_ARRAY_BUFFER, VertexSegmentSize * JAM_TRANSIENT_ARENA_FRAMES, nullptr, GL_STREAM_DRAW ) ;
+
+	glVertexAttribPointer( p->attrib(JAM_PROGRAM_ATTRIB_POSITION), 3, GL_FLOAT,	GL_FALSE, sizeof(V3F_C4B_T2F), (void*)0 ) ;
+	glEnableVertexAttribArray( p->attrib(JAM_PROGRAM_ATTRIB_POSITION) ) ;
+
+	glVertexAttribPointer( p->attrib(JAM_PROGRAM_ATTRIB_COLOR), 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(V3F_C4B_T2F), (void*)sizeof(Vertex3f) ) ;
+	glEnableVertexAttribArray( p->attrib(JAM_PROGRAM_ATTRIB_COLOR) ) ;
+
+	glVertexAttribPointer( p->attrib(JAM_PROGRAM_ATTRIB_TEXCOORDS), 2, GL_FLOAT,	GL_FALSE, sizeof(V3F_C4B_T2F), (void*)(sizeof(Vertex3f) + sizeof(Color)) ) ;
+	glEnableVertexAttribArray( p->attrib(JAM_PROGRAM_ATTRIB_TEXCOORDS) ) ;
+
+	// the element buffer binding is part of the vao state
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_ebo ) ;
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, IndexSegmentSize * JAM_TRANSIENT_ARENA_FRAMES, nullptr, GL_STREAM_DRAW ) ;
+
+	glBindVertexArray( 0 ) ;
+	glBindBuffer( GL_ARRAY_BUFFER, 0 ) ;
+}
+
+void TransientVertexArena::orphan()
+{
+	// the driver gives us new storage, the old one is freed when the GPU is done with it
+	glBindBuffer( GL_ARRAY_BUFFER, m_vbo ) ;
+	glBufferData( GL_ARRAY_BUFFER, VertexSegmentSize * JAM_TRANSIENT_ARENA_FRAMES, nullptr, GL_STREAM_DRAW ) ;
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, IndexSegmentSize * JAM_TRANSIENT_ARENA_FRAMES, nullptr, GL_STREAM_DRAW ) ;
+
+	for( size_t i=0; i<JAM_TRANSIENT_ARENA_FRAMES; i++ ) {
+		if( m_fences[i] ) {
+			glDeleteSync( m_fences[i] ) ;
+			m_fences[i] = 0 ;
+		}
+	}
+
+	m_vertexCount = 0 ;
+	m_indexCount = 0 ;
+	m_numOfOrphans++ ;
+}
+
+void TransientVertexArena::write( GLenum target, size_t offset, size_t size, const void* pData )
+{
+	// the range is not used by the GPU (fenced or orphaned), no need to synchronize
+	void* p = glMapBufferRange( target, (GLintptr)offset, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT ) ;
+	if( p ) {
+		memcpy( p, pData, size ) ;
+		glUnmapBuffer( target ) ;
+	}
+	else {
+		glBufferSubData( target, (GLintptr)offset, (GLsizeiptr)size, pData ) ;
+	}
+}
+
+void TransientVertexArena::draw( StridedVertexBuffer& vbuff, Material* pMaterial, GLenum pType /*= GL_TRIANGLES*/ )
+{
+	size_t numOfVertices = vbuff.getNumOfVertices() ;
+	size_t numOfIndices = vbuff.getNumOfIndices() ;
+	if( numOfVertices == 0 || numOfIndices == 0 ) {
+		return ;
+	}
+
+	if( !m_vao ) {
+		create() ;
+	}
+
+	// the element array buffer is bound by the vao
+	glBindVertexArray( m_vao ) ;
+
+	if( m_vertexCount + numOfVertices > JAM_TRANSIENT_ARENA_VERTICES_PER_FRAME || m_indexCount + numOfIndices > JAM_TRANSIENT_ARENA_INDICES_PER_FRAME ) {
+		orphan() ;
+	}
+
+	size_t baseVertex = m_segment * JAM_TRANSIENT_ARENA_VERTICES_PER_FRAME + m_vertexCount ;
+	size_t firstIndex = m_segment * JAM_TRANSIENT_ARENA_INDICES_PER_FRAME + m_indexCount ;
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_vbo ) ;
+	write( GL_ARRAY_BUFFER, baseVertex * sizeof(V3F_C4B_T2F), numOfVertices * sizeof(V3F_C4B_T2F), vbuff.getVertexArray() ) ;
+	glBindBuffer( GL_ARRAY_BUFFER, 0 ) ;
+	write( GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(U16), numOfIndices * sizeof(U16), vbuff.getIndexArray() ) ;
+
+	m_vertexCount += numOfVertices ;
+	m_indexCount += numOfIndices ;
+	m_numOfDraws++ ;
+	m_numOfBytes += numOfVertices * sizeof(V3F_C4B_T2F) + numOfIndices * sizeof(U16) ;
+
+	pMaterial->bind() ;
+	glDrawElementsBaseVertex( pType, (GLsizei)numOfIndices, GL_UNSIGNED_SHORT, (const void*)(firstIndex * sizeof(U16)), (GLint)baseVertex ) ;
+	pMaterial->unbind() ;
+
+	glBindVertexArray( 0 ) ;
+}
+
+void TransientVertexArena::newFrame()
+{
+	JAM_PROFILE_COUNTER( "TransientVertexArena.draws", (double)m_numOfDraws ) ;
+	JAM_PROFILE_COUNTER( "TransientVertexArena.bytes", (double)m_numOfBytes ) ;
+	JAM_PROFILE_COUNTER( "TransientVertexArena.orphans", (double)m_numOfOrphans ) ;
+	m_numOfDraws = 0 ;
+	m_numOfBytes = 0 ;
+	m_numOfOrphans = 0 ;
+
+	if( !m_vao ) {
+		return ;
+	}
+
+	// fences the commands which read the segment of the frame just ended
+	if( m_vertexCount || m_indexCount ) {
+		if( m_fences[m_segment] ) {
+			glDeleteSync( m_fences[m_segment] ) ;
+		}
+		m_fences[m_segment] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ) ;
+	}
+
+	m_segment = (m_segment + 1) % JAM_TRANSIENT_ARENA_FRAMES ;
+	m_vertexCount = 0 ;
+	m_indexCount = 0 ;
+
+	// normally signaled long ago, the GPU is JAM_TRANSIENT_ARENA_FRAMES-1 frames behind at most
+	GLsync fence = m_fences[m_segment] ;
+	if( fence ) {
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT ;
+		while( glClientWaitSync( fence, flags, 1000000 ) == GL_TIMEOUT_EXPIRED ) {
+			flags = 0 ;
+		}
+		glDeleteSync( fence ) ;
+		m_fences[m_segment] = 0 ;
+	}
+}
+
+}
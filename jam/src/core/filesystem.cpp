@@ -188,6 +188,13 @@ int64_t getFileSize(const char* filename)
 	return rc == 0 ? stat_buf.st_size : -1;
 }
 
+int64_t getFileModificationTime(const char* filename)
+{
+	struct _stat64 stat_buf;
+	int rc = _stat64(filename,&stat_buf);
+	return rc == 0 ? (int64_t)stat_buf.st_mtime : -1;
+}
+
 String getCurrentDirectory()
 {
 	String retValue ;
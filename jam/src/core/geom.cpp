@@ -128,5 +128,20 @@ Matrix4 createTranslationMatrix3D(const Vector3 & v)
 	return glm::translate( m, v ) ;
 }
 
+Matrix3 computeNormalMatrix(const Matrix4& model)
+{
+	Matrix3 m(model) ;
+	float xx = glm::dot(m[0],m[0]) ;
+	float eps = 1e-4f * xx ;
+
+	// rotation and uniform scale only: normals are scaled but keep their direction, shaders normalize them
+	if( fabs(glm::dot(m[1],m[1]) - xx) <= eps && fabs(glm::dot(m[2],m[2]) - xx) <= eps &&
+		fabs(glm::dot(m[0],m[1])) <= eps && fabs(glm::dot(m[0],m[2])) <= eps && fabs(glm::dot(m[1],m[2])) <= eps ) {
+		return m ;
+	}
+
+	return glm::transpose( glm::inverse(m) ) ;
+}
+
 }
 
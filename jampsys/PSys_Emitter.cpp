@@ -30,6 +30,7 @@
 #include "stdafx.h"
 #include <jam/Application.h>
 #include <jam/Gfx.h>
+#include <jam/JobSystem.h>
 
 using namespace jam;
 
@@ -203,6 +204,7 @@ bool PSysEmitter::update()
 {
     updateMovements();
 
+    m_toUpdate.clear();
     for (auto iter = particles.begin(); iter != particles.end();) {
         auto* p = *iter;
         p->render = false;
@@ -267,7 +269,7 @@ bool PSysEmitter::update()
                     p->pos->dx += windX * (jam::Application::getSingleton().getElapsed());
 
                 p->render = true;
-                p->update(); // *** UPDATE PARTICLES
+                m_toUpdate.push_back(p); // *** UPDATE PARTICLES (below)
 
             }
         } // is emitted
@@ -275,6 +277,13 @@ bool PSysEmitter::update()
             ++iter;
     } // *** for
 
+    // *** components integration doesn't depend on other particles, so it's spread over the job threads
+    jam::GetJobSystem().parallelFor(m_toUpdate.size(), PARTICLES_UPDATE_GRAIN, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            m_toUpdate[i]->update();
+        }
+    });
+
     // ******************************************************************************
     /*if (particles.size()==0)
     {
@@ -98,6 +98,8 @@ public:
 private:
 	void RemoveParticleFast(PARTICLE* pa);
 
+	std::vector<PARTICLE*> m_toUpdate;				// particles to integrate, updated in parallel at the end of update()
+
 	size_t idPa;
 };
 
@@ -58,3 +58,4 @@
 #define MIN_SIZE_THRESHOLD	0.2f
 #define MAX_PARTICLES_EMITTED 80000
 #define MIN_PARTICLES_EMITTED 256
+#define PARTICLES_UPDATE_GRAIN	512		// particles integrated by a single job
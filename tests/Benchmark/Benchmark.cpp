@@ -0,0 +1,515 @@
+/**********************************************************************************
+* 
+* Benchmark.cpp
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#include <jam/Application.h>
+#include <jam/Draw3dManager.h>
+#include <jam/DrawItemManager.h>
+#include <jam/ActionInterval.h>
+#include <jam/ActionInstant.h>
+#include <jam/CollisionManager.h>
+#include <jam/Scene.h>
+#include <jam/Sprite.h>
+#include <jam/Layer.h>
+#include <jam/Camera.h>
+#include <jam/Gfx.h>
+#include <jam/SysTimer.h>
+#include <jam/core/bmkextras.hpp>
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+
+using namespace jam;
+
+#define BENCHMARK_NUM_OF_GEMS				210		// frames in the gem sheet
+#define BENCHMARK_SPRITES					2000
+#define BENCHMARK_COLLIDERS					1000
+#define BENCHMARK_ZORDER_LAYERS				8
+#define BENCHMARK_ZORDER_SPRITES			250		// per layer
+#define BENCHMARK_ZORDER_MOVES				64		// reordered sprites per frame
+#define BENCHMARK_SPAWN_PER_FRAME			32
+
+//*******************
+//
+// Allocations tracking
+//
+// Global operator new is replaced by this executable, so the allocations of the engine are counted
+// when it's linked statically (a shared engine has its own allocator on Windows)
+//
+//*******************
+
+static std::atomic<bool>		s_countAllocations(false) ;
+static std::atomic<uint64_t>	s_allocations(0) ;
+static std::atomic<uint64_t>	s_allocatedBytes(0) ;
+static std::atomic<uint64_t>	s_frees(0) ;
+
+void* operator new( size_t size )
+{
+	if( s_countAllocations.load( std::memory_order_relaxed ) ) {
+		s_allocations.fetch_add( 1, std::memory_order_relaxed ) ;
+		s_allocatedBytes.fetch_add( size, std::memory_order_relaxed ) ;
+	}
+	void* p = malloc( size ? size : 1 ) ;
+	if( !p ) {
+		throw std::bad_alloc() ;
+	}
+	return p ;
+}
+
+void* operator new[]( size_t size )
+{
+	return operator new( size ) ;
+}
+
+void operator delete( void* p ) noexcept
+{
+	if( p && s_countAllocations.load( std::memory_order_relaxed ) ) {
+		s_frees.fetch_add( 1, std::memory_order_relaxed ) ;
+	}
+	free( p ) ;
+}
+
+void operator delete[]( void* p ) noexcept
+{
+	operator delete( p ) ;
+}
+
+static size_t countNodes( const Node* pNode )
+{
+	size_t count = 1 ;
+	for( const Ref<Node>& child : pNode->getChildren() ) {
+		count += countNodes( child.get() ) ;
+	}
+	return count ;
+}
+
+//*******************
+//
+// Class Benchmark
+//
+//*******************
+
+Benchmark::Benchmark( const BenchmarkOptions& options ) :
+	m_options(options),
+	m_scenes(),
+	m_currentScene(0),
+	m_sceneFrame(0),
+	m_measureStartNs(0),
+	m_stats(),
+	m_statsIndices(),
+	m_frameStats(),
+	m_droppedEvents(0),
+	m_gems(),
+	m_results()
+{
+	setHeadless() ;
+	setFixedFrameMode() ;
+	// zones repeated for every node would dominate the measured work
+	Profiler::setDetailEnabled( false ) ;
+
+	BenchmarkScene scenes[] = {
+		{ "sprites",	&Benchmark::buildSprites,		nullptr },
+		{ "collisions",	&Benchmark::buildCollisions,	nullptr },
+		{ "zorder",		&Benchmark::buildZOrder,		&Benchmark::updateZOrder },
+		{ "spawn",		&Benchmark::buildSpawn,			&Benchmark::updateSpawn },
+	} ;
+	for( const BenchmarkScene& scene : scenes ) {
+		if( m_options.sceneName.empty() || m_options.sceneName == scene.name ) {
+			m_scenes.push_back( scene ) ;
+		}
+	}
+}
+
+bool Benchmark::init()
+{
+	if( m_scenes.empty() ) {
+		fprintf( stderr, "Unknown scene %s\n", m_options.sceneName.c_str() ) ;
+		return false ;
+	}
+
+	Draw3DManager::Origin3D(JAM_WINDOWS_WIDTH,JAM_WINDOWS_HEIGHT) ;
+	setClearColor( Color::MIDNIGHTBLUE ) ;
+
+	GetDrawItemMgr().loadSheet("./media/gemsheet.png","spritesheets",64,64,15,14);
+
+	Camera* pCamera = new Camera() ;
+	pCamera->setOrthographicProjection(	-Draw3DManager::VPWidth/2, Draw3DManager::VPWidth/2,
+										-Draw3DManager::VPHeight/2, Draw3DManager::VPHeight/2,
+										1.f, 50.f ) ;
+	pCamera->lookAt( Vector3(0,0,30), Vector3(0,0,0), Vector3(0,1,0) ) ;
+	getScene()->setCamera(pCamera) ;
+
+	m_currentScene = 0 ;
+	startScene() ;
+
+	return true ;
+}
+
+void Benchmark::beforeSceneUpdate()
+{
+	const BenchmarkScene& scene = m_scenes[m_currentScene] ;
+	if( scene.update ) {
+		(this->*scene.update)() ;
+	}
+}
+
+/**
+	Scenes are switched at the end of the frame, measures start after the warm up frames
+	and last exactly the requested number of frames
+*/
+void Benchmark::exitFrame()
+{
+	m_sceneFrame++ ;
+
+	// the profiler buffers hold only a few frames of events, so they are aggregated and discarded every frame
+	if( Profiler::isCapturing() ) {
+		accumulateStats() ;
+	}
+
+	if( m_sceneFrame == m_options.warmupFrames ) {
+		startMeasure() ;
+	}
+	else if( m_sceneFrame == m_options.warmupFrames + m_options.frames ) {
+		endScene() ;
+
+		if( ++m_currentScene < m_scenes.size() ) {
+			startScene() ;
+		}
+		else {
+			signalExit() ;
+		}
+	}
+}
+
+void Benchmark::destroy()
+{
+	s_countAllocations = false ;
+	Profiler::stop() ;
+	m_gems.clear() ;
+}
+
+void Benchmark::startScene()
+{
+	// every scene starts from the same random sequence
+	RNDSEED( m_options.seed ) ;
+	Random::seed( m_options.seed ) ;
+
+	(this->*m_scenes[m_currentScene].build)() ;
+	m_sceneFrame = 0 ;
+
+	if( m_options.warmupFrames == 0 ) {
+		startMeasure() ;
+	}
+}
+
+void Benchmark::startMeasure()
+{
+	Profiler::clear() ;
+	m_stats.clear() ;
+	m_statsIndices.clear() ;
+	m_droppedEvents = 0 ;
+	s_allocations = 0 ;
+	s_allocatedBytes = 0 ;
+	s_frees = 0 ;
+	s_countAllocations = true ;
+	Profiler::start() ;
+	m_measureStartNs = GetSysTimer().getTimeNs() ;
+}
+
+void Benchmark::accumulateStats()
+{
+	// the aggregation allocates, it must not be counted as work of the scene
+	bool countAllocations = s_countAllocations.exchange( false ) ;
+
+	m_droppedEvents += Profiler::getNumOfDroppedEvents() ;
+	Profiler::getStats( m_frameStats ) ;
+	Profiler::clear() ;
+
+	for( const ProfileStats& fs : m_frameStats ) {
+		auto it = m_statsIndices.insert( std::make_pair( std::make_pair((int)fs.type, std::string(fs.name)), m_stats.size() ) ).first ;
+		if( it->second == m_stats.size() ) {
+			m_stats.push_back( fs ) ;
+			continue ;
+		}
+
+		ProfileStats& s = m_stats[it->second] ;
+		s.count += fs.count ;
+		s.total += fs.total ;
+		s.min = Min( s.min, fs.min ) ;
+		s.max = Max( s.max, fs.max ) ;
+	}
+
+	s_countAllocations = countAllocations ;
+}
+
+void Benchmark::endScene()
+{
+	uint64_t endNs = GetSysTimer().getTimeNs() ;
+	s_countAllocations = false ;
+	Profiler::stop() ;
+
+	BenchmarkResult result ;
+	result.name = m_scenes[m_currentScene].name ;
+	result.numOfNodes = countNodes( getScene() ) - 1 ;
+	result.frames = m_options.frames ;
+	result.wallNs = endNs - m_measureStartNs ;
+	result.allocations = s_allocations ;
+	result.allocatedBytes = s_allocatedBytes ;
+	result.frees = s_frees ;
+	result.droppedEvents = m_droppedEvents ;
+	result.stats = m_stats ;
+	// same order of Profiler::getStats()
+	std::sort( result.stats.begin(), result.stats.end(), []( const ProfileStats& a, const ProfileStats& b ) {
+		return a.type != b.type ? a.type < b.type : strcmp( a.name, b.name ) < 0 ;
+	} ) ;
+	m_results.push_back( result ) ;
+
+	Profiler::clear() ;
+
+	getScene()->destroy() ;
+	GetCollMgr().clearCollisions() ;
+	m_gems.clear() ;
+}
+
+Sprite* Benchmark::createGem( Node* pParent, int zOrder /*= 0*/ )
+{
+	Ref<Sprite> sprite( new Sprite() ) ;
+	sprite->setFrame( GetDrawItemMgr().getObject( "gemsheet_" + std::to_string( RND(BENCHMARK_NUM_OF_GEMS) ) ) ) ;
+	sprite->setPos( Vector2( RANGERANDF(-Draw3DManager::HalfOriginal3DWidth, Draw3DManager::HalfOriginal3DWidth),
+							 RANGERANDF(-Draw3DManager::HalfOriginal3DHeight, Draw3DManager::HalfOriginal3DHeight) ) ) ;
+	pParent->addChild( sprite, zOrder ) ;
+	return sprite.get() ;
+}
+
+/// Sprites rotating and moving back and forth, as in SpritesDemo
+void Benchmark::buildSprites()
+{
+	for( size_t i=0; i<BENCHMARK_SPRITES; i++ ) {
+		Sprite* pSprite = createGem( getScene() ) ;
+
+		RotateBy* actRotateBy = RotateBy::actionWithDuration( RANGERANDF(1,4), RND(2) ? 360.0f : -360.0f ) ;
+		pSprite->runAction( RepeatForever::actionWithAction(actRotateBy) ) ;
+
+		MoveBy* actMoveBy = MoveBy::actionWithDuration( RANGERANDF(1,3), Vector2(RANGERANDF(-200,200),RANGERANDF(-200,200)) ) ;
+		Sequence* actSequence = Sequence::actionOneTwo( actMoveBy, actMoveBy->reverse() ) ;
+		pSprite->runAction( RepeatForever::actionWithAction(actSequence) ) ;
+	}
+}
+
+/// Two sets of moving sprites colliding by their bounding boxes
+void Benchmark::buildCollisions()
+{
+	GetCollMgr().setCollisions( 1, 2, CollisionManager::Method::BoundingBox, 0 ) ;
+
+	for( size_t i=0; i<BENCHMARK_COLLIDERS; i++ ) {
+		Sprite* pSprite = createGem( getScene() ) ;
+		pSprite->setCollisionType( (i & 1) + 1 ) ;
+
+		MoveBy* actMoveBy = MoveBy::actionWithDuration( RANGERANDF(1,3), Vector2(RANGERANDF(-300,300),RANGERANDF(-300,300)) ) ;
+		Sequence* actSequence = Sequence::actionOneTwo( actMoveBy, actMoveBy->reverse() ) ;
+		pSprite->runAction( RepeatForever::actionWithAction(actSequence) ) ;
+	}
+}
+
+/// Layered sprites, as in TestSpritesZOrder, some of them are reordered every frame
+void Benchmark::buildZOrder()
+{
+	for( size_t l=0; l<BENCHMARK_ZORDER_LAYERS; l++ ) {
+		Ref<Layer> layer( new Layer() ) ;
+		getScene()->addChild( layer, (int)RND(16) - 8 ) ;
+		for( size_t i=0; i<BENCHMARK_ZORDER_SPRITES; i++ ) {
+			m_gems.push_back( createGem( layer, (int)RND(64) - 32 ) ) ;
+		}
+	}
+}
+
+void Benchmark::updateZOrder()
+{
+	for( size_t i=0; i<BENCHMARK_ZORDER_MOVES; i++ ) {
+		Sprite* pSprite = m_gems[ RND(m_gems.size()) ] ;
+		pSprite->getParent()->reorderChild( pSprite, (int)RND(64) - 32 ) ;
+	}
+}
+
+/// Short lived sprites, spawned every frame and destroyed by their own actions
+void Benchmark::buildSpawn()
+{
+}
+
+void Benchmark::updateSpawn()
+{
+	for( size_t i=0; i<BENCHMARK_SPAWN_PER_FRAME; i++ ) {
+		Sprite* pSprite = createGem( getScene() ) ;
+		MoveBy* actMoveBy = MoveBy::actionWithDuration( RANGERANDF(0.5f,2), Vector2(RANGERANDF(-300,300),RANGERANDF(-300,300)) ) ;
+		Sequence* actSequence = Sequence::actionOneTwo( actMoveBy, DestroyTarget::action(pSprite) ) ;
+		pSprite->runAction( actSequence ) ;
+	}
+}
+
+//*******************
+//
+// Results
+//
+//*******************
+
+static void writeStats( FILE* fp, const char* key, const std::vector<ProfileStats>& stats, ProfileStats::Type type )
+{
+	fprintf( fp, ",\n      \"%s\": [", key ) ;
+	bool first = true ;
+	for( const ProfileStats& s : stats ) {
+		if( s.type != type ) {
+			continue ;
+		}
+		fprintf( fp, "%s\n        {\"name\": \"%s\", \"count\": %llu, \"total\": %.17g, \"min\": %.17g, \"max\": %.17g, \"avg\": %.17g}",
+			first ? "" : ",", s.name, (unsigned long long)s.count, s.total, s.min, s.max, s.count ? s.total / s.count : 0.0 ) ;
+		first = false ;
+	}
+	fprintf( fp, "%s]", first ? "" : "\n      " ) ;
+}
+
+/**
+	Writes the results as JSON, zones durations are in nanoseconds.
+	A zone open when the measure starts or stops isn't recorded, so zones have to be compared by their averages
+*/
+bool Benchmark::writeResults() const
+{
+	FILE* fp = m_options.outFileName.empty() ? stdout : fopen( m_options.outFileName.c_str(), "wb" ) ;
+	if( !fp ) {
+		fprintf( stderr, "Cannot write %s\n", m_options.outFileName.c_str() ) ;
+		return false ;
+	}
+
+	fprintf( fp, "{\n  \"seed\": %u,\n  \"warmupFrames\": %llu,\n  \"frames\": %llu,\n  \"frameTimeNs\": %llu,\n  \"scenes\": [",
+		m_options.seed, (unsigned long long)m_options.warmupFrames, (unsigned long long)m_options.frames,
+		(unsigned long long)(getAnimationInterval() * 1e9 + 0.5) ) ;
+
+	for( size_t i=0; i<m_results.size(); i++ ) {
+		const BenchmarkResult& r = m_results[i] ;
+		fprintf( fp, "%s\n    {\n      \"name\": \"%s\",\n      \"nodes\": %llu,\n      \"frames\": %llu,\n      \"wallNs\": %llu,\n"
+					 "      \"allocations\": %llu,\n      \"allocatedBytes\": %llu,\n      \"frees\": %llu,\n      \"droppedEvents\": %llu",
+			i ? "," : "", r.name.c_str(), (unsigned long long)r.numOfNodes, (unsigned long long)r.frames, (unsigned long long)r.wallNs,
+			(unsigned long long)r.allocations, (unsigned long long)r.allocatedBytes, (unsigned long long)r.frees,
+			(unsigned long long)r.droppedEvents ) ;
+		writeStats( fp, "zones", r.stats, ProfileStats::Type::Zone ) ;
+		writeStats( fp, "gpuZones", r.stats, ProfileStats::Type::GpuZone ) ;
+		writeStats( fp, "counters", r.stats, ProfileStats::Type::Counter ) ;
+		fprintf( fp, "\n    }" ) ;
+	}
+	fprintf( fp, "%s]\n}\n", m_results.empty() ? "" : "\n  " ) ;
+
+	bool ok = (ferror(fp) == 0) && !m_scenes.empty() && m_results.size() == m_scenes.size() ;
+
+	// stats missing some events would compare a part of the run against a whole one
+	for( const BenchmarkResult& r : m_results ) {
+		if( r.droppedEvents > 0 ) {
+			fprintf( stderr, "Scene %s: %llu profiler events dropped, results are incomplete\n", r.name.c_str(), (unsigned long long)r.droppedEvents ) ;
+			ok = false ;
+		}
+	}
+	if( fp != stdout ) {
+		fclose( fp ) ;
+	}
+	return ok ;
+}
+
+static void printUsage()
+{
+	printf( "Usage: Benchmark [options]\n"
+			"  --seed <n>       random seed of the scenes (default 1)\n"
+			"  --warmup <n>     frames run before measuring every scene (default 60)\n"
+			"  --frames <n>     measured frames of every scene (default 600)\n"
+			"  --scene <name>   runs only the given scene: sprites, collisions, zorder, spawn\n"
+			"  --out <file>     writes the results to file instead of stdout\n"
+			"  --software       asks Mesa for software rendering, so results don't depend on the GPU\n"
+			"  --offscreen      uses the SDL offscreen video driver, no display is needed\n" ) ;
+}
+
+int main( int argc, char** argv ) 
+{
+	BenchmarkOptions options ;
+	options.seed = 1 ;
+	options.warmupFrames = 60 ;
+	options.frames = 600 ;
+
+	for( int i=1; i<argc; i++ ) {
+		const char* arg = argv[i] ;
+		const char* value = (i+1 < argc) ? argv[i+1] : nullptr ;
+		if( !strcmp(arg,"--software") ) {
+			SDL_setenv( "LIBGL_ALWAYS_SOFTWARE", "1", 1 ) ;
+		}
+		else if( !strcmp(arg,"--offscreen") ) {
+			SDL_setenv( "SDL_VIDEODRIVER", "offscreen", 1 ) ;
+		}
+		else if( value && !strcmp(arg,"--seed") ) {
+			options.seed = (unsigned int)strtoul( value, nullptr, 10 ) ; i++ ;
+		}
+		else if( value && !strcmp(arg,"--warmup") ) {
+			options.warmupFrames = strtoull( value, nullptr, 10 ) ; i++ ;
+		}
+		else if( value && !strcmp(arg,"--frames") ) {
+			options.frames = strtoull( value, nullptr, 10 ) ; i++ ;
+		}
+		else if( value && !strcmp(arg,"--scene") ) {
+			options.sceneName = value ; i++ ;
+		}
+		else if( value && !strcmp(arg,"--out") ) {
+			options.outFileName = value ; i++ ;
+		}
+		else {
+			printUsage() ;
+			return 2 ;
+		}
+	}
+
+	if( options.frames == 0 ) {
+		printUsage() ;
+		return 2 ;
+	}
+
+	bool ok = false ;
+	try {
+		Benchmark app( options ) ;
+		app.start() ;
+		ok = app.writeResults() ;
+	}
+	catch( std::exception& ex )	{
+		fprintf( stderr, "Exception thrown:\n%s\n", ex.what() ) ;
+	}
+	catch(...) {
+		fprintf( stderr, "Unknown exception thrown!\n" ) ;
+	}
+
+	return ok ? 0 : 1 ;
+}
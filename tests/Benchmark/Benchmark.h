@@ -0,0 +1,128 @@
+/**********************************************************************************
+* 
+* Benchmark.h
+* 
+* This file is part of Jam
+* 
+* Copyright (c) 2014-2019 Giovanni Zito.
+* Copyright (c) 2014-2019 Jam contributors (cf. AUTHORS.md)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* 
+**********************************************************************************/
+
+#ifndef __Benchmark_App_H__
+#define __Benchmark_App_H__
+
+#include <jam/Application.h>
+#include <jam/Profiler.h>
+#include <jam/Layer.h>
+#include <jam/Sprite.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+/**
+	Command line options of the benchmark
+*/
+struct BenchmarkOptions
+{
+	unsigned int			seed ;
+	uint64_t				warmupFrames ;		// frames run before measuring every scene
+	uint64_t				frames ;			// measured frames of every scene
+	std::string				sceneName ;			// runs only this scene when not empty
+	std::string				outFileName ;		// results are written to stdout when empty
+};
+
+/**
+	Results of a single scene
+*/
+struct BenchmarkResult
+{
+	std::string						name ;
+	size_t							numOfNodes ;
+	uint64_t						frames ;
+	uint64_t						wallNs ;
+	uint64_t						allocations ;
+	uint64_t						allocatedBytes ;
+	uint64_t						frees ;
+	size_t							droppedEvents ;	// profiler events lost, the stats are incomplete when not 0
+	std::vector<jam::ProfileStats>	stats ;
+};
+
+/**
+	Runs scripted scenes for a fixed number of frames, in a hidden window and with a fixed frame time,
+	and reports the profiler zones and counters, the allocations and the draw calls of every scene as JSON.
+
+	Every scene is built from the same seed, so two runs of the same build issue the same work
+*/
+class Benchmark : public jam::Application
+{
+public:
+	explicit				Benchmark( const BenchmarkOptions& options ) ;
+
+	bool					writeResults() const ;
+
+protected:
+	virtual bool			init() ;
+	virtual void			beforeSceneUpdate() ;
+	virtual void			exitFrame() ;
+	virtual void			destroy() ;
+
+private:
+	struct BenchmarkScene
+	{
+		const char*			name ;
+		void				(Benchmark::*build)() ;
+		void				(Benchmark::*update)() ;
+	};
+
+	void					startScene() ;
+	void					startMeasure() ;
+	void					accumulateStats() ;
+	void					endScene() ;
+
+	// scenes
+	void					buildSprites() ;
+	void					buildCollisions() ;
+	void					buildZOrder() ;
+	void					updateZOrder() ;
+	void					buildSpawn() ;
+	void					updateSpawn() ;
+
+	jam::Sprite*			createGem( jam::Node* pParent, int zOrder = 0 ) ;
+
+private:
+	BenchmarkOptions				m_options ;
+	std::vector<BenchmarkScene>		m_scenes ;
+	size_t							m_currentScene ;
+	uint64_t						m_sceneFrame ;
+	uint64_t						m_measureStartNs ;
+	std::vector<jam::ProfileStats>	m_stats ;			// stats of the measured frames of the current scene
+	std::map<std::pair<int,std::string>,size_t>	m_statsIndices ;	// (type,name) -> index in m_stats
+	std::vector<jam::ProfileStats>	m_frameStats ;
+	size_t							m_droppedEvents ;
+	std::vector<jam::Sprite*>		m_gems ;		// owned by the scene, only used by the scene which built them
+	std::vector<BenchmarkResult>	m_results ;
+};
+
+
+#endif // __Benchmark_App_H__